@@ -7,11 +7,20 @@
 #include <co_core.h>
 
 #include <BMSCANOpenMacros.hpp>
+#include <BalancingController.hpp>
 #include <BQSettingStorage.hpp>
+#include <ChannelStats.hpp>
 #include <EVT/dev/IWDG.hpp>
 #include <EVT/io/pin.hpp>
+#include <FaultLog.hpp>
+#include <I2CTransactionQueue.hpp>
 #include <ResetHandler.hpp>
+#include <Snapshot.hpp>
+#include <SocEstimator.hpp>
 #include <SystemDetect.hpp>
+#include <TPDOTrigger.hpp>
+#include <TelemetryRecorder.hpp>
+#include <TaskScheduler.hpp>
 #include <dev/Interlock.hpp>
 #include <dev/ThermistorMux.hpp>
 
@@ -74,6 +83,8 @@ public:
      *
      * @param bqSettingsStorage Object used to manage BQ settings storage
      * @param bq BQ chip instance
+     * @param i2cQueue Transaction queue of the BQ I2C bus, the periodic BQ
+     *                 reads are run through it
      * @param interlock GPIO used to check the interlock status
      * @param alarm GPIO used to check the BQ alarm status
      * @param systemDetect Object used to detect what system the BMS is connected to
@@ -81,7 +92,7 @@ public:
      * @param thermMux MUX for pack thermistors
      * @param resetHandler Handler for reset messages
      */
-    BMS(BQSettingsStorage& bqSettingsStorage, DEV::BQ76952 bq, DEV::Interlock& interlock,
+    BMS(BQSettingsStorage& bqSettingsStorage, DEV::BQ76952 bq, I2CTransactionQueue& i2cQueue, DEV::Interlock& interlock,
         IO::GPIO& alarm, SystemDetect& systemDetect, IO::GPIO& bmsOK,
         DEV::ThermistorMux& thermMux, ResetHandler& resetHandler, EVT::core::DEV::IWDG& iwdg);
 
@@ -124,12 +135,114 @@ public:
      */
     void process();
 
+    /**
+     * Get the current state of the BMS
+     *
+     * @return The current state
+     */
+    State getState();
+
+    /**
+     * Get the run time statistics of one of the periodic BMS tasks
+     *
+     * Useful for checking how much headroom is left in the main loop.
+     *
+     * @param[in] taskId ID of the task, one of the BMS::*_TASK values
+     * @return The statistics of the task
+     */
+    TaskScheduler::TaskStats getTaskStats(uint8_t taskId);
+
+    /**
+     * Get the TPDOs which should be sent now
+     *
+     * A TPDO should be sent when one of its values has moved past its
+     * deadband, or its state or error values have changed, since it was last
+     * reported. The caller is expected to trigger the returned TPDOs on the
+     * CANopen node, the stack then holds them back for the inhibit time.
+     * Unchanged TPDOs are still sent on the keep-alive timer.
+     *
+     * @return Mask with bit N set if TPDO N should be sent
+     */
+    uint8_t getTriggeredTPDOs();
+
+    /**
+     * Update the statistics of the queue of received CAN frames, exposed
+     * over CANopen so the size of the queue can be checked on the bike
+     *
+     * @param[in] highWaterMark Largest number of frames waiting at once
+     * @param[in] overflowCount Number of frames dropped because it was full
+     */
+    void setCANQueueStats(uint32_t highWaterMark, uint32_t overflowCount);
+
+    /** IDs of the periodic tasks run by the BMS, in order of registration */
+    static constexpr uint8_t CURRENT_TASK = 0;
+    static constexpr uint8_t CELL_VOLTAGE_TASK = 1;
+    static constexpr uint8_t BQ_STATUS_TASK = 2;
+    static constexpr uint8_t BQ_TEMP_TASK = 3;
+    static constexpr uint8_t THERMISTOR_TASK = 4;
+    static constexpr uint8_t TELEMETRY_RECORD_TASK = 5;
+    static constexpr uint8_t BALANCING_TASK = 6;
+    /** Number of periodic tasks run by the BMS */
+    static constexpr uint8_t NUM_TASKS = 7;
+
 private:
     /**
      * Have to know the size of the object dictionary for initialization
      * process.
      */
-    static constexpr uint16_t OBJECT_DICTIONARY_SIZE = 142;
+    static constexpr uint16_t OBJECT_DICTIONARY_SIZE = 177;
+
+    /**
+     * Object dictionary index of the per cell balancing control
+     */
+    static constexpr uint16_t BALANCING_INDEX = 0x2107;
+
+    /**
+     * Object dictionary index of the state of charge data
+     */
+    static constexpr uint16_t SOC_DATA_INDEX = 0x2110;
+
+    /**
+     * Object dictionary index of the received CAN frame queue statistics
+     */
+    static constexpr uint16_t CAN_QUEUE_STATS_INDEX = 0x2111;
+
+    /**
+     * Object dictionary index of the telemetry log
+     */
+    static constexpr uint16_t TELEMETRY_LOG_INDEX = 0x2112;
+
+    /**
+     * Object dictionary index of the fault log
+     */
+    static constexpr uint16_t FAULT_LOG_INDEX = 0x2113;
+
+    /**
+     * Object dictionary index of the BQ settings image download
+     */
+    static constexpr uint16_t BQ_SETTINGS_INDEX = 0x2114;
+
+    /**
+     * Capacity of the battery pack in mAh
+     */
+    static constexpr uint32_t PACK_CAPACITY = 20000;
+
+    /**
+     * Minimum time between two sends of the same TPDO, in 100us units
+     */
+    static constexpr uint16_t TPDO_INHIBIT_TIME = 100;
+
+    /**
+     * Period in ms at which TPDOs are sent when their values do not change
+     */
+    static constexpr uint16_t TPDO_KEEP_ALIVE = 5000;
+
+    /** Change in TPDO values which triggers the TPDO to be sent */
+    static constexpr uint16_t CELL_VOLTAGE_DEADBAND = 10;
+    static constexpr uint16_t PACK_VOLTAGE_DEADBAND = 10;
+    static constexpr uint16_t CURRENT_DEADBAND = 500;
+    static constexpr uint16_t TEMP_DEADBAND = 1;
+    static constexpr uint16_t SOC_DEADBAND = 10;
 
     /**
      * The active state of the alarm. When the alarm is in this state,
@@ -161,12 +274,6 @@ private:
      */
     static constexpr uint32_t ERROR_TIME_DELAY = 5000;
 
-    /**
-     * Maximum number of attempts to read a safe thermistor temperature before
-     * throwing an error
-     */
-    static constexpr uint8_t MAX_THERM_READ_ATTEMPTS = 3;
-
     /**
      * Maximum thermistor temperature considered safe
      */
@@ -177,6 +284,68 @@ private:
      */
     static constexpr uint8_t NUM_THERMISTORS = 6;
 
+    /**
+     * Value of thermistorsRead once every thermistor has been read
+     */
+    static constexpr uint8_t ALL_THERMISTORS_READ = (1 << NUM_THERMISTORS) - 1;
+
+    /**
+     * Periods in milliseconds of the periodic BMS tasks
+     */
+    static constexpr uint32_t CURRENT_PERIOD = 10;
+    static constexpr uint32_t CELL_VOLTAGE_PERIOD = 20;
+    static constexpr uint32_t BQ_STATUS_PERIOD = 100;
+    static constexpr uint32_t BQ_TEMP_PERIOD = 500;
+    /**
+     * The thermistor task only advances the non-blocking MUX read, so it is
+     * polled often. A full scan of the pack still takes several settling
+     * times.
+     */
+    static constexpr uint32_t THERMISTOR_PERIOD = 10;
+    /**
+     * Samples are recorded as often as the cell voltages are read
+     */
+    static constexpr uint32_t TELEMETRY_RECORD_PERIOD = CELL_VOLTAGE_PERIOD;
+    /**
+     * The cells being balanced take turns once per period
+     */
+    static constexpr uint32_t BALANCING_PERIOD = 1000;
+
+    /**
+     * Task mask for states where the BQ can not be trusted and only the
+     * thermistors are read
+     */
+    static constexpr uint32_t THERMISTOR_ONLY_TASKS = TaskScheduler::taskMask(THERMISTOR_TASK);
+
+    /**
+     * Values the BMS reports over CANopen, published together
+     *
+     * @var batteryVoltage Total voltage of the battery
+     * @var voltageInfo Minimum and maximum cell voltages and their IDs
+     * @var current Total current through the battery
+     * @var packTempInfo Minimum and maximum thermistor temperatures and their IDs
+     * @var bqTempInfo Temperatures measured by the BQ
+     * @var state Current state of the BMS
+     * @var thermistorTemperature Per-thermistor temperature of the pack
+     * @var errorRegister Errors which have occurred on the BMS
+     * @var bqStatus Status information pulled from the BQ
+     * @var cellVoltage Per-cell voltage of the pack
+     * @var stateOfCharge Estimated state of charge of the pack in units of 0.01%
+     */
+    struct Telemetry {
+        uint16_t batteryVoltage;
+        CellVoltageInfo voltageInfo;
+        int16_t current;
+        PackTempInfo packTempInfo;
+        BqTempInfo bqTempInfo;
+        uint8_t state;
+        uint8_t thermistorTemperature[NUM_THERMISTORS];
+        uint8_t errorRegister;
+        uint8_t bqStatus[7];
+        uint16_t cellVoltage[DEV::BQ76952::NUM_CELLS];
+        uint16_t stateOfCharge;
+    };
+
     /**
      * The interface for storing and retrieving BQ Settings
      */
@@ -187,6 +356,11 @@ private:
      */
     DEV::BQ76952 bq;
 
+    /**
+     * Transaction queue of the BQ I2C bus
+     */
+    I2CTransactionQueue& i2cQueue;
+
     /**
      * The current state of the BMS
      */
@@ -233,6 +407,26 @@ private:
      */
     EVT::core::DEV::IWDG& iwdg;
 
+    /**
+     * Estimates the state of charge of the pack from the measured current
+     */
+    SocEstimator socEstimator;
+
+    /**
+     * Journal of fault events, kept in EEPROM across resets
+     */
+    FaultLog faultLog;
+
+    /**
+     * Decides when the event driven TPDOs are sent
+     */
+    TPDOTrigger tpdoTrigger;
+
+    /**
+     * Scheduler which runs the periodic data acquisition tasks
+     */
+    TaskScheduler scheduler;
+
     /**
      * Boolean flag which represents that a state has just changed
      *
@@ -247,12 +441,6 @@ private:
      */
     uint8_t numBqAttemptsMade = 0;
 
-    /**
-     * Utility variable that tracks the number of attempts made to read safe
-     * thermistor temperatures
-     */
-    uint8_t numThermAttemptsMade = 0;
-
     /**
      * Keeps track of the last time an attempt was made to communicate with the
      * BQ chip
@@ -263,89 +451,116 @@ private:
     uint32_t lastBqAttemptTime = 0;
 
     /**
-     * Keeps track of the last time an attempt was made to read safe thermistor
-     * temperatures
+     * Number of failed BQ operations in a row of each periodic task, indexed
+     * by the BMS::*_TASK IDs
      *
-     * This is used in combination with BMS::numThermAttemptsMade to read
-     * thermistor temperatures a certain number of times with delay in attempts
+     * Each task counts its own failures, so a task whose reads succeed does
+     * not hide another task whose reads fail every time.
      */
-    uint32_t lastThermAttemptTime = 0;
+    uint8_t numBqTaskFailures[NUM_TASKS] = {};
+
+    /**
+     * Time of the last failed BQ operation of each periodic task, the task
+     * waits ERROR_TIME_DELAY before trying again
+     */
+    uint32_t lastBqTaskFailureTime[NUM_TASKS] = {};
 
     /**
      * Represents the total voltage read by the BQ chip
      *
-     * This value is updated by reading the voltage from the BQ chip and is then
-     * exposed over CANopen.
+     * This value is the sum of the cell voltages, used for the state of
+     * charge estimate.
      */
     uint32_t totalVoltage = 0;
 
     /**
-     * Represents the total voltage in the battery
+     * Values reported over CANopen. The tasks fill the working copy, which is
+     * published once per call to process(), and the object dictionary and TPDO
+     * trigger only look at the published copy.
      */
-    uint16_t batteryVoltage = 0;
+    Snapshot<Telemetry> telemetry;
 
     /**
-     * Represents the total current through the battery
+     * Minimum and maximum of the thermistor temperatures, updated as each
+     * thermistor is read
      */
-    int16_t current = 0;
+    ChannelStats<uint8_t, NUM_THERMISTORS> thermistorStats;
 
     /**
-     * Stores the per-thermistor temperature for the battery pack
+     * Log of the telemetry over the last few seconds, frozen on a fault
      */
-    uint8_t thermistorTemperature[NUM_THERMISTORS] = {};
+    TelemetryRecorder telemetryRecorder;
 
     /**
-     * Stores important information about pack thermistor temperatures
+     * Decides which cells are balanced
      */
-    PackTempInfo packTempInfo{
-        .minPackTemp = 0,
-        .minPackTempId = 0,
-        .maxPackTemp = 0,
-        .maxPackTempId = 0,
-    };
+    BalancingController balancingController;
 
     /**
-     * Stores temperature information measured by the BQ
+     * Cells being balanced by the BQ, bit N for cell N + 1. Refreshed from
+     * the BQ every balancing period and reported over CANopen.
      */
-    BqTempInfo bqTempInfo{
-        .internalTemp = 0,
-        .temp1 = 0,
-        .temp2 = 0,
-    };
+    uint16_t balancingMask = 0;
 
     /**
-     * Stores the per-cell voltage for the battery pack. This value is updated
-     * by reading the voltage from the BQ chip and is then exposed over
-     * CANopen.
+     * Set while the balancing controller decides which cells are balanced,
+     * cleared by writing to a cell over CANopen
      */
-    uint16_t cellVoltage[DEV::BQ76952::NUM_CELLS] = {};
+    uint8_t automaticBalancing = 1;
 
     /**
-     * Used to store values which the BMS updates.
-     * Holds information about the minimum and maximum cell's voltages and Ids.
+     * Cells to balance while automaticBalancing is cleared, bit N for cell
+     * N + 1. Written over CANopen and applied on the next balancing period.
      */
-    CellVoltageInfo voltageInfo{
-        .minCellVoltage = 0,
-        .minCellVoltageId = 0,
-        .maxCellVoltage = 0,
-        .maxCellVoltageId = 0,
-    };
+    uint16_t manualBalancingMask = 0;
 
     /**
-     * Array that stores status information pulled from the BQ
+     * CANopen interface of the per cell balancing entries
      */
-    uint8_t bqStatusArr[7] = {};
+    CO_OBJ_TYPE balancingCANOpen = {
+        balancingCANOpenSize,
+        balancingCANOpenCtrl,
+        balancingCANOpenRead,
+        balancingCANOpenWrite,
+    };
 
     /**
      * Value representing what errors have occurred on the BMS
      */
     uint8_t errorRegister = 0;
 
+    /**
+     * Errors already written to the fault log, so each fault is logged once
+     * when its bit is first set
+     */
+    uint8_t loggedErrors = 0;
+
     /**
      * Value that tracks the ID of the last thermistor that was read
      */
     uint8_t lastCheckedThermNum = -1;
 
+    /**
+     * Bit per thermistor, set once it has been read since the BMS started
+     */
+    uint8_t thermistorsRead = 0;
+
+    /**
+     * Whether the published pack temperatures cover every thermistor, until
+     * then the maximum may be missing a hot thermistor
+     */
+    bool packTempsComplete = false;
+
+    /**
+     * Largest number of received CAN frames waiting to be processed at once
+     */
+    uint32_t canQueueHighWaterMark = 0;
+
+    /**
+     * Number of received CAN frames dropped because the queue was full
+     */
+    uint32_t canQueueOverflowCount = 0;
+
     /**
      * Handle the start of the state machine logic
      *
@@ -422,8 +637,9 @@ private:
     /**
      * Update the local voltage variables with the values from the BQ chip
      *
-     * This will iterate over all the values of interest and update them. These
-     * values will then be able to be read over CANopen.
+     * This will submit the reads of all the values of interest and wait for
+     * them to be collected. These values will then be able to be read over
+     * CANopen.
      *
      * This should be called when in a state where the BQ is ready and able
      * to read voltage. In other states, a call to this function should not
@@ -431,12 +647,135 @@ private:
      */
     void updateBQData();
 
+    /**
+     * Submit a read of the cell voltages from the BQ chip
+     */
+    void updateCellVoltages();
+
+    /**
+     * Submit a read of the pack current from the BQ chip
+     */
+    void updateCurrent();
+
+    /**
+     * Integrate the latest current reading into the state of charge estimate
+     */
+    void updateStateOfCharge();
+
+    /**
+     * Submit a read of the BQ status registers and the total pack voltage
+     */
+    void updateBQStatus();
+
+    /**
+     * Submit a read of the temperatures measured by the BQ chip
+     */
+    void updateBQTemps();
+
+    /**
+     * Submit a periodic BQ read, unless a failed BQ operation of the task is
+     * still waiting out the retry delay
+     *
+     * @param[in] taskId The task making the read, one of the BMS::*_TASK values
+     * @param[in] read The read to submit
+     * @param[in] callback Collects the read once it completes
+     */
+    void submitBQRead(uint8_t taskId, DEV::BQ76952::DataRead read, I2CTransactionQueue::Callback callback);
+
+    /**
+     * Completion callbacks of the periodic BQ reads, these collect the
+     * results
+     *
+     * @param[in] status Result of the transaction, checked when collecting
+     * @param[in] priv The BMS instance
+     */
+    static void cellVoltageReadComplete(I2CTransactionQueue::Status status, void* priv);
+    static void currentReadComplete(I2CTransactionQueue::Status status, void* priv);
+    static void bqStatusReadComplete(I2CTransactionQueue::Status status, void* priv);
+    static void bqTempReadComplete(I2CTransactionQueue::Status status, void* priv);
+    static void balancingReadComplete(I2CTransactionQueue::Status status, void* priv);
+
+    /**
+     * Check if a failed BQ operation of a task is still waiting out the
+     * retry delay
+     *
+     * @param[in] taskId The task, one of the BMS::*_TASK values
+     * @return True if BQ communication of the task should be skipped for now
+     */
+    bool isBQRetryPending(uint8_t taskId);
+
+    /**
+     * Handle the result of a BQ operation of a task, tracking the failed
+     * attempts of the task and setting the error register once the maximum
+     * number of attempts has been reached
+     *
+     * @param[in] taskId The task, one of the BMS::*_TASK values
+     * @param[in] result The result of the BQ operation
+     */
+    void handleBQResult(uint8_t taskId, DEV::BQ76952::Status result);
+
+    /**
+     * Scheduler entry points for the periodic tasks
+     *
+     * @param[in] priv The BMS instance
+     */
+    static void currentTask(void* priv);
+    static void cellVoltageTask(void* priv);
+    static void bqStatusTask(void* priv);
+    static void bqTempTask(void* priv);
+    static void thermistorTask(void* priv);
+    static void telemetryRecordTask(void* priv);
+    static void balancingTask(void* priv);
+
     /**
      * Read one thermistor value and report an over-temperature error if
      * necessary
      */
     void updateThermistorReading();
 
+    /**
+     * Add the telemetry to the telemetry log
+     *
+     * @param[in] data The telemetry to record
+     */
+    void recordTelemetry(const Telemetry& data);
+
+    /**
+     * Balance the cells while the BMS is in SYSTEM_READY or CHARGING, and
+     * stop balancing in any other state
+     *
+     * The cells are picked by the balancing controller, or taken from
+     * manualBalancingMask while automaticBalancing is cleared.
+     */
+    void updateBalancing();
+
+    /**
+     * Write the cells to balance to the BQ, if they changed
+     *
+     * @param[in] mask Mask with bit N set to balance cell N + 1
+     */
+    void setBalancingMask(uint16_t mask);
+
+    /**
+     * Write a fault event to the fault log
+     *
+     * @param[in] data The telemetry when the fault happened
+     */
+    void logFault(const Telemetry& data);
+
+    /**
+     * CANopen interface of the per cell balancing entries, the cell is the
+     * sub index of the entry and obj->Data points to the BMS
+     *
+     * Reads are served from balancingMask without touching the bus. Writes
+     * only update manualBalancingMask, so any number of cells written in one
+     * period go out to the BQ in a single RAM write.
+     */
+    static uint32_t balancingCANOpenSize(CO_OBJ_T* obj, CO_NODE_T* node, uint32_t width);
+    static CO_ERR balancingCANOpenCtrl(CO_OBJ_T* obj, CO_NODE_T* node, uint16_t func, uint32_t para);
+    static CO_ERR balancingCANOpenRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len);
+    static CO_ERR balancingCANOpenWrite(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len);
+
     /**
      * Clear the local voltage values (set to 0)
      *
@@ -447,6 +786,12 @@ private:
      */
     void clearVoltageReadings();
 
+    /**
+     * Publish the working copy of the telemetry, along with the current state
+     * and error register, to the object dictionary
+     */
+    void publishTelemetry();
+
     /**
      * The object dictionary of the BMS
      *
@@ -460,13 +805,14 @@ private:
         SDO_CONFIGURATION_1200,
 
         // TPDO Settings
-        TRANSMIT_PDO_SETTINGS_OBJECT_18XX(0, TRANSMIT_PDO_TRIGGER_TIMER, 0, 1000),
-        TRANSMIT_PDO_SETTINGS_OBJECT_18XX(1, TRANSMIT_PDO_TRIGGER_TIMER, 0, 1000),
-        TRANSMIT_PDO_SETTINGS_OBJECT_18XX(2, TRANSMIT_PDO_TRIGGER_TIMER, 0, 1000),
-        TRANSMIT_PDO_SETTINGS_OBJECT_18XX(3, TRANSMIT_PDO_TRIGGER_TIMER, 0, 1000),
-        EXTRA_TRANSMIT_PDO_SETTINGS_OBJECT_18XX(4, TRANSMIT_PDO_TRIGGER_TIMER, 0, 1000),
-        EXTRA_TRANSMIT_PDO_SETTINGS_OBJECT_18XX(5, TRANSMIT_PDO_TRIGGER_TIMER, 0, 1000),
-        EXTRA_TRANSMIT_PDO_SETTINGS_OBJECT_18XX(6, TRANSMIT_PDO_TRIGGER_TIMER, 0, 1000),
+        TRANSMIT_PDO_SETTINGS_OBJECT_18XX(0, TRANSMIT_PDO_TRIGGER_TIMER, TPDO_INHIBIT_TIME, TPDO_KEEP_ALIVE),
+        TRANSMIT_PDO_SETTINGS_OBJECT_18XX(1, TRANSMIT_PDO_TRIGGER_TIMER, TPDO_INHIBIT_TIME, TPDO_KEEP_ALIVE),
+        TRANSMIT_PDO_SETTINGS_OBJECT_18XX(2, TRANSMIT_PDO_TRIGGER_TIMER, TPDO_INHIBIT_TIME, TPDO_KEEP_ALIVE),
+        TRANSMIT_PDO_SETTINGS_OBJECT_18XX(3, TRANSMIT_PDO_TRIGGER_TIMER, TPDO_INHIBIT_TIME, TPDO_KEEP_ALIVE),
+        EXTRA_TRANSMIT_PDO_SETTINGS_OBJECT_18XX(4, TRANSMIT_PDO_TRIGGER_TIMER, TPDO_INHIBIT_TIME, TPDO_KEEP_ALIVE),
+        EXTRA_TRANSMIT_PDO_SETTINGS_OBJECT_18XX(5, TRANSMIT_PDO_TRIGGER_TIMER, TPDO_INHIBIT_TIME, TPDO_KEEP_ALIVE),
+        EXTRA_TRANSMIT_PDO_SETTINGS_OBJECT_18XX(6, TRANSMIT_PDO_TRIGGER_TIMER, TPDO_INHIBIT_TIME, TPDO_KEEP_ALIVE),
+        EXTRA_TRANSMIT_PDO_SETTINGS_OBJECT_18XX(7, TRANSMIT_PDO_TRIGGER_TIMER, TPDO_INHIBIT_TIME, TPDO_KEEP_ALIVE),
 
         // TPDO Mappings
         // TPDO0
@@ -501,13 +847,13 @@ private:
         // TPDO3
         TRANSMIT_PDO_MAPPING_START_KEY_1AXX(3, 8),
         TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 1, PDO_MAPPING_UNSIGNED8),//errorRegister
-        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 2, PDO_MAPPING_UNSIGNED8),//bqStatusArr[0]
-        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 3, PDO_MAPPING_UNSIGNED8),//bqStatusArr[1]
-        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 4, PDO_MAPPING_UNSIGNED8),//bqStatusArr[2]
-        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 5, PDO_MAPPING_UNSIGNED8),//bqStatusArr[3]
-        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 6, PDO_MAPPING_UNSIGNED8),//bqStatusArr[4]
-        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 7, PDO_MAPPING_UNSIGNED8),//bqStatusArr[5]
-        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 8, PDO_MAPPING_UNSIGNED8),//bqStatusArr[6]
+        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 2, PDO_MAPPING_UNSIGNED8),//bqStatus[0]
+        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 3, PDO_MAPPING_UNSIGNED8),//bqStatus[1]
+        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 4, PDO_MAPPING_UNSIGNED8),//bqStatus[2]
+        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 5, PDO_MAPPING_UNSIGNED8),//bqStatus[3]
+        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 6, PDO_MAPPING_UNSIGNED8),//bqStatus[4]
+        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 7, PDO_MAPPING_UNSIGNED8),//bqStatus[5]
+        TRANSMIT_PDO_MAPPING_ENTRY_1AXX(3, 8, PDO_MAPPING_UNSIGNED8),//bqStatus[6]
 
         // TPDO4
         TRANSMIT_PDO_MAPPING_START_KEY_1AXX(4, 4),
@@ -530,134 +876,177 @@ private:
         TRANSMIT_PDO_MAPPING_ENTRY_1AXX(6, 3, PDO_MAPPING_UNSIGNED16),//cellVoltage[10]
         TRANSMIT_PDO_MAPPING_ENTRY_1AXX(6, 4, PDO_MAPPING_UNSIGNED16),//cellVoltage[11]
 
+        // TPDO7
+        TRANSMIT_PDO_MAPPING_START_KEY_1AXX(7, 1),
+        TRANSMIT_PDO_MAPPING_LINK_ENTRY_1AXX(7, 1, SOC_DATA_INDEX, PDO_MAPPING_UNSIGNED16),//stateOfCharge
+
         // Data Links
         // TPDO0
         DATA_LINK_START_KEY_21XX(0, 5),
-        DATA_LINK_21XX(0, 1, CO_TSIGNED16, &batteryVoltage),
-        DATA_LINK_21XX(0, 2, CO_TSIGNED16, &voltageInfo.minCellVoltage),
-        DATA_LINK_21XX(0, 3, CO_TUNSIGNED8, &voltageInfo.minCellVoltageId),
-        DATA_LINK_21XX(0, 4, CO_TSIGNED16, &voltageInfo.maxCellVoltage),
-        DATA_LINK_21XX(0, 5, CO_TUNSIGNED8, &voltageInfo.maxCellVoltageId),
+        DATA_LINK_21XX(0, 1, CO_TSIGNED16, &telemetry.published().batteryVoltage),
+        DATA_LINK_21XX(0, 2, CO_TSIGNED16, &telemetry.published().voltageInfo.minCellVoltage),
+        DATA_LINK_21XX(0, 3, CO_TUNSIGNED8, &telemetry.published().voltageInfo.minCellVoltageId),
+        DATA_LINK_21XX(0, 4, CO_TSIGNED16, &telemetry.published().voltageInfo.maxCellVoltage),
+        DATA_LINK_21XX(0, 5, CO_TUNSIGNED8, &telemetry.published().voltageInfo.maxCellVoltageId),
 
         // TPDO1
         DATA_LINK_START_KEY_21XX(1, 7),
-        DATA_LINK_21XX(1, 1, CO_TSIGNED16, &current),
-        DATA_LINK_21XX(1, 2, CO_TUNSIGNED8, &packTempInfo.minPackTemp),
-        DATA_LINK_21XX(1, 3, CO_TUNSIGNED8, &packTempInfo.minPackTempId),
-        DATA_LINK_21XX(1, 4, CO_TUNSIGNED8, &packTempInfo.maxPackTemp),
-        DATA_LINK_21XX(1, 5, CO_TUNSIGNED8, &packTempInfo.maxPackTempId),
-        DATA_LINK_21XX(1, 6, CO_TUNSIGNED8, &bqTempInfo.internalTemp),
-        DATA_LINK_21XX(1, 7, CO_TUNSIGNED8, &state),
+        DATA_LINK_21XX(1, 1, CO_TSIGNED16, &telemetry.published().current),
+        DATA_LINK_21XX(1, 2, CO_TUNSIGNED8, &telemetry.published().packTempInfo.minPackTemp),
+        DATA_LINK_21XX(1, 3, CO_TUNSIGNED8, &telemetry.published().packTempInfo.minPackTempId),
+        DATA_LINK_21XX(1, 4, CO_TUNSIGNED8, &telemetry.published().packTempInfo.maxPackTemp),
+        DATA_LINK_21XX(1, 5, CO_TUNSIGNED8, &telemetry.published().packTempInfo.maxPackTempId),
+        DATA_LINK_21XX(1, 6, CO_TUNSIGNED8, &telemetry.published().bqTempInfo.internalTemp),
+        DATA_LINK_21XX(1, 7, CO_TUNSIGNED8, &telemetry.published().state),
 
         // TPDO2
         DATA_LINK_START_KEY_21XX(2, 8),
-        DATA_LINK_21XX(2, 1, CO_TUNSIGNED8, &thermistorTemperature[0]),
-        DATA_LINK_21XX(2, 2, CO_TUNSIGNED8, &thermistorTemperature[1]),
-        DATA_LINK_21XX(2, 3, CO_TUNSIGNED8, &thermistorTemperature[2]),
-        DATA_LINK_21XX(2, 4, CO_TUNSIGNED8, &thermistorTemperature[3]),
-        DATA_LINK_21XX(2, 5, CO_TUNSIGNED8, &thermistorTemperature[4]),
-        DATA_LINK_21XX(2, 6, CO_TUNSIGNED8, &thermistorTemperature[5]),
-        DATA_LINK_21XX(2, 7, CO_TUNSIGNED8, &bqTempInfo.temp1),
-        DATA_LINK_21XX(2, 8, CO_TUNSIGNED8, &bqTempInfo.temp2),
+        DATA_LINK_21XX(2, 1, CO_TUNSIGNED8, &telemetry.published().thermistorTemperature[0]),
+        DATA_LINK_21XX(2, 2, CO_TUNSIGNED8, &telemetry.published().thermistorTemperature[1]),
+        DATA_LINK_21XX(2, 3, CO_TUNSIGNED8, &telemetry.published().thermistorTemperature[2]),
+        DATA_LINK_21XX(2, 4, CO_TUNSIGNED8, &telemetry.published().thermistorTemperature[3]),
+        DATA_LINK_21XX(2, 5, CO_TUNSIGNED8, &telemetry.published().thermistorTemperature[4]),
+        DATA_LINK_21XX(2, 6, CO_TUNSIGNED8, &telemetry.published().thermistorTemperature[5]),
+        DATA_LINK_21XX(2, 7, CO_TUNSIGNED8, &telemetry.published().bqTempInfo.temp1),
+        DATA_LINK_21XX(2, 8, CO_TUNSIGNED8, &telemetry.published().bqTempInfo.temp2),
 
         // TPDO3
         DATA_LINK_START_KEY_21XX(3, 8),
-        DATA_LINK_21XX(3, 1, CO_TUNSIGNED8, &errorRegister),
-        DATA_LINK_21XX(3, 2, CO_TUNSIGNED8, &bqStatusArr[0]),
-        DATA_LINK_21XX(3, 3, CO_TUNSIGNED8, &bqStatusArr[1]),
-        DATA_LINK_21XX(3, 4, CO_TUNSIGNED8, &bqStatusArr[2]),
-        DATA_LINK_21XX(3, 5, CO_TUNSIGNED8, &bqStatusArr[3]),
-        DATA_LINK_21XX(3, 6, CO_TUNSIGNED8, &bqStatusArr[4]),
-        DATA_LINK_21XX(3, 7, CO_TUNSIGNED8, &bqStatusArr[5]),
-        DATA_LINK_21XX(3, 8, CO_TUNSIGNED8, &bqStatusArr[6]),
+        DATA_LINK_21XX(3, 1, CO_TUNSIGNED8, &telemetry.published().errorRegister),
+        DATA_LINK_21XX(3, 2, CO_TUNSIGNED8, &telemetry.published().bqStatus[0]),
+        DATA_LINK_21XX(3, 3, CO_TUNSIGNED8, &telemetry.published().bqStatus[1]),
+        DATA_LINK_21XX(3, 4, CO_TUNSIGNED8, &telemetry.published().bqStatus[2]),
+        DATA_LINK_21XX(3, 5, CO_TUNSIGNED8, &telemetry.published().bqStatus[3]),
+        DATA_LINK_21XX(3, 6, CO_TUNSIGNED8, &telemetry.published().bqStatus[4]),
+        DATA_LINK_21XX(3, 7, CO_TUNSIGNED8, &telemetry.published().bqStatus[5]),
+        DATA_LINK_21XX(3, 8, CO_TUNSIGNED8, &telemetry.published().bqStatus[6]),
 
         // TPDO4
         DATA_LINK_START_KEY_21XX(4, 4),
-        DATA_LINK_21XX(4, 1, CO_TUNSIGNED16, &cellVoltage[0]),
-        DATA_LINK_21XX(4, 2, CO_TUNSIGNED16, &cellVoltage[1]),
-        DATA_LINK_21XX(4, 3, CO_TUNSIGNED16, &cellVoltage[2]),
-        DATA_LINK_21XX(4, 4, CO_TUNSIGNED16, &cellVoltage[3]),
+        DATA_LINK_21XX(4, 1, CO_TUNSIGNED16, &telemetry.published().cellVoltage[0]),
+        DATA_LINK_21XX(4, 2, CO_TUNSIGNED16, &telemetry.published().cellVoltage[1]),
+        DATA_LINK_21XX(4, 3, CO_TUNSIGNED16, &telemetry.published().cellVoltage[2]),
+        DATA_LINK_21XX(4, 4, CO_TUNSIGNED16, &telemetry.published().cellVoltage[3]),
 
         // TPDO5
         DATA_LINK_START_KEY_21XX(5, 4),
-        DATA_LINK_21XX(5, 1, CO_TUNSIGNED16, &cellVoltage[4]),
-        DATA_LINK_21XX(5, 2, CO_TUNSIGNED16, &cellVoltage[5]),
-        DATA_LINK_21XX(5, 3, CO_TUNSIGNED16, &cellVoltage[6]),
-        DATA_LINK_21XX(5, 4, CO_TUNSIGNED16, &cellVoltage[7]),
+        DATA_LINK_21XX(5, 1, CO_TUNSIGNED16, &telemetry.published().cellVoltage[4]),
+        DATA_LINK_21XX(5, 2, CO_TUNSIGNED16, &telemetry.published().cellVoltage[5]),
+        DATA_LINK_21XX(5, 3, CO_TUNSIGNED16, &telemetry.published().cellVoltage[6]),
+        DATA_LINK_21XX(5, 4, CO_TUNSIGNED16, &telemetry.published().cellVoltage[7]),
 
         // TPDO6
         DATA_LINK_START_KEY_21XX(6, 4),
-        DATA_LINK_21XX(6, 1, CO_TUNSIGNED16, &cellVoltage[8]),
-        DATA_LINK_21XX(6, 2, CO_TUNSIGNED16, &cellVoltage[9]),
-        DATA_LINK_21XX(6, 3, CO_TUNSIGNED16, &cellVoltage[10]),
-        DATA_LINK_21XX(6, 4, CO_TUNSIGNED16, &cellVoltage[11]),
-        //TODO: Update SDOs to work with CANopen stack updates
-        /*
-        /// Expose information on the balancing of the target cells. Per
-        /// cell ability to poll if the cell is balancing and write out
-        /// balancing control.
+        DATA_LINK_21XX(6, 1, CO_TUNSIGNED16, &telemetry.published().cellVoltage[8]),
+        DATA_LINK_21XX(6, 2, CO_TUNSIGNED16, &telemetry.published().cellVoltage[9]),
+        DATA_LINK_21XX(6, 3, CO_TUNSIGNED16, &telemetry.published().cellVoltage[10]),
+        DATA_LINK_21XX(6, 4, CO_TUNSIGNED16, &telemetry.published().cellVoltage[11]),
+
+        // Balancing, reading a cell reports whether the BQ is balancing it and
+        // writing one switches from the balancing controller to the written
+        // cells, until automatic balancing is set again
+        BMS_DATA_START_KEY(BALANCING_INDEX, 13),
         {
-            .Key = CO_KEY(0x2107, 1, CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 1,
+            .Key = CO_KEY(BALANCING_INDEX, 1, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
         {
-            .Key = CO_KEY(0x2107, 2,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 2,
+            .Key = CO_KEY(BALANCING_INDEX, 2, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
         {
-            .Key = CO_KEY(0x2107, 3,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 3,
+            .Key = CO_KEY(BALANCING_INDEX, 3, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
         {
-            .Key = CO_KEY(0x2107, 4,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 4,
+            .Key = CO_KEY(BALANCING_INDEX, 4, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
+        },
+        {
+            .Key = CO_KEY(BALANCING_INDEX, 5, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
-
         {
-            .Key = CO_KEY(0x2107, 5,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 5,
+            .Key = CO_KEY(BALANCING_INDEX, 6, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
         {
-            .Key = CO_KEY(0x2107, 6,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 6,
+            .Key = CO_KEY(BALANCING_INDEX, 7, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
         {
-            .Key = CO_KEY(0x2107, 7,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 7,
+            .Key = CO_KEY(BALANCING_INDEX, 8, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
         {
-            .Key = CO_KEY(0x2107, 8,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 8,
+            .Key = CO_KEY(BALANCING_INDEX, 9, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
         {
-            .Key = CO_KEY(0x2107, 9,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 9,
+            .Key = CO_KEY(BALANCING_INDEX, 10, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
         {
-            .Key = CO_KEY(0x2107, 10,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 10,
+            .Key = CO_KEY(BALANCING_INDEX, 11, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
         {
-            .Key = CO_KEY(0x2107, 11,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 11,
+            .Key = CO_KEY(BALANCING_INDEX, 12, CO_OBJ_____RW),
+            .Type = &balancingCANOpen,
+            .Data = (CO_DATA) this,
         },
+        BMS_DATA_LINK_RW(BALANCING_INDEX, 13, CO_TUNSIGNED8, &automaticBalancing),
+
+        // TPDO7
+        BMS_DATA_START_KEY(SOC_DATA_INDEX, 1),
+        BMS_DATA_LINK(SOC_DATA_INDEX, 1, CO_TUNSIGNED16, &telemetry.published().stateOfCharge),
+
+        // Received CAN frame queue statistics, read over SDO
+        BMS_DATA_START_KEY(CAN_QUEUE_STATS_INDEX, 2),
+        BMS_DATA_LINK(CAN_QUEUE_STATS_INDEX, 1, CO_TUNSIGNED32, &canQueueHighWaterMark),
+        BMS_DATA_LINK(CAN_QUEUE_STATS_INDEX, 2, CO_TUNSIGNED32, &canQueueOverflowCount),
+
+        // Telemetry log, uploading the log freezes it and clearing the frozen
+        // flag starts recording again
+        BMS_DATA_START_KEY(TELEMETRY_LOG_INDEX, 2),
         {
-            .Key = CO_KEY(0x2107, 12,  CO_OBJ____PRW),
-            .Type = ((CO_OBJ_TYPE*) &bq.balancingCANOpen),
-            .Data = (uintptr_t) 12,
+            .Key = CO_KEY(TELEMETRY_LOG_INDEX, 1, CO_OBJ_____R_),
+            .Type = &telemetryRecorder.canOpenInterface,
+            .Data = (CO_DATA) &telemetryRecorder,
         },
-*/
+        BMS_DATA_LINK_RW(TELEMETRY_LOG_INDEX, 2, CO_TUNSIGNED8, telemetryRecorder.getFrozenFlag()),
+
+        // Fault log, the valid records oldest first, and the number of fault
+        // events logged over the life of the BMS
+        BMS_DATA_START_KEY(FAULT_LOG_INDEX, 2),
+        {
+            .Key = CO_KEY(FAULT_LOG_INDEX, 1, CO_OBJ_____R_),
+            .Type = &faultLog.canOpenInterface,
+            .Data = (CO_DATA) &faultLog,
+        },
+        BMS_DATA_LINK(FAULT_LOG_INDEX, 2, CO_TUNSIGNED32, faultLog.getNumAppended()),
+
+        // BQ settings, a settings image is downloaded into EEPROM and the
+        // number of stored settings is set once it is validated
+        BMS_DATA_START_KEY(BQ_SETTINGS_INDEX, 2),
+        {
+            .Key = CO_KEY(BQ_SETTINGS_INDEX, 1, CO_OBJ_____RW),
+            .Type = &bqSettingsStorage.canOpenInterface,
+            .Data = (CO_DATA) &bqSettingsStorage,
+        },
+        BMS_DATA_LINK(BQ_SETTINGS_INDEX, 2, CO_TUNSIGNED16, &bqSettingsStorage.numSettings),
+
         // End of dictionary marker
         CO_OBJ_DICT_ENDMARK,
     };
@@ -43,3 +43,65 @@
         .Type = CO_TPDO_EVENT,                                                                          \
         .Data = (CO_DATA) INTERVAL,                                                                     \
     }
+
+/**
+ * This macro creates a TPDO mapping entry which links to an arbitrary object
+ * dictionary index. Used for TPDOs whose data does not live at the default
+ * 0x2100 + TPDO_NUMBER data link index.
+ *
+ * @param TPDO_NUMBER (integer) the TPDO number this mapping entry is for.
+ * @param SUB_INDEX (integer) the sub index of the mapping entry.
+ * @param LINK_INDEX (hex) the object dictionary index of the linked data.
+ * @param DATA_SIZE (hex) the size of the linked data, use the PDO_MAPPING_* values.
+ */
+#define TRANSMIT_PDO_MAPPING_LINK_ENTRY_1AXX(TPDO_NUMBER, SUB_INDEX, LINK_INDEX, DATA_SIZE) \
+    {                                                                                      \
+        .Key = CO_KEY(0x1A00 + TPDO_NUMBER, SUB_INDEX, CO_OBJ_D___R_),                     \
+        .Type = CO_TUNSIGNED32,                                                            \
+        .Data = (CO_DATA) CO_LINK(LINK_INDEX, SUB_INDEX, DATA_SIZE),                       \
+    }
+
+/**
+ * This macro creates the sub index 0 entry of a BMS specific data object,
+ * holding the number of sub indices in the object.
+ *
+ * @param INDEX (hex) the object dictionary index of the object.
+ * @param NUMBER_OF_SUB_INDICES (integer) the number of sub indices in the object.
+ */
+#define BMS_DATA_START_KEY(INDEX, NUMBER_OF_SUB_INDICES) \
+    {                                                    \
+        .Key = CO_KEY(INDEX, 0x00, CO_OBJ_D___R_),       \
+        .Type = CO_TUNSIGNED8,                           \
+        .Data = (CO_DATA) NUMBER_OF_SUB_INDICES,         \
+    }
+
+/**
+ * This macro creates a read only, PDO mappable link to BMS data.
+ *
+ * @param INDEX (hex) the object dictionary index of the object.
+ * @param SUB_INDEX (integer) the sub index of the entry.
+ * @param DATA_TYPE (CO_OBJ_TYPE*) the CANopen type of the data.
+ * @param DATA_POINTER (pointer) pointer to the data.
+ */
+#define BMS_DATA_LINK(INDEX, SUB_INDEX, DATA_TYPE, DATA_POINTER) \
+    {                                                            \
+        .Key = CO_KEY(INDEX, SUB_INDEX, CO_OBJ____PR_),          \
+        .Type = DATA_TYPE,                                       \
+        .Data = (CO_DATA) DATA_POINTER,                          \
+    }
+
+/**
+ * This macro creates a read/write link to BMS data, which can be changed
+ * over SDO.
+ *
+ * @param INDEX (hex) the object dictionary index of the object.
+ * @param SUB_INDEX (integer) the sub index of the entry.
+ * @param DATA_TYPE (CO_OBJ_TYPE*) the CANopen type of the data.
+ * @param DATA_POINTER (pointer) pointer to the data.
+ */
+#define BMS_DATA_LINK_RW(INDEX, SUB_INDEX, DATA_TYPE, DATA_POINTER) \
+    {                                                               \
+        .Key = CO_KEY(INDEX, SUB_INDEX, CO_OBJ_____RW),             \
+        .Type = DATA_TYPE,                                          \
+        .Data = (CO_DATA) DATA_POINTER,                             \
+    }
@@ -22,6 +22,12 @@ public:
      */
     static constexpr uint8_t ARRAY_SIZE = 7;
 
+    /**
+     * The largest size of a setting in the stream encoding, see
+     * BQSetting::fromStream. Units are bytes.
+     */
+    static constexpr uint8_t MAX_STREAM_SIZE = 7;
+
     /**
      * Represents the different options where the settings can be applied.
      */
@@ -78,6 +84,46 @@ public:
      */
     void toArray(uint8_t buffer[ARRAY_SIZE]);
 
+    /**
+     * Populate the content of the object with the next setting of a stream
+     *
+     * In the stream every setting only takes the bytes it needs, its
+     * address is stored as the distance from where the previous setting
+     * ends. Settings sorted by address mostly follow on from each other,
+     * which takes no address bytes at all. A setting is in the format below:
+     * Byte 0:
+     *      Bit 0 and Bit 1: Command type, as in BQSetting::fromArray
+     *      Bit 2-4: Number of bytes of data, 0 to 4
+     *      Bit 5 and Bit 6: Address encoding
+     *          00 -> Address is nextAddress, no address bytes
+     *          01 -> Address is nextAddress plus the 1 address byte
+     *          10 -> Address is the 2 address bytes
+     *          11 -> Unused
+     * Address bytes, 0 to 2, little endian
+     * Data, the number of bytes of data, little endian
+     *
+     * @param buffer[in] The stream, at the setting
+     * @param length[in] The number of bytes left in the stream
+     * @param nextAddress[in,out] Address following on from the previous
+     *        setting, its address plus its number of bytes, 0 for the first
+     *        setting. Updated for the next setting.
+     * @return The number of bytes of the setting, 0 if it is invalid or
+     *         does not fit in length
+     */
+    uint8_t fromStream(const uint8_t* buffer, uint32_t length, uint16_t& nextAddress);
+
+    /**
+     * Populate an array with the stream representation of the BQSetting
+     *
+     * This follows the form shown on BQSetting::fromStream.
+     *
+     * @param buffer[out] The array to populate, MAX_STREAM_SIZE in size
+     * @param nextAddress[in,out] Address following on from the previous
+     *        setting, updated for the next setting
+     * @return The number of bytes of the setting
+     */
+    uint8_t toStream(uint8_t buffer[MAX_STREAM_SIZE], uint16_t& nextAddress);
+
     /**
      * Get the setting type
      *
@@ -110,6 +156,14 @@ public:
     uint8_t getNumBytes();
 
 private:
+    // Address encodings of the stream, each the number of address bytes
+    /** The address follows on from the previous setting */
+    static constexpr uint8_t STREAM_ADDRESS_NEXT = 0;
+    /** The address is a 1 byte offset from where the previous setting ends */
+    static constexpr uint8_t STREAM_ADDRESS_OFFSET = 1;
+    /** The address is stored in full */
+    static constexpr uint8_t STREAM_ADDRESS_ABSOLUTE = 2;
+
     /** The type of the setting */
     BQSettingType settingType;
     /**
@@ -3,8 +3,10 @@
 #include <cstdint>
 
 #include <EVT/dev/storage/M24C32.hpp>
+#include <co_core.h>
 
 #include <BQSetting.hpp>
+#include <I2CTransactionQueue.hpp>
 #include <dev/BQ76952.hpp>
 
 namespace BMS {
@@ -15,22 +17,107 @@ namespace BMS {
  *
  * Part of the logic for the BQ storage handler is exposing the settings
  * over the CANopen network. This is handled by producing a CANopen stack
- * driver for a custom field. That field has the ability to read and write
- * BQ settings through the storage handler. The value
- * `BQSettingsStorage::canOpenInterface` can be added to the CANopen
- * object dictionary to allow settings to be sent over. The process to write
- * out the settings should be
+ * driver for a custom field. The value `BQSettingsStorage::canOpenInterface`
+ * can be added to the CANopen object dictionary as a domain, and a settings
+ * image, as made by `tools/bqsettings/run.py convert`, is sent over with an
+ * SDO segmented or block download, see BQSettingsStorage::downloadBytes.
  *
- *  1) Update the number of settings that are stored. The number of settings
- *     will be exposed over CANopen (`BQSettingsStorage::numSettings`).
- *  2) Using SDO segmented download, send over each BQ Setting
+ * Settings are written into EEPROM a whole 32 byte page at a time. Once all
+ * settings have come over, the header with the number of settings and the
+ * CRC of the settings is written to EEPROM, see BQSettingsStorage::Header.
  *
- * The settings will be written into EEPROM. Once all settings have come
- * over CANopen, the number of settings in EEPROM will also be updated
- * accordingly.
+ * Images are stored in the stream encoding of BQSetting::fromStream, which
+ * takes around half the EEPROM of the fixed 7 byte encoding and half the
+ * time to read. Images in the fixed encoding, from older tools, are still
+ * read.
  */
 class BQSettingsStorage {
 public:
+    /** Magic number at the start of the settings header ("BS") */
+    static constexpr uint16_t SETTINGS_MAGIC = 0x5342;
+    /** Version of the settings format, settings in the fixed encoding */
+    static constexpr uint8_t SETTINGS_VERSION = 1;
+    /** Version of the settings format, settings in the stream encoding */
+    static constexpr uint8_t STREAM_SETTINGS_VERSION = 2;
+    /** Size of the settings header in bytes */
+    static constexpr uint8_t HEADER_SIZE = 16;
+    /** Header flag, the image is followed by a CRC for each block of settings */
+    static constexpr uint8_t FLAG_BLOCK_CRC = 0x01;
+    /** Header flag, the settings are in the stream encoding */
+    static constexpr uint8_t FLAG_STREAM = 0x02;
+    /** Number of settings in the fixed encoding covered by each block CRC */
+    static constexpr uint8_t CRC_BLOCK_SETTINGS = 32;
+    /** Number of bytes of settings covered by each block CRC */
+    static constexpr uint16_t CRC_BLOCK_SIZE = CRC_BLOCK_SETTINGS * BQSetting::ARRAY_SIZE;
+    /**
+     * Maximum number of settings that can be stored, keeps the image and
+     * block CRCs clear of the fault log and SOC record at the end of the
+     * EEPROM
+     */
+    static constexpr uint16_t MAX_SETTINGS = 512;
+    /** Size in bytes of the largest settings image, with its block CRCs */
+    static constexpr uint32_t MAX_IMAGE_SIZE = HEADER_SIZE + MAX_SETTINGS * BQSetting::ARRAY_SIZE
+                                               + 4 * (MAX_SETTINGS / CRC_BLOCK_SETTINGS);
+
+    /**
+     * Header stored at the start of the settings in EEPROM
+     *
+     * In EEPROM the header is stored little endian as
+     *
+     * Byte 0-1: SETTINGS_MAGIC
+     * Byte 2: STREAM_SETTINGS_VERSION with FLAG_STREAM, otherwise
+     *         SETTINGS_VERSION
+     * Byte 3: Flags
+     * Byte 4-5: Number of settings
+     * Byte 6-7: Size of the settings in bytes with FLAG_STREAM, otherwise 0
+     * Byte 8-11: CRC32 of all settings
+     * Byte 12-15: CRC32 of bytes 0-11
+     *
+     * The settings follow the header back to back, each in the format of
+     * BQSetting::fromStream with FLAG_STREAM and of BQSetting::fromArray
+     * otherwise. When FLAG_BLOCK_CRC is set the settings are followed by
+     * the CRC32 of each block of CRC_BLOCK_SIZE bytes of settings (the last
+     * block may be shorter).
+     *
+     * @var numSettings Number of settings in the image
+     * @var flags Combination of the FLAG_* values
+     * @var imageCrc CRC32 of all settings in the image
+     * @var settingsSize Size of the settings in bytes, only stored with
+     *      FLAG_STREAM, headerFromArray fills it in for both encodings
+     */
+    struct Header {
+        uint16_t numSettings;
+        uint8_t flags;
+        uint32_t imageCrc;
+        uint16_t settingsSize;
+    };
+
+    /**
+     * Convert a header into its EEPROM format
+     *
+     * @param[in] header The header to convert
+     * @param[out] buffer The EEPROM format of the header
+     */
+    static void headerToArray(const Header& header, uint8_t buffer[HEADER_SIZE]);
+
+    /**
+     * Parse and validate a header in its EEPROM format
+     *
+     * @param[in] buffer The EEPROM format of the header
+     * @param[out] header The parsed header
+     * @return True if the magic number, version, header CRC, number of
+     *         settings and size are valid
+     */
+    static bool headerFromArray(const uint8_t buffer[HEADER_SIZE], Header& header);
+
+    /**
+     * Get the size of a settings image
+     *
+     * @param[in] header The header of the image
+     * @return The size in bytes of the header, settings and block CRCs
+     */
+    static uint32_t imageSize(const Header& header);
+
     /**
      * Make a new settings storage instance
      *
@@ -74,15 +161,61 @@ public:
      * write the next setting to. Therefore, users can write sequential
      * settings by simply calling this method multiple times.
      *
+     * Once the last setting is written the header is written with the CRC of
+     * the settings, and the new image is loaded and validated.
+     *
      * @param setting[in] The setting to write to EEPROM
      */
     void writeSetting(BQSetting& setting);
 
     /**
-     * Write the number of settings into EEPROM.
+     * Start writing a new image of BQSettingsStorage::getNumSettings settings.
+     *
+     * The stored header is invalidated until the last setting is written, so
+     * a partial upload is never used.
      */
     void writeNumSettings();
 
+    /**
+     * Start a download of a settings image, this invalidates the stored
+     * image until the download completes
+     */
+    void startDownload();
+
+    /**
+     * Add the next part of a settings image download
+     *
+     * The image is the same as stored in EEPROM: the header, the settings
+     * and, if flagged in the header, the block CRCs. It can come in parts of
+     * any size. The settings are written to EEPROM as each page fills up,
+     * while the header is held back until the whole image has come in and
+     * matches the CRC in the header, and the new image is then loaded and
+     * validated.
+     *
+     * Once a download has failed the rest of it is rejected, until the next
+     * call to BQSettingsStorage::startDownload.
+     *
+     * @param[in] bytes The next bytes of the image
+     * @param[in] numBytes The number of bytes
+     * @return False if the image is invalid, too large or fails validation
+     */
+    bool downloadBytes(const uint8_t* bytes, uint32_t numBytes);
+
+    /**
+     * Check if the last download took in the whole image and stored it
+     *
+     * @return True if the downloaded image is stored and valid
+     */
+    bool isDownloadComplete();
+
+    /**
+     * Take the I2C bus from the given queue around the EEPROM accesses made
+     * from CANopen, which runs alongside the queued BQ reads
+     *
+     * @param[in] queue The transaction queue of the bus the EEPROM is on
+     */
+    void setI2CQueue(I2CTransactionQueue& queue);
+
     /**
      * Reset the EEPROM offset where to write setting back to the being
      */
@@ -104,6 +237,24 @@ public:
      */
     void resetTransfer();
 
+    /**
+     * Load the settings image from EEPROM and validate it
+     *
+     * This is done once when the storage is made and again once new
+     * settings have been written. The image is read with page aligned burst
+     * reads into a RAM cache, so BQSettingsStorage::readSetting is served
+     * from RAM and a transfer only puts BQ traffic on the I2C bus. Images
+     * larger than BQSettingsStorage::CACHE_SIZE bytes are not cached, they
+     * are streamed through the CRC check and settings are read from EEPROM
+     * one at a time.
+     *
+     * An image which fails the CRC check, or holds an invalid setting, is not
+     * used and BQSettingsStorage::hasSettings returns false.
+     *
+     * @return True if the image is valid
+     */
+    bool loadImage();
+
     /**
      * Transfer a single setting over to the BQ chip. Will update the given
      * flag to represent that the setting that was transferred by the most
@@ -128,17 +279,155 @@ public:
      */
     BMS::DEV::BQ76952::Status transferSetting(bool& isComplete);
 
+    /**
+     * Transfer a block of settings over to the BQ chip
+     *
+     * Consecutive RAM settings whose addresses are contiguous are coalesced
+     * into a single block of up to BQ76952::MAX_RAM_BLOCK_SIZE bytes, which
+     * is written and verified with one subcommand buffer write. Otherwise
+     * behaves like BQSettingsStorage::transferSetting, each call transfers
+     * one block and the flag is set once the last block is transferred.
+     *
+     * NOTE: BQSettingsStorage::resetTransfer must be called before the
+     * first call to transferBlock
+     *
+     * @param[out] isComplete Flag that represents all settings have been transferred
+     * @return The resulting status of the transfer operation
+     */
+    BMS::DEV::BQ76952::Status transferBlock(bool& isComplete);
+
     /**
      * Check if the settings are stored and can be used
      *
-     * This includes checking to see if there are settings stored, and also
-     * checks to make sure settings are not actively being written to.
+     * This includes checking to see if there are settings stored, that they
+     * passed validation, and also checks to make sure settings are not
+     * actively being written to.
      *
      * @return Whether there are stored settings to use
      */
     bool hasSettings();
 
+    /**
+     * Check if the stored settings are already applied to the BQ chip
+     *
+     * This is the case when the stored image, identified by its CRC, is
+     * unchanged since it was last transferred successfully, and a sample of the settings read back from
+     * the BQ matches the image. The BQ keeps its RAM when only the BMS is
+     * reset, so this allows skipping the transfer on warm restarts.
+     *
+     * @return True if the transfer can be skipped
+     */
+    bool isAppliedToBQ();
+
+    /**
+     * CANopen stack interface. Exposes the settings image download over
+     * CANopen, obj->Data points to the storage.
+     */
+    CO_OBJ_TYPE canOpenInterface;
+
 private:
+    /**
+     * Number of settings read back from the BQ to check that the stored
+     * settings are applied
+     */
+    static constexpr uint8_t SIGNATURE_SAMPLES = 8;
+
+    /**
+     * Size of the RAM cache in bytes, enough for around 256 settings in the
+     * stream encoding
+     */
+    static constexpr uint16_t CACHE_SIZE = 1024;
+
+    /**
+     * Size of an EEPROM page, the cache is loaded one page at a time
+     */
+    static constexpr uint8_t EEPROM_PAGE_SIZE = 32;
+
+    /**
+     * State of the RAM cache of the settings image
+     */
+    enum class CacheState {
+        /** Settings are read from EEPROM */
+        UNLOADED = 0,
+        /** Settings are read from the cache */
+        LOADED = 1,
+    };
+
+    /**
+     * Parse the setting at the start of a buffer, in the encoding of the
+     * stored image
+     *
+     * @param[in] buffer The buffer, at the setting
+     * @param[in] length Number of bytes of settings left in the buffer
+     * @param[out] setting The parsed setting
+     * @param[in,out] nextAddress Address following on from the previous
+     *                setting, see BQSetting::fromStream
+     * @return The number of bytes of the setting, 0 if it is invalid
+     */
+    uint8_t parseSetting(const uint8_t* buffer, uint32_t length, BQSetting& setting, uint16_t& nextAddress);
+
+    /**
+     * Read part of the settings image, from the cache when it is loaded and
+     * otherwise from EEPROM with page aligned burst reads
+     *
+     * @param[in] offset Offset into the image, 0 is the first setting
+     * @param[out] buffer Buffer to read into
+     * @param[in] numBytes Number of bytes to read
+     */
+    void readImage(uint32_t offset, uint8_t* buffer, uint32_t numBytes);
+
+    /**
+     * Compute the CRC32 of part of the settings image
+     *
+     * @param[in] offset Offset into the image, 0 is the first setting
+     * @param[in] numBytes Number of bytes to include
+     * @return The CRC32 of the given part of the image
+     */
+    uint32_t computeImageCrc(uint32_t offset, uint32_t numBytes);
+
+    /**
+     * Log the first block of settings which does not match its block CRC,
+     * used to narrow down where a corrupted image is damaged
+     */
+    void logBadBlock();
+
+    /**
+     * Add bytes to the image being written at BQSettingsStorage::addressLocation,
+     * writing out each page once it is full
+     *
+     * @param[in] bytes The bytes to write
+     * @param[in] numBytes The number of bytes
+     */
+    void bufferImage(const uint8_t* bytes, uint32_t numBytes);
+
+    /**
+     * Write out the buffered part of the current page, if any
+     */
+    void flushPage();
+
+    /**
+     * Write out the rest of the image and its header, then load the new
+     * image
+     *
+     * @param[in] header The header of the new image
+     * @return True if the new image is valid
+     */
+    bool commitImage(const Header& header);
+
+    /**
+     * Reject the rest of the download in progress
+     *
+     * @param[in] reason Logged reason for the failure
+     * @return Always false, to be returned by BQSettingsStorage::downloadBytes
+     */
+    bool failDownload(const char* reason);
+
+    /** CANopen stack callbacks of BQSettingsStorage::canOpenInterface */
+    static uint32_t canOpenSize(CO_OBJ_T* obj, CO_NODE_T* node, uint32_t width);
+    static CO_ERR canOpenCtrl(CO_OBJ_T* obj, CO_NODE_T* node, uint16_t func, uint32_t para);
+    static CO_ERR canOpenRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len);
+    static CO_ERR canOpenWrite(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len);
+
     /**
      * The starting address in EEPROM where the BQ settings are stored
      */
@@ -152,9 +441,75 @@ private:
      */
     uint16_t numSettings;
     /**
-     * CANopen stack interface. Exposes the BQ settings over CANopen
+     * Flags of the stored image, see BQSettingsStorage::Header
      */
-    CO_OBJ_TYPE canOpenInterface;
+    uint8_t flags = 0;
+    /**
+     * Size in bytes of the settings of the stored image
+     */
+    uint16_t settingsSize = 0;
+    /**
+     * Address following on from the last setting read, see
+     * BQSetting::fromStream
+     */
+    uint16_t readNextAddress = 0;
+    /**
+     * Address following on from the last setting written, see
+     * BQSetting::toStream
+     */
+    uint16_t writeNextAddress = 0;
+    /**
+     * CRC32 of the stored image, from the header
+     */
+    uint32_t imageCrc = 0;
+    /**
+     * Whether the stored image passed validation
+     */
+    bool isImageValid = false;
+    /**
+     * Running CRC32 of the settings written since the last call to
+     * BQSettingsStorage::writeNumSettings
+     */
+    uint32_t writeCrc = 0;
+    /**
+     * Page of the image being written, only the part up to
+     * BQSettingsStorage::addressLocation is filled in
+     */
+    uint8_t pageBuffer[EEPROM_PAGE_SIZE] = {};
+    /**
+     * Number of bytes in BQSettingsStorage::pageBuffer not yet written out
+     */
+    uint8_t pageFill = 0;
+    /**
+     * Header of the image being downloaded, held back until the image is
+     * complete
+     */
+    uint8_t downloadHeader[HEADER_SIZE] = {};
+    /**
+     * Parsed header of the image being downloaded, valid once
+     * BQSettingsStorage::downloadSize is set
+     */
+    Header downloadedHeader = {};
+    /**
+     * Number of bytes of the image downloaded so far
+     */
+    uint32_t downloadOffset = 0;
+    /**
+     * Size of the image being downloaded, 0 until its header has come in
+     */
+    uint32_t downloadSize = 0;
+    /**
+     * Set once the download in progress has been rejected
+     */
+    bool downloadFailed = false;
+    /**
+     * Set once the last download has been stored
+     */
+    bool downloadComplete = false;
+    /**
+     * Queue to take the I2C bus from around CANopen EEPROM accesses, if any
+     */
+    I2CTransactionQueue* i2cQueue = nullptr;
     /**
      * EEPROM for storing the BQ settings.
      */
@@ -174,6 +529,31 @@ private:
      * BQ
      */
     uint16_t numSettingsTransferred = 0;
+    /**
+     * Setting that has been read from EEPROM but did not fit in the last
+     * transferred block
+     */
+    BQSetting pendingSetting;
+    /**
+     * Whether BQSettingsStorage::pendingSetting holds a setting
+     */
+    bool hasPendingSetting = false;
+    /**
+     * RAM copy of the stored settings, in the EEPROM format
+     */
+    uint8_t cache[CACHE_SIZE] = {};
+    /**
+     * State of BQSettingsStorage::cache
+     */
+    CacheState cacheState = CacheState::UNLOADED;
+    /**
+     * CRC32 of the image that was last transferred successfully
+     */
+    uint32_t appliedCrc = 0;
+    /**
+     * Whether BQSettingsStorage::appliedCrc holds a valid CRC
+     */
+    bool hasAppliedCrc = false;
 
     friend class BMS;
 };
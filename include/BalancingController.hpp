@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+namespace BMS {
+
+/**
+ * Decides which cells are passively balanced
+ *
+ * Cells more than START_THRESHOLD above the lowest cell are bled until they
+ * are within STOP_THRESHOLD of it. The mask of every cell to bleed is worked
+ * out in one pass over the cell voltages, so it can be written to the BQ in
+ * a single RAM write.
+ *
+ * The cells take turns: each update only bleeds the even or the odd cells,
+ * alternating between updates. No two neighbouring cells are ever bled at
+ * once, and every cell is bled at most half of the time, which keeps the
+ * heat of the bleed resistors spread out. Among the cells of a turn the
+ * highest ones are picked, up to MAX_BALANCING_CELLS.
+ *
+ * The number of cells bled is halved within TEMP_DERATE_MARGIN of the
+ * temperature limits, and balancing stops at the limits. Balancing also
+ * stops while the lowest cell is below MIN_CELL_VOLTAGE, which includes
+ * the cell voltages not being read yet.
+ */
+class BalancingController {
+public:
+    /** Number of cells in the pack */
+    static constexpr uint8_t NUM_CELLS = 12;
+    /** Voltage above the lowest cell in mV at which a cell starts to be bled */
+    static constexpr uint16_t START_THRESHOLD = 15;
+    /** Voltage above the lowest cell in mV at which a cell stops being bled */
+    static constexpr uint16_t STOP_THRESHOLD = 5;
+    /** Lowest cell voltage in mV at which cells are balanced */
+    static constexpr uint16_t MIN_CELL_VOLTAGE = 3000;
+    /** Largest number of cells bled at once */
+    static constexpr uint8_t MAX_BALANCING_CELLS = 4;
+    /** Highest pack temperature in C at which cells are balanced */
+    static constexpr uint8_t MAX_PACK_TEMP = 45;
+    /** Highest BQ internal temperature in C at which cells are balanced */
+    static constexpr uint8_t MAX_BQ_TEMP = 70;
+    /** Distance in C below the temperature limits at which fewer cells are bled */
+    static constexpr uint8_t TEMP_DERATE_MARGIN = 5;
+
+    /**
+     * Work out the cells to bleed from the latest readings
+     *
+     * @param[in] cellVoltage Per-cell voltage in mV, NUM_CELLS in size
+     * @param[in] packTemp Highest thermistor temperature in C
+     * @param[in] bqTemp BQ internal temperature in C
+     * @return Mask with bit N set if cell N + 1 should be bled
+     */
+    uint16_t update(const uint16_t cellVoltage[NUM_CELLS], uint8_t packTemp, uint8_t bqTemp);
+
+    /**
+     * Stop balancing, every cell has to exceed START_THRESHOLD again to be
+     * bled
+     */
+    void reset();
+
+    /**
+     * Get the cells which still need balancing, bled in this turn or not
+     *
+     * @return Mask with bit N set if cell N + 1 is above STOP_THRESHOLD
+     */
+    uint16_t getUnbalancedCells() const;
+
+private:
+    /** Cells which need balancing, kept between updates for the hysteresis */
+    uint16_t unbalancedCells = 0;
+    /** Set when the odd cells take their turn */
+    bool oddTurn = false;
+};
+
+}// namespace BMS
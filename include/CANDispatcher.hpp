@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+
+#include <EVT/io/types/CANMessage.hpp>
+
+namespace BMS {
+
+/**
+ * Table of handlers for the standard CAN IDs the BMS listens to
+ *
+ * Used from the CAN interrupt handler so each frame is only given to the
+ * logic that cares about its ID, instead of every frame going through every
+ * consumer. The same IDs are meant to be loaded into the CAN hardware
+ * acceptance filters, so frames for other nodes never reach the interrupt
+ * handler at all:
+ *
+ * \code{.cpp}
+ * for (uint8_t i = 0; i < dispatcher.getNumHandlers(); i++) {
+ *     can.addCANFilter(dispatcher.getId(i), CANDispatcher::EXACT_MATCH_MASK, i);
+ * }
+ * \endcode
+ */
+class CANDispatcher {
+public:
+    /** Maximum number of IDs that can be handled */
+    static constexpr uint8_t MAX_HANDLERS = 8;
+
+    /** Acceptance filter mask which matches all 11 bits of a standard ID */
+    static constexpr uint16_t EXACT_MATCH_MASK = 0x7FF;
+
+    /**
+     * Function which handles frames with a given ID, called in interrupt
+     * context
+     *
+     * @param[in] message The received frame
+     * @param[in] priv Private data that was provided with the handler
+     */
+    typedef void (*Handler)(EVT::core::IO::CANMessage& message, void* priv);
+
+    /**
+     * Add a handler for a standard CAN ID
+     *
+     * @param[in] id The standard CAN ID to handle
+     * @param[in] handler The function to call for frames with the ID
+     * @param[in] priv Private data passed to the handler
+     * @return False if the table is full or the ID already has a handler
+     */
+    bool addHandler(uint16_t id, Handler handler, void* priv);
+
+    /**
+     * Give a frame to the handler of its ID
+     *
+     * Extended frames are not handled.
+     *
+     * @param[in] message The received frame
+     * @return True if the frame was handled
+     */
+    bool dispatch(EVT::core::IO::CANMessage& message);
+
+    /**
+     * Get the number of IDs with a handler
+     *
+     * @return The number of handlers
+     */
+    uint8_t getNumHandlers();
+
+    /**
+     * Get the ID of a handler, used to set up the acceptance filters
+     *
+     * @param[in] index Index of the handler, in the order they were added
+     * @return The standard CAN ID of the handler
+     */
+    uint16_t getId(uint8_t index);
+
+private:
+    /**
+     * Entry of the dispatch table
+     *
+     * @var id The standard CAN ID handled
+     * @var handler Function called for the ID
+     * @var priv Private data passed to the handler
+     */
+    struct Entry {
+        uint16_t id;
+        Handler handler;
+        void* priv;
+    };
+
+    /** Dispatch table, a handful of entries so a linear scan is cheapest */
+    Entry entries[MAX_HANDLERS] = {};
+    /** Number of entries in the dispatch table */
+    uint8_t numHandlers = 0;
+};
+
+}// namespace BMS
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+namespace BMS {
+
+/**
+ * CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320)
+ *
+ * Matches zlib's crc32, so images produced by the host tools can be checked
+ * on the BMS. A 16 entry nibble table is used to keep the flash footprint
+ * small. The CRC can be computed over data in pieces:
+ *
+ * \code{.cpp}
+ * uint32_t crc = CRC32::INITIAL;
+ * crc = CRC32::update(crc, first, firstLength);
+ * crc = CRC32::update(crc, second, secondLength);
+ * crc = CRC32::finalize(crc);
+ * \endcode
+ */
+class CRC32 {
+public:
+    /** Value to start a CRC computation from */
+    static constexpr uint32_t INITIAL = 0xFFFFFFFF;
+
+    /**
+     * Add data to a running CRC
+     *
+     * @param[in] crc The running CRC, CRC32::INITIAL for the first piece
+     * @param[in] data The data to add
+     * @param[in] length The number of bytes of data
+     * @return The updated running CRC
+     */
+    static uint32_t update(uint32_t crc, const uint8_t* data, uint32_t length);
+
+    /**
+     * Get the final CRC from a running CRC
+     *
+     * @param[in] crc The running CRC
+     * @return The CRC of all data added
+     */
+    static constexpr uint32_t finalize(uint32_t crc) {
+        return ~crc;
+    }
+
+    /**
+     * Compute the CRC of a single piece of data
+     *
+     * @param[in] data The data
+     * @param[in] length The number of bytes of data
+     * @return The CRC of the data
+     */
+    static uint32_t compute(const uint8_t* data, uint32_t length);
+};
+
+}// namespace BMS
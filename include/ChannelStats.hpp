@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+
+namespace BMS {
+
+/**
+ * Minimum, maximum, sum and mean of a fixed set of channels, such as the
+ * thermistors or the cells of the pack
+ *
+ * The statistics are kept up to date as channels are updated one at a time.
+ * An update only rescans the channels when it moves the channel holding the
+ * minimum up or the channel holding the maximum down, every other update is
+ * constant time. Ties go to the lowest channel.
+ *
+ * All channels start at 0.
+ *
+ * @tparam T Type of the channel values
+ * @tparam N Number of channels
+ */
+template<class T, uint8_t N>
+class ChannelStats {
+    static_assert(N > 0, "ChannelStats needs at least one channel");
+
+public:
+    /**
+     * Update the value of one channel
+     *
+     * @param[in] channel The channel, 0 to N - 1
+     * @param[in] value The new value of the channel
+     */
+    void update(uint8_t channel, T value) {
+        T oldValue = values[channel];
+        sum += static_cast<int32_t>(value) - static_cast<int32_t>(oldValue);
+        values[channel] = value;
+
+        if (channel == minChannel) {
+            // The minimum went up, another channel may be lower now
+            if (value > oldValue) {
+                minChannel = findMin();
+            }
+        } else if (value < values[minChannel] || (value == values[minChannel] && channel < minChannel)) {
+            minChannel = channel;
+        }
+
+        if (channel == maxChannel) {
+            // The maximum went down, another channel may be higher now
+            if (value < oldValue) {
+                maxChannel = findMax();
+            }
+        } else if (value > values[maxChannel] || (value == values[maxChannel] && channel < maxChannel)) {
+            maxChannel = channel;
+        }
+    }
+
+    /**
+     * Update the values of all channels
+     *
+     * @param[in] newValues The new values, one per channel
+     */
+    void updateAll(const T newValues[N]) {
+        sum = 0;
+        for (uint8_t i = 0; i < N; i++) {
+            values[i] = newValues[i];
+            sum += values[i];
+        }
+        minChannel = findMin();
+        maxChannel = findMax();
+    }
+
+    /**
+     * Set all channels back to 0
+     */
+    void reset() {
+        for (uint8_t i = 0; i < N; i++) {
+            values[i] = 0;
+        }
+        sum = 0;
+        minChannel = 0;
+        maxChannel = 0;
+    }
+
+    /**
+     * Get the value of a channel
+     *
+     * @param[in] channel The channel
+     * @return The value of the channel
+     */
+    T get(uint8_t channel) const {
+        return values[channel];
+    }
+
+    /**
+     * Get the lowest value
+     *
+     * @return The lowest value of all channels
+     */
+    T getMin() const {
+        return values[minChannel];
+    }
+
+    /**
+     * Get the channel with the lowest value
+     *
+     * @return The lowest channel holding the lowest value
+     */
+    uint8_t getMinChannel() const {
+        return minChannel;
+    }
+
+    /**
+     * Get the highest value
+     *
+     * @return The highest value of all channels
+     */
+    T getMax() const {
+        return values[maxChannel];
+    }
+
+    /**
+     * Get the channel with the highest value
+     *
+     * @return The lowest channel holding the highest value
+     */
+    uint8_t getMaxChannel() const {
+        return maxChannel;
+    }
+
+    /**
+     * Get the sum of all channels
+     *
+     * @return The sum
+     */
+    int32_t getSum() const {
+        return sum;
+    }
+
+    /**
+     * Get the mean of all channels, rounded towards 0
+     *
+     * @return The mean
+     */
+    T getMean() const {
+        return static_cast<T>(sum / N);
+    }
+
+private:
+    /** Value of each channel */
+    T values[N] = {};
+    /** Sum of all channels */
+    int32_t sum = 0;
+    /** Channel holding the lowest value */
+    uint8_t minChannel = 0;
+    /** Channel holding the highest value */
+    uint8_t maxChannel = 0;
+
+    /**
+     * Scan the channels for the lowest value
+     *
+     * @return The lowest channel holding the lowest value
+     */
+    uint8_t findMin() const {
+        uint8_t channel = 0;
+        for (uint8_t i = 1; i < N; i++) {
+            if (values[i] < values[channel]) {
+                channel = i;
+            }
+        }
+        return channel;
+    }
+
+    /**
+     * Scan the channels for the highest value
+     *
+     * @return The lowest channel holding the highest value
+     */
+    uint8_t findMax() const {
+        uint8_t channel = 0;
+        for (uint8_t i = 1; i < N; i++) {
+            if (values[i] > values[channel]) {
+                channel = i;
+            }
+        }
+        return channel;
+    }
+};
+
+}// namespace BMS
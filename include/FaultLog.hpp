@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+
+#include <EVT/dev/storage/M24C32.hpp>
+#include <co_core.h>
+
+#include <BMSInfo.hpp>
+#include <I2CTransactionQueue.hpp>
+
+namespace BMS {
+
+/**
+ * Journal of fault events kept in EEPROM, so faults can be looked into after
+ * the BMS was reset
+ *
+ * The journal is a ring of NUM_RECORDS slots of one EEPROM page each, between
+ * the end of the BQ settings image and the SOC record. Each record is written
+ * with a single page write to the slot after the newest record, overwriting
+ * the oldest one once the ring is full, so every page sees the same share of
+ * the writes.
+ *
+ * Every record carries a sequence number, one more than the record before
+ * it, and a CRC. At boot only the sequence numbers are read. The slot with
+ * the highest sequence number holds the newest record unless its CRC does
+ * not match, which happens when the power was lost during its write. The
+ * slot is then treated as empty, and the next highest sequence number is
+ * checked.
+ *
+ * In EEPROM a record is stored little endian as
+ *
+ * Byte 0-3: Sequence number
+ * Byte 4-7: Time since boot in milliseconds
+ * Byte 8: State of the BMS
+ * Byte 9: Error register
+ * Byte 10-16: BQ status bytes
+ * Byte 17-18: Minimum cell voltage
+ * Byte 19: ID of the cell with the minimum voltage
+ * Byte 20-21: Maximum cell voltage
+ * Byte 22: ID of the cell with the maximum voltage
+ * Byte 23-24: Current
+ * Byte 25: Maximum thermistor temperature
+ * Byte 26: ID of the thermistor with the maximum temperature
+ * Byte 27: Reserved, 0
+ * Byte 28-31: CRC32 of bytes 0-27
+ *
+ * The journal is downloaded over a CANopen SDO domain through
+ * FaultLog::canOpenInterface, as the valid records in this format from
+ * oldest to newest.
+ */
+class FaultLog {
+public:
+    /** Address in EEPROM of the first slot, the page after the settings image */
+    static constexpr uint32_t EEPROM_ADDRESS = 0x0E60;
+    /** Size of a record, one EEPROM page */
+    static constexpr uint8_t RECORD_SIZE = 32;
+    /** Number of slots, up to the SOC record */
+    static constexpr uint8_t NUM_RECORDS = 12;
+
+    /**
+     * Snapshot of the BMS when a fault happened
+     *
+     * @var time Time since boot in milliseconds
+     * @var state State of the BMS
+     * @var errorRegister Errors which have occurred on the BMS
+     * @var bqStatus Status information pulled from the BQ
+     * @var voltageInfo Minimum and maximum cell voltages and their IDs
+     * @var current Total current through the battery
+     * @var maxPackTemp Maximum thermistor temperature
+     * @var maxPackTempId ID of the thermistor with the maximum temperature
+     */
+    struct Record {
+        uint32_t time;
+        uint8_t state;
+        uint8_t errorRegister;
+        uint8_t bqStatus[7];
+        CellVoltageInfo voltageInfo;
+        int16_t current;
+        uint8_t maxPackTemp;
+        uint8_t maxPackTempId;
+    };
+
+    /**
+     * Make a new fault log
+     *
+     * @param[in] eeprom EEPROM the journal is kept in
+     * @param[in] i2cQueue Transaction queue of the bus the EEPROM is on
+     */
+    FaultLog(EVT::core::DEV::M24C32& eeprom, I2CTransactionQueue& i2cQueue);
+
+    /**
+     * Find the newest record in EEPROM, so appends continue after it
+     */
+    void load();
+
+    /**
+     * Write a record to the slot after the newest record
+     *
+     * @param[in] record The record
+     */
+    void append(const Record& record);
+
+    /**
+     * Get the number of records appended over the life of the journal
+     *
+     * @return Pointer to the count, linked into the object dictionary
+     */
+    const uint32_t* getNumAppended() const;
+
+    /**
+     * Convert a record into its EEPROM format, with its CRC
+     *
+     * @param[in] record The record
+     * @param[in] sequence Sequence number of the record
+     * @param[out] buffer The buffer to fill, RECORD_SIZE in size
+     */
+    static void recordToArray(const Record& record, uint32_t sequence, uint8_t buffer[RECORD_SIZE]);
+
+    /**
+     * CANopen stack interface. Exposes the journal as a read only domain, the
+     * object's data has to point to the fault log.
+     */
+    CO_OBJ_TYPE canOpenInterface;
+
+private:
+    /** Sequence number of an empty or damaged slot */
+    static constexpr uint32_t EMPTY_SEQUENCE = 0xFFFFFFFF;
+
+    /** EEPROM the journal is kept in */
+    EVT::core::DEV::M24C32& eeprom;
+    /** Transaction queue of the bus the EEPROM is on */
+    I2CTransactionQueue& i2cQueue;
+    /** Sequence number of the record in each slot */
+    uint32_t slotSequence[NUM_RECORDS] = {};
+    /** Slot the next record is written to */
+    uint8_t head = 0;
+    /** Sequence number of the next record, also the number appended */
+    uint32_t nextSequence = 0;
+
+    /** Slots in the download, oldest first, found when it starts */
+    uint8_t downloadSlots[NUM_RECORDS] = {};
+    /** Number of slots in the download */
+    uint8_t numDownloadSlots = 0;
+    /** Offset of the next CANopen read into the download */
+    uint32_t readOffset = 0;
+    /** Slot held in readBuffer, NUM_RECORDS if none */
+    uint8_t bufferedSlot = NUM_RECORDS;
+    /** Last slot read for the download */
+    uint8_t readBuffer[RECORD_SIZE] = {};
+
+    /**
+     * Read a slot and check its CRC
+     *
+     * @param[in] slot The slot
+     * @param[out] buffer The buffer to fill, RECORD_SIZE in size
+     * @return False if the CRC does not match
+     */
+    bool readSlot(uint8_t slot, uint8_t buffer[RECORD_SIZE]);
+
+    /**
+     * Find the valid records for a download
+     *
+     * @return Size of the download in bytes
+     */
+    uint32_t startDownload();
+
+    // CANopen stack callbacks, the object data points to the fault log
+    static uint32_t canOpenSize(CO_OBJ_T* obj, CO_NODE_T* node, uint32_t width);
+    static CO_ERR canOpenCtrl(CO_OBJ_T* obj, CO_NODE_T* node, uint16_t func, uint32_t para);
+    static CO_ERR canOpenRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len);
+    static CO_ERR canOpenWrite(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len);
+};
+
+}// namespace BMS
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <EVT/io/I2C.hpp>
+
+namespace BMS {
+
+/**
+ * Queue of I2C transactions run one transfer at a time on a shared bus
+ *
+ * A transaction is a chain of register transfers to one device, such as a
+ * write of a register address followed by a read of N bytes, with a
+ * completion callback. Transactions are submitted from the main loop and run
+ * in submission order. How a transfer is moved is up to the Bus backend: an
+ * interrupt or DMA driven backend reports each transfer complete from its
+ * interrupt handler, which starts the next transfer right away, so a whole
+ * chain runs without the main loop. BlockingBus runs each transfer through
+ * the EVT-core I2C interface as soon as it is started.
+ *
+ * The completion callbacks are not run from the interrupt handler but from
+ * process(), in the main loop, where the results can be collected.
+ *
+ * The queue is the only owner of the bus while a transfer is on the wire.
+ * Code which uses the bus directly, such as the EEPROM driver, has to hold
+ * the bus with acquireBus() while it does.
+ */
+class I2CTransactionQueue {
+public:
+    /** Maximum number of transactions in the queue, power of two */
+    static constexpr uint8_t MAX_TRANSACTIONS = 8;
+
+    /**
+     * Status of a transaction or transfer
+     */
+    enum class Status {
+        /** Completed successfully */
+        OK = 0,
+        /** Queued or on the wire */
+        PENDING = 1,
+        /** The device did not acknowledge, the rest of the chain was dropped */
+        ERROR = 2,
+        /** The queue or the transfer chain has no room left */
+        FULL = 3,
+    };
+
+    /**
+     * Single register transfer of a transaction
+     *
+     * @var type Direction of the transfer
+     * @var reg Register address, written first
+     * @var bytes Bytes written after the register address, or filled by the read
+     * @var length Number of bytes in bytes
+     */
+    struct Transfer {
+        enum class Type {
+            /** Register address, then the bytes, in one write */
+            WRITE = 0,
+            /** Register address write, then a read of the bytes */
+            READ = 1,
+        };
+
+        Type type;
+        uint8_t reg;
+        uint8_t* bytes;
+        uint8_t length;
+    };
+
+    /**
+     * Function which is called when a transaction completes
+     *
+     * @param[in] status Status::OK or Status::ERROR
+     * @param[in] priv Private data given on submission
+     */
+    typedef void (*Callback)(Status status, void* priv);
+
+    /**
+     * Backend which moves transfers on the bus
+     *
+     * Every started transfer has to be reported with complete(), from an
+     * interrupt handler or before startTransfer() returns.
+     */
+    class Bus {
+    public:
+        virtual ~Bus() = default;
+
+        /**
+         * Start a transfer, only called when no transfer is on the wire
+         *
+         * @param[in] addr 7-bit address of the device
+         * @param[in] transfer The transfer, valid until it completes
+         */
+        virtual void startTransfer(uint8_t addr, const Transfer& transfer) = 0;
+
+        /**
+         * Wait until the transfer on the wire, if any, has been reported
+         * complete
+         */
+        virtual void waitTransfer() = 0;
+
+    protected:
+        /**
+         * Report the transfer on the wire complete
+         *
+         * @param[in] status Status::OK or Status::ERROR
+         */
+        void complete(Status status);
+
+    private:
+        /** Queue the transfers belong to */
+        I2CTransactionQueue* queue = nullptr;
+
+        friend class I2CTransactionQueue;
+    };
+
+    /**
+     * Backend which runs each transfer through the blocking EVT-core I2C
+     * interface as soon as it is started
+     */
+    class BlockingBus : public Bus {
+    public:
+        /**
+         * Make a new blocking backend
+         *
+         * @param[in] i2c The I2C bus to run transfers on
+         */
+        explicit BlockingBus(EVT::core::IO::I2C& i2c);
+
+        void startTransfer(uint8_t addr, const Transfer& transfer) override;
+        void waitTransfer() override;
+
+    private:
+        /** I2C bus to run transfers on */
+        EVT::core::IO::I2C& i2c;
+    };
+
+    /**
+     * Chain of transfers to one device
+     *
+     * The transaction, and every buffer its transfers point to, has to stay
+     * valid until it completes.
+     */
+    class Transaction {
+    public:
+        /** Maximum number of transfers in a chain */
+        static constexpr uint8_t MAX_TRANSFERS = 8;
+
+        /**
+         * Start a new, empty chain
+         *
+         * @param[in] addr 7-bit address of the device
+         */
+        void reset(uint8_t addr);
+
+        /**
+         * Append a write of a register to the chain
+         *
+         * @param[in] reg Register address
+         * @param[in] bytes Bytes to write after the register address
+         * @param[in] length Number of bytes to write
+         * @return False if the chain is full
+         */
+        bool addWrite(uint8_t reg, uint8_t* bytes, uint8_t length);
+
+        /**
+         * Append a read of a register to the chain
+         *
+         * @param[in] reg Register address
+         * @param[out] bytes Buffer to fill
+         * @param[in] length Number of bytes to read
+         * @return False if the chain is full
+         */
+        bool addRead(uint8_t reg, uint8_t* bytes, uint8_t length);
+
+        /**
+         * Get the status of the transaction
+         *
+         * @return Status::PENDING until it completes, then the result
+         */
+        Status getStatus() const;
+
+    private:
+        /** Transfers of the chain */
+        Transfer transfers[MAX_TRANSFERS] = {};
+        /** Number of transfers in the chain */
+        uint8_t numTransfers = 0;
+        /** Transfer on the wire, advanced from the completion interrupt */
+        volatile uint8_t currentTransfer = 0;
+        /** 7-bit address of the device */
+        uint8_t addr = 0;
+        /** Status of the transaction, set from the completion interrupt */
+        volatile Status status = Status::OK;
+        /** Called on completion */
+        Callback callback = nullptr;
+        /** Private data for the callback */
+        void* priv = nullptr;
+
+        friend class I2CTransactionQueue;
+
+        /**
+         * Append a transfer to the chain
+         *
+         * @return False if the chain is full
+         */
+        bool add(Transfer::Type type, uint8_t reg, uint8_t* bytes, uint8_t length);
+    };
+
+    /**
+     * Make a new, empty queue
+     *
+     * @param[in] bus The backend which moves the transfers
+     */
+    explicit I2CTransactionQueue(Bus& bus);
+
+    /**
+     * Queue a transaction, starting it if the bus is free
+     *
+     * @param[in] transaction The transaction, not already queued
+     * @param[in] callback Called from process() on completion, can be nullptr
+     * @param[in] priv Private data for the callback
+     * @return Status::PENDING if queued, Status::FULL if the queue is full
+     */
+    Status submit(Transaction& transaction, Callback callback, void* priv);
+
+    /**
+     * Run the callbacks of the completed transactions, without waiting on
+     * the bus
+     */
+    void process();
+
+    /**
+     * Run every queued transaction to completion, waiting on the bus, and
+     * run their callbacks
+     */
+    void flush();
+
+    /**
+     * Check if every queued transaction completed and was processed
+     *
+     * @return True if no transaction is queued or in flight
+     */
+    bool isIdle() const;
+
+    /**
+     * Take the bus for direct use
+     *
+     * Waits for the transfer on the wire, if any, and keeps the queue from
+     * starting another one until releaseBus(). A chain on the wire resumes
+     * with its next transfer afterwards.
+     */
+    void acquireBus();
+
+    /**
+     * Give the bus back to the queue
+     */
+    void releaseBus();
+
+private:
+    /** Backend which moves the transfers */
+    Bus& bus;
+    /** Queued transactions */
+    Transaction* transactions[MAX_TRANSACTIONS] = {};
+
+    // Free running counts of the transactions in each step, the slot of a
+    // transaction is its count modulo MAX_TRANSACTIONS. The main loop
+    // submits and collects, the completion interrupt starts and completes.
+    /** Number of transactions submitted */
+    std::atomic<uint8_t> numSubmitted{0};
+    /** Number of transactions started */
+    std::atomic<uint8_t> numStarted{0};
+    /** Number of transactions completed */
+    std::atomic<uint8_t> numCompleted{0};
+    /** Number of transactions whose callback ran */
+    std::atomic<uint8_t> numCollected{0};
+
+    /** True while a transfer is on the wire or being started */
+    std::atomic<bool> busy{false};
+    /** True while the bus is taken for direct use */
+    std::atomic<bool> busAcquired{false};
+    /** True while the queue is inside Bus::startTransfer() */
+    bool starting = false;
+    /** True if the transfer being started completed before it returned */
+    bool completedInStart = false;
+    /** Result of the last completed transfer */
+    Status lastStatus = Status::OK;
+
+    /**
+     * Start the next transaction if the bus is free
+     */
+    void kick();
+
+    /**
+     * Make the next queued transaction with transfers the one in flight
+     *
+     * @return False if there is none, the bus is then free
+     */
+    bool selectNext();
+
+    /**
+     * Start the current transfer of the transaction in flight, and every
+     * transfer after it that completes before the start returns
+     */
+    void startTransfers();
+
+    /**
+     * Move past a completed transfer
+     *
+     * @param[in] status Result of the transfer
+     * @return True if there is another transfer to start
+     */
+    bool advance(Status status);
+
+    /**
+     * Handle the report of a completed transfer from the backend
+     *
+     * @param[in] status Result of the transfer
+     */
+    void transferComplete(Status status);
+
+    /**
+     * Get the transaction in flight
+     *
+     * @return The most recently started transaction
+     */
+    Transaction& inFlight();
+};
+
+}// namespace BMS
@@ -6,6 +6,11 @@ namespace BMS {
 
 /**
  * Detects and reports reset CAN messages
+ *
+ * A reset is requested by MSG_HIST_LEN consecutive reset frames, standard ID
+ * 0x7FF with the payload 00 01 .. 07. Frames are matched as they arrive, so
+ * registering a frame from the CAN interrupt handler is constant time and no
+ * frames are stored.
  */
 class ResetHandler {
 public:
@@ -15,37 +20,58 @@ public:
     ResetHandler();
 
     /**
-     * Register a received CAN message
+     * Register a received CAN message, meant to be called from the CAN
+     * interrupt handler
+     *
+     * Any other frame in between reset frames restarts the count.
      *
      * @param msg Message to register
      */
-    void registerInput(EVT::core::IO::CANMessage msg);
+    void registerInput(EVT::core::IO::CANMessage& msg);
 
     /**
      * Check whether reset messages have been received, indicating that the BMS
      * should reset
      *
+     * A reset is only reported once, the next one needs another
+     * MSG_HIST_LEN consecutive reset frames.
+     *
      * @return Whether the BMS should reset
      */
     bool shouldReset();
 
+    /**
+     * Drop a reset requested before now, so frames received while the BMS
+     * was not listening for a reset can not reset it later
+     *
+     * Only the requested reset is dropped, the count of consecutive reset
+     * frames is left to registerInput.
+     */
+    void clear();
+
 private:
     /** Number of reset message frames required to trigger a reset */
     static constexpr uint8_t MSG_HIST_LEN = 5;
     /** Reset message ID */
     static constexpr uint16_t RESET_ID = 0x7FF;
-    ;
     /** Reset message array length */
     static constexpr uint8_t RESET_ARR_LEN = 8;
-    ;
     /** Reset message array */
     static constexpr uint8_t const RESET_ARR[8] =
         {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
 
-    /** Array of last MSG_HIST_LEN messages received */
-    EVT::core::IO::CANMessage msgHistory[MSG_HIST_LEN] = {};
-    /** Index of the last registered message */
-    uint8_t lastRegMsgIndex = 0;
+    /**
+     * Check if a frame is a reset frame
+     *
+     * @param msg The frame
+     * @return True if the frame has the reset ID and payload
+     */
+    static bool isResetMessage(EVT::core::IO::CANMessage& msg);
+
+    /** Number of consecutive reset frames received, only used by registerInput */
+    uint8_t numResetMsgs = 0;
+    /** Set by registerInput when a reset was requested, cleared by shouldReset and clear */
+    volatile bool resetRequested = false;
 };
 
 }// namespace BMS
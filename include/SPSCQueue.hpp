@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace BMS {
+
+/**
+ * Lock-free single producer, single consumer ring buffer
+ *
+ * Made for handing data from an interrupt handler (the producer) to the main
+ * loop (the consumer) without disabling interrupts. Only the producer writes
+ * the head index and only the consumer writes the tail index, each publishing
+ * its index with release ordering after the element was written or read, so
+ * neither side can see a partially copied element. The indices run freely
+ * and are masked into the buffer, which is why the capacity has to be a
+ * power of two.
+ *
+ * Elements pushed while the queue is full are dropped and counted. The
+ * largest number of elements ever waiting in the queue is kept as a high
+ * water mark, which together with the overflow count shows whether the
+ * capacity is right.
+ *
+ * @tparam T Type of the elements, copied in and out of the queue
+ * @tparam N Capacity of the queue, must be a power of two
+ */
+template<class T, uint32_t N>
+class SPSCQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+public:
+    /** Number of elements the queue can hold */
+    static constexpr uint32_t CAPACITY = N;
+
+    /**
+     * Add an element to the queue, only called by the producer
+     *
+     * @param[in] element The element to copy into the queue
+     * @return False if the queue was full and the element was dropped
+     */
+    bool push(const T& element) {
+        uint32_t currentHead = head.load(std::memory_order_relaxed);
+        uint32_t used = currentHead - tail.load(std::memory_order_acquire);
+
+        if (used == N) {
+            overflowCount.store(overflowCount.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+            return false;
+        }
+
+        buffer[currentHead & MASK] = element;
+        head.store(currentHead + 1, std::memory_order_release);
+
+        if (used + 1 > highWaterMark.load(std::memory_order_relaxed)) {
+            highWaterMark.store(used + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /**
+     * Take the oldest element out of the queue, only called by the consumer
+     *
+     * @param[out] element The oldest element
+     * @return False if the queue was empty
+     */
+    bool pop(T* element) {
+        uint32_t currentTail = tail.load(std::memory_order_relaxed);
+
+        if (currentTail == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        *element = buffer[currentTail & MASK];
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Check if the queue is empty, only meaningful to the consumer
+     *
+     * @return True if there are no elements in the queue
+     */
+    bool isEmpty() const {
+        return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Get the number of elements dropped because the queue was full
+     *
+     * @return The number of dropped elements
+     */
+    uint32_t getOverflowCount() const {
+        return overflowCount.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the largest number of elements which were in the queue at once
+     *
+     * @return The high water mark, CAPACITY once the queue has been full
+     */
+    uint32_t getHighWaterMark() const {
+        return highWaterMark.load(std::memory_order_relaxed);
+    }
+
+private:
+    /** Mask turning a free running index into a buffer index */
+    static constexpr uint32_t MASK = N - 1;
+
+    /** Storage for the elements */
+    T buffer[N] = {};
+    /** Index of the next element to write, written by the producer */
+    std::atomic<uint32_t> head{0};
+    /** Index of the next element to read, written by the consumer */
+    std::atomic<uint32_t> tail{0};
+    /** Number of dropped elements, written by the producer */
+    std::atomic<uint32_t> overflowCount{0};
+    /** Largest number of elements in the queue, written by the producer */
+    std::atomic<uint32_t> highWaterMark{0};
+};
+
+}// namespace BMS
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+
+#include <BQSettingStorage.hpp>
+
+namespace BMS {
+
+/**
+ * Receiver of the BQ settings image streamed over a serial link
+ *
+ * The host sends the image produced by `tools/bqsettings/run.py convert` in
+ * data frames of up to MAX_PAYLOAD bytes, numbered from 0. Up to
+ * WINDOW_FRAMES frames are sent back to back, the last one flagged with
+ * FLAG_END_OF_WINDOW, before the host waits for a response. The frames in
+ * order are kept in RAM while they come in, and only handed to
+ * BQSettingsStorage, which writes them to EEPROM a page at a time, once the
+ * window is complete. The UART is polled, so nothing can be received while
+ * the EEPROM is written.
+ *
+ * A data frame is
+ *
+ * Byte 0: DATA_SOF
+ * Byte 1-2: Sequence number, little endian
+ * Byte 3: Flags
+ * Byte 4: Number of payload bytes N, 1 to MAX_PAYLOAD
+ * Byte 5-(4+N): Payload, the next bytes of the image
+ * Byte (5+N)-(8+N): CRC32 of bytes 1-(4+N), little endian
+ *
+ * and the response to a window is
+ *
+ * Byte 0: RESPONSE_SOF
+ * Byte 1: Status
+ * Byte 2-3: Sequence number of the next frame expected, little endian
+ * Byte 4-7: CRC32 of bytes 1-3, little endian
+ *
+ * Frames with a bad CRC, and every frame after them in the window, are
+ * dropped. The response then asks for the first frame missing, and the host
+ * sends the window again from there. A window whose last frame is lost is
+ * answered once nothing has come in for IDLE_TIMEOUT. Frame 0 starts the
+ * download over, so a host can restart at any time.
+ */
+class SettingsUpload {
+public:
+    /** Start of a data frame */
+    static constexpr uint8_t DATA_SOF = 0xA5;
+    /** Start of a response */
+    static constexpr uint8_t RESPONSE_SOF = 0x5A;
+    /** Largest number of payload bytes in a data frame */
+    static constexpr uint8_t MAX_PAYLOAD = 64;
+    /** Largest number of data frames sent before a response */
+    static constexpr uint8_t WINDOW_FRAMES = 8;
+    /** Flag of the last data frame of a window */
+    static constexpr uint8_t FLAG_END_OF_WINDOW = 0x01;
+    /** Bytes of a data frame besides the payload */
+    static constexpr uint8_t FRAME_OVERHEAD = 9;
+    /** Size of a response */
+    static constexpr uint8_t RESPONSE_SIZE = 8;
+    /** Time in ms without a byte after which a window is answered */
+    static constexpr uint32_t IDLE_TIMEOUT = 20;
+    /** Baud rate of the UART */
+    static constexpr uint32_t BAUD_RATE = 115200;
+
+    /**
+     * Status sent in a response
+     */
+    enum class Status {
+        /** Send the frames from the sequence number in the response */
+        CONTINUE = 0,
+        /** The image is stored */
+        DONE = 1,
+        /** The image was rejected, it has to be sent again from frame 0 */
+        REJECTED = 2,
+    };
+
+    /**
+     * Serial link to the host
+     */
+    class Link {
+    public:
+        virtual ~Link() = default;
+
+        /**
+         * Check if a byte has been received
+         *
+         * @return True if read() returns right away
+         */
+        virtual bool isReadable() = 0;
+
+        /**
+         * Read a received byte
+         *
+         * @return The byte
+         */
+        virtual uint8_t read() = 0;
+
+        /**
+         * Send bytes to the host
+         *
+         * @param[in] bytes The bytes to send
+         * @param[in] length Number of bytes to send
+         */
+        virtual void write(uint8_t* bytes, uint8_t length) = 0;
+    };
+
+    /**
+     * Make a new receiver, waiting for frame 0
+     *
+     * @param[in] link Link to the host
+     * @param[in] storage Storage the image is downloaded into
+     */
+    SettingsUpload(Link& link, BQSettingsStorage& storage);
+
+    /**
+     * Read the received bytes and answer the window once it is complete,
+     * called from the main loop
+     */
+    void process();
+
+    /**
+     * Check if an image has been stored
+     *
+     * @return True once the last window of an image has been stored
+     */
+    bool isDone() const;
+
+    /**
+     * Get the number of windows answered
+     *
+     * @return Number of responses sent
+     */
+    uint32_t getNumWindows() const;
+
+    /**
+     * Get the number of data frames dropped, for a bad CRC or for coming in
+     * out of order
+     *
+     * @return Number of frames dropped
+     */
+    uint32_t getNumDropped() const;
+
+private:
+    /** Bytes of a data frame before the payload, after the start byte */
+    static constexpr uint8_t FRAME_HEADER_SIZE = 4;
+
+    /** Link to the host */
+    Link& link;
+    /** Storage the image is downloaded into */
+    BQSettingsStorage& storage;
+
+    /** Frame being received, after the start byte */
+    uint8_t frame[FRAME_HEADER_SIZE + MAX_PAYLOAD + 4] = {};
+    /** Number of bytes of the frame received, 0 while looking for the start */
+    uint8_t frameFill = 0;
+    /** True once the start byte of a frame came in */
+    bool inFrame = false;
+
+    /** Payloads of the frames of the window, in order */
+    uint8_t window[WINDOW_FRAMES * MAX_PAYLOAD] = {};
+    /** Number of bytes in window */
+    uint16_t windowFill = 0;
+    /** Number of frames in window */
+    uint8_t windowFrames = 0;
+    /** True if a frame was dropped since the last response */
+    bool hasDropped = false;
+    /** True if frame 0 came in, the download starts over on the next response */
+    bool restartPending = false;
+
+    /** Sequence number of the next frame expected */
+    uint16_t expectedSequence = 0;
+    /** Status sent in the last response */
+    Status status = Status::CONTINUE;
+    /** Time in ms the last byte came in */
+    uint32_t lastByteTime = 0;
+
+    /** Number of responses sent */
+    uint32_t numWindows = 0;
+    /** Number of data frames dropped */
+    uint32_t numDropped = 0;
+
+    /**
+     * Take in a received byte
+     *
+     * @param[in] byte The byte
+     */
+    void receive(uint8_t byte);
+
+    /**
+     * Take in a complete data frame
+     */
+    void handleFrame();
+
+    /**
+     * Store the frames of the window and send the response
+     */
+    void answerWindow();
+};
+
+}// namespace BMS
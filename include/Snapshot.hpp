@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace BMS {
+
+/**
+ * Double buffered set of values which is filled piece by piece and handed
+ * to readers as a whole
+ *
+ * Writers fill the working copy as results come in, then publish() copies it
+ * over the published copy in one go. Readers only ever look at the published
+ * copy, so they see the values of one publish and never a mix of old and new
+ * values, such as cell voltages from one read next to the minimum of another.
+ *
+ * Readers in the same context as the writer, such as the CANopen stack in the
+ * main loop, can read the published copy directly, as it only changes inside
+ * publish(). Readers which can interrupt publish() use read(), which checks
+ * the sequence counter. The counter is odd while a publish is copying and
+ * even otherwise, so a copy taken while it was odd or while it changed is
+ * torn and taken again.
+ *
+ * @tparam T Type of the values, copied as a whole
+ */
+template<class T>
+class Snapshot {
+public:
+    /**
+     * Get the copy which is filled by the writers
+     *
+     * @return The working copy
+     */
+    T& working() {
+        return workingCopy;
+    }
+
+    /**
+     * Get the copy handed to readers, its address does not change so it can
+     * be linked into the object dictionary
+     *
+     * @return The published copy
+     */
+    const T& published() const {
+        return publishedCopy;
+    }
+
+    /**
+     * Copy the working copy over the published copy
+     */
+    void publish() {
+        uint32_t currentSequence = sequence.load(std::memory_order_relaxed);
+        sequence.store(currentSequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        publishedCopy = workingCopy;
+
+        sequence.store(currentSequence + 2, std::memory_order_release);
+    }
+
+    /**
+     * Take a consistent copy of the published values from a context which can
+     * interrupt publish()
+     *
+     * @param[out] copy The published values
+     * @return False if publish() changed the values while copying, the copy
+     * is then torn and has to be taken again
+     */
+    bool read(T& copy) const {
+        uint32_t startSequence = sequence.load(std::memory_order_acquire);
+        if (startSequence & 1) {
+            return false;
+        }
+
+        copy = publishedCopy;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == startSequence;
+    }
+
+    /**
+     * Get the number of publishes so far
+     *
+     * @return The number of completed publishes
+     */
+    uint32_t getNumPublished() const {
+        return sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    /** Values being filled by the writers */
+    T workingCopy{};
+    /** Values handed to the readers */
+    T publishedCopy{};
+    /** Twice the number of publishes, plus one while a publish is copying */
+    std::atomic<uint32_t> sequence{0};
+};
+
+}// namespace BMS
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+
+#include <EVT/dev/storage/M24C32.hpp>
+
+namespace BMS {
+
+/**
+ * Estimates the state of charge (SOC) of the battery pack
+ *
+ * The estimate is made by coulomb counting the pack current reported by the
+ * BQ. Integration is done entirely in integer math: charge is tracked in
+ * milliamp-seconds with the sub-mAs remainder carried between samples so
+ * no charge is lost to rounding. When the pack has been at rest long enough
+ * for the cell voltages to relax, the count is corrected against an open
+ * circuit voltage (OCV) vs SOC table.
+ *
+ * The estimate is persisted to EEPROM whenever it moves by SAVE_DELTA, so it
+ * survives resets of the BMS. Updates only flag that a save is due, the
+ * owner makes the save once it has the EEPROM's bus.
+ */
+class SocEstimator {
+public:
+    /** SOC value representing a full pack, SOC is in units of 0.01% */
+    static constexpr uint16_t SOC_FULL = 10000;
+
+    /** Address in EEPROM where the SOC record is stored (last EEPROM page) */
+    static constexpr uint32_t EEPROM_ADDRESS = 0x0FE0;
+
+    /**
+     * Make a new SOC estimator
+     *
+     * @param[in] eeprom EEPROM used to persist the estimate
+     * @param[in] capacity Capacity of the pack in mAh
+     */
+    SocEstimator(EVT::core::DEV::M24C32& eeprom, uint32_t capacity);
+
+    /**
+     * Restore the estimate from EEPROM
+     *
+     * If no valid record is stored, the estimate is marked as uninitialized
+     * and will be set from the OCV table on the first update.
+     */
+    void load();
+
+    /**
+     * Write the current estimate to EEPROM
+     */
+    void save();
+
+    /**
+     * Integrate a new current sample into the estimate
+     *
+     * A sample more than MAX_SAMPLE_GAP after the last one is not integrated,
+     * it only restarts sampling.
+     *
+     * @param[in] current Pack current in mA, positive when charging
+     * @param[in] cellVoltage Average cell voltage in mV
+     * @param[in] timestamp Time of the sample in milliseconds
+     */
+    void update(int16_t current, uint16_t cellVoltage, uint32_t timestamp);
+
+    /**
+     * Check whether the estimate has moved far enough since the last save,
+     * or was just set from the OCV, to be saved
+     *
+     * @return True if save() should be called
+     */
+    bool isSaveDue();
+
+    /**
+     * Get the estimated state of charge
+     *
+     * @return State of charge in units of 0.01%
+     */
+    uint16_t getSoc();
+
+    /**
+     * Look up the state of charge for a relaxed cell voltage
+     *
+     * @param[in] cellVoltage Open circuit cell voltage in mV
+     * @return State of charge in units of 0.01%
+     */
+    static uint16_t ocvToSoc(uint16_t cellVoltage);
+
+private:
+    /** Value stored with the record to mark it as valid */
+    static constexpr uint16_t RECORD_MAGIC = 0x50C1;
+
+    /** Size of the EEPROM record in bytes */
+    static constexpr uint8_t RECORD_SIZE = 8;
+
+    /** Current magnitude in mA below which the pack is considered at rest */
+    static constexpr int16_t REST_CURRENT = 100;
+
+    /** Time in milliseconds the pack has to be at rest before OCV correction */
+    static constexpr uint32_t REST_TIME = 600000;
+
+    /**
+     * Longest time in milliseconds between samples that is integrated, a
+     * longer gap restarts sampling
+     */
+    static constexpr uint32_t MAX_SAMPLE_GAP = 1000;
+
+    /** Change in SOC (0.01%) since the last save that triggers a new save */
+    static constexpr uint16_t SAVE_DELTA = 100;
+
+    /** Number of points in the OCV table */
+    static constexpr uint8_t OCV_TABLE_SIZE = 11;
+
+    /** Cell OCV in mV at 0%, 10%, ..., 100% SOC */
+    static constexpr uint16_t OCV_TABLE[OCV_TABLE_SIZE] = {
+        3000,
+        3450,
+        3550,
+        3610,
+        3660,
+        3710,
+        3780,
+        3870,
+        3960,
+        4060,
+        4180,
+    };
+
+    /** EEPROM used to persist the estimate */
+    EVT::core::DEV::M24C32& eeprom;
+
+    /** Capacity of the pack in mAs */
+    int32_t capacity;
+
+    /** Charge in mAs represented by one SOC step (0.01%) */
+    int32_t chargePerStep;
+
+    /** Charge remaining in the pack in mAs */
+    int32_t charge = 0;
+
+    /** Charge below 1 mAs in mA*ms carried over between samples */
+    int32_t chargeRemainder = 0;
+
+    /** Time of the last sample in milliseconds */
+    uint32_t lastTimestamp = 0;
+
+    /** Time at which the pack was first seen at rest in milliseconds */
+    uint32_t restStartTime = 0;
+
+    /** SOC at the time of the last save */
+    uint16_t lastSavedSoc = 0;
+
+    /** Whether the charge holds a valid estimate */
+    bool initialized = false;
+
+    /** Whether the estimate has changed enough to be saved */
+    bool saveDue = false;
+
+    /** Whether a sample has been taken since the estimator started */
+    bool hasSample = false;
+
+    /** Whether the pack is currently at rest */
+    bool atRest = false;
+
+    /** Whether the OCV correction has been applied for the current rest */
+    bool restCorrected = false;
+
+    /**
+     * Set the charge from an SOC value
+     *
+     * @param[in] soc State of charge in units of 0.01%
+     */
+    void setSoc(uint16_t soc);
+};
+
+}// namespace BMS
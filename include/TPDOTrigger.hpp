@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+
+namespace BMS {
+
+/**
+ * Decides when event driven TPDOs should be sent
+ *
+ * Each value mapped into a TPDO is watched along with a deadband. When any
+ * value of a TPDO has moved further than its deadband from the value last
+ * sent, the TPDO is reported as needing to be sent, and every value of that
+ * TPDO becomes the new reference. A deadband of 0 reports any change, which
+ * is what states and error flags want.
+ *
+ * The TPDOs themselves are still sent by the CANopen stack, which applies
+ * the inhibit time and the event (keep-alive) timer from the TPDO settings.
+ */
+class TPDOTrigger {
+public:
+    /** Maximum number of values that can be watched */
+    static constexpr uint8_t MAX_VALUES = 48;
+
+    /**
+     * Watch a value mapped into a TPDO
+     *
+     * @param[in] tpdo Number of the TPDO the value is mapped into (0-7)
+     * @param[in] value Pointer to the value
+     * @param[in] deadband Change in the value which triggers the TPDO
+     * @return False if there is no room left to watch the value
+     */
+    bool watch(uint8_t tpdo, const uint8_t* value, uint16_t deadband = 0);
+
+    /**
+     * @copydoc TPDOTrigger::watch(uint8_t, const uint8_t*, uint16_t)
+     */
+    bool watch(uint8_t tpdo, const uint16_t* value, uint16_t deadband = 0);
+
+    /**
+     * @copydoc TPDOTrigger::watch(uint8_t, const uint8_t*, uint16_t)
+     */
+    bool watch(uint8_t tpdo, const int16_t* value, uint16_t deadband = 0);
+
+    /**
+     * Check the watched values and get the TPDOs which should be sent
+     *
+     * The values of the returned TPDOs become the reference for the next
+     * call, so the caller is expected to trigger them.
+     *
+     * @return Mask with bit N set if TPDO N should be sent
+     */
+    uint8_t poll();
+
+private:
+    /** Type of a watched value */
+    enum class ValueType : uint8_t {
+        UNSIGNED8 = 0,
+        UNSIGNED16 = 1,
+        SIGNED16 = 2,
+    };
+
+    /**
+     * A value being watched
+     *
+     * @var value Pointer to the value
+     * @var type Type of the value
+     * @var tpdo TPDO the value is mapped into
+     * @var deadband Change in the value which triggers the TPDO
+     * @var lastSent Value when the TPDO was last triggered
+     */
+    struct WatchedValue {
+        const void* value;
+        ValueType type;
+        uint8_t tpdo;
+        uint16_t deadband;
+        int32_t lastSent;
+    };
+
+    /**
+     * Add a value to the watched values
+     *
+     * @param[in] tpdo Number of the TPDO the value is mapped into
+     * @param[in] value Pointer to the value
+     * @param[in] type Type of the value
+     * @param[in] deadband Change in the value which triggers the TPDO
+     * @return False if there is no room left to watch the value
+     */
+    bool add(uint8_t tpdo, const void* value, ValueType type, uint16_t deadband);
+
+    /**
+     * Read the current value of a watched value
+     *
+     * @param[in] watched The watched value
+     * @return The current value
+     */
+    static int32_t read(const WatchedValue& watched);
+
+    /** Values being watched */
+    WatchedValue values[MAX_VALUES] = {};
+    /** Number of values being watched */
+    uint8_t numValues = 0;
+};
+
+}// namespace BMS
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+
+namespace BMS {
+
+/**
+ * Cooperative, fixed-capacity periodic task scheduler
+ *
+ * Tasks are registered once with a period and a priority and are then run
+ * from BMS::process whenever they are due. No memory is allocated, all tasks
+ * live in a statically sized table. Tasks run to completion, so a long running
+ * task delays every task behind it; the per-task statistics expose this so
+ * the loop headroom can be inspected.
+ */
+class TaskScheduler {
+public:
+    /** Maximum number of tasks that can be registered */
+    static constexpr uint8_t MAX_TASKS = 8;
+
+    /** Task mask which selects every registered task */
+    static constexpr uint32_t ALL_TASKS = 0xFFFFFFFF;
+
+    /**
+     * Function that is run by the scheduler
+     *
+     * @param[in] priv Private data that was provided when registering the task
+     */
+    typedef void (*TaskFunction)(void* priv);
+
+    /**
+     * Run time statistics of a single task
+     *
+     * @var lastExecTime Execution time of the most recent run in milliseconds
+     * @var maxExecTime Longest execution time seen in milliseconds
+     * @var numRuns Number of times the task has run
+     * @var numOverruns Number of runs which either took longer than the task
+     *                  period or started more than a full period late
+     */
+    struct TaskStats {
+        uint32_t lastExecTime;
+        uint32_t maxExecTime;
+        uint32_t numRuns;
+        uint32_t numOverruns;
+    };
+
+    /**
+     * Make a new scheduler with no tasks
+     */
+    TaskScheduler();
+
+    /**
+     * Register a new periodic task
+     *
+     * Tasks with a lower priority value run first when several tasks are due
+     * in the same call to TaskScheduler::process.
+     *
+     * @param[in] func Function to run
+     * @param[in] priv Private data passed to the function
+     * @param[in] period Time in milliseconds between runs of the task
+     * @param[in] priority Priority of the task, 0 being the highest
+     * @return ID of the task, or MAX_TASKS if the task table is full
+     */
+    uint8_t addTask(TaskFunction func, void* priv, uint32_t period, uint8_t priority);
+
+    /**
+     * Run every task which is due and selected by the task mask
+     *
+     * @param[in] taskMask Bit mask of the task IDs which are allowed to run
+     */
+    void process(uint32_t taskMask = ALL_TASKS);
+
+    /**
+     * Make every task due on the next call to TaskScheduler::process
+     */
+    void reset();
+
+    /**
+     * Get the run time statistics of a task
+     *
+     * @param[in] taskId ID of the task returned by TaskScheduler::addTask
+     * @return The statistics of the task, all zero for an unknown ID
+     */
+    TaskStats getTaskStats(uint8_t taskId);
+
+    /**
+     * Get the task mask bit for a task
+     *
+     * @param[in] taskId ID of the task returned by TaskScheduler::addTask
+     * @return Mask with only the bit of the given task set
+     */
+    static constexpr uint32_t taskMask(uint8_t taskId) {
+        return 1u << taskId;
+    }
+
+private:
+    /**
+     * Entry of the task table
+     */
+    struct Task {
+        /** Function to run */
+        TaskFunction func;
+        /** Private data passed to the function */
+        void* priv;
+        /** Time in milliseconds between runs */
+        uint32_t period;
+        /** Time in milliseconds at which the task is next due */
+        uint32_t nextRunTime;
+        /** Priority of the task, 0 being the highest */
+        uint8_t priority;
+        /** ID of the task, index of registration */
+        uint8_t id;
+        /** Run time statistics of the task */
+        TaskStats stats;
+    };
+
+    /** Task table, kept sorted by priority */
+    Task tasks[MAX_TASKS] = {};
+
+    /** Number of registered tasks */
+    uint8_t numTasks = 0;
+};
+
+}// namespace BMS
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstdint>
+
+#include <co_core.h>
+
+namespace BMS {
+
+/**
+ * RAM ring buffer of the pack telemetry over the last few seconds, for
+ * looking into a fault after the fact
+ *
+ * Samples are delta encoded into fixed size blocks. The first record of a
+ * block is a keyframe holding every value of the sample. Every later record
+ * holds the time since the previous sample and only the values which
+ * changed, as the difference to the previous sample:
+ *
+ *  - Keyframe: time (uint32), cell voltages (uint16), current (int16),
+ *    temperatures, BQ status bytes and error register (uint8), little endian
+ *  - Delta: varint time difference, varint mask of the changed fields, then
+ *    a zigzag varint difference for each changed field in field order
+ *
+ * Varints are 7 bits per byte, least significant group first, with the top
+ * bit set on every byte but the last. A record which does not fit in the
+ * rest of the block starts the next block with a keyframe, and when every
+ * block is in use the oldest block is dropped. Every block decodes on its
+ * own.
+ *
+ * The recorder is frozen when the BMS detects a fault, so the log keeps the
+ * samples leading up to it. The log is downloaded over a CANopen SDO domain
+ * through TelemetryRecorder::canOpenInterface, which also freezes it so the
+ * download is consistent. Recording only starts again once the frozen flag
+ * is cleared.
+ *
+ * The downloaded log is a header of the format version (uint8), the number
+ * of blocks (uint8) and the number of samples (uint16), followed by each
+ * block from oldest to newest as its length (uint16) and its records.
+ */
+class TelemetryRecorder {
+public:
+    /** Number of cell voltages in a sample */
+    static constexpr uint8_t NUM_CELLS = 12;
+    /** Number of temperatures in a sample, the thermistors then the BQ */
+    static constexpr uint8_t NUM_TEMPS = 9;
+    /** Number of BQ status bytes in a sample */
+    static constexpr uint8_t NUM_STATUS = 7;
+    /** Number of values in a sample, not counting the time */
+    static constexpr uint8_t NUM_FIELDS = NUM_CELLS + 1 + NUM_TEMPS + NUM_STATUS + 1;
+
+    /** Size of a block in bytes */
+    static constexpr uint16_t BLOCK_SIZE = 256;
+    /**
+     * Number of blocks in the ring buffer, about 1.5 s of samples at the
+     * 20 ms recording period within the 1.5 KB of RAM set aside for the log
+     */
+    static constexpr uint8_t NUM_BLOCKS = 6;
+
+    /** Version of the downloaded log format */
+    static constexpr uint8_t FORMAT_VERSION = 1;
+    /** Size of the header of the downloaded log in bytes */
+    static constexpr uint8_t LOG_HEADER_SIZE = 4;
+    /** Size of a keyframe in bytes */
+    static constexpr uint8_t KEYFRAME_SIZE = 4 + NUM_CELLS * 2 + 2 + NUM_TEMPS + NUM_STATUS + 1;
+
+    /**
+     * Values recorded at one point in time
+     *
+     * @var time Time of the sample in milliseconds
+     * @var cellVoltage Per-cell voltage in mV
+     * @var current Total current through the battery
+     * @var temperature Thermistor temperatures, then the BQ internal and
+     * on-board temperatures
+     * @var bqStatus Status information pulled from the BQ
+     * @var errorRegister Errors which have occurred on the BMS
+     */
+    struct Sample {
+        uint32_t time;
+        uint16_t cellVoltage[NUM_CELLS];
+        int16_t current;
+        uint8_t temperature[NUM_TEMPS];
+        uint8_t bqStatus[NUM_STATUS];
+        uint8_t errorRegister;
+    };
+
+    /**
+     * Make a new, empty and recording, recorder
+     */
+    TelemetryRecorder();
+
+    /**
+     * Add a sample to the log, ignored while frozen
+     *
+     * @param[in] sample The sample
+     */
+    void record(const Sample& sample);
+
+    /**
+     * Stop recording, keeping the samples in the log
+     */
+    void freeze();
+
+    /**
+     * Check if recording is stopped
+     *
+     * @return True if frozen
+     */
+    bool isFrozen() const;
+
+    /**
+     * Get the flag which is set while frozen, linked into the object
+     * dictionary so it can be cleared over CANopen to start recording again
+     *
+     * @return Pointer to the frozen flag
+     */
+    uint8_t* getFrozenFlag();
+
+    /**
+     * Get the number of samples in the log
+     *
+     * @return The number of samples
+     */
+    uint16_t getNumSamples() const;
+
+    /**
+     * Get the size of the downloaded log
+     *
+     * @return Size of the log in bytes, including the header
+     */
+    uint32_t getLogSize() const;
+
+    /**
+     * Copy part of the downloaded log
+     *
+     * @param[in] offset Offset into the log
+     * @param[out] buffer The buffer to fill
+     * @param[in] length Number of bytes to copy
+     * @return Number of bytes copied, less than length at the end of the log
+     */
+    uint32_t readLog(uint32_t offset, uint8_t* buffer, uint32_t length) const;
+
+    /**
+     * CANopen stack interface. Exposes the log as a read only domain, the
+     * object's data has to point to the recorder.
+     */
+    CO_OBJ_TYPE canOpenInterface;
+
+private:
+    /** Largest delta record, every field changed by the most it can */
+    static constexpr uint8_t MAX_DELTA_SIZE = 5 + 5 + NUM_FIELDS * 3;
+
+    /** Encoded samples */
+    uint8_t blocks[NUM_BLOCKS][BLOCK_SIZE] = {};
+    /** Number of bytes used in each block */
+    uint16_t blockLength[NUM_BLOCKS] = {};
+    /** Number of samples in each block */
+    uint8_t blockSamples[NUM_BLOCKS] = {};
+    /** Block samples are being added to */
+    uint8_t currentBlock = 0;
+    /** Number of blocks in use */
+    uint8_t numBlocks = 0;
+    /** Values of the last recorded sample */
+    int32_t lastFields[NUM_FIELDS] = {};
+    /** Time of the last recorded sample */
+    uint32_t lastTime = 0;
+    /** Set while frozen, written over CANopen */
+    uint8_t frozen = 0;
+    /** Offset of the next CANopen read into the log */
+    uint32_t readOffset = 0;
+
+    /**
+     * Start the next block with a keyframe, dropping the oldest block if
+     * every block is in use
+     *
+     * @param[in] sample The sample
+     * @param[in] fields The values of the sample
+     */
+    void startBlock(const Sample& sample, const int32_t fields[NUM_FIELDS]);
+
+    /**
+     * Encode the difference to the last sample
+     *
+     * @param[in] sample The sample
+     * @param[in] fields The values of the sample
+     * @param[out] buffer The buffer to fill, MAX_DELTA_SIZE in size
+     * @return The size of the record
+     */
+    uint8_t encodeDelta(const Sample& sample, const int32_t fields[NUM_FIELDS], uint8_t* buffer) const;
+
+    /**
+     * Get the index of a block from its age
+     *
+     * @param[in] age 0 for the oldest block in use
+     * @return The index into blocks
+     */
+    uint8_t blockIndex(uint8_t age) const;
+
+    /**
+     * Flatten a sample into its values, in field order
+     *
+     * @param[in] sample The sample
+     * @param[out] fields The values
+     */
+    static void toFields(const Sample& sample, int32_t fields[NUM_FIELDS]);
+
+    /**
+     * Append a varint
+     *
+     * @param[in] value The value
+     * @param[out] buffer The buffer to append to
+     * @return The number of bytes written
+     */
+    static uint8_t putVarint(uint32_t value, uint8_t* buffer);
+
+    // CANopen stack callbacks, the object data points to the recorder
+    static uint32_t canOpenSize(CO_OBJ_T* obj, CO_NODE_T* node, uint32_t width);
+    static CO_ERR canOpenCtrl(CO_OBJ_T* obj, CO_NODE_T* node, uint16_t func, uint32_t para);
+    static CO_ERR canOpenRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len);
+    static CO_ERR canOpenWrite(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len);
+};
+
+}// namespace BMS
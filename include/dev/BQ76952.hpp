@@ -4,8 +4,7 @@
 
 #include <BMSInfo.hpp>
 #include <BQSetting.hpp>
-
-#include <co_obj.h>
+#include <I2CTransactionQueue.hpp>
 
 namespace BMS::DEV {
 
@@ -25,6 +24,12 @@ public:
      */
     static constexpr uint8_t NUM_CELLS = 12;
 
+    /**
+     * The largest block that can be written to RAM at once, the size of
+     * the subcommand transfer buffer (0x40-0x5F)
+     */
+    static constexpr uint8_t MAX_RAM_BLOCK_SIZE = 32;
+
     /**
      * Represents the status of operation of the BQ76952
      *
@@ -42,6 +47,27 @@ public:
         ERROR = 0x40,
     };
 
+    /**
+     * Periodic reads of the BQ data which can be run through an I2C
+     * transaction queue. Each one is submitted with submitRead() and, once
+     * its callback ran, decoded with the matching collect function.
+     */
+    enum class DataRead {
+        /** Cell voltages, collectCellVoltage() */
+        CELL_VOLTAGE = 0,
+        /** Pack current, collectCurrent() */
+        CURRENT = 1,
+        /** Stack voltage and status registers, collectStatus() */
+        STATUS = 2,
+        /** BQ temperatures, collectTemps() */
+        TEMPS = 3,
+        /** Cells being balanced, collectBalancing() */
+        BALANCING = 4,
+    };
+
+    /** Number of DataRead values */
+    static constexpr uint8_t NUM_DATA_READS = 5;
+
     /**
      * Create a new instance of the BQ76952 which will communicate over the
      * given I2C bus with the given address
@@ -86,6 +112,20 @@ public:
      */
     Status makeDirectRead(uint8_t reg, uint16_t* result);
 
+    /**
+     * Execute a block read of consecutive direct command registers
+     *
+     * The BQ auto-increments the register address during a read, so a
+     * contiguous window of direct command results can be fetched in a single
+     * I2C transaction instead of one write-address + read per register.
+     *
+     * @param[in] reg The first I2C register address to read from
+     * @param[out] buffer The buffer to fill with the raw register bytes
+     * @param[in] numBytes The number of bytes to read
+     * @return The status of the read request attempt
+     */
+    Status makeBlockRead(uint8_t reg, uint8_t* buffer, uint8_t numBytes);
+
     /**
      * Execute a subcommand read request
      *
@@ -138,6 +178,24 @@ public:
      */
     Status writeRAMSetting(BQSetting& setting);
 
+    /**
+     * Write a block of contiguous RAM in a single subcommand buffer write
+     *
+     * The address and all data bytes are sent in one transfer, followed by
+     * the checksum and length. The block is then verified by reading it back
+     * in one transfer, rather than once per setting.
+     *
+     * @param[in] address The RAM address of the first byte
+     * @param[in] data The bytes to write
+     * @param[in] numBytes The number of bytes, at most MAX_RAM_BLOCK_SIZE
+     * @return The result of the block write attempt
+     *         Status::I2C_ERROR => Failed to communicate with the BQ
+     *         Status::ERROR => Block not accepted by BQ
+     *         Status::TIMEOUT => BQ did not complete the write in time
+     *         Status::OK => Successfully wrote out the block
+     */
+    Status writeRAMBlock(uint16_t address, const uint8_t* data, uint8_t numBytes);
+
     /**
      * Check to see if the BQ chip is in configure mode
      *
@@ -193,6 +251,17 @@ public:
      */
     Status setBalancing(uint8_t targetCell, uint8_t enable);
 
+    /**
+     * Write out the balancing state of every cell at once
+     *
+     * The whole mask goes out in a single write of CB_ACTIVE_CELLS. Host
+     * controlled balancing has to be set up in the BQ settings.
+     *
+     * @param[in] cellMask Mask with bit N set to balance cell N + 1
+     * @return The status of the write attempt
+     */
+    Status setBalancingMask(uint16_t cellMask);
+
     /**
      * Read the current running through pack
      *
@@ -225,8 +294,66 @@ public:
      */
     Status getBQStatus(uint8_t bqStatusArr[7]);
 
-    /** CANopen interface for probing the state of the balancing */
-    //CO_OBJ_TYPE balancingCANOpen;
+    /**
+     * Queue the I2C transfers of a periodic data read
+     *
+     * The results are decoded with the matching collect function once the
+     * callback ran. If the same read is still in flight it is left to
+     * complete and not queued again.
+     *
+     * @param[in] queue The transaction queue of the BQ I2C bus
+     * @param[in] read The data to read
+     * @param[in] callback Called when the read completes
+     * @param[in] priv Private data for the callback
+     * @return Status::OK if the read is queued or still in flight,
+     *         Status::ERROR if the queue is full
+     */
+    Status submitRead(I2CTransactionQueue& queue, DataRead read,
+                      I2CTransactionQueue::Callback callback, void* priv);
+
+    /**
+     * Decode a completed DataRead::CELL_VOLTAGE read
+     *
+     * @param[out] cellVoltages The buffer to fill with the cell voltage, must
+     *                          be NUM_CELLS in size
+     * @param[out] sum The total voltage across all cells
+     * @param[out] voltageInfo Minimum and maximum cell voltages
+     * @return Status::I2C_ERROR if the read did not complete successfully
+     */
+    Status collectCellVoltage(uint16_t cellVoltages[NUM_CELLS], uint32_t& sum, CellVoltageInfo& voltageInfo);
+
+    /**
+     * Decode a completed DataRead::CURRENT read
+     *
+     * @param[out] current Current running through the pack
+     * @return Status::I2C_ERROR if the read did not complete successfully
+     */
+    Status collectCurrent(int16_t& current);
+
+    /**
+     * Decode a completed DataRead::STATUS read
+     *
+     * @param[out] totalVoltage Total voltage of the pack
+     * @param[out] bqStatusArr BQ status information
+     * @return Status::I2C_ERROR if the read did not complete successfully
+     */
+    Status collectStatus(uint16_t& totalVoltage, uint8_t bqStatusArr[7]);
+
+    /**
+     * Decode a completed DataRead::TEMPS read
+     *
+     * @param[out] bqTempInfo Temperature information measured by the BQ
+     * @return Status::I2C_ERROR if the read did not complete successfully
+     */
+    Status collectTemps(BqTempInfo& bqTempInfo);
+
+    /**
+     * Decode a completed DataRead::BALANCING read
+     *
+     * @param[out] cellMask Mask with bit N set if cell N + 1 is being balanced
+     * @return Status::I2C_ERROR if the read did not complete successfully
+     */
+    Status collectBalancing(uint16_t& cellMask);
 
 private:
     /** Used for commands and subcommands */
@@ -241,9 +368,21 @@ private:
     /** Base address where the cell voltages are located */
     static constexpr uint8_t CELL_VOLTAGE_BASE_ADDR = 0x14;
 
+    /**
+     * Number of bytes in the cell voltage window (0x14-0x33). Covers all 16
+     * cell inputs of the BQ, 2 bytes per cell.
+     */
+    static constexpr uint8_t CELL_VOLTAGE_WINDOW_SIZE = 32;
+
+    /** Direct command registers of the periodic reads */
+    static constexpr uint8_t CURRENT_ADDR = 0x3A;
+    static constexpr uint8_t STATUS_READ_ADDRS[] = {0x34, 0x02, 0x04, 0x06, 0x62, 0x12};
+    static constexpr uint8_t TEMP_READ_ADDRS[] = {0x68, 0x70, 0x74};
+
     /** Addresses for controlling balancing */
     static constexpr uint16_t BALANCING_CONFIG_ADDR = 0x9335;
     static constexpr uint16_t ACTIVE_BALANCING_ADDR = 0x0083;
+    static constexpr uint8_t ACTIVE_BALANCING_SUBCOMMAND[2] = {0x83, 0x00};
 
     /** Used to enter and exit config mode */
     static constexpr uint8_t ENTER_CONFIG[2] = {0x90, 0x00};
@@ -281,6 +420,34 @@ private:
     EVT::core::IO::I2C& i2c;
     /** The address of the BQ76952 on the I2C bus */
     uint8_t i2cAddress;
+
+    /** Transactions of the periodic reads, indexed by DataRead */
+    I2CTransactionQueue::Transaction dataReads[NUM_DATA_READS];
+    /** Raw bytes of the periodic reads, filled by the transaction queue */
+    uint8_t rawCellVoltages[CELL_VOLTAGE_WINDOW_SIZE] = {};
+    uint8_t rawCurrent[2] = {};
+    uint8_t rawStatus[2 * sizeof(STATUS_READ_ADDRS)] = {};
+    uint8_t rawTemps[2 * sizeof(TEMP_READ_ADDRS)] = {};
+    uint8_t rawBalancing[2] = {};
+
+    /**
+     * Check if a periodic read completed successfully
+     *
+     * @param[in] read The read
+     * @return Status::OK if it did, Status::I2C_ERROR otherwise
+     */
+    Status readResult(DataRead read);
+
+    /**
+     * Pull the cell voltages out of the raw cell voltage window
+     *
+     * @param[in] rawVoltages The cell voltage window, CELL_VOLTAGE_WINDOW_SIZE bytes
+     * @param[out] cellVoltages The cell voltages
+     * @param[out] sum The total voltage across all cells
+     * @param[out] voltageInfo Minimum and maximum cell voltages
+     */
+    static void decodeCellVoltages(const uint8_t* rawVoltages, uint16_t cellVoltages[NUM_CELLS],
+                                   uint32_t& sum, CellVoltageInfo& voltageInfo);
 };
 
 }// namespace BMS::DEV
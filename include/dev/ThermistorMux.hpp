@@ -1,9 +1,11 @@
 #pragma once
 
-#include <EVT/dev/Thermistor.hpp>
+#include <EVT/io/ADC.hpp>
 #include <EVT/io/GPIO.hpp>
 #include <EVT/utils/time.hpp>
 
+#include <dev/ThermistorTable.hpp>
+
 namespace IO = EVT::core::IO;
 namespace time = EVT::core::time;
 
@@ -11,6 +13,11 @@ namespace BMS::DEV {
 
 /**
  * Multiplexer connected to thermistors
+ *
+ * Each reading takes OVERSAMPLE_COUNT ADC samples and uses their median, so
+ * single sample spikes are dropped. The non-blocking reads also run each
+ * thermistor through its own fixed-point IIR low pass filter, which smooths
+ * the remaining noise enough for a reading to be acted on directly.
  */
 class ThermistorMux {
 public:
@@ -22,36 +29,92 @@ public:
      */
     ThermistorMux(IO::GPIO* muxSelectArr[3], IO::ADC& adc);
 
+    /** Number of thermistors the MUX can select */
+    static constexpr uint8_t NUM_CHANNELS = 8;
+
     /**
      * Get temperature from one thermistor
      *
+     * Blocks for the settling time. The reading is the median of the
+     * oversampled ADC samples, it does not go through or update the IIR
+     * filter of the thermistor.
+     *
      * @param[in] thermNum Number of thermistor to read
-     * @return Thermistor temperature
+     * @return Thermistor temperature in 0.1 C
      */
-    uint16_t getTemp(uint8_t thermNum);
+    int16_t getTemp(uint8_t thermNum);
+
+    /**
+     * Non-blocking temperature read of one thermistor
+     *
+     * The first call for a thermistor selects it on the MUX and returns
+     * immediately. Subsequent calls return false until the MUX has had
+     * SETTLING_TIME milliseconds to settle, at which point the ADC is
+     * oversampled, the median is added to the IIR filter of the thermistor
+     * and the filtered temperature is returned. The first reading of a
+     * thermistor starts its filter at that reading. Requesting a different
+     * thermistor while one is settling restarts the selection.
+     *
+     * @param[in] thermNum Number of thermistor to read
+     * @param[out] temp Filtered thermistor temperature in 0.1 C, only updated when true is returned
+     * @return True if a new sample was taken, false if still settling
+     */
+    bool pollTemp(uint8_t thermNum, int16_t& temp);
 
 private:
+    /**
+     * States of the non-blocking acquisition
+     */
+    enum class AcquisitionState {
+        /** No thermistor is selected */
+        IDLE = 0,
+        /** A thermistor is selected and the MUX output is settling */
+        SETTLING = 1,
+    };
+
+    /** Time in milliseconds for the MUX output to settle after selection */
+    static constexpr uint32_t SETTLING_TIME = 40;
+
+    /** Number of ADC samples per reading, odd so the median is a sample */
+    static constexpr uint8_t OVERSAMPLE_COUNT = 5;
+
+    /** A new reading moves the filtered temperature 1 / 2^IIR_SHIFT of the way */
+    static constexpr uint8_t IIR_SHIFT = 1;
+
+    /** Fraction bits kept in the filtered temperatures */
+    static constexpr uint8_t FILTER_FRACTION_BITS = 4;
+
+    /** Conversion from ADC counts to temperature, generated at compile time */
+    static constexpr ThermistorTable TEMP_TABLE{ThermistorTable::DEV1_PARAMS};
+
     /** Array of MUX select pins */
     IO::GPIO* muxSelectArr[3];
-    /** Thermistor instance to read the temperatures with */
-    EVT::core::DEV::Thermistor therm;
+    /** Current state of the non-blocking acquisition */
+    AcquisitionState acquisitionState = AcquisitionState::IDLE;
+    /** The thermistor currently selected on the MUX */
+    uint8_t selectedTherm = 0;
+    /** Time in milliseconds at which the current thermistor was selected */
+    uint32_t selectTime = 0;
+    /** ADC the MUX output is connected to */
+    IO::ADC& adc;
+    /** Filtered temperature of each thermistor, 0.1 C with FILTER_FRACTION_BITS */
+    int32_t filteredTemp[NUM_CHANNELS] = {};
+    /** Bit N is set once thermistor N has a filtered temperature */
+    uint8_t filterStarted = 0;
 
     /**
-     * Conversion equation from ADC counts to temperature in Celsius
+     * Set the MUX select pins to route the given thermistor to the ADC
      *
-     * T(x) = 0.00000375688x^2 + 0.0121347x - 15.9911
-     * Returns value in Celsius
-     *
-     * @param adcCounts ADC reading to convert
-     * @return Thermistor temperature in Celsius
+     * @param[in] thermNum Number of thermistor to select
      */
-    static uint32_t convert(uint32_t adcCounts) {
-        uint16_t temp;
-
-        temp = (((uint64_t) adcCounts * adcCounts) * 375688 + ((uint64_t) adcCounts) * 1213470000 - 1599110000000) / 100000000000;
+    void select(uint8_t thermNum);
 
-        return temp;
-    }
+    /**
+     * Oversample the ADC and convert the median of the samples
+     *
+     * @return Temperature in 0.1 C
+     */
+    int16_t readMedianTemp();
 };
 
 }// namespace BMS::DEV
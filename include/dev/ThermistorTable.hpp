@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdint>
+
+namespace BMS::DEV {
+
+/**
+ * Conversion from thermistor ADC counts to temperature through a lookup table
+ *
+ * The thermistor is an NTC on the high side of a voltage divider, with a fixed
+ * resistor to ground across which the ADC measures, so the ADC count rises
+ * with the temperature. The table holds the temperature at every STEP ADC
+ * counts and is generated at compile time from a quadratic fit of a
+ * calibration, or from the Beta or the Steinhart-Hart model of the NTC. A
+ * conversion is then a table read and a linear interpolation in 32-bit
+ * integer math.
+ *
+ * Temperatures are in signed tenths of a degree Celsius, clamped to
+ * MIN_TEMP and MAX_TEMP.
+ */
+class ThermistorTable {
+public:
+    /**
+     * Models of the NTC resistance over temperature
+     */
+    enum class Model {
+        /** 1/T = 1/T25 + ln(R/R25)/beta */
+        BETA = 0,
+        /** 1/T = A + B*ln(R) + C*ln(R)^3 */
+        STEINHART_HART = 1,
+        /** T = fit2*x^2 + fit1*x + fit0, in C from the ADC counts x */
+        QUADRATIC = 2,
+    };
+
+    /**
+     * Parameters of the thermistor circuit
+     *
+     * @var model Model used to generate the table
+     * @var r25 Resistance of the NTC at 25 C in ohms, Beta model
+     * @var beta Beta value of the NTC in kelvin, Beta model
+     * @var a Steinhart-Hart A coefficient
+     * @var b Steinhart-Hart B coefficient
+     * @var c Steinhart-Hart C coefficient
+     * @var fixedResistor Resistance of the fixed divider resistor in ohms,
+     * Beta and Steinhart-Hart models
+     * @var fit2 Coefficient of x^2, quadratic fit
+     * @var fit1 Coefficient of x, quadratic fit
+     * @var fit0 Constant term, quadratic fit
+     */
+    struct Params {
+        Model model;
+        double r25;
+        double beta;
+        double a;
+        double b;
+        double c;
+        double fixedResistor;
+        double fit2;
+        double fit1;
+        double fit0;
+    };
+
+    /**
+     * Thermistors of the DEV1 BMS, the quadratic fit of their calibration
+     * that ThermistorMux evaluated at run time before the table
+     */
+    static constexpr Params DEV1_PARAMS = {
+        .model = Model::QUADRATIC,
+        .r25 = 0.0,
+        .beta = 0.0,
+        .a = 0.0,
+        .b = 0.0,
+        .c = 0.0,
+        .fixedResistor = 0.0,
+        .fit2 = 0.00000375688,
+        .fit1 = 0.0121347,
+        .fit0 = -15.9911,
+    };
+
+    /** Number of ADC counts, 12-bit ADC */
+    static constexpr uint32_t ADC_COUNTS = 4096;
+    /** log2 of the ADC counts between two table points */
+    static constexpr uint8_t STEP_SHIFT = 5;
+    /** ADC counts between two table points */
+    static constexpr uint32_t STEP = 1 << STEP_SHIFT;
+    /** Number of table points, including both ends of the ADC range */
+    static constexpr uint32_t NUM_POINTS = ADC_COUNTS / STEP + 1;
+
+    /** Lowest temperature reported, in 0.1 C */
+    static constexpr int16_t MIN_TEMP = -400;
+    /** Highest temperature reported, in 0.1 C */
+    static constexpr int16_t MAX_TEMP = 1250;
+
+    /**
+     * Generate the table for a thermistor circuit
+     *
+     * @param[in] params The thermistor circuit
+     */
+    constexpr explicit ThermistorTable(const Params& params) {
+        for (uint32_t i = 0; i < NUM_POINTS; i++) {
+            double temp = modelTemp(params, i * STEP);
+            points[i] = static_cast<int16_t>(temp < 0 ? temp - 0.5 : temp + 0.5);
+        }
+    }
+
+    /**
+     * Convert ADC counts to temperature
+     *
+     * @param[in] adcCounts ADC reading, counts past the ADC range are clamped
+     * @return Temperature in 0.1 C
+     */
+    int16_t convert(uint32_t adcCounts) const {
+        if (adcCounts >= ADC_COUNTS) {
+            return points[NUM_POINTS - 1];
+        }
+
+        uint32_t index = adcCounts >> STEP_SHIFT;
+        int32_t fraction = static_cast<int32_t>(adcCounts & (STEP - 1));
+        int32_t low = points[index];
+        int32_t high = points[index + 1];
+
+        return static_cast<int16_t>(low + (((high - low) * fraction) >> STEP_SHIFT));
+    }
+
+    /**
+     * Temperature the model gives for an ADC reading, the exact value the
+     * table approximates
+     *
+     * @param[in] params The thermistor circuit
+     * @param[in] adcCounts ADC reading
+     * @return Temperature in 0.1 C, clamped to MIN_TEMP and MAX_TEMP
+     */
+    static constexpr double modelTemp(const Params& params, uint32_t adcCounts) {
+        double temp = 0.0;
+        if (params.model == Model::QUADRATIC) {
+            double x = adcCounts;
+            temp = (params.fit2 * x * x + params.fit1 * x + params.fit0) * 10.0;
+        } else {
+            // No current through the divider, the NTC is colder than any model
+            if (adcCounts == 0) {
+                return MIN_TEMP;
+            }
+            if (adcCounts >= ADC_COUNTS) {
+                return MAX_TEMP;
+            }
+
+            double resistance = params.fixedResistor * (ADC_COUNTS - adcCounts) / adcCounts;
+            double inverseKelvin = 0.0;
+            if (params.model == Model::BETA) {
+                inverseKelvin = 1.0 / T25 + log(resistance / params.r25) / params.beta;
+            } else {
+                double lnR = log(resistance);
+                inverseKelvin = params.a + params.b * lnR + params.c * lnR * lnR * lnR;
+            }
+            temp = (1.0 / inverseKelvin - ZERO_CELSIUS) * 10.0;
+        }
+
+        if (temp < MIN_TEMP) {
+            return MIN_TEMP;
+        }
+        if (temp > MAX_TEMP) {
+            return MAX_TEMP;
+        }
+        return temp;
+    }
+
+private:
+    /** 0 C in kelvin */
+    static constexpr double ZERO_CELSIUS = 273.15;
+    /** 25 C in kelvin */
+    static constexpr double T25 = ZERO_CELSIUS + 25.0;
+    /** ln(2) */
+    static constexpr double LN2 = 0.69314718055994530942;
+
+    /**
+     * Natural logarithm usable at compile time, std::log is not constexpr
+     *
+     * Scales x into [1, 2) by powers of two, then sums the series
+     * ln(x) = 2 * (y + y^3/3 + y^5/5 + ...) with y = (x - 1) / (x + 1) <= 1/3.
+     *
+     * @param[in] x Value to take the logarithm of, has to be positive
+     * @return ln(x)
+     */
+    static constexpr double log(double x) {
+        int32_t exponent = 0;
+        while (x >= 2.0) {
+            x /= 2.0;
+            exponent++;
+        }
+        while (x < 1.0) {
+            x *= 2.0;
+            exponent--;
+        }
+
+        double y = (x - 1.0) / (x + 1.0);
+        double ySquared = y * y;
+        double term = y;
+        double sum = 0.0;
+        for (uint8_t n = 1; n < 40; n += 2) {
+            sum += term / n;
+            term *= ySquared;
+        }
+
+        return 2.0 * sum + exponent * LN2;
+    }
+
+    /** Temperature in 0.1 C at every STEP ADC counts */
+    int16_t points[NUM_POINTS] = {};
+};
+
+}// namespace BMS::DEV
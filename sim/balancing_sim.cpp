@@ -0,0 +1,241 @@
+/**
+ * Host simulation of the passive cell balancing
+ *
+ * Runs the balancing controller against a model of the 12 cell pack, each
+ * cell an open circuit voltage curve, an internal resistance and a bleed
+ * resistor switched in by the balancing mask, and reports how long the pack
+ * takes to balance:
+ *
+ * - Rest: the pack sits in SYSTEM_READY with the cells spread over a few
+ *   percent of charge
+ * - Charge: the pack is charged until its highest cell is full, balanced
+ *   while charging and afterwards
+ * - Warm: the rest case close to the pack temperature limit, fewer cells
+ *   are bled at once
+ * - Hot: the rest case over the pack temperature limit, nothing is bled
+ *
+ * Every mask is checked to bleed no neighbouring cell inputs and no more
+ * cells than allowed at the temperature.
+ *
+ * Usage: balancing_sim
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <BalancingController.hpp>
+
+using BMS::BalancingController;
+
+constexpr uint8_t NUM_CELLS = BalancingController::NUM_CELLS;
+
+/** Capacity of a cell in mAh, matches the BMS */
+constexpr double CELL_CAPACITY = 20000.0;
+
+/** Internal resistance of a cell in ohm */
+constexpr double CELL_RESISTANCE = 0.002;
+
+/** Resistance of the balancing path in ohm */
+constexpr double BLEED_RESISTANCE = 75.0;
+
+/** Period of the balancing task in seconds, matches the BMS */
+constexpr uint32_t BALANCING_PERIOD = 1;
+
+/** Longest time a case is run for, in seconds */
+constexpr uint32_t MAX_TIME = 120 * 3600;
+
+/** Charging current in mA */
+constexpr double CHARGE_CURRENT = 10000.0;
+
+/** Highest cell voltage in mV at which the charger stops */
+constexpr uint16_t CHARGE_END_VOLTAGE = 4150;
+
+/** Cell input each cell is connected to, matches the BQ76952 driver */
+constexpr uint8_t CELL_INPUT[NUM_CELLS] = {0, 1, 2, 3, 4, 5, 6, 8, 10, 12, 14, 15};
+
+/** Open circuit voltage in mV every 10% of charge */
+constexpr double OCV_TABLE[] = {3000, 3450, 3550, 3610, 3660, 3720, 3800, 3880, 3970, 4070, 4180};
+
+/** Number of failed checks, only the first few are printed */
+static uint32_t numFailures = 0;
+
+/**
+ * Record a failure
+ *
+ * @param[in] context Description of the failed check
+ * @param[in] time Time of the failure in seconds
+ */
+static void fail(const char* context, uint32_t time) {
+    if (numFailures++ < 10) {
+        printf("FAIL %s at %u s\r\n", context, time);
+    }
+}
+
+/**
+ * Get the open circuit voltage of a cell
+ *
+ * @param[in] soc State of charge, 0 to 1
+ * @return The voltage in mV
+ */
+static double ocv(double soc) {
+    if (soc <= 0) {
+        return OCV_TABLE[0];
+    }
+    if (soc >= 1) {
+        return OCV_TABLE[10];
+    }
+    uint8_t point = static_cast<uint8_t>(soc * 10);
+    double fraction = soc * 10 - point;
+    return OCV_TABLE[point] + fraction * (OCV_TABLE[point + 1] - OCV_TABLE[point]);
+}
+
+/**
+ * Scenario run against the pack
+ *
+ * @var name Name printed in the report
+ * @var startSoc State of charge of the lowest cell at the start
+ * @var charge True to charge until the highest cell is full
+ * @var packTemp Pack temperature in C
+ * @var expectBalanced True if the pack has to be balanced by the end
+ */
+struct Scenario {
+    const char* name;
+    double startSoc;
+    bool charge;
+    uint8_t packTemp;
+    bool expectBalanced;
+};
+
+/**
+ * Run a scenario and report how long the pack took to balance
+ *
+ * @param[in] scenario The scenario
+ */
+static void run(const Scenario& scenario) {
+    // Same spread for every case, up to 4% of charge
+    double soc[NUM_CELLS];
+    srand(3);
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        soc[i] = scenario.startSoc + (rand() % 401) / 10000.0;
+    }
+
+    BalancingController controller;
+    uint8_t maxCells = BalancingController::MAX_BALANCING_CELLS;
+    if (scenario.packTemp >= BalancingController::MAX_PACK_TEMP) {
+        maxCells = 0;
+    } else if (scenario.packTemp + BalancingController::TEMP_DERATE_MARGIN >= BalancingController::MAX_PACK_TEMP) {
+        maxCells /= 2;
+    }
+
+    bool charging = scenario.charge;
+    uint32_t chargeEnd = 0;
+    uint32_t balancedTime = 0;
+    uint32_t bleedTime[NUM_CELLS] = {};
+    double bledCharge = 0;
+    uint16_t startSpread = 0;
+    uint16_t endSpread = 0;
+    uint16_t mask = 0;
+
+    for (uint32_t time = 0; time < MAX_TIME; time++) {
+        double current = charging ? CHARGE_CURRENT : 0;
+
+        uint16_t cellVoltage[NUM_CELLS];
+        uint16_t minVoltage = UINT16_MAX;
+        uint16_t maxVoltage = 0;
+        for (uint8_t i = 0; i < NUM_CELLS; i++) {
+            double bleed = (mask & (1 << i)) ? ocv(soc[i]) / BLEED_RESISTANCE : 0;
+            cellVoltage[i] = static_cast<uint16_t>(ocv(soc[i]) + (current - bleed) * CELL_RESISTANCE);
+            minVoltage = cellVoltage[i] < minVoltage ? cellVoltage[i] : minVoltage;
+            maxVoltage = cellVoltage[i] > maxVoltage ? cellVoltage[i] : maxVoltage;
+        }
+        if (time == 0) {
+            startSpread = maxVoltage - minVoltage;
+        }
+        endSpread = maxVoltage - minVoltage;
+
+        if (charging && maxVoltage >= CHARGE_END_VOLTAGE) {
+            charging = false;
+            chargeEnd = time;
+        }
+
+        if (time % BALANCING_PERIOD == 0) {
+            mask = controller.update(cellVoltage, scenario.packTemp, 30);
+
+            // Bled cells, checked on the cell inputs of the BQ
+            uint32_t inputs = 0;
+            uint8_t count = 0;
+            for (uint8_t i = 0; i < NUM_CELLS; i++) {
+                if (mask & (1 << i)) {
+                    inputs |= 1UL << CELL_INPUT[i];
+                    count++;
+                }
+            }
+            if (inputs & (inputs << 1)) {
+                fail("neighbouring cells bled", time);
+            }
+            if (count > maxCells) {
+                fail("too many cells bled", time);
+            }
+        }
+
+        // Balanced once every cell is within the start threshold and nothing
+        // is bled, after the charger is done
+        if (!charging && mask == 0 && endSpread <= BalancingController::START_THRESHOLD) {
+            if (balancedTime == 0) {
+                balancedTime = time;
+            }
+            if (time > balancedTime + 600) {
+                break;
+            }
+        } else {
+            balancedTime = 0;
+        }
+
+        for (uint8_t i = 0; i < NUM_CELLS; i++) {
+            double bleed = 0;
+            if (mask & (1 << i)) {
+                bleed = ocv(soc[i]) / BLEED_RESISTANCE;
+                bleedTime[i]++;
+                bledCharge += bleed / 3600.0;
+            }
+            soc[i] += (current - bleed) / 3600.0 / CELL_CAPACITY;
+        }
+    }
+
+    uint32_t maxBleedTime = 0;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        maxBleedTime = bleedTime[i] > maxBleedTime ? bleedTime[i] : maxBleedTime;
+    }
+
+    printf("%-6s spread %2u mV -> %2u mV, ", scenario.name, startSpread, endSpread);
+    if (balancedTime) {
+        printf("balanced after %5.1f h", balancedTime / 3600.0);
+    } else {
+        printf("not balanced after %5.1f h", MAX_TIME / 3600.0);
+    }
+    printf(", %4.0f mAh bled, busiest cell bled %4.1f h", bledCharge, maxBleedTime / 3600.0);
+    if (scenario.charge) {
+        printf(", charged in %.1f h", chargeEnd / 3600.0);
+    }
+    printf("\r\n");
+
+    if (scenario.expectBalanced != (balancedTime != 0)) {
+        fail(scenario.name, MAX_TIME);
+    }
+}
+
+int main() {
+    static const Scenario SCENARIOS[] = {
+        {"Rest", 0.50, false, 25, true},
+        {"Charge", 0.30, true, 25, true},
+        {"Warm", 0.50, false, 42, true},
+        {"Hot", 0.50, false, 46, false},
+    };
+
+    for (const Scenario& scenario : SCENARIOS) {
+        run(scenario);
+    }
+
+    printf("%s\r\n", numFailures ? "FAIL" : "PASS");
+    return numFailures ? 1 : 0;
+}
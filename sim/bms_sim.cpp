@@ -0,0 +1,503 @@
+/**
+ * Host simulation of the BMS
+ *
+ * Runs the real BMS state machine and drivers against the BQ76952 and
+ * M24C32 models on a simulated I2C bus. The settings image is loaded into
+ * the simulated EEPROM, either from a binary file produced by
+ * `tools/bqsettings/run.py convert` or from a generated image, and the
+ * simulation reports how long it takes to reach SYSTEM_READY along with the
+ * bus traffic it took to get there and to keep the BMS running. It ends with
+ * the cell voltage reads failing on their own, which has to be reported.
+ *
+ * Usage: bms_sim [settings.bin]
+ */
+
+#include <cstdio>
+
+#include <EVT/dev/storage/M24C32.hpp>
+#include <EVT/utils/time.hpp>
+
+#include <BMS.hpp>
+#include <BQSettingStorage.hpp>
+#include <CRC32.hpp>
+#include <ResetHandler.hpp>
+#include <SystemDetect.hpp>
+#include <dev/BQ76952.hpp>
+#include <dev/Interlock.hpp>
+#include <dev/ThermistorMux.hpp>
+
+#include <sim/BQ76952Sim.hpp>
+#include <sim/M24C32Sim.hpp>
+#include <sim/SimADC.hpp>
+#include <sim/SimAsyncI2C.hpp>
+#include <sim/SimClock.hpp>
+#include <sim/SimGPIO.hpp>
+#include <sim/SimI2C.hpp>
+#include <sim/SimIWDG.hpp>
+
+namespace IO = EVT::core::IO;
+namespace time = EVT::core::time;
+namespace SIM = BMS::SIM;
+
+/** Number of settings in the generated settings image */
+constexpr uint16_t GENERATED_NUM_SETTINGS = 200;
+
+/** Maximum time the BMS is given to reach SYSTEM_READY in milliseconds */
+constexpr uint32_t STARTUP_TIMEOUT = 60000;
+
+/** Time the BMS is run in SYSTEM_READY for the steady state report in milliseconds */
+constexpr uint32_t STEADY_STATE_TIME = 10000;
+
+/** Longest time a persistent failure of one BQ read may go unreported in milliseconds */
+constexpr uint32_t READ_FAULT_TIMEOUT = 30000;
+
+/** First cell voltage register of the BQ */
+constexpr uint8_t CELL_VOLTAGE_REGISTER = 0x14;
+
+/** Period of the main loop in milliseconds, matches the DEV1-BMS target */
+constexpr uint32_t LOOP_PERIOD = 10;
+
+/** Completion latency of an interrupt driven I2C transfer in microseconds */
+constexpr uint32_t I2C_LATENCY = 20;
+
+/** Raw thermistor ADC count, roughly 25 C */
+constexpr uint32_t THERMISTOR_RAW = 2050;
+
+/** Time the pack is run with two high cells in milliseconds */
+constexpr uint32_t BALANCING_TIME = 5000;
+
+/** Time the balanced pack is run for balancing to stop, in milliseconds */
+constexpr uint32_t BALANCING_STOP_TIME = 2000;
+
+/** Time the pack is discharged before the fault in milliseconds */
+constexpr uint32_t DISCHARGE_TIME = 5000;
+
+/** Time the BMS is run after the fault in milliseconds */
+constexpr uint32_t AFTER_FAULT_TIME = 1000;
+
+/** Object dictionary index of the per cell balancing control */
+constexpr uint16_t BALANCING_INDEX = 0x2107;
+
+/** Object dictionary index of the telemetry log */
+constexpr uint16_t TELEMETRY_LOG_INDEX = 0x2112;
+
+/** Cells balanced over SDO, bit N for cell N + 1 */
+constexpr uint16_t SDO_BALANCING_CELLS = 0x0815;
+
+/**
+ * Load a binary settings file into the simulated EEPROM
+ *
+ * @param[in] path Path to the binary file
+ * @param[in] eeprom The EEPROM model to load
+ * @return The number of settings in the image, 0 on failure
+ */
+static uint16_t loadSettingsFile(const char* path, SIM::M24C32Sim& eeprom) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        printf("Failed to open %s\r\n", path);
+        return 0;
+    }
+
+    uint8_t buffer[SIM::M24C32Sim::MEMORY_SIZE];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+
+    BMS::BQSettingsStorage::Header header;
+    if (size < BMS::BQSettingsStorage::HEADER_SIZE
+        || !BMS::BQSettingsStorage::headerFromArray(buffer, header)) {
+        printf("%s is not a valid settings image\r\n", path);
+        return 0;
+    }
+
+    eeprom.load(0, buffer, size);
+    return header.numSettings;
+}
+
+/**
+ * Generate a settings image of 1, 2 and 4 byte RAM settings
+ *
+ * @param[in] eeprom The EEPROM model to load
+ * @return The number of settings generated
+ */
+static uint16_t generateSettings(SIM::M24C32Sim& eeprom) {
+    static constexpr uint8_t SIZES[3] = {1, 2, 4};
+
+    uint8_t buffer[BMS::BQSetting::MAX_STREAM_SIZE];
+    uint32_t crc = BMS::CRC32::INITIAL;
+    uint16_t address = 0x9180;
+    uint16_t nextAddress = 0;
+    uint16_t settingsSize = 0;
+    for (uint16_t i = 0; i < GENERATED_NUM_SETTINGS; i++) {
+        uint8_t numBytes = SIZES[i % 3];
+        BMS::BQSetting setting(BMS::BQSetting::BQSettingType::RAM, numBytes, address, 0x5A5A5A5A + i);
+
+        uint8_t size = setting.toStream(buffer, nextAddress);
+        eeprom.load(BMS::BQSettingsStorage::HEADER_SIZE + settingsSize, buffer, size);
+        crc = BMS::CRC32::update(crc, buffer, size);
+        settingsSize += size;
+
+        address += numBytes;
+    }
+
+    BMS::BQSettingsStorage::Header header = {
+        .numSettings = GENERATED_NUM_SETTINGS,
+        .flags = BMS::BQSettingsStorage::FLAG_STREAM,
+        .imageCrc = BMS::CRC32::finalize(crc),
+        .settingsSize = settingsSize,
+    };
+    uint8_t headerBuffer[BMS::BQSettingsStorage::HEADER_SIZE];
+    BMS::BQSettingsStorage::headerToArray(header, headerBuffer);
+    eeprom.load(0, headerBuffer, BMS::BQSettingsStorage::HEADER_SIZE);
+
+    return GENERATED_NUM_SETTINGS;
+}
+
+/**
+ * Print the bus traffic and elapsed time for a phase of the simulation
+ *
+ * @param[in] name Name of the phase
+ * @param[in] i2c The simulated bus
+ * @param[in] elapsed Simulated time of the phase in microseconds
+ */
+static void report(const char* name, SIM::SimI2C& i2c, uint64_t elapsed) {
+    SIM::SimI2C::Stats stats = i2c.getStats();
+    printf("%s: %llu.%03llu ms, %u I2C transactions, %u bytes, bus busy %llu.%03llu ms (%llu%%)\r\n",
+           name,
+           static_cast<unsigned long long>(elapsed / 1000), static_cast<unsigned long long>(elapsed % 1000),
+           stats.numTransactions, stats.numBytes,
+           static_cast<unsigned long long>(stats.busTime / 1000), static_cast<unsigned long long>(stats.busTime % 1000),
+           static_cast<unsigned long long>(elapsed ? stats.busTime * 100 / elapsed : 0));
+}
+
+/**
+ * Find an entry of the object dictionary
+ *
+ * @param[in] bms The BMS to search
+ * @param[in] index Index of the entry
+ * @param[in] subIndex Sub index of the entry
+ * @return The entry, nullptr if it was not found
+ */
+static CO_OBJ_T* findEntry(BMS::BMS& bms, uint16_t index, uint8_t subIndex) {
+    for (uint8_t i = 0; i < bms.getNumElements(); i++) {
+        CO_OBJ_T* candidate = &bms.getObjectDictionary()[i];
+        if (candidate->Key >> 8 == (static_cast<uint32_t>(index) << 8 | subIndex)) {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Read every cell of the balancing entries, the way an SDO tool polls them
+ *
+ * @param[in] bms The BMS to read from
+ * @return Mask with bit N set if cell N + 1 reads as balancing
+ */
+static uint16_t pollBalancing(BMS::BMS& bms) {
+    uint16_t mask = 0;
+    for (uint8_t cell = 1; cell <= BMS::DEV::BQ76952::NUM_CELLS; cell++) {
+        CO_OBJ_T* entry = findEntry(bms, BALANCING_INDEX, cell);
+        uint8_t balancing = 0;
+        if (entry != nullptr && entry->Type->Read(entry, nullptr, &balancing, 1) == CO_ERR_NONE && balancing) {
+            mask |= 1 << (cell - 1);
+        }
+    }
+    return mask;
+}
+
+/**
+ * Upload the telemetry log through its object dictionary entry, the way
+ * the CANopen stack does for an SDO segmented upload
+ *
+ * @param[in] bms The BMS to upload from
+ * @param[out] buffer The buffer to fill
+ * @param[in] size Size of the buffer
+ * @return The size of the log, 0 if it was not found or does not fit
+ */
+static uint32_t uploadTelemetryLog(BMS::BMS& bms, uint8_t* buffer, uint32_t size) {
+    CO_OBJ_T* entry = findEntry(bms, TELEMETRY_LOG_INDEX, 1);
+    if (entry == nullptr) {
+        return 0;
+    }
+
+    uint32_t logSize = entry->Type->Size(entry, nullptr, 0);
+    if (logSize > size) {
+        return 0;
+    }
+
+    entry->Type->Ctrl(entry, nullptr, CO_CTRL_SET_OFF, 0);
+    for (uint32_t offset = 0; offset < logSize; offset += 7) {
+        uint32_t length = logSize - offset < 7 ? logSize - offset : 7;
+        entry->Type->Read(entry, nullptr, &buffer[offset], length);
+    }
+    return logSize;
+}
+
+/**
+ * Process the BMS until it reaches SYSTEM_READY, or fails to
+ *
+ * @param[in] bms The BMS to process
+ * @return True if the BMS reached SYSTEM_READY
+ */
+static bool runToReady(BMS::BMS& bms) {
+    uint32_t timeout = time::millis() + STARTUP_TIMEOUT;
+    while (bms.getState() != BMS::BMS::State::SYSTEM_READY
+           && bms.getState() != BMS::BMS::State::INITIALIZATION_ERROR
+           && time::millis() < timeout) {
+        bms.process();
+        time::wait(LOOP_PERIOD);
+    }
+
+    if (bms.getState() != BMS::BMS::State::SYSTEM_READY) {
+        printf("BMS failed to reach SYSTEM_READY, state: %u\r\n", static_cast<uint8_t>(bms.getState()));
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    SIM::SimI2C i2c(100000);
+    SIM::BQ76952Sim bqSim;
+    SIM::M24C32Sim eepromSim;
+    i2c.attach(0x08, bqSim);
+    i2c.attach(0x57, eepromSim);
+
+    EVT::core::DEV::M24C32 eeprom(0x57, i2c);
+    uint16_t numSettings = argc > 1 ? loadSettingsFile(argv[1], eepromSim) : generateSettings(eepromSim);
+    if (numSettings == 0) {
+        return 1;
+    }
+    printf("Settings in EEPROM: %u\r\n", numSettings);
+
+    // Balanced pack at rest, 25 C everywhere
+    for (uint8_t i = 0; i < SIM::BQ76952Sim::NUM_CELL_INPUTS; i++) {
+        bqSim.setCellVoltage(i, 3700);
+    }
+    bqSim.setStackVoltage(4440);
+    bqSim.setCurrent(0);
+    bqSim.setTemperatures(2982, 2982, 2982);
+
+    SIM::SimGPIO interlockGPIO(IO::GPIO::Direction::INPUT);
+    SIM::SimGPIO alarm(IO::GPIO::Direction::INPUT);
+    SIM::SimGPIO bmsOK(IO::GPIO::Direction::OUTPUT);
+    SIM::SimGPIO muxS1(IO::GPIO::Direction::OUTPUT);
+    SIM::SimGPIO muxS2(IO::GPIO::Direction::OUTPUT);
+    SIM::SimGPIO muxS3(IO::GPIO::Direction::OUTPUT);
+    IO::GPIO* muxSelectArr[3] = {&muxS1, &muxS2, &muxS3};
+    SIM::SimADC thermAdc;
+    thermAdc.setRaw(THERMISTOR_RAW);
+    SIM::SimIWDG iwdg(500);
+
+    BMS::DEV::BQ76952 bq(i2c, 0x08);
+
+    // The settings image is read into RAM and checked when the storage is made
+    i2c.resetStats();
+    uint64_t loadStart = SIM::clock::micros();
+    BMS::BQSettingsStorage bqSettingsStorage(eeprom, bq);
+    report("Settings load", i2c, SIM::clock::micros() - loadStart);
+    SIM::SimAsyncI2C i2cBus(i2c, I2C_LATENCY);
+    BMS::I2CTransactionQueue i2cQueue(i2cBus);
+    BMS::DEV::Interlock interlock(interlockGPIO);
+    BMS::DEV::ThermistorMux thermMux(muxSelectArr, thermAdc);
+    BMS::SystemDetect systemDetect(0x70A, 0x710, 1000);
+    BMS::ResetHandler resetHandler;
+
+    BMS::BMS bms(bqSettingsStorage, bq, i2cQueue, interlock, alarm, systemDetect, bmsOK, thermMux, resetHandler, iwdg);
+
+    // Startup, from construction of the BMS to SYSTEM_READY
+    i2c.resetStats();
+    uint64_t startTime = SIM::clock::micros();
+    if (!runToReady(bms)) {
+        return 1;
+    }
+    report("Startup", i2c, SIM::clock::micros() - startTime);
+
+    SIM::BQ76952Sim::Stats bqStats = bqSim.getStats();
+    printf("BQ: %u subcommands, %u RAM writes, %u rejected writes\r\n",
+           bqStats.numSubcommands, bqStats.numRAMWrites, bqStats.numRejectedWrites);
+
+    // Every stored setting should now be in the BQ data memory
+    uint16_t numMismatched = 0;
+    BMS::BQSetting setting;
+    bqSettingsStorage.resetEEPROMOffset();
+    for (uint16_t i = 0; i < bqSettingsStorage.getNumSettings(); i++) {
+        bqSettingsStorage.readSetting(setting);
+        if (bqSim.getDataMemory(setting.getAddress(), setting.getNumBytes()) != setting.getData()) {
+            numMismatched++;
+        }
+    }
+    printf("Settings not applied to the BQ: %u\r\n", numMismatched);
+    if (numMismatched > 0) {
+        return 1;
+    }
+
+    // Steady state in SYSTEM_READY
+    i2c.resetStats();
+    startTime = SIM::clock::micros();
+    uint32_t endTime = time::millis() + STEADY_STATE_TIME;
+    uint64_t maxProcessTime = 0;
+    uint32_t numTriggeredTPDOs = 0;
+    bms.getTriggeredTPDOs();
+    while (time::millis() < endTime) {
+        uint64_t processStart = SIM::clock::micros();
+        bms.process();
+        uint64_t processTime = SIM::clock::micros() - processStart;
+        if (processTime > maxProcessTime) {
+            maxProcessTime = processTime;
+        }
+
+        uint8_t triggeredTPDOs = bms.getTriggeredTPDOs();
+        for (uint8_t i = 0; i < 8; i++) {
+            numTriggeredTPDOs += (triggeredTPDOs >> i) & 1;
+        }
+        time::wait(LOOP_PERIOD);
+    }
+    report("Steady state", i2c, SIM::clock::micros() - startTime);
+    printf("Longest process() call: %llu us, watchdog timeouts: %u\r\n",
+           static_cast<unsigned long long>(maxProcessTime), iwdg.getNumTimeouts());
+    SIM::SimAsyncI2C::Stats busStats = i2cBus.getStats();
+    printf("Queued I2C transfers: %u, overlapped: %u, waited on: %u\r\n",
+           busStats.numTransfers, busStats.numOverlapped, busStats.numWaits);
+    printf("Change triggered TPDOs: %u\r\n", numTriggeredTPDOs);
+
+    static const char* TASK_NAMES[] = {"current", "cell voltage", "BQ status", "BQ temp", "thermistor", "telemetry",
+                                       "balancing"};
+    for (uint8_t i = 0; i <= BMS::BMS::BALANCING_TASK; i++) {
+        BMS::TaskScheduler::TaskStats stats = bms.getTaskStats(i);
+        printf("Task %-12s runs: %6u, max exec: %u ms, overruns: %u\r\n",
+               TASK_NAMES[i], stats.numRuns, stats.maxExecTime, stats.numOverruns);
+    }
+
+    // Two high cells, cell 4 and cell 10 on cell input 12. Both are odd
+    // cells, balanced together every other period, and each change of the
+    // mask is a single RAM write.
+    bqSim.resetStats();
+    bqSim.setCellVoltage(3, 3740);
+    bqSim.setCellVoltage(12, 3725);
+    uint16_t seenMasks = 0;
+    uint32_t balancingStart = time::millis();
+    while (time::millis() - balancingStart < BALANCING_TIME) {
+        bms.process();
+        seenMasks |= bqSim.getBalancingMask();
+        time::wait(LOOP_PERIOD);
+    }
+    uint32_t balancingWrites = bqSim.getStats().numRAMWrites;
+    bqSim.setCellVoltage(3, 3700);
+    bqSim.setCellVoltage(12, 3700);
+    balancingStart = time::millis();
+    while (time::millis() - balancingStart < BALANCING_STOP_TIME) {
+        bms.process();
+        time::wait(LOOP_PERIOD);
+    }
+    printf("Balancing: cell inputs 0x%04x balanced, %u RAM writes in %u ms, stopped: %s\r\n",
+           seenMasks, balancingWrites, BALANCING_TIME, bqSim.getBalancingMask() == 0 ? "yes" : "no");
+    if (seenMasks != ((1 << 3) | (1 << 12)) || bqSim.getBalancingMask() != 0) {
+        return 1;
+    }
+
+    // Balancing over SDO. Polling every cell is served from the cached mask
+    // without touching the bus, and the cells written within one period go
+    // out to the BQ in a single RAM write.
+    i2c.resetStats();
+    pollBalancing(bms);
+    uint32_t pollTransactions = i2c.getStats().numTransactions;
+    bqSim.resetStats();
+    for (uint8_t cell = 1; cell <= BMS::DEV::BQ76952::NUM_CELLS; cell++) {
+        CO_OBJ_T* entry = findEntry(bms, BALANCING_INDEX, cell);
+        uint8_t balancing = (SDO_BALANCING_CELLS >> (cell - 1)) & 1;
+        if (balancing) {
+            entry->Type->Write(entry, nullptr, &balancing, 1);
+        }
+    }
+    balancingStart = time::millis();
+    while (time::millis() - balancingStart < BALANCING_STOP_TIME) {
+        bms.process();
+        time::wait(LOOP_PERIOD);
+    }
+    uint16_t sdoInputs = bqSim.getBalancingMask();
+    uint32_t sdoWrites = bqSim.getStats().numRAMWrites;
+    uint16_t polledMask = pollBalancing(bms);
+
+    // Back to automatic balancing, the balanced pack stops bleeding. The
+    // stack writes the flag straight into the linked variable.
+    CO_OBJ_T* automatic = findEntry(bms, BALANCING_INDEX, BMS::DEV::BQ76952::NUM_CELLS + 1);
+    *reinterpret_cast<uint8_t*>(automatic->Data) = 1;
+    balancingStart = time::millis();
+    while (time::millis() - balancingStart < BALANCING_STOP_TIME) {
+        bms.process();
+        time::wait(LOOP_PERIOD);
+    }
+    printf("SDO balancing: cells polled in %u I2C transactions, cells 0x%03x written, cell inputs 0x%04x "
+           "balanced in %u RAM writes, polled back 0x%03x, automatic stopped: %s\r\n",
+           pollTransactions, SDO_BALANCING_CELLS, sdoInputs, sdoWrites, polledMask,
+           pollBalancing(bms) == 0 && bqSim.getBalancingMask() == 0 ? "yes" : "no");
+    if (pollTransactions != 0 || sdoInputs != 0x8015 || sdoWrites != 1 || polledMask != SDO_BALANCING_CELLS
+        || pollBalancing(bms) != 0 || bqSim.getBalancingMask() != 0) {
+        return 1;
+    }
+
+    // Discharge, with the cells sagging unevenly, until the BQ raises its
+    // alarm. The telemetry log has to be frozen with the samples leading up
+    // to the fault.
+    bqSim.setCurrent(-8000);
+    uint32_t dischargeStart = time::millis();
+    while (time::millis() - dischargeStart < DISCHARGE_TIME) {
+        uint32_t elapsed = time::millis() - dischargeStart;
+        for (uint8_t i = 0; i < SIM::BQ76952Sim::NUM_CELL_INPUTS; i++) {
+            bqSim.setCellVoltage(i, 3700 - elapsed / 20 - (elapsed / 7 + i * 3) % 5);
+        }
+        bms.process();
+        time::wait(LOOP_PERIOD);
+    }
+    alarm.setState(IO::GPIO::State::HIGH);
+    uint32_t faultTime = time::millis();
+    while (time::millis() - faultTime < AFTER_FAULT_TIME) {
+        bms.process();
+        time::wait(LOOP_PERIOD);
+    }
+
+    uint8_t telemetryLog[BMS::TelemetryRecorder::LOG_HEADER_SIZE
+                         + BMS::TelemetryRecorder::NUM_BLOCKS * (2 + BMS::TelemetryRecorder::BLOCK_SIZE)];
+    uint32_t logSize = uploadTelemetryLog(bms, telemetryLog, sizeof(telemetryLog));
+    if (bms.getState() != BMS::BMS::State::UNSAFE_CONDITIONS_ERROR || logSize == 0) {
+        printf("BMS did not enter UNSAFE_CONDITIONS_ERROR with a telemetry log, state: %u\r\n",
+               static_cast<uint8_t>(bms.getState()));
+        return 1;
+    }
+    uint16_t numSamples = telemetryLog[2] | telemetryLog[3] << 8;
+    printf("Telemetry log at the fault: %u samples (%u ms), %u blocks, %u bytes\r\n",
+           numSamples, numSamples * 20, telemetryLog[1], logSize);
+    alarm.setState(IO::GPIO::State::LOW);
+    bqSim.setCurrent(0);
+
+    // Warm restart, the BMS state machine starts over while the BQ keeps its
+    // configuration, as happens on a reset request
+    BMS::BMS restartedBms(bqSettingsStorage, bq, i2cQueue, interlock, alarm, systemDetect, bmsOK, thermMux, resetHandler, iwdg);
+    i2c.resetStats();
+    bqSim.resetStats();
+    startTime = SIM::clock::micros();
+    if (!runToReady(restartedBms)) {
+        return 1;
+    }
+    report("Warm restart", i2c, SIM::clock::micros() - startTime);
+    printf("BQ RAM writes on warm restart: %u\r\n", bqSim.getStats().numRAMWrites);
+
+    // Only the cell voltage reads fail, while the current and status reads
+    // keep working. The failure still has to be reported.
+    bqSim.setReadFailure(CELL_VOLTAGE_REGISTER);
+    uint32_t readFaultStart = time::millis();
+    while (restartedBms.getState() == BMS::BMS::State::SYSTEM_READY
+           && time::millis() - readFaultStart < READ_FAULT_TIMEOUT) {
+        restartedBms.process();
+        time::wait(LOOP_PERIOD);
+    }
+    bqSim.setReadFailure(SIM::BQ76952Sim::NO_REGISTER);
+    if (restartedBms.getState() != BMS::BMS::State::UNSAFE_CONDITIONS_ERROR) {
+        printf("Failing cell voltage reads not reported, state: %u\r\n",
+               static_cast<uint8_t>(restartedBms.getState()));
+        return 1;
+    }
+    printf("Failing cell voltage reads reported after %u ms\r\n", time::millis() - readFaultStart);
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+/**
+ * Host benchmark of the CAN interrupt handler
+ *
+ * Replays one second of a synthetic, fully loaded 1 Mbit/s bike bus through
+ * two versions of the DEV1-BMS CAN interrupt handler:
+ *
+ * - Unfiltered: every frame reaches the handler, which passes it to the
+ *   system detect, the reset handler and the CANopen queue
+ * - Filtered: only the IDs in the dispatch table and reset frames pass the
+ *   (emulated) hardware acceptance filters, each goes to the reset handler
+ *   and then to the handler of its ID
+ *
+ * The host is much faster than the STM32, so the absolute times only matter
+ * relative to each other. The number of frames reaching the handler does
+ * carry over directly.
+ *
+ * Usage: can_isr_bench [seconds]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <EVT/io/types/CANMessage.hpp>
+
+#include <CANDispatcher.hpp>
+#include <ResetHandler.hpp>
+#include <SPSCQueue.hpp>
+#include <SystemDetect.hpp>
+
+namespace IO = EVT::core::IO;
+
+/** Frames per second on a fully loaded 1 Mbit/s bus, ~125 bit frames */
+constexpr uint32_t FRAMES_PER_SECOND = 8000;
+
+/**
+ * Standard IDs the BMS listens to, BMS.hpp is not included as its headers
+ * clash with <chrono>, so the node ID (BMS::NODE_ID) is repeated here
+ */
+constexpr uint16_t NMT_ID = 0x000;
+constexpr uint16_t SDO_REQUEST_ID = 0x600 + 20;
+constexpr uint16_t BIKE_HEART_BEAT = 0x70A;
+constexpr uint16_t CHARGER_HEART_BEAT = 0x710;
+constexpr uint16_t RESET_ID = 0x7FF;
+
+/** Capacity of the received frame queue, same as DEV1-BMS */
+constexpr uint32_t CAN_RX_QUEUE_SIZE = 64;
+
+/**
+ * Data needed by the interrupt handlers, mirrors DEV1-BMS
+ */
+struct CANInterruptParams {
+    BMS::SPSCQueue<IO::CANMessage, CAN_RX_QUEUE_SIZE>* queue;
+    BMS::SystemDetect* systemDetect;
+    BMS::ResetHandler* resetHandler;
+    BMS::CANDispatcher* dispatcher;
+};
+
+/** Interrupt handler without filtering, as DEV1-BMS used to have */
+static void unfilteredHandler(IO::CANMessage& message, void* priv) {
+    CANInterruptParams* params = static_cast<CANInterruptParams*>(priv);
+
+    params->systemDetect->processHeartbeat(message.getId());
+    params->resetHandler->registerInput(message);
+    if (!message.isCANExtended()) {
+        params->queue->push(message);
+    }
+}
+
+static void canOpenFrameHandler(IO::CANMessage& message, void* priv) {
+    static_cast<CANInterruptParams*>(priv)->queue->push(message);
+}
+
+static void heartbeatFrameHandler(IO::CANMessage& message, void* priv) {
+    static_cast<CANInterruptParams*>(priv)->systemDetect->processHeartbeat(message.getId());
+}
+
+/** Interrupt handler behind the acceptance filters, as DEV1-BMS has now */
+static void filteredHandler(IO::CANMessage& message, void* priv) {
+    CANInterruptParams* params = static_cast<CANInterruptParams*>(priv);
+
+    params->resetHandler->registerInput(message);
+    params->dispatcher->dispatch(message);
+}
+
+/**
+ * Emulate the hardware acceptance filters
+ *
+ * @param[in] dispatcher Dispatch table the filters are loaded from, reset
+ *                       frames have a filter of their own
+ * @param[in] message The frame on the bus
+ * @return True if the frame would reach the interrupt handler
+ */
+static bool passesFilters(BMS::CANDispatcher& dispatcher, IO::CANMessage& message) {
+    if ((message.getId() & BMS::CANDispatcher::EXACT_MATCH_MASK) == RESET_ID) {
+        return true;
+    }
+    for (uint8_t i = 0; i < dispatcher.getNumHandlers(); i++) {
+        if ((message.getId() & BMS::CANDispatcher::EXACT_MATCH_MASK) == dispatcher.getId(i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Make one second of bus traffic: bike heartbeat at 10 Hz, a few SDO
+ * requests for the BMS, one NMT command and PDOs of other nodes filling the
+ * rest of the bus
+ *
+ * @param[out] frames The frames, FRAMES_PER_SECOND of them
+ */
+static void makeTraffic(IO::CANMessage* frames) {
+    uint8_t payload[8] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    srand(1);
+
+    for (uint32_t i = 0; i < FRAMES_PER_SECOND; i++) {
+        uint16_t id;
+        if (i % (FRAMES_PER_SECOND / 10) == 0) {
+            id = BIKE_HEART_BEAT;
+        } else if (i % (FRAMES_PER_SECOND / 20) == 1) {
+            id = SDO_REQUEST_ID;
+        } else if (i == 2) {
+            id = NMT_ID;
+        } else {
+            id = 0x180 + rand() % 0x400;
+        }
+        frames[i] = IO::CANMessage(id, 8, payload, false);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t seconds = argc > 1 ? atoi(argv[1]) : 20;
+
+    static IO::CANMessage frames[FRAMES_PER_SECOND];
+    makeTraffic(frames);
+
+    BMS::SPSCQueue<IO::CANMessage, CAN_RX_QUEUE_SIZE> queue;
+    BMS::SystemDetect systemDetect(BIKE_HEART_BEAT, CHARGER_HEART_BEAT, 1000);
+    BMS::ResetHandler resetHandler;
+    BMS::CANDispatcher dispatcher;
+    CANInterruptParams params = {
+        .queue = &queue,
+        .systemDetect = &systemDetect,
+        .resetHandler = &resetHandler,
+        .dispatcher = &dispatcher,
+    };
+
+    dispatcher.addHandler(NMT_ID, canOpenFrameHandler, &params);
+    dispatcher.addHandler(SDO_REQUEST_ID, canOpenFrameHandler, &params);
+    dispatcher.addHandler(BIKE_HEART_BEAT, heartbeatFrameHandler, &params);
+    dispatcher.addHandler(CHARGER_HEART_BEAT, heartbeatFrameHandler, &params);
+
+    // The hardware drops the other frames, so only the accepted ones are
+    // replayed through the filtered handler
+    static IO::CANMessage accepted[FRAMES_PER_SECOND];
+    uint32_t numAccepted = 0;
+    for (uint32_t i = 0; i < FRAMES_PER_SECOND; i++) {
+        if (passesFilters(dispatcher, frames[i])) {
+            accepted[numAccepted++] = frames[i];
+        }
+    }
+
+    for (uint8_t filtered = 0; filtered < 2; filtered++) {
+        IO::CANMessage* replayed = filtered ? accepted : frames;
+        uint32_t numReplayed = filtered ? numAccepted : FRAMES_PER_SECOND;
+        IO::CANMessage drained;
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t s = 0; s < seconds; s++) {
+            for (uint32_t i = 0; i < numReplayed; i++) {
+                if (filtered) {
+                    filteredHandler(replayed[i], &params);
+                } else {
+                    unfilteredHandler(replayed[i], &params);
+                }
+
+                // The main loop keeps up with the queue
+                while (queue.pop(&drained)) {}
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        uint64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        uint64_t numHandled = static_cast<uint64_t>(numReplayed) * seconds;
+        printf("%s: %u frames/s reach the handler, %llu ns per frame, %llu ns handler time per bus second\r\n",
+               filtered ? "Filtered + dispatch" : "Unfiltered", numReplayed,
+               static_cast<unsigned long long>(numHandled ? total / numHandled : 0),
+               static_cast<unsigned long long>(total / seconds));
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * Host check of the BQ76952 cell voltage block read
+ *
+ * Reads the cell voltages through BQ76952::getCellVoltage from the BQ model
+ * on the simulated bus and checks:
+ *
+ * - Bus: the whole cell voltage window comes over in one addressed read,
+ *   the register address write and the read with a repeated START
+ * - Values: each cell reads a distinct cell input of the model, in order,
+ *   and the sum, minimum and maximum match the cells read
+ *
+ * Usage: cell_voltage_read_check
+ */
+
+#include <cstdio>
+
+#include <dev/BQ76952.hpp>
+
+#include <sim/BQ76952Sim.hpp>
+#include <sim/SimI2C.hpp>
+
+namespace SIM = BMS::SIM;
+using BMS::DEV::BQ76952;
+
+/** Address of the BQ on the bus */
+constexpr uint8_t BQ_ADDR = 0x08;
+
+/** Voltage of the first cell input in mV, each following input is 10 mV higher */
+constexpr uint16_t BASE_VOLTAGE = 3600;
+
+/** Addressed transfers of one block read, the register write and the read */
+constexpr uint32_t BLOCK_READ_TRANSACTIONS = 2;
+
+/** Bytes of one block read, the register address and the cell voltage window */
+constexpr uint32_t BLOCK_READ_BYTES = 1 + 32;
+
+/** Number of failed checks */
+static uint32_t numFailures = 0;
+
+/**
+ * Record a failure
+ *
+ * @param[in] context Description of the failed check
+ */
+static void fail(const char* context) {
+    numFailures++;
+    printf("FAIL %s\r\n", context);
+}
+
+int main() {
+    SIM::SimI2C i2c;
+    SIM::BQ76952Sim bqSim;
+    i2c.attach(BQ_ADDR, bqSim);
+    BQ76952 bq(i2c, BQ_ADDR);
+
+    for (uint8_t i = 0; i < SIM::BQ76952Sim::NUM_CELL_INPUTS; i++) {
+        bqSim.setCellVoltage(i, BASE_VOLTAGE + i * 10);
+    }
+
+    uint16_t cellVoltages[BQ76952::NUM_CELLS];
+    uint32_t sum = 0;
+    BMS::CellVoltageInfo voltageInfo = {};
+
+    i2c.resetStats();
+    BQ76952::Status status = bq.getCellVoltage(cellVoltages, sum, voltageInfo);
+    SIM::SimI2C::Stats stats = i2c.getStats();
+
+    printf("getCellVoltage: %u I2C transactions, %u bytes, %llu us on the bus\r\n",
+           stats.numTransactions, stats.numBytes, static_cast<unsigned long long>(stats.busTime));
+
+    if (status != BQ76952::Status::OK) {
+        fail("read failed");
+    }
+    if (stats.numTransactions != BLOCK_READ_TRANSACTIONS || stats.numBytes != BLOCK_READ_BYTES) {
+        fail("not a single block read");
+    }
+
+    uint32_t expectedSum = 0;
+    for (uint8_t i = 0; i < BQ76952::NUM_CELLS; i++) {
+        uint16_t voltage = cellVoltages[i];
+        bool isInput = voltage >= BASE_VOLTAGE && (voltage - BASE_VOLTAGE) % 10 == 0
+                       && (voltage - BASE_VOLTAGE) / 10 < SIM::BQ76952Sim::NUM_CELL_INPUTS;
+        if (!isInput || (i > 0 && voltage <= cellVoltages[i - 1])) {
+            fail("cell voltages do not follow the cell inputs");
+            break;
+        }
+        expectedSum += voltage;
+    }
+
+    if (sum != expectedSum) {
+        fail("sum of the cell voltages");
+    }
+    if (voltageInfo.minCellVoltage != cellVoltages[0] || voltageInfo.minCellVoltageId != 1
+        || voltageInfo.maxCellVoltage != cellVoltages[BQ76952::NUM_CELLS - 1]
+        || voltageInfo.maxCellVoltageId != BQ76952::NUM_CELLS) {
+        fail("minimum and maximum cell voltages");
+    }
+
+    printf("%s\r\n", numFailures ? "FAIL" : "PASS");
+    return numFailures ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * Host check of ChannelStats
+ *
+ * Compares ChannelStats against a full rescan of the channels after every
+ * update, exhaustively over small channel counts and value ranges:
+ *
+ * - Every start state and every single update of 3 channels with values 0-4
+ * - Every sequence of 4 updates of 3 channels with values 0-3, from reset
+ * - Every sequence of 3 updates of 4 signed channels with values -2 to 2
+ * - updateAll() with every state of 4 channels with values 0-5
+ *
+ * Usage: channel_stats_check
+ */
+
+#include <cstdio>
+
+#include <ChannelStats.hpp>
+
+/** Number of failed comparisons, only the first few are printed */
+static uint32_t numFailures = 0;
+
+/** Number of comparisons made */
+static uint32_t numChecks = 0;
+
+/**
+ * Compare the statistics against a full rescan of the channel values
+ *
+ * @tparam T Type of the channel values
+ * @tparam N Number of channels
+ * @param[in] stats The statistics under test
+ * @param[in] values The values the channels should have
+ * @param[in] context Description of the case, printed on failure
+ */
+template<class T, uint8_t N>
+static void check(const BMS::ChannelStats<T, N>& stats, const T* values, const char* context) {
+    uint8_t minChannel = 0;
+    uint8_t maxChannel = 0;
+    int32_t sum = 0;
+    bool valuesMatch = true;
+
+    for (uint8_t i = 0; i < N; i++) {
+        if (values[i] < values[minChannel]) {
+            minChannel = i;
+        }
+        if (values[i] > values[maxChannel]) {
+            maxChannel = i;
+        }
+        sum += values[i];
+        valuesMatch &= stats.get(i) == values[i];
+    }
+
+    numChecks++;
+    if (valuesMatch && stats.getMin() == values[minChannel] && stats.getMinChannel() == minChannel
+        && stats.getMax() == values[maxChannel] && stats.getMaxChannel() == maxChannel
+        && stats.getSum() == sum && stats.getMean() == static_cast<T>(sum / N)) {
+        return;
+    }
+
+    if (numFailures++ < 10) {
+        printf("FAIL %s: values", context);
+        for (uint8_t i = 0; i < N; i++) {
+            printf(" %d", values[i]);
+        }
+        printf(", min %d (%u) expected %d (%u), max %d (%u) expected %d (%u), sum %d expected %d\r\n",
+               stats.getMin(), stats.getMinChannel(), values[minChannel], minChannel,
+               stats.getMax(), stats.getMaxChannel(), values[maxChannel], maxChannel,
+               stats.getSum(), sum);
+    }
+}
+
+/**
+ * Turn a number into channel values, one digit per channel
+ *
+ * @param[in] number The number
+ * @param[in] base Number of values per channel
+ * @param[in] offset Value of the digit 0
+ * @param[out] values The values
+ */
+template<class T, uint8_t N>
+static void toValues(uint32_t number, uint32_t base, T offset, T* values) {
+    for (uint8_t i = 0; i < N; i++) {
+        values[i] = static_cast<T>(number % base) + offset;
+        number /= base;
+    }
+}
+
+/**
+ * Run every sequence of a number of single channel updates from reset
+ *
+ * @tparam T Type of the channel values
+ * @tparam N Number of channels
+ * @param[in] numValues Number of values per channel
+ * @param[in] offset Lowest value
+ * @param[in] length Number of updates in each sequence
+ * @param[in] context Description, printed on failure
+ */
+template<class T, uint8_t N>
+static void checkSequences(uint32_t numValues, T offset, uint8_t length, const char* context) {
+    uint32_t numUpdates = N * numValues;
+    uint32_t numSequences = 1;
+    for (uint8_t i = 0; i < length; i++) {
+        numSequences *= numUpdates;
+    }
+
+    for (uint32_t sequence = 0; sequence < numSequences; sequence++) {
+        BMS::ChannelStats<T, N> stats;
+        T values[N] = {};
+
+        uint32_t remaining = sequence;
+        for (uint8_t step = 0; step < length; step++) {
+            uint32_t update = remaining % numUpdates;
+            remaining /= numUpdates;
+
+            uint8_t channel = update % N;
+            T value = static_cast<T>(update / N) + offset;
+            stats.update(channel, value);
+            values[channel] = value;
+            check(stats, values, context);
+        }
+    }
+}
+
+int main() {
+    // Every start state and every single update
+    {
+        constexpr uint8_t N = 3;
+        constexpr uint32_t NUM_VALUES = 5;
+        for (uint32_t state = 0; state < NUM_VALUES * NUM_VALUES * NUM_VALUES; state++) {
+            for (uint8_t channel = 0; channel < N; channel++) {
+                for (uint8_t value = 0; value < NUM_VALUES; value++) {
+                    uint8_t values[N];
+                    toValues<uint8_t, N>(state, NUM_VALUES, 0, values);
+
+                    BMS::ChannelStats<uint8_t, N> stats;
+                    stats.updateAll(values);
+                    stats.update(channel, value);
+                    values[channel] = value;
+                    check(stats, values, "single update");
+                }
+            }
+        }
+    }
+
+    checkSequences<uint8_t, 3>(4, 0, 4, "unsigned sequence");
+    checkSequences<int16_t, 4>(5, -2, 3, "signed sequence");
+
+    // updateAll() with every state, the cell voltage case
+    {
+        constexpr uint8_t N = 4;
+        constexpr uint32_t NUM_VALUES = 6;
+        BMS::ChannelStats<uint16_t, N> stats;
+        for (uint32_t state = 0; state < NUM_VALUES * NUM_VALUES * NUM_VALUES * NUM_VALUES; state++) {
+            uint16_t values[N];
+            toValues<uint16_t, N>(state, NUM_VALUES, 0, values);
+            stats.updateAll(values);
+            check(stats, values, "update all");
+        }
+    }
+
+    printf("%u checks, %u failed: %s\r\n", numChecks, numFailures, numFailures ? "FAIL" : "PASS");
+    return numFailures ? 1 : 0;
+}
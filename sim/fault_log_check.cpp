@@ -0,0 +1,252 @@
+/**
+ * Host check of the fault log
+ *
+ * Appends records to the fault log on the M24C32 model and restarts the log
+ * from the EEPROM contents after every append, the way a reset of the BMS
+ * does, then checks:
+ *
+ * - Ring: once every slot is in use the oldest record is overwritten, and
+ *   the newest NUM_RECORDS records download oldest first
+ * - Power loss: for every slot of the ring, before and after it wraps, and
+ *   for every number of bytes of the page written before the power is cut,
+ *   the records written before the cut are intact, the cut record is either
+ *   whole or gone, and the next append continues the sequence
+ * - Boot: the number of bytes read from the EEPROM to find the head
+ * - Appends during a download: a fault logged part way through a download,
+ *   once the oldest record has gone out, leaves the downloaded log as it was
+ *   when the download started
+ *
+ * Usage: fault_log_check
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include <EVT/dev/storage/M24C32.hpp>
+
+#include <FaultLog.hpp>
+#include <I2CTransactionQueue.hpp>
+
+#include <sim/M24C32Sim.hpp>
+#include <sim/SimAsyncI2C.hpp>
+#include <sim/SimI2C.hpp>
+
+namespace SIM = BMS::SIM;
+using BMS::FaultLog;
+
+/** Address of the EEPROM on the bus */
+constexpr uint8_t EEPROM_ADDR = 0x57;
+
+/** Completion latency of a transfer in microseconds */
+constexpr uint32_t LATENCY = 20;
+
+/** Number of failed checks, only the first few are printed */
+static uint32_t numFailures = 0;
+
+/**
+ * Record a failure
+ *
+ * @param[in] context Description of the failed check
+ * @param[in] numWritten Number of records appended before the check
+ * @param[in] cut Number of bytes written before the power was cut
+ */
+static void fail(const char* context, uint32_t numWritten, uint32_t cut) {
+    if (numFailures++ < 10) {
+        printf("FAIL %s, %u records, cut after %u bytes\r\n", context, numWritten, cut);
+    }
+}
+
+/**
+ * EEPROM on a simulated bus, with the queue the fault log takes the bus from
+ */
+struct Board {
+    SIM::SimI2C i2c;
+    SIM::M24C32Sim eepromSim;
+    EVT::core::DEV::M24C32 eeprom;
+    SIM::SimAsyncI2C bus;
+    BMS::I2CTransactionQueue i2cQueue;
+
+    Board() : eeprom(EEPROM_ADDR, i2c), bus(i2c, LATENCY), i2cQueue(bus) {
+        i2c.attach(EEPROM_ADDR, eepromSim);
+    }
+};
+
+/**
+ * Make the record with a given sequence number, every field derived from it
+ *
+ * @param[in] sequence The sequence number
+ * @return The record
+ */
+static FaultLog::Record makeRecord(uint32_t sequence) {
+    FaultLog::Record record;
+    record.time = sequence * 1000 + 17;
+    record.state = sequence % 9;
+    record.errorRegister = 1 << (sequence % 3);
+    for (uint8_t i = 0; i < 7; i++) {
+        record.bqStatus[i] = sequence * 7 + i;
+    }
+    record.voltageInfo = {
+        .minCellVoltage = static_cast<int16_t>(3000 + sequence),
+        .minCellVoltageId = static_cast<uint8_t>(sequence % 12 + 1),
+        .maxCellVoltage = static_cast<int16_t>(4000 + sequence),
+        .maxCellVoltageId = static_cast<uint8_t>((sequence + 5) % 12 + 1),
+    };
+    record.current = static_cast<int16_t>(-1000 * static_cast<int32_t>(sequence % 20));
+    record.maxPackTemp = 20 + sequence % 40;
+    record.maxPackTempId = sequence % 6;
+    return record;
+}
+
+/**
+ * Download the log through the CANopen interface, 7 bytes per segment
+ *
+ * @param[in] faultLog The fault log
+ * @param[out] log The buffer to fill
+ * @return The size of the log
+ */
+static uint32_t upload(FaultLog& faultLog, uint8_t* log) {
+    CO_OBJ_T entry = {0, &faultLog.canOpenInterface, (CO_DATA) &faultLog};
+
+    uint32_t size = faultLog.canOpenInterface.Size(&entry, nullptr, 0);
+    faultLog.canOpenInterface.Ctrl(&entry, nullptr, CO_CTRL_SET_OFF, 0);
+    for (uint32_t offset = 0; offset < size; offset += 7) {
+        uint32_t length = size - offset < 7 ? size - offset : 7;
+        faultLog.canOpenInterface.Read(&entry, nullptr, &log[offset], length);
+    }
+    return size;
+}
+
+/**
+ * Check the log holds the newest of the records written, with their
+ * sequence numbers, when downloaded
+ *
+ * @param[in] faultLog The fault log, just loaded
+ * @param[in] numWritten Number of records written
+ * @param[in] numSlots Number of slots holding records, one less than the
+ * ring after a cut write destroyed the oldest record
+ * @param[in] cut Number of bytes written before the power was cut
+ */
+static void checkLog(FaultLog& faultLog, uint32_t numWritten, uint8_t numSlots, uint32_t cut) {
+    if (*faultLog.getNumAppended() != numWritten) {
+        fail("count", numWritten, cut);
+        return;
+    }
+
+    // Expected sequence numbers, newest first
+    uint32_t expected[FaultLog::NUM_RECORDS];
+    uint8_t numExpected = 0;
+    for (uint32_t sequence = numWritten; sequence-- > 0 && numExpected < numSlots;) {
+        expected[numExpected++] = sequence;
+    }
+
+    uint8_t log[FaultLog::NUM_RECORDS * FaultLog::RECORD_SIZE];
+    uint32_t size = upload(faultLog, log);
+    if (size != numExpected * FaultLog::RECORD_SIZE) {
+        fail("download size", numWritten, cut);
+        return;
+    }
+    for (uint8_t i = 0; i < numExpected; i++) {
+        uint8_t bytes[FaultLog::RECORD_SIZE];
+        uint32_t sequence = expected[numExpected - 1 - i];
+        FaultLog::recordToArray(makeRecord(sequence), sequence, bytes);
+        if (memcmp(&log[i * FaultLog::RECORD_SIZE], bytes, FaultLog::RECORD_SIZE) != 0) {
+            fail("download", numWritten, cut);
+            return;
+        }
+    }
+}
+
+int main() {
+    constexpr uint32_t NUM_APPENDS = FaultLog::NUM_RECORDS * 5 / 2;
+
+    // Ring, restarting after every append
+    {
+        Board board;
+        for (uint32_t i = 0; i < NUM_APPENDS; i++) {
+            FaultLog faultLog(board.eeprom, board.i2cQueue);
+            faultLog.load();
+            checkLog(faultLog, i, FaultLog::NUM_RECORDS, FaultLog::RECORD_SIZE);
+            faultLog.append(makeRecord(i));
+        }
+        FaultLog faultLog(board.eeprom, board.i2cQueue);
+        faultLog.load();
+        checkLog(faultLog, NUM_APPENDS, FaultLog::NUM_RECORDS, FaultLog::RECORD_SIZE);
+
+        SIM::SimI2C::Stats before = board.i2c.getStats();
+        FaultLog booted(board.eeprom, board.i2cQueue);
+        booted.load();
+        SIM::SimI2C::Stats after = board.i2c.getStats();
+        printf("Boot with a full ring: %u bytes in %u transactions\r\n",
+               after.numBytes - before.numBytes, after.numTransactions - before.numTransactions);
+        printf("Ring: %u appends, %u write cycles\r\n", NUM_APPENDS, board.eepromSim.getNumWriteCycles());
+    }
+
+    // A fault logged part way through a download, once the oldest record has
+    // gone out
+    {
+        Board board;
+        FaultLog faultLog(board.eeprom, board.i2cQueue);
+        faultLog.load();
+        for (uint32_t i = 0; i < NUM_APPENDS; i++) {
+            faultLog.append(makeRecord(i));
+        }
+
+        uint8_t expected[FaultLog::NUM_RECORDS * FaultLog::RECORD_SIZE];
+        uint32_t size = upload(faultLog, expected);
+
+        CO_OBJ_T entry = {0, &faultLog.canOpenInterface, (CO_DATA) &faultLog};
+        uint8_t log[FaultLog::NUM_RECORDS * FaultLog::RECORD_SIZE];
+        faultLog.canOpenInterface.Size(&entry, nullptr, 0);
+        faultLog.canOpenInterface.Ctrl(&entry, nullptr, CO_CTRL_SET_OFF, 0);
+        bool appended = false;
+        for (uint32_t offset = 0; offset < size; offset += 7) {
+            uint32_t length = size - offset < 7 ? size - offset : 7;
+            faultLog.canOpenInterface.Read(&entry, nullptr, &log[offset], length);
+
+            if (!appended && offset + 7 >= size / 2) {
+                faultLog.append(makeRecord(NUM_APPENDS));
+                appended = true;
+            }
+        }
+        if (memcmp(log, expected, size) != 0) {
+            fail("download with a fault logged part way through", NUM_APPENDS, FaultLog::RECORD_SIZE);
+        }
+    }
+
+    // Power loss during an append, at every slot and every byte of the page
+    uint32_t numCuts = 0;
+    for (uint32_t numWritten = 0; numWritten < NUM_APPENDS; numWritten++) {
+        for (uint32_t cut = 0; cut <= FaultLog::RECORD_SIZE; cut++) {
+            Board board;
+            {
+                FaultLog faultLog(board.eeprom, board.i2cQueue);
+                faultLog.load();
+                for (uint32_t i = 0; i < numWritten; i++) {
+                    faultLog.append(makeRecord(i));
+                }
+                board.eepromSim.cutPowerOnNextWrite(cut);
+                faultLog.append(makeRecord(numWritten));
+            }
+
+            // A record is only there once all of its page was written. A cut
+            // write loses the record it overwrote as well.
+            bool committed = cut == FaultLog::RECORD_SIZE;
+            uint32_t numCommitted = committed ? numWritten + 1 : numWritten;
+            FaultLog faultLog(board.eeprom, board.i2cQueue);
+            faultLog.load();
+            checkLog(faultLog, numCommitted, committed ? FaultLog::NUM_RECORDS : FaultLog::NUM_RECORDS - 1, cut);
+
+            // The sequence continues after the last whole record, into the
+            // slot the cut record was written to
+            faultLog.append(makeRecord(numCommitted));
+            FaultLog rebooted(board.eeprom, board.i2cQueue);
+            rebooted.load();
+            checkLog(rebooted, numCommitted + 1, FaultLog::NUM_RECORDS, cut);
+            numCuts++;
+        }
+    }
+    printf("Power loss: %u cut writes\r\n", numCuts);
+
+    printf("%s\r\n", numFailures ? "FAIL" : "PASS");
+    return numFailures ? 1 : 0;
+}
@@ -0,0 +1,392 @@
+/**
+ * Host check of the I2C transaction queue
+ *
+ * Runs transactions against the BQ76952 model through the interrupt driven
+ * backend, whose transfers complete a fixed latency after their wire time,
+ * and checks:
+ *
+ * - Chain: submitting returns without moving the clock, the chain runs in
+ *   the background and the callback runs from process() with the data
+ * - Order: transactions complete in submission order, one transfer on the
+ *   wire at a time
+ * - Error: a transfer which is not acknowledged fails the transaction, drops
+ *   the rest of its chain and the next transaction still runs
+ * - Full: a submission past the queue size is refused
+ * - Acquire: no transfer starts while the bus is acquired, the held chain
+ *   resumes on release
+ * - BQ reads: the periodic BQ reads, submitted and collected through the
+ *   queue on both backends, match the blocking reads
+ *
+ * Usage: i2c_queue_check
+ */
+
+#include <cstdio>
+
+#include <I2CTransactionQueue.hpp>
+#include <dev/BQ76952.hpp>
+
+#include <sim/BQ76952Sim.hpp>
+#include <sim/SimAsyncI2C.hpp>
+#include <sim/SimClock.hpp>
+#include <sim/SimI2C.hpp>
+
+namespace IO = EVT::core::IO;
+namespace SIM = BMS::SIM;
+using BMS::I2CTransactionQueue;
+using BMS::DEV::BQ76952;
+
+/** Address of the BQ on the bus */
+constexpr uint8_t BQ_ADDR = 0x08;
+
+/** Address nothing acknowledges */
+constexpr uint8_t MISSING_ADDR = 0x30;
+
+/** Completion latency of a transfer in microseconds */
+constexpr uint32_t LATENCY = 20;
+
+/** Cells being balanced while the BQ reads are compared, bit N for cell N + 1 */
+constexpr uint16_t BALANCING_CELLS = 0x0815;
+
+/**
+ * Completion record of the callbacks
+ *
+ * @var order Index of each transaction in completion order
+ * @var status Status each transaction completed with, by index
+ * @var numCompleted Number of completed transactions
+ */
+struct Completions {
+    uint8_t order[I2CTransactionQueue::MAX_TRANSACTIONS];
+    I2CTransactionQueue::Status status[I2CTransactionQueue::MAX_TRANSACTIONS];
+    uint8_t numCompleted;
+};
+
+/**
+ * Private data of a callback
+ *
+ * @var completions Record to add the completion to
+ * @var index Index of the transaction
+ */
+struct CallbackData {
+    Completions* completions;
+    uint8_t index;
+};
+
+/**
+ * Record the completion of a transaction
+ *
+ * @param[in] status Result of the transaction
+ * @param[in] priv The CallbackData of the transaction
+ */
+static void recordCompletion(I2CTransactionQueue::Status status, void* priv) {
+    CallbackData* data = static_cast<CallbackData*>(priv);
+    Completions* completions = data->completions;
+    completions->order[completions->numCompleted++] = data->index;
+    completions->status[data->index] = status;
+}
+
+/**
+ * Print the result of a check
+ *
+ * @param[in] name Name of the check
+ * @param[in] passed True if the check passed
+ * @return passed
+ */
+static bool report(const char* name, bool passed) {
+    printf("%-10s %s\r\n", name, passed ? "PASS" : "FAIL");
+    return passed;
+}
+
+/**
+ * Set up the BQ model with distinct values in every register that is read
+ *
+ * @param[in] bqSim The model
+ */
+static void fillBQ(SIM::BQ76952Sim& bqSim) {
+    for (uint8_t i = 0; i < SIM::BQ76952Sim::NUM_CELL_INPUTS; i++) {
+        bqSim.setCellVoltage(i, 3500 + 13 * i);
+    }
+    bqSim.setStackVoltage(4321);
+    bqSim.setCurrent(-1234);
+    bqSim.setTemperatures(2982, 3012, 2952);
+    bqSim.setDirectRegister(0x02, 0x0102);
+    bqSim.setDirectRegister(0x04, 0x0304);
+    bqSim.setDirectRegister(0x06, 0x0506);
+    bqSim.setDirectRegister(0x62, 0x0708);
+    bqSim.setDirectRegister(0x12, 0x0908);
+}
+
+static bool checkChain() {
+    SIM::SimI2C i2c;
+    SIM::BQ76952Sim bqSim;
+    i2c.attach(BQ_ADDR, bqSim);
+    fillBQ(bqSim);
+    SIM::SimAsyncI2C bus(i2c, LATENCY);
+    I2CTransactionQueue queue(bus);
+
+    uint8_t cells[32];
+    uint8_t current[2];
+    uint8_t stack[2];
+    I2CTransactionQueue::Transaction transaction;
+    transaction.reset(BQ_ADDR);
+    transaction.addRead(0x14, cells, sizeof(cells));
+    transaction.addRead(0x3A, current, sizeof(current));
+    transaction.addRead(0x34, stack, sizeof(stack));
+
+    Completions completions = {};
+    CallbackData data = {&completions, 0};
+    uint64_t start = SIM::clock::micros();
+    bool passed = queue.submit(transaction, recordCompletion, &data) == I2CTransactionQueue::Status::PENDING;
+    passed &= SIM::clock::micros() == start;
+    passed &= transaction.getStatus() == I2CTransactionQueue::Status::PENDING;
+
+    // The chain runs in the background, the callback waits for process()
+    SIM::clock::advance(10000);
+    passed &= transaction.getStatus() == I2CTransactionQueue::Status::OK;
+    passed &= completions.numCompleted == 0;
+    queue.process();
+    passed &= completions.numCompleted == 1 && completions.status[0] == I2CTransactionQueue::Status::OK;
+    passed &= queue.isIdle();
+    passed &= bus.getStats().numTransfers == 3;
+
+    passed &= (cells[1] << 8 | cells[0]) == 3500 && (cells[31] << 8 | cells[30]) == 3500 + 13 * 15;
+    passed &= static_cast<int16_t>(current[1] << 8 | current[0]) == -1234;
+    passed &= (stack[1] << 8 | stack[0]) == 4321;
+
+    return report("Chain", passed);
+}
+
+static bool checkOrder() {
+    SIM::SimI2C i2c;
+    SIM::BQ76952Sim bqSim;
+    i2c.attach(BQ_ADDR, bqSim);
+    SIM::SimAsyncI2C bus(i2c, LATENCY);
+    I2CTransactionQueue queue(bus);
+
+    constexpr uint8_t NUM_TRANSACTIONS = 5;
+    uint8_t buffers[NUM_TRANSACTIONS][2];
+    I2CTransactionQueue::Transaction transactions[NUM_TRANSACTIONS];
+    Completions completions = {};
+    CallbackData data[NUM_TRANSACTIONS];
+    bool passed = true;
+
+    for (uint8_t i = 0; i < NUM_TRANSACTIONS; i++) {
+        transactions[i].reset(BQ_ADDR);
+        // Chains of 1 to 5 transfers, one of them empty
+        for (uint8_t j = 0; j < (i + 1) % NUM_TRANSACTIONS; j++) {
+            transactions[i].addRead(0x14 + 2 * j, buffers[i], 2);
+        }
+        data[i] = {&completions, i};
+        passed &= queue.submit(transactions[i], recordCompletion, &data[i]) == I2CTransactionQueue::Status::PENDING;
+    }
+
+    queue.flush();
+
+    passed &= completions.numCompleted == NUM_TRANSACTIONS;
+    for (uint8_t i = 0; i < NUM_TRANSACTIONS; i++) {
+        passed &= completions.order[i] == i && completions.status[i] == I2CTransactionQueue::Status::OK;
+    }
+    passed &= bus.getStats().numTransfers == 1 + 2 + 3 + 4 && bus.getStats().numOverlapped == 0;
+
+    return report("Order", passed);
+}
+
+static bool checkError() {
+    SIM::SimI2C i2c;
+    SIM::BQ76952Sim bqSim;
+    i2c.attach(BQ_ADDR, bqSim);
+    SIM::SimAsyncI2C bus(i2c, LATENCY);
+    I2CTransactionQueue queue(bus);
+
+    uint8_t buffer[2];
+    I2CTransactionQueue::Transaction missing;
+    missing.reset(MISSING_ADDR);
+    missing.addRead(0x14, buffer, 2);
+    missing.addRead(0x16, buffer, 2);
+    missing.addRead(0x18, buffer, 2);
+
+    I2CTransactionQueue::Transaction present;
+    present.reset(BQ_ADDR);
+    present.addRead(0x14, buffer, 2);
+
+    Completions completions = {};
+    CallbackData data[2] = {{&completions, 0}, {&completions, 1}};
+    queue.submit(missing, recordCompletion, &data[0]);
+    queue.submit(present, recordCompletion, &data[1]);
+    queue.flush();
+
+    bool passed = completions.numCompleted == 2;
+    passed &= completions.status[0] == I2CTransactionQueue::Status::ERROR;
+    passed &= completions.status[1] == I2CTransactionQueue::Status::OK;
+    passed &= bus.getStats().numTransfers == 2;
+
+    return report("Error", passed);
+}
+
+static bool checkFull() {
+    SIM::SimI2C i2c;
+    SIM::BQ76952Sim bqSim;
+    i2c.attach(BQ_ADDR, bqSim);
+    SIM::SimAsyncI2C bus(i2c, LATENCY);
+    I2CTransactionQueue queue(bus);
+
+    uint8_t buffer[2];
+    I2CTransactionQueue::Transaction transactions[I2CTransactionQueue::MAX_TRANSACTIONS + 1];
+    bool passed = true;
+    for (uint8_t i = 0; i <= I2CTransactionQueue::MAX_TRANSACTIONS; i++) {
+        transactions[i].reset(BQ_ADDR);
+        transactions[i].addRead(0x14, buffer, 2);
+        I2CTransactionQueue::Status expected = i < I2CTransactionQueue::MAX_TRANSACTIONS
+                                                   ? I2CTransactionQueue::Status::PENDING
+                                                   : I2CTransactionQueue::Status::FULL;
+        passed &= queue.submit(transactions[i], nullptr, nullptr) == expected;
+    }
+
+    // Completed but not yet processed transactions still take their slot
+    SIM::clock::advance(100000);
+    passed &= queue.submit(transactions[I2CTransactionQueue::MAX_TRANSACTIONS], nullptr, nullptr)
+              == I2CTransactionQueue::Status::FULL;
+    queue.process();
+    passed &= queue.isIdle();
+
+    return report("Full", passed);
+}
+
+static bool checkAcquire() {
+    SIM::SimI2C i2c;
+    SIM::BQ76952Sim bqSim;
+    i2c.attach(BQ_ADDR, bqSim);
+    SIM::SimAsyncI2C bus(i2c, LATENCY);
+    I2CTransactionQueue queue(bus);
+
+    uint8_t buffer[2];
+    I2CTransactionQueue::Transaction transaction;
+    transaction.reset(BQ_ADDR);
+    for (uint8_t i = 0; i < I2CTransactionQueue::Transaction::MAX_TRANSFERS; i++) {
+        transaction.addRead(0x14 + 2 * i, buffer, 2);
+    }
+    queue.submit(transaction, nullptr, nullptr);
+
+    // Take the bus in the middle of the chain
+    SIM::clock::advance(1000);
+    queue.acquireBus();
+    uint32_t numStarted = bus.getStats().numTransfers;
+    bool passed = numStarted > 1 && numStarted < I2CTransactionQueue::Transaction::MAX_TRANSFERS;
+    passed &= !bus.isBusy();
+
+    // Direct use of the bus, nothing of the queue may start meanwhile
+    uint8_t direct[2];
+    passed &= i2c.readMemReg(BQ_ADDR, 0x3A, direct, 2, 1) == IO::I2C::I2CStatus::OK;
+    SIM::clock::advance(10000);
+    passed &= bus.getStats().numTransfers == numStarted;
+    passed &= transaction.getStatus() == I2CTransactionQueue::Status::PENDING;
+
+    queue.releaseBus();
+    queue.flush();
+    passed &= transaction.getStatus() == I2CTransactionQueue::Status::OK;
+    passed &= bus.getStats().numTransfers == I2CTransactionQueue::Transaction::MAX_TRANSFERS;
+    passed &= bus.getStats().numOverlapped == 0;
+
+    return report("Acquire", passed);
+}
+
+/**
+ * Run the periodic BQ reads through a queue and compare them to the
+ * blocking reads
+ *
+ * @param[in] i2c The simulated bus, with the BQ model attached
+ * @param[in] queue Queue on a backend on the same bus
+ * @param[in] background True if the backend completes transfers in the
+ *                       background, false if it completes them on start
+ * @return True if every read matches
+ */
+static bool compareBQReads(SIM::SimI2C& i2c, I2CTransactionQueue& queue, bool background) {
+    BQ76952 bq(i2c, BQ_ADDR);
+    Completions completions = {};
+    CallbackData data[BQ76952::NUM_DATA_READS];
+    bool passed = bq.setBalancingMask(BALANCING_CELLS) == BQ76952::Status::OK;
+
+    for (uint8_t i = 0; i < BQ76952::NUM_DATA_READS; i++) {
+        data[i] = {&completions, i};
+        passed &= bq.submitRead(queue, static_cast<BQ76952::DataRead>(i), recordCompletion, &data[i])
+                  == BQ76952::Status::OK;
+    }
+    // Resubmitting reads still in flight does not queue them again
+    if (background) {
+        for (uint8_t i = 0; i < BQ76952::NUM_DATA_READS; i++) {
+            passed &= bq.submitRead(queue, static_cast<BQ76952::DataRead>(i), recordCompletion, &data[i])
+                      == BQ76952::Status::OK;
+        }
+    }
+    queue.flush();
+    passed &= completions.numCompleted == BQ76952::NUM_DATA_READS;
+
+    uint16_t cells[BQ76952::NUM_CELLS], expectedCells[BQ76952::NUM_CELLS];
+    uint32_t sum, expectedSum;
+    BMS::CellVoltageInfo info, expectedInfo;
+    passed &= bq.collectCellVoltage(cells, sum, info) == BQ76952::Status::OK;
+    passed &= bq.getCellVoltage(expectedCells, expectedSum, expectedInfo) == BQ76952::Status::OK;
+    for (uint8_t i = 0; i < BQ76952::NUM_CELLS; i++) {
+        passed &= cells[i] == expectedCells[i];
+    }
+    passed &= sum == expectedSum && info.minCellVoltage == expectedInfo.minCellVoltage
+              && info.maxCellVoltageId == expectedInfo.maxCellVoltageId;
+
+    int16_t current, expectedCurrent;
+    passed &= bq.collectCurrent(current) == BQ76952::Status::OK;
+    passed &= bq.getCurrent(expectedCurrent) == BQ76952::Status::OK && current == expectedCurrent;
+
+    uint16_t totalVoltage, expectedTotalVoltage;
+    uint8_t status[7], expectedStatus[7];
+    passed &= bq.collectStatus(totalVoltage, status) == BQ76952::Status::OK;
+    passed &= bq.getTotalVoltage(expectedTotalVoltage) == BQ76952::Status::OK;
+    passed &= bq.getBQStatus(expectedStatus) == BQ76952::Status::OK;
+    passed &= totalVoltage == expectedTotalVoltage;
+    for (uint8_t i = 0; i < 7; i++) {
+        passed &= status[i] == expectedStatus[i];
+    }
+
+    BMS::BqTempInfo temps, expectedTemps;
+    passed &= bq.collectTemps(temps) == BQ76952::Status::OK;
+    passed &= bq.getTemps(expectedTemps) == BQ76952::Status::OK;
+    passed &= temps.internalTemp == expectedTemps.internalTemp && temps.temp1 == expectedTemps.temp1
+              && temps.temp2 == expectedTemps.temp2;
+
+    uint16_t balancing;
+    passed &= bq.collectBalancing(balancing) == BQ76952::Status::OK && balancing == BALANCING_CELLS;
+    for (uint8_t i = 0; i < BQ76952::NUM_CELLS; i++) {
+        bool expectedBalancing;
+        passed &= bq.isBalancing(i + 1, &expectedBalancing) == BQ76952::Status::OK;
+        passed &= expectedBalancing == ((balancing >> i) & 1);
+    }
+
+    return passed;
+}
+
+static bool checkBQReads() {
+    SIM::SimI2C i2c;
+    SIM::BQ76952Sim bqSim;
+    i2c.attach(BQ_ADDR, bqSim);
+    fillBQ(bqSim);
+
+    SIM::SimAsyncI2C asyncBus(i2c, LATENCY);
+    I2CTransactionQueue asyncQueue(asyncBus);
+    bool passed = compareBQReads(i2c, asyncQueue, true);
+
+    I2CTransactionQueue::BlockingBus blockingBus(i2c);
+    I2CTransactionQueue blockingQueue(blockingBus);
+    passed &= compareBQReads(i2c, blockingQueue, false);
+
+    return report("BQ reads", passed);
+}
+
+int main() {
+    bool passed = true;
+    passed &= checkChain();
+    passed &= checkOrder();
+    passed &= checkError();
+    passed &= checkFull();
+    passed &= checkAcquire();
+    passed &= checkBQReads();
+
+    return passed ? 0 : 1;
+}
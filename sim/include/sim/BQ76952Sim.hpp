@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstdint>
+
+#include <sim/SimI2C.hpp>
+
+namespace BMS::SIM {
+
+/**
+ * Register-level behavioral model of the BQ76952
+ *
+ * Covers the parts of the chip the BMS firmware relies on:
+ *
+ *  - Direct commands (0x00-0x7F) with an auto-incrementing register pointer
+ *  - Subcommands written to 0x3E/0x3F with the response placed in the
+ *    0x40-0x5F transfer buffer and its checksum/length in 0x60/0x61
+ *  - RAM (data memory) writes which are only committed once a matching
+ *    checksum and length are written to 0x60/0x61
+ *  - CONFIG_UPDATE mode (SET_CFGUPDATE / EXIT_CFGUPDATE) which gates data
+ *    memory writes and is reported in Battery Status bit 0
+ *
+ * Measurements are set directly through the setters, there is no analog
+ * model behind them.
+ * TI Technical Reference Manual: https://www.ti.com/lit/ug/sluuby2b/sluuby2b.pdf
+ */
+class BQ76952Sim : public SimI2CDevice {
+public:
+    /** Number of cell inputs on the chip */
+    static constexpr uint8_t NUM_CELL_INPUTS = 16;
+
+    /** First address of the modeled data memory */
+    static constexpr uint16_t DATA_MEMORY_START = 0x9000;
+
+    /** Size of the modeled data memory in bytes */
+    static constexpr uint16_t DATA_MEMORY_SIZE = 0x400;
+
+    /**
+     * Counters for the operations the model has handled
+     *
+     * @var numSubcommands Subcommands executed, RAM reads included
+     * @var numRAMWrites Data memory and subcommand writes committed
+     * @var numRejectedWrites Writes dropped for a bad checksum or length, or
+     *                        data memory writes outside CONFIG_UPDATE mode
+     */
+    struct Stats {
+        uint32_t numSubcommands;
+        uint32_t numRAMWrites;
+        uint32_t numRejectedWrites;
+    };
+
+    /**
+     * Make a new BQ model with all measurements zeroed
+     */
+    BQ76952Sim();
+
+    bool write(const uint8_t* bytes, uint16_t length) override;
+    bool read(uint8_t* bytes, uint16_t length) override;
+
+    /**
+     * Set the voltage of a cell input
+     *
+     * @param[in] cellInput Cell input, 0 for VC1 up to 15 for VC16
+     * @param[in] voltage Voltage in mV
+     */
+    void setCellVoltage(uint8_t cellInput, uint16_t voltage);
+
+    /**
+     * Set the stack voltage
+     *
+     * @param[in] voltage Voltage in units of 10 mV
+     */
+    void setStackVoltage(uint16_t voltage);
+
+    /**
+     * Set the CC2 current
+     *
+     * @param[in] current Current in mA, positive when charging
+     */
+    void setCurrent(int16_t current);
+
+    /**
+     * Set the internal and TS1/TS3 temperatures
+     *
+     * @param[in] internal Internal temperature in 0.1 K
+     * @param[in] ts1 TS1 temperature in 0.1 K
+     * @param[in] ts3 TS3 temperature in 0.1 K
+     */
+    void setTemperatures(uint16_t internal, uint16_t ts1, uint16_t ts3);
+
+    /**
+     * Set a 16-bit direct command register, such as a status register
+     *
+     * @param[in] reg The direct command register
+     * @param[in] value The value to report
+     */
+    void setDirectRegister(uint8_t reg, uint16_t value);
+
+    /**
+     * Make the chip stop acknowledging its address
+     *
+     * @param[in] failed True to fail all transfers
+     */
+    void setCommunicationFailure(bool failed);
+
+    /**
+     * Make reads starting at one direct command register fail, while the
+     * rest of the chip keeps answering
+     *
+     * @param[in] reg The register, NO_REGISTER for none
+     */
+    void setReadFailure(uint8_t reg);
+
+    /** No register, for setReadFailure */
+    static constexpr uint8_t NO_REGISTER = 0xFF;
+
+    /**
+     * Check if the chip is in CONFIG_UPDATE mode
+     *
+     * @return True if in CONFIG_UPDATE mode
+     */
+    bool inConfigUpdateMode();
+
+    /**
+     * Read a value from the modeled data memory
+     *
+     * @param[in] address Data memory address
+     * @param[in] numBytes Number of bytes, up to 4
+     * @return The little endian value stored at the address
+     */
+    uint32_t getDataMemory(uint16_t address, uint8_t numBytes);
+
+    /**
+     * Get the CB_ACTIVE_CELLS balancing mask
+     *
+     * @return The active balancing bit mask
+     */
+    uint16_t getBalancingMask();
+
+    /**
+     * Get the operation counters
+     *
+     * @return The counters since the last reset
+     */
+    Stats getStats();
+
+    /**
+     * Clear the operation counters
+     */
+    void resetStats();
+
+private:
+    /** Subcommand address registers */
+    static constexpr uint8_t COMMAND_ADDR = 0x3E;
+    /** Start of the subcommand transfer buffer */
+    static constexpr uint8_t TRANSFER_BUFFER_ADDR = 0x40;
+    /** Size of the subcommand transfer buffer */
+    static constexpr uint8_t TRANSFER_BUFFER_SIZE = 32;
+    /** Transfer buffer checksum register, followed by the length register */
+    static constexpr uint8_t CHECKSUM_ADDR = 0x60;
+    /** Battery Status register */
+    static constexpr uint8_t BATTERY_STATUS_ADDR = 0x12;
+    /** First cell voltage register */
+    static constexpr uint8_t CELL_VOLTAGE_BASE_ADDR = 0x14;
+
+    /** Subcommands handled by the model */
+    static constexpr uint16_t DEVICE_NUMBER = 0x0001;
+    static constexpr uint16_t CB_ACTIVE_CELLS = 0x0083;
+    static constexpr uint16_t SET_CFGUPDATE = 0x0090;
+    static constexpr uint16_t EXIT_CFGUPDATE = 0x0092;
+
+    /** Value reported by the DEVICE_NUMBER subcommand */
+    static constexpr uint16_t DEVICE_ID = 0x7695;
+
+    /** Direct command register space */
+    uint8_t registers[0x80] = {};
+    /** Modeled data memory */
+    uint8_t dataMemory[DATA_MEMORY_SIZE] = {};
+    /** Active balancing mask */
+    uint16_t balancingMask = 0;
+    /** Register pointer for reads */
+    uint8_t pointer = 0;
+    /** Whether the chip is in CONFIG_UPDATE mode */
+    bool configUpdate = false;
+    /** Whether all transfers fail */
+    bool commFailure = false;
+    /** Register whose reads fail, NO_REGISTER for none */
+    uint8_t failedRegister = NO_REGISTER;
+    /** Operation counters */
+    Stats stats = {0, 0, 0};
+
+    /**
+     * Run the subcommand written to 0x3E/0x3F and load its response into the
+     * transfer buffer
+     */
+    void executeSubcommand();
+
+    /**
+     * Commit a write once the checksum and length have been written
+     */
+    void commitWrite();
+
+    /**
+     * Fill the transfer buffer with a response and its checksum and length
+     *
+     * @param[in] response The response bytes
+     * @param[in] length Number of response bytes
+     */
+    void loadResponse(const uint8_t* response, uint8_t length);
+
+    /**
+     * Store a 16-bit little endian value in the register space
+     *
+     * @param[in] reg The register to store to
+     * @param[in] value The value to store
+     */
+    void setRegister16(uint8_t reg, uint16_t value);
+};
+
+}// namespace BMS::SIM
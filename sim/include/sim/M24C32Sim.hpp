@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+
+#include <sim/SimI2C.hpp>
+
+namespace BMS::SIM {
+
+/**
+ * Behavioral model of the M24C32 32 Kbit I2C EEPROM
+ *
+ * Models the 2-byte memory address pointer with auto-increment, 32-byte page
+ * wrap-around on writes and the internal write cycle time. Accessing the
+ * device during a write cycle moves the simulated clock to the end of the
+ * cycle, standing in for acknowledge polling. Used with the real EVT-core
+ * M24C32 driver on top of SimI2C.
+ */
+class M24C32Sim : public SimI2CDevice {
+public:
+    /** Size of the memory in bytes */
+    static constexpr uint16_t MEMORY_SIZE = 4096;
+
+    /** Size of a write page in bytes */
+    static constexpr uint8_t PAGE_SIZE = 32;
+
+    /** Internal write cycle time in microseconds */
+    static constexpr uint32_t WRITE_CYCLE_TIME = 5000;
+
+    /**
+     * Make a new EEPROM model, erased to 0xFF
+     */
+    M24C32Sim();
+
+    bool write(const uint8_t* bytes, uint16_t length) override;
+    bool read(uint8_t* bytes, uint16_t length) override;
+
+    /**
+     * Directly load memory contents, bypassing the bus
+     *
+     * @param[in] address Memory address to start at
+     * @param[in] bytes Data to load
+     * @param[in] length Number of bytes to load
+     */
+    void load(uint16_t address, const uint8_t* bytes, uint16_t length);
+
+    /**
+     * Get direct access to the memory contents
+     *
+     * @return Pointer to MEMORY_SIZE bytes of memory
+     */
+    uint8_t* getMemory();
+
+    /**
+     * Get the number of write cycles that have taken place
+     *
+     * @return The number of page write cycles
+     */
+    uint32_t getNumWriteCycles();
+
+    /**
+     * Cut the power during the next write cycle
+     *
+     * Only the first numBytes data bytes of the next write are programmed.
+     * The rest of the bytes the write covers are left holding garbage, as
+     * they are after a page write cut short part way through.
+     *
+     * @param[in] numBytes Number of data bytes programmed before the cut
+     */
+    void cutPowerOnNextWrite(uint8_t numBytes);
+
+private:
+    /** Memory contents */
+    uint8_t memory[MEMORY_SIZE];
+    /** Current address pointer */
+    uint16_t pointer = 0;
+    /** Simulated time at which the current write cycle finishes */
+    uint64_t busyUntil = 0;
+    /** Number of page write cycles */
+    uint32_t numWriteCycles = 0;
+    /** Set while the power is cut on the next write cycle */
+    bool powerCut = false;
+    /** Number of data bytes programmed before the power is cut */
+    uint8_t bytesBeforeCut = 0;
+    /** State of the generator of the garbage left by a cut write */
+    uint32_t garbageState = 0x2545F491;
+
+    /**
+     * Advance the simulated clock past a running write cycle
+     */
+    void waitForWriteCycle();
+};
+
+}// namespace BMS::SIM
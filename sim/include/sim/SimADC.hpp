@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+#include <EVT/io/ADC.hpp>
+
+namespace BMS::SIM {
+
+/**
+ * Host implementation of the EVT-core ADC interface
+ *
+ * Reports a raw 12-bit count set by the simulation, or one supplied by a
+ * callback so time varying inputs such as a thermistor MUX can be modeled.
+ */
+class SimADC : public EVT::core::IO::ADC {
+public:
+    /** Full scale raw count of the 12-bit ADC */
+    static constexpr uint32_t MAX_RAW = 4095;
+
+    /** Reference voltage of the ADC */
+    static constexpr float VREF = 3.3f;
+
+    /**
+     * Source of raw samples
+     *
+     * @param[in] priv Private data provided with the source
+     * @return The raw ADC count
+     */
+    typedef uint32_t (*SampleSource)(void* priv);
+
+    /**
+     * Make a new simulated ADC reading 0
+     */
+    SimADC();
+
+    float read() override;
+    uint32_t readRaw() override;
+    float readPercentage() override;
+
+    /**
+     * Set a fixed raw count
+     *
+     * @param[in] raw The raw count to report
+     */
+    void setRaw(uint32_t raw);
+
+    /**
+     * Take samples from a callback instead of a fixed value
+     *
+     * @param[in] source The sample source, nullptr to use the fixed value
+     * @param[in] priv Private data passed to the source
+     */
+    void setSource(SampleSource source, void* priv);
+
+    /**
+     * Get the number of samples that have been taken
+     *
+     * @return The number of samples
+     */
+    uint32_t getNumSamples();
+
+private:
+    /** Fixed raw count */
+    uint32_t raw = 0;
+    /** Optional sample source */
+    SampleSource source = nullptr;
+    /** Private data of the sample source */
+    void* sourcePriv = nullptr;
+    /** Number of samples taken */
+    uint32_t numSamples = 0;
+};
+
+}// namespace BMS::SIM
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+
+#include <I2CTransactionQueue.hpp>
+
+#include <sim/SimI2C.hpp>
+
+namespace BMS::SIM {
+
+/**
+ * Interrupt driven I2C backend of the transaction queue, on the simulated bus
+ *
+ * A transfer runs in the background: its completion "interrupt" is a clock
+ * event which fires once the simulated time has moved past the wire time of
+ * the transfer plus a fixed completion latency, the time the interrupt or
+ * DMA handling would take. Starting a transfer leaves the clock alone, so
+ * the time the firmware spends waiting on the bus can be told apart from the
+ * time it can spend on other work.
+ */
+class SimAsyncI2C : public I2CTransactionQueue::Bus {
+public:
+    /**
+     * Transfer statistics
+     *
+     * @var numTransfers Number of transfers started
+     * @var numOverlapped Number of transfers started while another one was
+     *                    still on the wire, 0 unless the queue is broken
+     * @var numWaits Number of times the firmware waited on a transfer
+     */
+    struct Stats {
+        uint32_t numTransfers;
+        uint32_t numOverlapped;
+        uint32_t numWaits;
+    };
+
+    /**
+     * Make a new backend
+     *
+     * @param[in] i2c The simulated bus the transfers are moved on
+     * @param[in] latency Time from the end of a transfer on the wire to its
+     *                    completion interrupt in microseconds
+     */
+    SimAsyncI2C(SimI2C& i2c, uint32_t latency);
+
+    void startTransfer(uint8_t addr, const I2CTransactionQueue::Transfer& transfer) override;
+    void waitTransfer() override;
+
+    /**
+     * Check if a transfer is on the wire
+     *
+     * @return True until the completion interrupt of the last transfer fired
+     */
+    bool isBusy();
+
+    /**
+     * Get the transfer statistics
+     *
+     * @return The statistics since the backend was made
+     */
+    Stats getStats();
+
+private:
+    /** Simulated bus the transfers are moved on */
+    SimI2C& i2c;
+    /** Completion latency in microseconds */
+    uint32_t latency;
+    /** Simulated time the transfer on the wire completes at */
+    uint64_t completionTime = 0;
+    /** True until the completion interrupt of the last transfer fired */
+    bool busy = false;
+    /** Result of the transfer on the wire */
+    I2CTransactionQueue::Status result = I2CTransactionQueue::Status::OK;
+    /** Transfer statistics */
+    Stats stats = {0, 0, 0};
+
+    /**
+     * Completion interrupt of a transfer
+     *
+     * @param[in] priv The backend
+     */
+    static void completionEvent(void* priv);
+};
+
+}// namespace BMS::SIM
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+namespace BMS::SIM {
+
+/**
+ * Simulated time base for the host build
+ *
+ * Replaces the EVT-core time backend. Time only moves forward when the
+ * simulation advances it, either explicitly or as a side effect of simulated
+ * bus traffic and calls to EVT::core::time::wait. This makes every run
+ * deterministic and lets bus time be measured exactly.
+ *
+ * Events can be scheduled to model interrupts. An event fires while the time
+ * is advanced past it, with the time set to the moment it was scheduled for.
+ */
+namespace clock {
+
+/** Maximum number of scheduled events */
+constexpr uint8_t MAX_EVENTS = 8;
+
+/**
+ * Function which is called when an event fires
+ *
+ * @param[in] priv Private data provided when scheduling the event
+ */
+typedef void (*Event)(void* priv);
+
+/**
+ * Get the simulated time
+ *
+ * @return Simulated time in microseconds
+ */
+uint64_t micros();
+
+/**
+ * Advance the simulated time
+ *
+ * @param[in] us Number of microseconds to move forward
+ */
+void advance(uint64_t us);
+
+/**
+ * Set the simulated time, without firing events
+ *
+ * @param[in] us New simulated time in microseconds
+ */
+void set(uint64_t us);
+
+/**
+ * Schedule an event
+ *
+ * @param[in] time Simulated time to fire the event at in microseconds, an
+ *                 event in the past fires on the next advance
+ * @param[in] event Function to call
+ * @param[in] priv Private data for the function
+ * @return False if too many events are scheduled
+ */
+bool schedule(uint64_t time, Event event, void* priv);
+
+}// namespace clock
+
+}// namespace BMS::SIM
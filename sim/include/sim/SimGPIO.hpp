@@ -0,0 +1,40 @@
+#pragma once
+
+#include <EVT/io/GPIO.hpp>
+
+namespace BMS::SIM {
+
+/**
+ * Host implementation of the EVT-core GPIO interface
+ *
+ * Outputs remember the last written state, inputs report whatever state the
+ * simulation sets.
+ */
+class SimGPIO : public EVT::core::IO::GPIO {
+public:
+    /**
+     * Make a new simulated GPIO
+     *
+     * @param[in] direction Direction of the pin
+     * @param[in] state Initial state of the pin
+     */
+    explicit SimGPIO(Direction direction = Direction::INPUT, State state = State::LOW);
+
+    void setDirection(Direction direction) override;
+    void writePin(State state) override;
+    State readPin() override;
+    void registerIRQ(TriggerEdge edge, void (*irqHandler)(GPIO* pin, void* priv), void* priv) override;
+
+    /**
+     * Drive the pin from the simulation side
+     *
+     * @param[in] state New state of the pin
+     */
+    void setState(State state);
+
+private:
+    /** Current state of the pin */
+    State state;
+};
+
+}// namespace BMS::SIM
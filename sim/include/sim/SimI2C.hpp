@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+
+#include <EVT/io/I2C.hpp>
+
+namespace BMS::SIM {
+
+/**
+ * Device which can be attached to the simulated I2C bus
+ *
+ * A device only sees the raw bytes of each transfer, exactly as a real I2C
+ * target would. Register pointers, auto-increment and side effects are up
+ * to the device model.
+ */
+class SimI2CDevice {
+public:
+    virtual ~SimI2CDevice() = default;
+
+    /**
+     * Handle a write transfer addressed to the device
+     *
+     * @param[in] bytes The bytes written by the controller
+     * @param[in] length The number of bytes written
+     * @return True if the device acknowledged the transfer
+     */
+    virtual bool write(const uint8_t* bytes, uint16_t length) = 0;
+
+    /**
+     * Handle a read transfer addressed to the device
+     *
+     * @param[out] bytes The bytes returned to the controller
+     * @param[in] length The number of bytes requested
+     * @return True if the device acknowledged the transfer
+     */
+    virtual bool read(uint8_t* bytes, uint16_t length) = 0;
+};
+
+/**
+ * Host implementation of the EVT-core I2C interface
+ *
+ * Routes every transfer to the device attached at the target address and
+ * advances the simulated clock by the time the transfer would take on the
+ * wire. Transfer statistics are kept so driver changes can be compared by
+ * the bus traffic they generate.
+ */
+class SimI2C : public EVT::core::IO::I2C {
+public:
+    /** Maximum number of devices on the bus */
+    static constexpr uint8_t MAX_DEVICES = 4;
+
+    /**
+     * Bus traffic statistics
+     *
+     * @var numTransactions Number of addressed transfers (START + address)
+     * @var numBytes Number of data bytes moved, address bytes excluded
+     * @var busTime Time spent on the wire in microseconds
+     */
+    struct Stats {
+        uint32_t numTransactions;
+        uint32_t numBytes;
+        uint64_t busTime;
+    };
+
+    /**
+     * Make a new simulated bus
+     *
+     * @param[in] frequency Bus clock frequency in Hz, used for timing
+     */
+    explicit SimI2C(uint32_t frequency = 100000);
+
+    /**
+     * Attach a device to the bus
+     *
+     * @param[in] addr 7-bit address of the device
+     * @param[in] device The device model
+     */
+    void attach(uint8_t addr, SimI2CDevice& device);
+
+    /**
+     * Get the bus traffic statistics
+     *
+     * @return The statistics since the last reset
+     */
+    Stats getStats();
+
+    /**
+     * Clear the bus traffic statistics
+     */
+    void resetStats();
+
+    /**
+     * Choose whether transfers advance the simulated clock
+     *
+     * Blocking transfers do. A backend which moves transfers in the
+     * background turns it off around its transfers and accounts for the
+     * wire time itself.
+     *
+     * @param[in] enable True to advance the clock by the wire time
+     */
+    void setClockAdvance(bool enable);
+
+    I2CStatus write(uint8_t addr, uint8_t byte) override;
+    I2CStatus read(uint8_t addr, uint8_t* output) override;
+    I2CStatus write(uint8_t addr, uint8_t* bytes, uint8_t length) override;
+    I2CStatus read(uint8_t addr, uint8_t* bytes, uint8_t length) override;
+    I2CStatus writeMemReg(uint8_t addr, uint32_t memAddress, uint8_t byte,
+                          uint16_t memAddSize, uint8_t maxWriteTime) override;
+    I2CStatus readMemReg(uint8_t addr, uint32_t memAddress, uint8_t* byte,
+                         uint16_t memAddSize) override;
+    I2CStatus writeMemReg(uint8_t addr, uint32_t memAddress, uint8_t* bytes,
+                          uint8_t size, uint16_t memAddSize, uint8_t maxWriteTime) override;
+    I2CStatus readMemReg(uint8_t addr, uint32_t memAddress, uint8_t* bytes,
+                         uint8_t size, uint16_t memAddSize) override;
+
+private:
+    /** Largest single transfer supported, memory address included */
+    static constexpr uint16_t MAX_TRANSFER_SIZE = 260;
+
+    /**
+     * Entry of the device table
+     */
+    struct Attached {
+        uint8_t addr;
+        SimI2CDevice* device;
+    };
+
+    /** Devices on the bus */
+    Attached devices[MAX_DEVICES] = {};
+    /** Number of attached devices */
+    uint8_t numDevices = 0;
+    /** Bus clock frequency in Hz */
+    uint32_t frequency;
+    /** Bus traffic statistics */
+    Stats stats = {0, 0, 0};
+    /** True if transfers advance the simulated clock */
+    bool clockAdvance = true;
+
+    /**
+     * Find the device attached at the given address
+     *
+     * @param[in] addr 7-bit address
+     * @return The device, nullptr if no device acknowledges the address
+     */
+    SimI2CDevice* find(uint8_t addr);
+
+    /**
+     * Account for a transfer and advance the simulated clock
+     *
+     * @param[in] numBytes Number of data bytes in the transfer
+     */
+    void account(uint16_t numBytes);
+
+    /**
+     * Write a memory address followed by data in a single transfer
+     */
+    I2CStatus writeWithAddress(uint8_t addr, uint32_t memAddress, uint16_t memAddSize,
+                               const uint8_t* bytes, uint16_t length);
+};
+
+}// namespace BMS::SIM
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include <EVT/dev/IWDG.hpp>
+
+namespace BMS::SIM {
+
+/**
+ * Host implementation of the EVT-core independent watchdog
+ *
+ * Records refreshes against the simulated clock and counts how often the
+ * refresh came later than the timeout, which on hardware would have reset
+ * the MCU.
+ */
+class SimIWDG : public EVT::core::DEV::IWDG {
+public:
+    /**
+     * Make a new simulated watchdog
+     *
+     * @param[in] timeout Watchdog timeout in milliseconds
+     */
+    explicit SimIWDG(uint32_t timeout);
+
+    void init() override;
+    void refresh() override;
+
+    /**
+     * Get the number of timeouts that would have reset the MCU
+     *
+     * @return The number of missed refreshes
+     */
+    uint32_t getNumTimeouts();
+
+private:
+    /** Watchdog timeout in milliseconds */
+    uint32_t timeout;
+    /** Whether the watchdog has been started */
+    bool started = false;
+    /** Simulated time of the last refresh in milliseconds */
+    uint32_t lastRefresh = 0;
+    /** Number of missed refreshes */
+    uint32_t numTimeouts = 0;
+};
+
+}// namespace BMS::SIM
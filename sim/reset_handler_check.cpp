@@ -0,0 +1,133 @@
+/**
+ * Host check of the ResetHandler frame matching
+ *
+ * Feeds sequences of reset frames mixed with other bus traffic into a
+ * ResetHandler, with the clear() the BMS does on entering a state, and
+ * compares what shouldReset() reports against the expected result of each
+ * sequence.
+ *
+ * Usage: reset_handler_check
+ */
+
+#include <cstdio>
+
+#include <EVT/io/types/CANMessage.hpp>
+
+#include <ResetHandler.hpp>
+
+namespace IO = EVT::core::IO;
+
+/**
+ * Kinds of frames used to build the sequences
+ */
+enum class Frame {
+    /** 0x7FF with the reset payload */
+    RESET,
+    /** Heartbeat of the bike */
+    HEARTBEAT,
+    /** 0x7FF with the wrong payload */
+    BAD_PAYLOAD,
+    /** 0x7FF with a short payload */
+    SHORT,
+    /** Not a frame, ResetHandler::clear() is called */
+    CLEAR,
+    /** Marks the end of a sequence */
+    END,
+};
+
+/**
+ * A sequence of frames and the expected result
+ *
+ * @var name Description of the sequence
+ * @var frames The frames, terminated by Frame::END
+ * @var expected Expected results of shouldReset() after the frames, first
+ * and second call
+ */
+struct Case {
+    const char* name;
+    Frame frames[16];
+    bool expected[2];
+};
+
+/**
+ * Build the CAN frame of a kind
+ *
+ * @param[in] frame The kind of frame
+ * @return The CAN frame
+ */
+static IO::CANMessage makeFrame(Frame frame) {
+    uint8_t payload[8] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+
+    switch (frame) {
+    case Frame::HEARTBEAT:
+        return IO::CANMessage(0x70A, 1, payload, false);
+    case Frame::BAD_PAYLOAD:
+        payload[7] = 0xFF;
+        return IO::CANMessage(0x7FF, 8, payload, false);
+    case Frame::SHORT:
+        return IO::CANMessage(0x7FF, 7, payload, false);
+    default:
+        return IO::CANMessage(0x7FF, 8, payload, false);
+    }
+}
+
+#define R Frame::RESET
+#define H Frame::HEARTBEAT
+#define B Frame::BAD_PAYLOAD
+#define S Frame::SHORT
+#define C Frame::CLEAR
+#define E Frame::END
+
+static const Case CASES[] = {
+    {"No frames", {E}, {false, false}},
+    {"Five reset frames", {R, R, R, R, R, E}, {true, false}},
+    {"Four reset frames", {R, R, R, R, E}, {false, false}},
+    {"Heartbeat before five reset frames", {H, R, R, R, R, R, E}, {true, false}},
+    {"Heartbeat after five reset frames", {R, R, R, R, R, H, E}, {true, false}},
+    {"Heartbeat interleaved", {R, R, H, R, R, R, E}, {false, false}},
+    {"Heartbeats between every frame", {R, H, R, H, R, H, R, H, R, E}, {false, false}},
+    {"Wrong payload interleaved", {R, R, R, R, B, R, E}, {false, false}},
+    {"Short payload interleaved", {R, S, R, R, R, R, E}, {false, false}},
+    {"Interrupted, then five reset frames", {R, R, H, R, R, R, R, R, E}, {true, false}},
+    {"Ten reset frames", {R, R, R, R, R, R, R, R, R, R, E}, {true, false}},
+    {"Nine reset frames", {R, R, R, R, R, R, R, R, R, E}, {true, false}},
+    {"Cleared after five reset frames", {R, R, R, R, R, C, E}, {false, false}},
+    {"Cleared, then five reset frames", {R, R, R, R, R, C, R, R, R, R, R, E}, {true, false}},
+    {"Cleared after two of five reset frames", {R, R, C, R, R, R, E}, {true, false}},
+};
+
+#undef R
+#undef H
+#undef B
+#undef S
+#undef C
+#undef E
+
+int main() {
+    uint8_t failed = 0;
+
+    for (const Case& c : CASES) {
+        BMS::ResetHandler resetHandler;
+
+        for (uint8_t i = 0; c.frames[i] != Frame::END; i++) {
+            if (c.frames[i] == Frame::CLEAR) {
+                resetHandler.clear();
+                continue;
+            }
+            IO::CANMessage message = makeFrame(c.frames[i]);
+            resetHandler.registerInput(message);
+        }
+
+        bool first = resetHandler.shouldReset();
+        bool second = resetHandler.shouldReset();
+        bool passed = first == c.expected[0] && second == c.expected[1];
+        if (!passed) {
+            failed++;
+        }
+
+        printf("%-40s shouldReset %d %d: %s\r\n", c.name, first, second, passed ? "PASS" : "FAIL");
+    }
+
+    printf("%u of %zu cases failed\r\n", failed, sizeof(CASES) / sizeof(CASES[0]));
+    return failed ? 1 : 0;
+}
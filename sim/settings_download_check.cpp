@@ -0,0 +1,369 @@
+/**
+ * Host check of the BQ settings download
+ *
+ * Downloads settings images into BQSettingsStorage through its CANopen
+ * interface, in the parts an SDO download hands over, onto the M24C32 model,
+ * then checks:
+ *
+ * - Download: for every part size, the image lands in EEPROM byte for byte,
+ *   is loaded again after a restart with the same settings and every page
+ *   is written once
+ * - Time: the EEPROM time of the download, an estimate of the time on the
+ *   bus for a segmented and a block SDO download, and the time to load the
+ *   image at boot, for images in the fixed and in the stream encoding
+ * - Rejected: a bad header, a corrupted setting and extra bytes fail the
+ *   download, and neither they nor a short image leave an image to use
+ * - Settings: BQSettingsStorage::writeSetting, used by the UART upload, goes
+ *   through the same page buffer and stores the same image
+ *
+ * Usage: settings_download_check
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+
+#include <EVT/dev/storage/M24C32.hpp>
+
+#include <BQSettingStorage.hpp>
+#include <CRC32.hpp>
+#include <dev/BQ76952.hpp>
+
+#include <sim/M24C32Sim.hpp>
+#include <sim/SimClock.hpp>
+#include <sim/SimI2C.hpp>
+
+namespace SIM = BMS::SIM;
+using BMS::BQSetting;
+using BMS::BQSettingsStorage;
+
+/** Address of the EEPROM on the bus */
+constexpr uint8_t EEPROM_ADDR = 0x57;
+
+/** Address of the BQ on the bus, not used by the download */
+constexpr uint8_t BQ_ADDR = 0x08;
+
+/** Number of settings in the images */
+constexpr uint16_t NUM_SETTINGS = 200;
+
+/** Address of the first setting in the images */
+constexpr uint16_t FIRST_ADDRESS = 0x9180;
+
+/** Bytes of data in an SDO segment */
+constexpr uint32_t SEGMENT_SIZE = 7;
+
+/** Segments in an SDO block, the largest block size */
+constexpr uint32_t BLOCK_SEGMENTS = 127;
+
+/** Time of a CAN frame at 500 kbit/s in microseconds, with bit stuffing */
+constexpr uint32_t FRAME_TIME = 260;
+
+/** Period of the DEV1-BMS main loop in microseconds, one SDO response per pass */
+constexpr uint32_t LOOP_PERIOD = 10000;
+
+/** Number of failed checks, only the first few are printed */
+static uint32_t numFailures = 0;
+
+/**
+ * Record a failure
+ *
+ * @param[in] context Description of the failed check
+ * @param[in] partSize Size of the parts the image was downloaded in
+ */
+static void fail(const char* context, uint32_t partSize) {
+    if (numFailures++ < 10) {
+        printf("FAIL %s, %u byte parts\r\n", context, partSize);
+    }
+}
+
+/**
+ * EEPROM and storage on a simulated bus
+ */
+struct Board {
+    SIM::SimI2C i2c;
+    SIM::M24C32Sim eepromSim;
+    EVT::core::DEV::M24C32 eeprom;
+    BMS::DEV::BQ76952 bq;
+
+    Board() : eeprom(EEPROM_ADDR, i2c), bq(i2c, BQ_ADDR) {
+        i2c.attach(EEPROM_ADDR, eepromSim);
+    }
+};
+
+/**
+ * Make the next setting of the images, 1, 2 and 4 byte RAM settings which
+ * mostly follow on from each other. Every 10th setting leaves a small gap and
+ * every 64th a large one, so every address encoding of the stream is used.
+ *
+ * @param[in] index Index of the setting
+ * @param[in,out] address Address of the setting, updated for the next one
+ * @return The setting
+ */
+static BQSetting makeSetting(uint16_t index, uint16_t& address) {
+    static constexpr uint8_t SIZES[3] = {1, 2, 4};
+
+    if (index % 64 == 63) {
+        address += 0x200;
+    } else if (index % 10 == 9) {
+        address += 3;
+    }
+    BQSetting setting(BQSetting::BQSettingType::RAM, SIZES[index % 3], address, 0x5A5A5A5A + index);
+    address += SIZES[index % 3];
+    return setting;
+}
+
+/**
+ * Make a settings image of the settings from makeSetting
+ *
+ * @param[out] image The buffer to fill, BQSettingsStorage::MAX_IMAGE_SIZE in size
+ * @param[in] blockCrc True to add the block CRCs
+ * @param[in] stream True for the stream encoding, false for the fixed one
+ * @return The size of the image
+ */
+static uint32_t makeImage(uint8_t* image, bool blockCrc, bool stream) {
+    uint8_t* settings = &image[BQSettingsStorage::HEADER_SIZE];
+    uint16_t settingsSize = 0;
+    uint16_t address = FIRST_ADDRESS;
+    uint16_t nextAddress = 0;
+    for (uint16_t i = 0; i < NUM_SETTINGS; i++) {
+        BQSetting setting = makeSetting(i, address);
+        if (stream) {
+            settingsSize += setting.toStream(&settings[settingsSize], nextAddress);
+        } else {
+            setting.toArray(&settings[settingsSize]);
+            settingsSize += BQSetting::ARRAY_SIZE;
+        }
+    }
+
+    uint8_t flags = blockCrc ? BQSettingsStorage::FLAG_BLOCK_CRC : 0;
+    BQSettingsStorage::Header header = {
+        .numSettings = NUM_SETTINGS,
+        .flags = static_cast<uint8_t>(stream ? flags | BQSettingsStorage::FLAG_STREAM : flags),
+        .imageCrc = BMS::CRC32::compute(settings, settingsSize),
+        .settingsSize = settingsSize,
+    };
+    BQSettingsStorage::headerToArray(header, image);
+
+    uint32_t size = BQSettingsStorage::HEADER_SIZE + settingsSize;
+    if (blockCrc) {
+        constexpr uint32_t BLOCK_SIZE = BQSettingsStorage::CRC_BLOCK_SIZE;
+        for (uint32_t offset = 0; offset < settingsSize; offset += BLOCK_SIZE) {
+            uint32_t numBytes = settingsSize - offset < BLOCK_SIZE ? settingsSize - offset : BLOCK_SIZE;
+            uint32_t crc = BMS::CRC32::compute(&settings[offset], numBytes);
+            for (uint8_t i = 0; i < 4; i++) {
+                image[size++] = (crc >> (i * 8)) & 0xFF;
+            }
+        }
+    }
+    return size;
+}
+
+/**
+ * Download an image through the CANopen interface of the storage, the way
+ * the CANopen stack does for an SDO download
+ *
+ * @param[in] storage The storage to download into
+ * @param[in] image The image
+ * @param[in] size Size of the image
+ * @param[in] partSize Number of bytes handed over in each write
+ * @return True if every write was accepted
+ */
+static bool download(BQSettingsStorage& storage, const uint8_t* image, uint32_t size, uint32_t partSize) {
+    CO_OBJ_T entry = {0, &storage.canOpenInterface, (CO_DATA) &storage};
+
+    if (storage.canOpenInterface.Size(&entry, nullptr, size) < size) {
+        return false;
+    }
+
+    // The stack sets the offset ahead of every part, not only the first
+    bool accepted = true;
+    uint8_t part[BLOCK_SEGMENTS * SEGMENT_SIZE];
+    for (uint32_t offset = 0; offset < size; offset += partSize) {
+        uint32_t length = size - offset < partSize ? size - offset : partSize;
+        storage.canOpenInterface.Ctrl(&entry, nullptr, CO_CTRL_SET_OFF, offset);
+        memcpy(part, &image[offset], length);
+        accepted &= storage.canOpenInterface.Write(&entry, nullptr, part, length) == CO_ERR_NONE;
+    }
+    return accepted;
+}
+
+/**
+ * Check the stored image matches, both right after the download and after a
+ * restart of the storage
+ *
+ * @param[in] board The board the image was downloaded on
+ * @param[in] storage The storage the image was downloaded into
+ * @param[in] image The image
+ * @param[in] size Size of the image
+ * @param[in] partSize Size of the parts the image was downloaded in
+ */
+static void checkStored(Board& board, BQSettingsStorage& storage, const uint8_t* image, uint32_t size,
+                        uint32_t partSize) {
+    if (!storage.hasSettings() || storage.getNumSettings() != NUM_SETTINGS) {
+        fail("not stored", partSize);
+        return;
+    }
+    if (memcmp(board.eepromSim.getMemory(), image, size) != 0) {
+        fail("EEPROM contents", partSize);
+        return;
+    }
+
+    BQSettingsStorage restarted(board.eeprom, board.bq);
+    if (!restarted.hasSettings() || restarted.getNumSettings() != NUM_SETTINGS) {
+        fail("not loaded after a restart", partSize);
+        return;
+    }
+
+    uint16_t address = FIRST_ADDRESS;
+    for (uint16_t i = 0; i < NUM_SETTINGS; i++) {
+        BQSetting expected = makeSetting(i, address);
+        BQSetting setting;
+        restarted.readSetting(setting);
+        if (setting.getSettingType() != expected.getSettingType() || setting.getAddress() != expected.getAddress()
+            || setting.getNumBytes() != expected.getNumBytes() || setting.getData() != expected.getData()) {
+            fail("settings read back", partSize);
+            return;
+        }
+    }
+}
+
+/**
+ * Check a download is rejected and leaves no image to use
+ *
+ * @param[in] name Name of the check
+ * @param[in] image The image
+ * @param[in] size Size of the image
+ */
+static void checkRejected(const char* name, const uint8_t* image, uint32_t size) {
+    Board board;
+    BQSettingsStorage storage(board.eeprom, board.bq);
+    if (download(storage, image, size, SEGMENT_SIZE) || storage.hasSettings() || storage.isDownloadComplete()) {
+        fail(name, SEGMENT_SIZE);
+        return;
+    }
+
+    BQSettingsStorage restarted(board.eeprom, board.bq);
+    if (restarted.hasSettings()) {
+        fail(name, SEGMENT_SIZE);
+    }
+}
+
+int main() {
+    static uint8_t image[BQSettingsStorage::MAX_IMAGE_SIZE];
+    static uint8_t bad[BQSettingsStorage::MAX_IMAGE_SIZE];
+
+    // Download, in the parts of a segmented and a block download and in odd
+    // sizes, with and without block CRCs, in both encodings
+    static constexpr uint32_t PART_SIZES[] = {1, 5, SEGMENT_SIZE, 32, 100, BLOCK_SEGMENTS * SEGMENT_SIZE};
+    for (bool stream : {false, true}) {
+    for (bool blockCrc : {false, true}) {
+        uint32_t size = makeImage(image, blockCrc, stream);
+        for (uint32_t partSize : PART_SIZES) {
+            Board board;
+            BQSettingsStorage storage(board.eeprom, board.bq);
+
+            uint32_t cyclesBefore = board.eepromSim.getNumWriteCycles();
+            uint64_t start = SIM::clock::micros();
+            if (!download(storage, image, size, partSize) || !storage.isDownloadComplete()) {
+                fail("download", partSize);
+                continue;
+            }
+            uint64_t elapsed = SIM::clock::micros() - start;
+            uint32_t cycles = board.eepromSim.getNumWriteCycles() - cyclesBefore;
+            checkStored(board, storage, image, size, partSize);
+
+            // One write of the old header, one of each page and one of the
+            // new header
+            uint32_t numPages = (size + SIM::M24C32Sim::PAGE_SIZE - 1) / SIM::M24C32Sim::PAGE_SIZE;
+            if (cycles != numPages + 2) {
+                fail("page writes", partSize);
+            }
+
+            if (blockCrc && partSize == SEGMENT_SIZE) {
+                uint64_t loadStart = SIM::clock::micros();
+                BQSettingsStorage loaded(board.eeprom, board.bq);
+                uint64_t loadTime = SIM::clock::micros() - loadStart;
+
+                uint32_t numSegments = (size + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+                uint32_t numBlocks = (numSegments + BLOCK_SEGMENTS - 1) / BLOCK_SEGMENTS;
+                printf("Image of %u settings in the %s encoding, %u bytes: %u EEPROM writes, "
+                       "%llu.%03llu ms in the BMS, loaded in %llu.%03llu ms\r\n",
+                       NUM_SETTINGS, stream ? "stream" : "fixed", size, cycles,
+                       static_cast<unsigned long long>(elapsed / 1000),
+                       static_cast<unsigned long long>(elapsed % 1000),
+                       static_cast<unsigned long long>(loadTime / 1000),
+                       static_cast<unsigned long long>(loadTime % 1000));
+                // Segmented: a request and a response per segment, one
+                // segment per pass of the main loop. Block: the segments of
+                // a block back to back, one acknowledgement per block.
+                printf("Estimated on the bus: segmented %u ms, block %u ms\r\n",
+                       (numSegments * (LOOP_PERIOD + 2 * FRAME_TIME)) / 1000,
+                       static_cast<uint32_t>((numSegments * FRAME_TIME + numBlocks * (LOOP_PERIOD + FRAME_TIME)
+                                              + elapsed)
+                                             / 1000));
+            }
+        }
+    }
+    }
+
+    // Rejected downloads
+    uint32_t size = makeImage(image, true, true);
+    memcpy(bad, image, size);
+    bad[5] ^= 0x01;
+    checkRejected("bad header", bad, size);
+
+    memcpy(bad, image, size);
+    bad[BQSettingsStorage::HEADER_SIZE + 100] ^= 0x10;
+    checkRejected("corrupted setting", bad, size);
+
+    memcpy(bad, image, size);
+    bad[size] = 0;
+    checkRejected("extra bytes", bad, size + 1);
+
+    // A download which stops early is never complete
+    {
+        Board board;
+        BQSettingsStorage storage(board.eeprom, board.bq);
+        download(storage, image, size - 1, SEGMENT_SIZE);
+        BQSettingsStorage restarted(board.eeprom, board.bq);
+        if (storage.isDownloadComplete() || storage.hasSettings() || restarted.hasSettings()) {
+            fail("short image", SEGMENT_SIZE);
+        }
+    }
+
+    // A new download starts over after a failed one
+    {
+        Board board;
+        BQSettingsStorage storage(board.eeprom, board.bq);
+        memcpy(bad, image, size);
+        bad[size - 1] ^= 0x01;
+        download(storage, bad, size / 2, SEGMENT_SIZE);
+        if (!download(storage, image, size, SEGMENT_SIZE)) {
+            fail("download after an aborted one", SEGMENT_SIZE);
+        }
+        checkStored(board, storage, image, size, SEGMENT_SIZE);
+    }
+
+    // Settings written one at a time, in the stream encoding
+    {
+        makeImage(bad, false, false);
+        uint32_t settingsSize = makeImage(image, false, true);
+        Board board;
+        BQSettingsStorage storage(board.eeprom, board.bq);
+        uint32_t cyclesBefore = board.eepromSim.getNumWriteCycles();
+        storage.setNumSettings(NUM_SETTINGS);
+        storage.resetEEPROMOffset();
+        storage.writeNumSettings();
+        BQSetting setting;
+        for (uint16_t i = 0; i < NUM_SETTINGS; i++) {
+            setting.fromArray(&bad[BQSettingsStorage::HEADER_SIZE + i * BQSetting::ARRAY_SIZE]);
+            storage.writeSetting(setting);
+        }
+        checkStored(board, storage, image, settingsSize, BQSetting::ARRAY_SIZE);
+        printf("Settings written one at a time: %u EEPROM writes\r\n",
+               board.eepromSim.getNumWriteCycles() - cyclesBefore);
+    }
+
+    printf("%s\r\n", numFailures ? "FAIL" : "PASS");
+    return numFailures ? 1 : 0;
+}
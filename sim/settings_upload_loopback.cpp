@@ -0,0 +1,316 @@
+/**
+ * Loopback check of the UART settings upload on Linux
+ *
+ * Runs BMS::SettingsUpload on one side of a pseudo terminal, storing into
+ * the M24C32 model, and `tools/bqsettings/run.py upload` on the other, the
+ * way the host tool talks to the uart_settings_upload target. Each case
+ * uploads a generated image, with errors injected on the BMS side of the
+ * line:
+ *
+ * - Clean: nothing injected
+ * - Corrupted: a bit of a received byte is flipped, the frame fails its CRC
+ * - Dropped: a received byte is lost, the frame is cut short
+ * - Lost response: the response to the first window never reaches the host
+ *
+ * and then checks the host tool succeeded, the image is in EEPROM byte for
+ * byte and is loaded after a restart. The bytes on the line, the windows
+ * and the EEPROM time are reported, with an estimate of the upload time at
+ * the baud rate of the target.
+ *
+ * The pseudo terminal has no baud rate, the time is estimated from the
+ * bytes sent. Needs python3 with pyserial.
+ *
+ * Usage: settings_upload_loopback [path to tools/bqsettings/run.py]
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <EVT/dev/storage/M24C32.hpp>
+
+#include <BQSettingStorage.hpp>
+#include <CRC32.hpp>
+#include <SettingsUpload.hpp>
+#include <dev/BQ76952.hpp>
+
+#include <sim/M24C32Sim.hpp>
+#include <sim/SimClock.hpp>
+#include <sim/SimI2C.hpp>
+
+namespace SIM = BMS::SIM;
+using BMS::BQSetting;
+using BMS::BQSettingsStorage;
+using BMS::SettingsUpload;
+
+/** Address of the EEPROM on the bus */
+constexpr uint8_t EEPROM_ADDR = 0x57;
+
+/** Address of the BQ on the bus, not used by the upload */
+constexpr uint8_t BQ_ADDR = 0x08;
+
+/** Number of settings in the image */
+constexpr uint16_t NUM_SETTINGS = 200;
+
+/** Longest time a case may take in milliseconds */
+constexpr uint32_t MAX_TIME = 30000;
+
+/** Bits on the line per byte, with the start and stop bits */
+constexpr uint32_t BITS_PER_BYTE = 10;
+
+/** Number of failed checks, only the first few are printed */
+static uint32_t numFailures = 0;
+
+/**
+ * Record a failure
+ *
+ * @param[in] context Description of the failed check
+ * @param[in] name Name of the case
+ */
+static void fail(const char* context, const char* name) {
+    if (numFailures++ < 10) {
+        printf("FAIL %s, %s\r\n", context, name);
+    }
+}
+
+/**
+ * Errors injected on the BMS side of the line
+ *
+ * @var name Name printed in the report
+ * @var corruptByte Index of the received byte to flip a bit of, -1 for none
+ * @var dropByte Index of the received byte to lose, -1 for none
+ * @var dropResponse Index of the response to lose, -1 for none
+ */
+struct Scenario {
+    const char* name;
+    int32_t corruptByte;
+    int32_t dropByte;
+    int32_t dropResponse;
+};
+
+/**
+ * Link to the host tool over the master side of a pseudo terminal
+ */
+class PtyLink : public SettingsUpload::Link {
+public:
+    PtyLink(int fd, const Scenario& scenario) : fd(fd), scenario(scenario) {}
+
+    bool isReadable() override {
+        while (!hasByte) {
+            if (::read(fd, &byte, 1) != 1) {
+                return false;
+            }
+
+            int32_t index = numReceived++;
+            if (index == scenario.dropByte) {
+                continue;
+            }
+            if (index == scenario.corruptByte) {
+                byte ^= 0x10;
+            }
+            hasByte = true;
+        }
+        return true;
+    }
+
+    uint8_t read() override {
+        hasByte = false;
+        return byte;
+    }
+
+    void write(uint8_t* bytes, uint8_t length) override {
+        if (static_cast<int32_t>(numResponses++) != scenario.dropResponse) {
+            ::write(fd, bytes, length);
+        }
+        numSent += length;
+    }
+
+    /** Number of bytes received from the host */
+    uint32_t numReceived = 0;
+    /** Number of bytes sent to the host */
+    uint32_t numSent = 0;
+
+private:
+    /** Master side of the pseudo terminal */
+    int fd;
+    /** Errors to inject */
+    const Scenario& scenario;
+    /** Received byte not read yet */
+    uint8_t byte = 0;
+    /** True if byte holds a received byte */
+    bool hasByte = false;
+    /** Number of responses sent */
+    uint32_t numResponses = 0;
+};
+
+/**
+ * EEPROM and storage on a simulated bus
+ */
+struct Board {
+    SIM::SimI2C i2c;
+    SIM::M24C32Sim eepromSim;
+    EVT::core::DEV::M24C32 eeprom;
+    BMS::DEV::BQ76952 bq;
+
+    Board() : eeprom(EEPROM_ADDR, i2c), bq(i2c, BQ_ADDR) {
+        i2c.attach(EEPROM_ADDR, eepromSim);
+    }
+};
+
+/**
+ * Make a settings image of 1, 2 and 4 byte RAM settings, in the stream
+ * encoding with block CRCs
+ *
+ * @param[out] image The buffer to fill, BQSettingsStorage::MAX_IMAGE_SIZE in size
+ * @return The size of the image
+ */
+static uint32_t makeImage(uint8_t* image) {
+    static constexpr uint8_t SIZES[3] = {1, 2, 4};
+
+    uint8_t* settings = &image[BQSettingsStorage::HEADER_SIZE];
+    uint16_t settingsSize = 0;
+    uint16_t address = 0x9180;
+    uint16_t nextAddress = 0;
+    for (uint16_t i = 0; i < NUM_SETTINGS; i++) {
+        BQSetting setting(BQSetting::BQSettingType::RAM, SIZES[i % 3], address, 0x5A5A5A5A + i);
+        settingsSize += setting.toStream(&settings[settingsSize], nextAddress);
+        address += SIZES[i % 3];
+    }
+
+    BQSettingsStorage::Header header = {
+        .numSettings = NUM_SETTINGS,
+        .flags = BQSettingsStorage::FLAG_BLOCK_CRC | BQSettingsStorage::FLAG_STREAM,
+        .imageCrc = BMS::CRC32::compute(settings, settingsSize),
+        .settingsSize = settingsSize,
+    };
+    BQSettingsStorage::headerToArray(header, image);
+
+    uint32_t size = BQSettingsStorage::HEADER_SIZE + settingsSize;
+    constexpr uint32_t BLOCK_SIZE = BQSettingsStorage::CRC_BLOCK_SIZE;
+    for (uint32_t offset = 0; offset < settingsSize; offset += BLOCK_SIZE) {
+        uint32_t numBytes = settingsSize - offset < BLOCK_SIZE ? settingsSize - offset : BLOCK_SIZE;
+        uint32_t crc = BMS::CRC32::compute(&settings[offset], numBytes);
+        for (uint8_t i = 0; i < 4; i++) {
+            image[size++] = (crc >> (i * 8)) & 0xFF;
+        }
+    }
+    return size;
+}
+
+/**
+ * Upload the image through a pseudo terminal and check it was stored
+ *
+ * @param[in] scenario Errors to inject
+ * @param[in] runPy Path to the host tool
+ * @param[in] imagePath Path to the image file
+ * @param[in] image The image
+ * @param[in] size Size of the image
+ */
+static void run(const Scenario& scenario, const char* runPy, const char* imagePath, const uint8_t* image,
+                uint32_t size) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        fail("no pseudo terminal", scenario.name);
+        return;
+    }
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    // Keep the slave side open, so the master does not hang up before the
+    // host tool opens it
+    const char* slaveName = ptsname(master);
+    int slave = open(slaveName, O_RDWR | O_NOCTTY);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(master);
+        close(slave);
+        execlp("python3", "python3", runPy, "upload", imagePath, slaveName, static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    Board board;
+    BQSettingsStorage storage(board.eeprom, board.bq);
+    PtyLink link(master, scenario);
+    SettingsUpload upload(link, storage);
+
+    // Time only moves on while the BMS waits for the host, or through the
+    // simulated EEPROM traffic
+    uint64_t start = SIM::clock::micros();
+    uint64_t waitTime = 0;
+    int status = -1;
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        upload.process();
+
+        pollfd event = {master, POLLIN, 0};
+        if (poll(&event, 1, 1) == 0 || !(event.revents & POLLIN)) {
+            SIM::clock::advance(1000);
+            waitTime += 1000;
+        }
+        if (waitTime / 1000 > MAX_TIME) {
+            kill(pid, SIGKILL);
+        }
+    }
+    close(slave);
+    close(master);
+    uint64_t eepromTime = SIM::clock::micros() - start - waitTime;
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fail("host tool failed", scenario.name);
+        return;
+    }
+    if (!upload.isDone() || !storage.hasSettings() || storage.getNumSettings() != NUM_SETTINGS) {
+        fail("not stored", scenario.name);
+        return;
+    }
+    if (memcmp(board.eepromSim.getMemory(), image, size) != 0) {
+        fail("EEPROM contents", scenario.name);
+        return;
+    }
+    BQSettingsStorage restarted(board.eeprom, board.bq);
+    if (!restarted.hasSettings() || restarted.getNumSettings() != NUM_SETTINGS) {
+        fail("not loaded after a restart", scenario.name);
+        return;
+    }
+
+    uint32_t lineTime = (link.numReceived + link.numSent) * BITS_PER_BYTE * 1000 / SettingsUpload::BAUD_RATE;
+    printf("%-13s %u bytes in %u windows, %u frames dropped, %u bytes on the line: "
+           "%u ms at %u baud + %u ms EEPROM\r\n",
+           scenario.name, size, upload.getNumWindows(), upload.getNumDropped(),
+           link.numReceived + link.numSent, lineTime, SettingsUpload::BAUD_RATE,
+           static_cast<uint32_t>(eepromTime / 1000));
+}
+
+int main(int argc, char** argv) {
+    const char* runPy = argc > 1 ? argv[1] : "tools/bqsettings/run.py";
+
+    static uint8_t image[BQSettingsStorage::MAX_IMAGE_SIZE];
+    uint32_t size = makeImage(image);
+
+    char imagePath[] = "/tmp/settings_upload_XXXXXX";
+    int imageFile = mkstemp(imagePath);
+    if (imageFile < 0 || write(imageFile, image, size) != static_cast<ssize_t>(size)) {
+        printf("FAIL could not write the image\r\n");
+        return 1;
+    }
+    close(imageFile);
+
+    static const Scenario SCENARIOS[] = {
+        {"Clean", -1, -1, -1},
+        {"Corrupted", 300, -1, -1},
+        {"Dropped", -1, 700, -1},
+        {"Lost response", -1, -1, 0},
+    };
+    for (const Scenario& scenario : SCENARIOS) {
+        run(scenario, runPy, imagePath, image, size);
+    }
+    unlink(imagePath);
+
+    printf("%s\r\n", numFailures ? "FAIL" : "PASS");
+    return numFailures ? 1 : 0;
+}
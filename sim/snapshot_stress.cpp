@@ -0,0 +1,121 @@
+/**
+ * Host stress test of the double buffered telemetry snapshot
+ *
+ * A writer thread stands in for the BMS tasks, filling the working copy one
+ * value at a time and publishing it. A reader thread stands in for a context
+ * which interrupts the main loop and takes copies with read(). The reader
+ * checks every copy it gets:
+ *
+ * - Every value matches the frame number, so no copy mixes two publishes
+ * - Frame numbers never go back
+ *
+ * Torn copies, which read() reports so they are taken again, are counted.
+ * The run is repeated with a reader which holds on to each copy, so it
+ * mostly reads while the writer is between publishes.
+ *
+ * Usage: snapshot_stress [publishes]
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <Snapshot.hpp>
+
+/** Number of values in a frame, same as the 12 cell voltages */
+constexpr uint8_t NUM_VALUES = 12;
+
+/**
+ * Stand-in for the telemetry, every value is derived from the frame number
+ *
+ * @var frame Number of the frame
+ * @var values Values derived from the frame number
+ */
+struct Frame {
+    uint32_t frame;
+    uint16_t values[NUM_VALUES];
+};
+
+/**
+ * Get the value a frame should hold, 0 for the frame 0 the snapshot starts
+ * out with
+ *
+ * @param[in] frame The frame number
+ * @param[in] index The index of the value
+ * @return The value
+ */
+static uint16_t expectedValue(uint32_t frame, uint8_t index) {
+    return static_cast<uint16_t>(frame * (31 + index * 7));
+}
+
+/**
+ * Run one writer and one reader thread on a snapshot
+ *
+ * @param[in] numPublishes Number of publishes the writer makes
+ * @param[in] readerDelay Busy loop iterations the reader spends per copy
+ * @return True if every copy the reader got was whole and in order
+ */
+static bool runStress(uint32_t numPublishes, uint32_t readerDelay) {
+    BMS::Snapshot<Frame> snapshot;
+    std::atomic<bool> done{false};
+    uint32_t numReads = 0;
+    uint32_t numTorn = 0;
+    uint32_t errors = 0;
+
+    std::thread reader([&]() {
+        Frame copy;
+        uint32_t lastFrame = 0;
+
+        while (!done.load(std::memory_order_acquire)) {
+            if (!snapshot.read(copy)) {
+                numTorn++;
+                continue;
+            }
+
+            bool whole = true;
+            for (uint8_t i = 0; i < NUM_VALUES; i++) {
+                whole &= copy.values[i] == expectedValue(copy.frame, i);
+            }
+            if (!whole || copy.frame < lastFrame) {
+                errors++;
+            }
+            lastFrame = copy.frame;
+            numReads++;
+
+            for (volatile uint32_t i = 0; i < readerDelay; i = i + 1) {}
+        }
+    });
+
+    std::thread writer([&]() {
+        for (uint32_t frame = 1; frame <= numPublishes; frame++) {
+            Frame& working = snapshot.working();
+            working.frame = frame;
+            for (uint8_t i = 0; i < NUM_VALUES; i++) {
+                working.values[i] = expectedValue(frame, i);
+            }
+            snapshot.publish();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    writer.join();
+    reader.join();
+
+    // The published copy has to be the last frame once the writer is done
+    Frame last;
+    bool passed = errors == 0 && snapshot.read(last) && last.frame == numPublishes
+                  && snapshot.getNumPublished() == numPublishes;
+    printf("Reader delay %u: %u publishes, %u reads, %u torn and retried, %u errors: %s\r\n",
+           readerDelay, numPublishes, numReads, numTorn, errors, passed ? "PASS" : "FAIL");
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    uint32_t numPublishes = argc > 1 ? atoi(argv[1]) : 5000000;
+
+    bool passed = runStress(numPublishes, 0);
+    passed &= runStress(numPublishes / 10, 200);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+/**
+ * Host check of the state of charge estimator
+ *
+ * Drives SocEstimator with a current trace sampled at jittered intervals,
+ * persisting to the M24C32 model on the simulated bus, and checks:
+ *
+ * - Coulomb counting: the charge tracks the exact integral of the trace to
+ *   within 1 mAs, including currents too small to move the charge by 1 mAs
+ *   in one sample
+ * - Saves: the stored estimate never falls more than SAVE_DELTA behind
+ * - OCV correction: only applied once the pack has been at rest for the
+ *   whole rest time, a current during the rest starts the time over
+ * - Restore: a new estimator loads the stored estimate, and a corrupted
+ *   record is rejected and replaced by one from the OCV
+ * - Gaps: a gap in sampling at full current is not integrated
+ *
+ * Usage: soc_estimator_check
+ */
+
+#include <cstdio>
+
+#include <EVT/dev/storage/M24C32.hpp>
+
+#include <SocEstimator.hpp>
+
+#include <sim/M24C32Sim.hpp>
+#include <sim/SimI2C.hpp>
+
+namespace SIM = BMS::SIM;
+using BMS::SocEstimator;
+
+/** Address of the EEPROM on the bus */
+constexpr uint8_t EEPROM_ADDR = 0x57;
+
+/** Capacity of the pack in mAh, matches the BMS */
+constexpr uint32_t PACK_CAPACITY = 20000;
+
+/** Charge in mAs of one SOC step of 0.01% */
+constexpr int64_t CHARGE_PER_STEP = PACK_CAPACITY * 36 / 100;
+
+/** Rest time before the OCV correction in milliseconds, matches SocEstimator */
+constexpr uint32_t REST_TIME = 600000;
+
+/** Change in SOC between saves, matches SocEstimator */
+constexpr uint16_t SAVE_DELTA = 100;
+
+/** Cell voltages in mV at 50% and 70% SOC on the OCV table */
+constexpr uint16_t OCV_50 = 3710;
+constexpr uint16_t OCV_70 = 3870;
+
+/** Number of failed checks, only the first few are printed */
+static uint32_t numFailures = 0;
+
+/**
+ * Record a failure
+ *
+ * @param[in] context Description of the failed check
+ * @param[in] timestamp Time of the sample in milliseconds
+ */
+static void fail(const char* context, uint32_t timestamp) {
+    if (numFailures++ < 10) {
+        printf("FAIL %s, at %u ms\r\n", context, timestamp);
+    }
+}
+
+/**
+ * EEPROM on a simulated bus
+ */
+struct Board {
+    SIM::SimI2C i2c;
+    SIM::M24C32Sim eepromSim;
+    EVT::core::DEV::M24C32 eeprom;
+
+    Board() : eeprom(EEPROM_ADDR, i2c) {
+        i2c.attach(EEPROM_ADDR, eepromSim);
+    }
+
+    /**
+     * Get the charge in the stored SOC record
+     *
+     * @return The charge in mAs
+     */
+    int32_t storedCharge() {
+        uint8_t* record = &eepromSim.getMemory()[SocEstimator::EEPROM_ADDRESS];
+        return static_cast<int32_t>(static_cast<uint32_t>(record[5]) << 24 | static_cast<uint32_t>(record[4]) << 16
+                                    | static_cast<uint32_t>(record[3]) << 8 | static_cast<uint32_t>(record[2]));
+    }
+
+    /**
+     * Get the charge the estimator holds, by saving it
+     *
+     * @param[in] soc The estimator
+     * @return The charge in mAs
+     */
+    int32_t charge(SocEstimator& soc) {
+        soc.save();
+        return storedCharge();
+    }
+};
+
+/**
+ * Current trace fed to the estimator, with the exact integral of what was
+ * fed
+ */
+struct Trace {
+    SocEstimator& soc;
+    Board& board;
+    uint32_t timestamp;
+    /** Exact charge in mA*ms since the start of the trace */
+    int64_t integral = 0;
+    /** State of the jitter generator */
+    uint32_t seed = 12345;
+
+    Trace(SocEstimator& soc, Board& board, uint32_t timestamp) : soc(soc), board(board), timestamp(timestamp) {}
+
+    /**
+     * Feed samples of a constant current for a time, 7 to 13 ms apart
+     *
+     * @param[in] current Pack current in mA
+     * @param[in] cellVoltage Average cell voltage in mV
+     * @param[in] duration Time to feed samples for in milliseconds
+     */
+    void run(int16_t current, uint16_t cellVoltage, uint32_t duration) {
+        uint32_t end = timestamp + duration;
+        while (timestamp < end) {
+            seed = seed * 1103515245 + 12345;
+            uint32_t interval = 7 + (seed >> 16) % 7;
+            timestamp += interval;
+            integral += static_cast<int64_t>(current) * interval;
+            soc.update(current, cellVoltage, timestamp);
+            if (soc.isSaveDue()) {
+                soc.save();
+            }
+
+            int32_t saved = board.storedCharge() / CHARGE_PER_STEP;
+            int32_t held = soc.getSoc();
+            if (saved - held >= SAVE_DELTA || held - saved >= SAVE_DELTA) {
+                fail("stored estimate behind", timestamp);
+            }
+        }
+    }
+};
+
+/**
+ * Check the charge of the estimator against the integral of a trace
+ *
+ * @param[in] trace The trace
+ * @param[in] start Charge at the start of the trace in mAs
+ * @param[in] context Description of the check
+ */
+static void checkCharge(Trace& trace, int32_t start, const char* context) {
+    int64_t error = static_cast<int64_t>(trace.board.charge(trace.soc)) * 1000 - (start * 1000LL + trace.integral);
+    if (error <= -1000 || error >= 1000) {
+        fail(context, trace.timestamp);
+    }
+}
+
+int main() {
+    Board board;
+
+    // Coulomb counting from an estimate set from the OCV of an erased EEPROM
+    SocEstimator soc(board.eeprom, PACK_CAPACITY);
+    soc.load();
+    soc.update(0, OCV_50, 0);
+    if (soc.getSoc() != 5000 || !soc.isSaveDue()) {
+        fail("estimate from the OCV", 0);
+    }
+    int32_t start = board.charge(soc);
+
+    Trace trace(soc, board, 0);
+    trace.run(-20000, OCV_50, 60000);
+    trace.run(15000, OCV_50, 30000);
+    trace.run(-7321, OCV_50, 45000);
+    checkCharge(trace, start, "count of large currents");
+
+    // Each sample is well below 1 mAs, only the carried remainder counts them
+    trace.run(-3, OCV_50, 20000);
+    trace.run(7, OCV_50, 20000);
+    checkCharge(trace, start, "count of currents below 1 mAs per sample");
+    printf("Counted %lld mAs, SOC %u after %u ms\r\n", static_cast<long long>(trace.integral / 1000), soc.getSoc(),
+           trace.timestamp);
+
+    // A current part way through the rest starts the rest time over
+    uint16_t countedSoc = soc.getSoc();
+    trace.run(0, OCV_70, REST_TIME / 2);
+    trace.run(-500, OCV_70, 100);
+    trace.run(0, OCV_70, REST_TIME - 100);
+    if (soc.getSoc() != countedSoc) {
+        fail("OCV correction before the rest time", trace.timestamp);
+    }
+    trace.run(0, OCV_70, 200);
+    if (soc.getSoc() != 7000) {
+        fail("no OCV correction after the rest time", trace.timestamp);
+    }
+    printf("SOC corrected from %u to %u at rest\r\n", countedSoc, soc.getSoc());
+
+    // The correction is saved and restored on the next start
+    SocEstimator restarted(board.eeprom, PACK_CAPACITY);
+    restarted.load();
+    if (restarted.getSoc() != 7000) {
+        fail("restore of the corrected estimate", trace.timestamp);
+    }
+
+    // A gap at full current is not integrated
+    start = board.charge(restarted);
+    restarted.update(-32768, OCV_70, trace.timestamp);
+    Trace gapTrace(restarted, board, trace.timestamp);
+    gapTrace.run(-32768, OCV_70, 1000);
+    int32_t beforeGap = board.charge(restarted);
+    gapTrace.timestamp += 120000;
+    restarted.update(-32768, OCV_70, gapTrace.timestamp);
+    if (board.charge(restarted) != beforeGap) {
+        fail("gap in sampling integrated", gapTrace.timestamp);
+    }
+    gapTrace.run(-32768, OCV_70, 1000);
+    checkCharge(gapTrace, start, "count around a gap in sampling");
+
+    // A corrupted record is rejected, the estimate comes from the OCV again
+    board.eepromSim.getMemory()[SocEstimator::EEPROM_ADDRESS + 3] ^= 0x01;
+    SocEstimator corrupted(board.eeprom, PACK_CAPACITY);
+    corrupted.load();
+    corrupted.update(0, 0, 0);
+    if (corrupted.getSoc() != 0) {
+        fail("estimate before a cell voltage reading", 0);
+    }
+    corrupted.update(0, OCV_50, 10);
+    if (corrupted.isSaveDue()) {
+        corrupted.save();
+    }
+    SocEstimator reloaded(board.eeprom, PACK_CAPACITY);
+    reloaded.load();
+    if (corrupted.getSoc() != 5000 || reloaded.getSoc() != 5000) {
+        fail("estimate from the OCV after a corrupted record", 10);
+    }
+
+    printf("%s\r\n", numFailures ? "FAIL" : "PASS");
+    return numFailures ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Host stress test of the SPSC queue used between the CAN interrupt handler
+ * and the main loop
+ *
+ * A producer thread stands in for the interrupt handler and pushes numbered
+ * frames in bursts, a consumer thread stands in for the main loop and pops
+ * them. The consumer checks every frame it gets:
+ *
+ * - The payload matches the sequence number, so no frame was torn
+ * - Sequence numbers only increase, so no frame was reordered or duplicated
+ *
+ * At the end every frame has to be either received or counted as an
+ * overflow. The run is repeated with a slow consumer so the full queue path
+ * is exercised as well.
+ *
+ * Usage: spsc_stress [frames]
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <SPSCQueue.hpp>
+
+/** Capacity of the queue under test, same as DEV1-BMS */
+constexpr uint32_t QUEUE_SIZE = 64;
+
+/** Largest burst of frames pushed back to back by the producer */
+constexpr uint32_t MAX_BURST = 96;
+
+/**
+ * Stand-in for a CAN frame, the payload repeats the sequence number so a
+ * torn copy is detected
+ *
+ * @var sequence Number of the frame
+ * @var payload Bytes derived from the sequence number
+ */
+struct Frame {
+    uint32_t sequence;
+    uint8_t payload[8];
+};
+
+/**
+ * Fill a frame for a sequence number
+ *
+ * @param[out] frame The frame
+ * @param[in] sequence The sequence number
+ */
+static void makeFrame(Frame& frame, uint32_t sequence) {
+    frame.sequence = sequence;
+    for (uint8_t i = 0; i < sizeof(frame.payload); i++) {
+        frame.payload[i] = static_cast<uint8_t>(sequence >> (i % 4 * 8)) ^ i;
+    }
+}
+
+/**
+ * Run one producer and one consumer thread on a queue
+ *
+ * @param[in] numFrames Number of frames the producer pushes
+ * @param[in] consumerDelay Busy loop iterations the consumer spends per frame
+ * @return True if the consumer saw every frame intact and in order
+ */
+static bool runStress(uint32_t numFrames, uint32_t consumerDelay) {
+    BMS::SPSCQueue<Frame, QUEUE_SIZE> queue;
+    bool producerDone = false;
+    std::atomic<bool> done{false};
+    uint32_t received = 0;
+    uint32_t errors = 0;
+
+    std::thread consumer([&]() {
+        Frame frame;
+        Frame expected;
+        int64_t lastSequence = -1;
+
+        while (true) {
+            // Read the flag before popping, so nothing pushed before it was
+            // set can be missed
+            bool finished = done.load(std::memory_order_acquire);
+
+            while (queue.pop(&frame)) {
+                makeFrame(expected, frame.sequence);
+                if (memcmp(&frame, &expected, sizeof(Frame)) != 0 || frame.sequence <= lastSequence) {
+                    errors++;
+                }
+                lastSequence = frame.sequence;
+                received++;
+
+                for (volatile uint32_t i = 0; i < consumerDelay; i = i + 1) {}
+            }
+
+            if (finished) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::thread producer([&]() {
+        Frame frame;
+        uint32_t sequence = 0;
+        srand(1);
+
+        while (sequence < numFrames) {
+            uint32_t burst = 1 + rand() % MAX_BURST;
+            for (uint32_t i = 0; i < burst && sequence < numFrames; i++) {
+                makeFrame(frame, sequence++);
+                queue.push(frame);
+            }
+            std::this_thread::yield();
+        }
+        producerDone = true;
+        done.store(true, std::memory_order_release);
+    });
+
+    producer.join();
+    consumer.join();
+
+    uint32_t overflows = queue.getOverflowCount();
+    bool passed = producerDone && errors == 0 && received + overflows == numFrames;
+    printf("Consumer delay %u: %u frames, %u received, %u overflows, high water mark %u of %u, %u errors: %s\r\n",
+           consumerDelay, numFrames, received, overflows, queue.getHighWaterMark(), QUEUE_SIZE, errors,
+           passed ? "PASS" : "FAIL");
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    uint32_t numFrames = argc > 1 ? atoi(argv[1]) : 5000000;
+
+    bool passed = runStress(numFrames, 0);
+    passed &= runStress(numFrames / 10, 200);
+
+    return passed ? 0 : 1;
+}
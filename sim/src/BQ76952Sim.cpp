@@ -0,0 +1,207 @@
+#include <sim/BQ76952Sim.hpp>
+
+#include <cstring>
+
+namespace BMS::SIM {
+
+BQ76952Sim::BQ76952Sim() = default;
+
+bool BQ76952Sim::write(const uint8_t* bytes, uint16_t length) {
+    if (commFailure || length == 0) {
+        return false;
+    }
+
+    uint8_t start = bytes[0];
+    pointer = start;
+
+    // Register address only, sets the pointer for a following read
+    if (length == 1) {
+        return true;
+    }
+
+    for (uint16_t i = 1; i < length; i++) {
+        registers[(start + i - 1) & 0x7F] = bytes[i];
+    }
+    uint8_t end = start + length - 2;
+
+    // Writing the checksum and length commits the data in the buffer
+    if (start <= CHECKSUM_ADDR + 1 && end >= CHECKSUM_ADDR + 1) {
+        commitWrite();
+    }
+    // A subcommand address with no data is a command or a read request
+    else if (start == COMMAND_ADDR && end == COMMAND_ADDR + 1) {
+        executeSubcommand();
+    }
+
+    return true;
+}
+
+bool BQ76952Sim::read(uint8_t* bytes, uint16_t length) {
+    if (commFailure || pointer == failedRegister) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < length; i++) {
+        bytes[i] = registers[pointer & 0x7F];
+        pointer++;
+    }
+    return true;
+}
+
+void BQ76952Sim::setCellVoltage(uint8_t cellInput, uint16_t voltage) {
+    if (cellInput < NUM_CELL_INPUTS) {
+        setRegister16(CELL_VOLTAGE_BASE_ADDR + cellInput * 2, voltage);
+    }
+}
+
+void BQ76952Sim::setStackVoltage(uint16_t voltage) {
+    setRegister16(0x34, voltage);
+}
+
+void BQ76952Sim::setCurrent(int16_t current) {
+    setRegister16(0x3A, static_cast<uint16_t>(current));
+}
+
+void BQ76952Sim::setTemperatures(uint16_t internal, uint16_t ts1, uint16_t ts3) {
+    setRegister16(0x68, internal);
+    setRegister16(0x70, ts1);
+    setRegister16(0x74, ts3);
+}
+
+void BQ76952Sim::setDirectRegister(uint8_t reg, uint16_t value) {
+    setRegister16(reg, value);
+}
+
+void BQ76952Sim::setCommunicationFailure(bool failed) {
+    commFailure = failed;
+}
+
+void BQ76952Sim::setReadFailure(uint8_t reg) {
+    failedRegister = reg;
+}
+
+bool BQ76952Sim::inConfigUpdateMode() {
+    return configUpdate;
+}
+
+uint32_t BQ76952Sim::getDataMemory(uint16_t address, uint8_t numBytes) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < numBytes && i < 4; i++) {
+        uint16_t offset = address - DATA_MEMORY_START + i;
+        if (address < DATA_MEMORY_START || offset >= DATA_MEMORY_SIZE) {
+            return 0;
+        }
+        value |= static_cast<uint32_t>(dataMemory[offset]) << (8 * i);
+    }
+    return value;
+}
+
+uint16_t BQ76952Sim::getBalancingMask() {
+    return balancingMask;
+}
+
+BQ76952Sim::Stats BQ76952Sim::getStats() {
+    return stats;
+}
+
+void BQ76952Sim::resetStats() {
+    stats = {0, 0, 0};
+}
+
+void BQ76952Sim::executeSubcommand() {
+    uint16_t command = registers[COMMAND_ADDR] | (registers[COMMAND_ADDR + 1] << 8);
+    stats.numSubcommands++;
+
+    uint8_t response[TRANSFER_BUFFER_SIZE] = {};
+
+    switch (command) {
+    case DEVICE_NUMBER:
+        response[0] = DEVICE_ID & 0xFF;
+        response[1] = DEVICE_ID >> 8;
+        loadResponse(response, 2);
+        return;
+    case CB_ACTIVE_CELLS:
+        response[0] = balancingMask & 0xFF;
+        response[1] = balancingMask >> 8;
+        loadResponse(response, 2);
+        return;
+    case SET_CFGUPDATE:
+        configUpdate = true;
+        registers[BATTERY_STATUS_ADDR] |= 0x01;
+        return;
+    case EXIT_CFGUPDATE:
+        configUpdate = false;
+        registers[BATTERY_STATUS_ADDR] &= ~0x01;
+        return;
+    default:
+        break;
+    }
+
+    // Data memory read, the buffer holds 32 bytes starting at the address
+    if (command >= DATA_MEMORY_START && command < DATA_MEMORY_START + DATA_MEMORY_SIZE) {
+        uint16_t offset = command - DATA_MEMORY_START;
+        uint8_t length = TRANSFER_BUFFER_SIZE;
+        if (offset + length > DATA_MEMORY_SIZE) {
+            length = DATA_MEMORY_SIZE - offset;
+        }
+        loadResponse(&dataMemory[offset], length);
+    }
+}
+
+void BQ76952Sim::commitWrite() {
+    uint16_t address = registers[COMMAND_ADDR] | (registers[COMMAND_ADDR + 1] << 8);
+    uint8_t checksum = registers[CHECKSUM_ADDR];
+    uint8_t length = registers[CHECKSUM_ADDR + 1];
+
+    // Length covers the two address bytes, the data, checksum and length
+    if (length < 4 || length - 4 > TRANSFER_BUFFER_SIZE) {
+        stats.numRejectedWrites++;
+        return;
+    }
+    uint8_t numBytes = length - 4;
+
+    uint8_t expected = registers[COMMAND_ADDR] + registers[COMMAND_ADDR + 1];
+    for (uint8_t i = 0; i < numBytes; i++) {
+        expected += registers[TRANSFER_BUFFER_ADDR + i];
+    }
+    expected = ~expected;
+
+    if (checksum != expected) {
+        stats.numRejectedWrites++;
+        return;
+    }
+
+    if (address == CB_ACTIVE_CELLS) {
+        balancingMask = registers[TRANSFER_BUFFER_ADDR] | (registers[TRANSFER_BUFFER_ADDR + 1] << 8);
+        stats.numRAMWrites++;
+        return;
+    }
+
+    uint16_t offset = address - DATA_MEMORY_START;
+    if (address < DATA_MEMORY_START || offset + numBytes > DATA_MEMORY_SIZE || !configUpdate) {
+        stats.numRejectedWrites++;
+        return;
+    }
+
+    memcpy(&dataMemory[offset], &registers[TRANSFER_BUFFER_ADDR], numBytes);
+    stats.numRAMWrites++;
+}
+
+void BQ76952Sim::loadResponse(const uint8_t* response, uint8_t length) {
+    memset(&registers[TRANSFER_BUFFER_ADDR], 0, TRANSFER_BUFFER_SIZE);
+    memcpy(&registers[TRANSFER_BUFFER_ADDR], response, length);
+
+    uint8_t checksum = registers[COMMAND_ADDR] + registers[COMMAND_ADDR + 1];
+    for (uint8_t i = 0; i < length; i++) {
+        checksum += response[i];
+    }
+    registers[CHECKSUM_ADDR] = ~checksum;
+    registers[CHECKSUM_ADDR + 1] = length + 4;
+}
+
+void BQ76952Sim::setRegister16(uint8_t reg, uint16_t value) {
+    registers[reg & 0x7F] = value & 0xFF;
+    registers[(reg + 1) & 0x7F] = value >> 8;
+}
+
+}// namespace BMS::SIM
@@ -0,0 +1,84 @@
+#include <sim/M24C32Sim.hpp>
+
+#include <cstring>
+
+#include <sim/SimClock.hpp>
+
+namespace BMS::SIM {
+
+M24C32Sim::M24C32Sim() {
+    memset(memory, 0xFF, MEMORY_SIZE);
+}
+
+bool M24C32Sim::write(const uint8_t* bytes, uint16_t length) {
+    if (length < 2) {
+        return false;
+    }
+    waitForWriteCycle();
+
+    pointer = ((bytes[0] << 8) | bytes[1]) % MEMORY_SIZE;
+
+    // Address only, sets the pointer for a following read
+    if (length == 2) {
+        return true;
+    }
+
+    // Data wraps around within the page
+    uint16_t pageStart = pointer - (pointer % PAGE_SIZE);
+    for (uint16_t i = 2; i < length; i++) {
+        if (powerCut && i - 2 >= bytesBeforeCut) {
+            garbageState ^= garbageState << 13;
+            garbageState ^= garbageState >> 17;
+            garbageState ^= garbageState << 5;
+            memory[pointer] = static_cast<uint8_t>(garbageState);
+        } else {
+            memory[pointer] = bytes[i];
+        }
+        pointer = pageStart + ((pointer + 1) % PAGE_SIZE);
+    }
+    powerCut = false;
+
+    busyUntil = clock::micros() + WRITE_CYCLE_TIME;
+    numWriteCycles++;
+    return true;
+}
+
+bool M24C32Sim::read(uint8_t* bytes, uint16_t length) {
+    waitForWriteCycle();
+
+    // Reads roll over the whole memory
+    for (uint16_t i = 0; i < length; i++) {
+        bytes[i] = memory[pointer];
+        pointer = (pointer + 1) % MEMORY_SIZE;
+    }
+    return true;
+}
+
+void M24C32Sim::load(uint16_t address, const uint8_t* bytes, uint16_t length) {
+    for (uint16_t i = 0; i < length && address + i < MEMORY_SIZE; i++) {
+        memory[address + i] = bytes[i];
+    }
+}
+
+uint8_t* M24C32Sim::getMemory() {
+    return memory;
+}
+
+uint32_t M24C32Sim::getNumWriteCycles() {
+    return numWriteCycles;
+}
+
+void M24C32Sim::cutPowerOnNextWrite(uint8_t numBytes) {
+    powerCut = true;
+    bytesBeforeCut = numBytes;
+}
+
+void M24C32Sim::waitForWriteCycle() {
+    // Stands in for the acknowledge polling a controller does while the
+    // write cycle is running
+    if (clock::micros() < busyUntil) {
+        clock::set(busyUntil);
+    }
+}
+
+}// namespace BMS::SIM
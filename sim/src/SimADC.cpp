@@ -0,0 +1,36 @@
+#include <sim/SimADC.hpp>
+
+namespace BMS::SIM {
+
+SimADC::SimADC() : EVT::core::IO::ADC(EVT::core::IO::Pin::PA_0) {}
+
+float SimADC::read() {
+    return static_cast<float>(readRaw()) * VREF / MAX_RAW;
+}
+
+uint32_t SimADC::readRaw() {
+    numSamples++;
+    if (source != nullptr) {
+        return source(sourcePriv);
+    }
+    return raw;
+}
+
+float SimADC::readPercentage() {
+    return static_cast<float>(readRaw()) / MAX_RAW;
+}
+
+void SimADC::setRaw(uint32_t raw) {
+    this->raw = raw;
+}
+
+void SimADC::setSource(SampleSource source, void* priv) {
+    this->source = source;
+    sourcePriv = priv;
+}
+
+uint32_t SimADC::getNumSamples() {
+    return numSamples;
+}
+
+}// namespace BMS::SIM
@@ -0,0 +1,63 @@
+#include <sim/SimAsyncI2C.hpp>
+
+#include <sim/SimClock.hpp>
+
+namespace IO = EVT::core::IO;
+
+namespace BMS::SIM {
+
+SimAsyncI2C::SimAsyncI2C(SimI2C& i2c, uint32_t latency) : i2c(i2c), latency(latency) {}
+
+void SimAsyncI2C::startTransfer(uint8_t addr, const I2CTransactionQueue::Transfer& transfer) {
+    stats.numTransfers++;
+    if (busy) {
+        stats.numOverlapped++;
+    }
+
+    // The device sees the transfer right away, the controller only learns
+    // the result once the wire time and the latency have passed
+    uint64_t busTime = i2c.getStats().busTime;
+    i2c.setClockAdvance(false);
+
+    IO::I2C::I2CStatus i2cStatus;
+    if (transfer.type == I2CTransactionQueue::Transfer::Type::READ) {
+        i2cStatus = i2c.readMemReg(addr, transfer.reg, transfer.bytes, transfer.length, 1);
+    } else {
+        uint8_t reg = transfer.reg;
+        i2cStatus = i2c.writeReg(addr, &reg, 1, transfer.bytes, transfer.length);
+    }
+
+    i2c.setClockAdvance(true);
+
+    result = i2cStatus == IO::I2C::I2CStatus::OK ? I2CTransactionQueue::Status::OK
+                                                 : I2CTransactionQueue::Status::ERROR;
+    completionTime = clock::micros() + (i2c.getStats().busTime - busTime) + latency;
+    busy = true;
+    clock::schedule(completionTime, completionEvent, this);
+}
+
+void SimAsyncI2C::waitTransfer() {
+    if (!busy) {
+        return;
+    }
+
+    stats.numWaits++;
+    uint64_t now = clock::micros();
+    clock::advance(completionTime > now ? completionTime - now : 0);
+}
+
+bool SimAsyncI2C::isBusy() {
+    return busy;
+}
+
+SimAsyncI2C::Stats SimAsyncI2C::getStats() {
+    return stats;
+}
+
+void SimAsyncI2C::completionEvent(void* priv) {
+    SimAsyncI2C* bus = static_cast<SimAsyncI2C*>(priv);
+    bus->busy = false;
+    bus->complete(bus->result);
+}
+
+}// namespace BMS::SIM
@@ -0,0 +1,90 @@
+#include <sim/SimClock.hpp>
+
+#include <EVT/utils/time.hpp>
+
+namespace BMS::SIM::clock {
+
+/** Simulated time in microseconds */
+static uint64_t currentTime = 0;
+
+/**
+ * Scheduled event
+ *
+ * @var time Simulated time to fire at
+ * @var event Function to call
+ * @var priv Private data for the function
+ */
+struct ScheduledEvent {
+    uint64_t time;
+    Event event;
+    void* priv;
+};
+
+/** Scheduled events, in no particular order */
+static ScheduledEvent events[MAX_EVENTS];
+
+/** Number of scheduled events */
+static uint8_t numEvents = 0;
+
+uint64_t micros() {
+    return currentTime;
+}
+
+void advance(uint64_t us) {
+    uint64_t endTime = currentTime + us;
+
+    // Fire the events in time order, an event can schedule another one
+    while (numEvents > 0) {
+        uint8_t next = 0;
+        for (uint8_t i = 1; i < numEvents; i++) {
+            if (events[i].time < events[next].time) {
+                next = i;
+            }
+        }
+        if (events[next].time > endTime) {
+            break;
+        }
+
+        ScheduledEvent fired = events[next];
+        events[next] = events[--numEvents];
+        if (fired.time > currentTime) {
+            currentTime = fired.time;
+        }
+        fired.event(fired.priv);
+    }
+
+    // An event may have advanced the time itself
+    if (currentTime < endTime) {
+        currentTime = endTime;
+    }
+}
+
+bool schedule(uint64_t time, Event event, void* priv) {
+    if (numEvents >= MAX_EVENTS) {
+        return false;
+    }
+
+    events[numEvents++] = {time, event, priv};
+    return true;
+}
+
+void set(uint64_t us) {
+    currentTime = us;
+}
+
+}// namespace BMS::SIM::clock
+
+///////////////////////////////////////////////////////////////////////////////
+// EVT-core time backend, driven by the simulated clock
+///////////////////////////////////////////////////////////////////////////////
+namespace EVT::core::time {
+
+void wait(uint32_t ms) {
+    BMS::SIM::clock::advance(static_cast<uint64_t>(ms) * 1000);
+}
+
+uint32_t millis() {
+    return static_cast<uint32_t>(BMS::SIM::clock::micros() / 1000);
+}
+
+}// namespace EVT::core::time
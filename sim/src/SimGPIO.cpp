@@ -0,0 +1,30 @@
+#include <sim/SimGPIO.hpp>
+
+namespace BMS::SIM {
+
+SimGPIO::SimGPIO(Direction direction, State state)
+    : EVT::core::IO::GPIO(EVT::core::IO::Pin::PA_0, direction), state(state) {}
+
+void SimGPIO::setDirection(Direction direction) {
+    (void) direction;
+}
+
+void SimGPIO::writePin(State state) {
+    this->state = state;
+}
+
+SimGPIO::State SimGPIO::readPin() {
+    return state;
+}
+
+void SimGPIO::registerIRQ(TriggerEdge edge, void (*irqHandler)(GPIO* pin, void* priv), void* priv) {
+    (void) edge;
+    (void) irqHandler;
+    (void) priv;
+}
+
+void SimGPIO::setState(State state) {
+    this->state = state;
+}
+
+}// namespace BMS::SIM
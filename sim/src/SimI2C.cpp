@@ -0,0 +1,140 @@
+#include <sim/SimI2C.hpp>
+
+#include <sim/SimClock.hpp>
+
+namespace BMS::SIM {
+
+SimI2C::SimI2C(uint32_t frequency)
+    : EVT::core::IO::I2C(EVT::core::IO::Pin::PB_6, EVT::core::IO::Pin::PB_7), frequency(frequency) {}
+
+void SimI2C::attach(uint8_t addr, SimI2CDevice& device) {
+    if (numDevices >= MAX_DEVICES) {
+        return;
+    }
+    devices[numDevices++] = {addr, &device};
+}
+
+SimI2C::Stats SimI2C::getStats() {
+    return stats;
+}
+
+void SimI2C::resetStats() {
+    stats = {0, 0, 0};
+}
+
+void SimI2C::setClockAdvance(bool enable) {
+    clockAdvance = enable;
+}
+
+SimI2CDevice* SimI2C::find(uint8_t addr) {
+    for (uint8_t i = 0; i < numDevices; i++) {
+        if (devices[i].addr == addr) {
+            return devices[i].device;
+        }
+    }
+    return nullptr;
+}
+
+void SimI2C::account(uint16_t numBytes) {
+    // START + address byte + data bytes, 9 clocks per byte (ACK included),
+    // plus roughly one clock for the STOP condition
+    uint64_t clocks = 1 + 9 * (1 + static_cast<uint64_t>(numBytes)) + 1;
+    uint64_t time = clocks * 1000000 / frequency;
+
+    stats.numTransactions++;
+    stats.numBytes += numBytes;
+    stats.busTime += time;
+    if (clockAdvance) {
+        clock::advance(time);
+    }
+}
+
+SimI2C::I2CStatus SimI2C::write(uint8_t addr, uint8_t byte) {
+    return write(addr, &byte, 1);
+}
+
+SimI2C::I2CStatus SimI2C::read(uint8_t addr, uint8_t* output) {
+    return read(addr, output, 1);
+}
+
+SimI2C::I2CStatus SimI2C::write(uint8_t addr, uint8_t* bytes, uint8_t length) {
+    account(length);
+    SimI2CDevice* device = find(addr);
+    if (device == nullptr || !device->write(bytes, length)) {
+        return I2CStatus::ERROR;
+    }
+    return I2CStatus::OK;
+}
+
+SimI2C::I2CStatus SimI2C::read(uint8_t addr, uint8_t* bytes, uint8_t length) {
+    account(length);
+    SimI2CDevice* device = find(addr);
+    if (device == nullptr || !device->read(bytes, length)) {
+        return I2CStatus::ERROR;
+    }
+    return I2CStatus::OK;
+}
+
+SimI2C::I2CStatus SimI2C::writeMemReg(uint8_t addr, uint32_t memAddress, uint8_t byte,
+                                      uint16_t memAddSize, uint8_t maxWriteTime) {
+    (void) maxWriteTime;
+    return writeWithAddress(addr, memAddress, memAddSize, &byte, 1);
+}
+
+SimI2C::I2CStatus SimI2C::readMemReg(uint8_t addr, uint32_t memAddress, uint8_t* byte,
+                                     uint16_t memAddSize) {
+    return readMemReg(addr, memAddress, byte, 1, memAddSize);
+}
+
+SimI2C::I2CStatus SimI2C::writeMemReg(uint8_t addr, uint32_t memAddress, uint8_t* bytes,
+                                      uint8_t size, uint16_t memAddSize, uint8_t maxWriteTime) {
+    (void) maxWriteTime;
+    return writeWithAddress(addr, memAddress, memAddSize, bytes, size);
+}
+
+SimI2C::I2CStatus SimI2C::readMemReg(uint8_t addr, uint32_t memAddress, uint8_t* bytes,
+                                     uint8_t size, uint16_t memAddSize) {
+    // Write the memory address, then a repeated START for the read. Counted
+    // as two addressed transfers like on the real bus.
+    uint8_t address[4];
+    for (uint16_t i = 0; i < memAddSize; i++) {
+        address[i] = (memAddress >> (8 * (memAddSize - 1 - i))) & 0xFF;
+    }
+
+    account(memAddSize);
+    SimI2CDevice* device = find(addr);
+    if (device == nullptr || !device->write(address, memAddSize)) {
+        return I2CStatus::ERROR;
+    }
+
+    account(size);
+    if (!device->read(bytes, size)) {
+        return I2CStatus::ERROR;
+    }
+    return I2CStatus::OK;
+}
+
+SimI2C::I2CStatus SimI2C::writeWithAddress(uint8_t addr, uint32_t memAddress, uint16_t memAddSize,
+                                           const uint8_t* bytes, uint16_t length) {
+    if (memAddSize + length > MAX_TRANSFER_SIZE) {
+        return I2CStatus::ERROR;
+    }
+
+    // Memory address is sent MSB first
+    uint8_t transfer[MAX_TRANSFER_SIZE];
+    for (uint16_t i = 0; i < memAddSize; i++) {
+        transfer[i] = (memAddress >> (8 * (memAddSize - 1 - i))) & 0xFF;
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        transfer[memAddSize + i] = bytes[i];
+    }
+
+    account(memAddSize + length);
+    SimI2CDevice* device = find(addr);
+    if (device == nullptr || !device->write(transfer, memAddSize + length)) {
+        return I2CStatus::ERROR;
+    }
+    return I2CStatus::OK;
+}
+
+}// namespace BMS::SIM
@@ -0,0 +1,28 @@
+#include <sim/SimIWDG.hpp>
+
+#include <EVT/utils/time.hpp>
+
+namespace time = EVT::core::time;
+
+namespace BMS::SIM {
+
+SimIWDG::SimIWDG(uint32_t timeout) : timeout(timeout) {}
+
+void SimIWDG::init() {
+    started = true;
+    lastRefresh = time::millis();
+}
+
+void SimIWDG::refresh() {
+    uint32_t now = time::millis();
+    if (started && (now - lastRefresh) > timeout) {
+        numTimeouts++;
+    }
+    lastRefresh = now;
+}
+
+uint32_t SimIWDG::getNumTimeouts() {
+    return numTimeouts;
+}
+
+}// namespace BMS::SIM
@@ -0,0 +1,324 @@
+/**
+ * Host check of the telemetry recorder
+ *
+ * Records generated samples, downloads the log the way the CANopen stack
+ * does and decodes it, then compares the decoded samples against the last
+ * samples recorded:
+ *
+ * - Round trip of a slow random walk, the normal case, after every sample
+ * - Round trip of fully random values, the largest records
+ * - Downloads in every segment size give the same bytes
+ * - Nothing is recorded while frozen, and recording continues once the
+ *   frozen flag is cleared
+ * - Starting a download freezes the log
+ *
+ * Usage: telemetry_recorder_check
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <TelemetryRecorder.hpp>
+
+using BMS::TelemetryRecorder;
+
+/** Size of the largest possible log */
+constexpr uint32_t MAX_LOG_SIZE = TelemetryRecorder::LOG_HEADER_SIZE
+                                  + TelemetryRecorder::NUM_BLOCKS * (2 + TelemetryRecorder::BLOCK_SIZE);
+
+/** Largest number of samples a log can hold, every record one byte or more */
+constexpr uint32_t MAX_SAMPLES = TelemetryRecorder::NUM_BLOCKS * TelemetryRecorder::BLOCK_SIZE;
+
+/** Number of failed checks, only the first few are printed */
+static uint32_t numFailures = 0;
+
+/**
+ * Record a failure
+ *
+ * @param[in] context Description of the failed check
+ */
+static void fail(const char* context) {
+    if (numFailures++ < 10) {
+        printf("FAIL %s\r\n", context);
+    }
+}
+
+/**
+ * Read a varint from a block
+ *
+ * @param[in] bytes The block
+ * @param[in,out] offset Offset of the varint, moved past it
+ * @return The value
+ */
+static uint32_t getVarint(const uint8_t* bytes, uint32_t& offset) {
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+    do {
+        byte = bytes[offset++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+/**
+ * Turn the values of a sample, in field order, back into the sample
+ *
+ * @param[in] time Time of the sample
+ * @param[in] fields The values
+ * @param[out] sample The sample
+ */
+static void fromFields(uint32_t time, const int32_t* fields, TelemetryRecorder::Sample& sample) {
+    uint8_t field = 0;
+    sample.time = time;
+    for (uint8_t i = 0; i < TelemetryRecorder::NUM_CELLS; i++) {
+        sample.cellVoltage[i] = fields[field++];
+    }
+    sample.current = fields[field++];
+    for (uint8_t i = 0; i < TelemetryRecorder::NUM_TEMPS; i++) {
+        sample.temperature[i] = fields[field++];
+    }
+    for (uint8_t i = 0; i < TelemetryRecorder::NUM_STATUS; i++) {
+        sample.bqStatus[i] = fields[field++];
+    }
+    sample.errorRegister = fields[field];
+}
+
+/**
+ * Decode a downloaded log, the same way a host tool would
+ *
+ * @param[in] log The log
+ * @param[in] size Size of the log
+ * @param[out] samples The decoded samples, oldest first
+ * @return The number of samples, -1 if the log is malformed
+ */
+static int32_t decodeLog(const uint8_t* log, uint32_t size, TelemetryRecorder::Sample* samples) {
+    if (size < TelemetryRecorder::LOG_HEADER_SIZE || log[0] != TelemetryRecorder::FORMAT_VERSION) {
+        return -1;
+    }
+
+    uint8_t numBlocks = log[1];
+    uint16_t numSamples = log[2] | log[3] << 8;
+    uint32_t offset = TelemetryRecorder::LOG_HEADER_SIZE;
+    int32_t count = 0;
+
+    for (uint8_t block = 0; block < numBlocks; block++) {
+        uint16_t length = log[offset] | log[offset + 1] << 8;
+        const uint8_t* bytes = &log[offset + 2];
+        offset += 2 + length;
+        if (offset > size || length < TelemetryRecorder::KEYFRAME_SIZE) {
+            return -1;
+        }
+
+        // Keyframe
+        int32_t fields[TelemetryRecorder::NUM_FIELDS];
+        uint32_t position = 0;
+        uint32_t time = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+        position += 4;
+        for (uint8_t i = 0; i < TelemetryRecorder::NUM_CELLS; i++) {
+            fields[i] = bytes[position] | bytes[position + 1] << 8;
+            position += 2;
+        }
+        fields[TelemetryRecorder::NUM_CELLS] = static_cast<int16_t>(bytes[position] | bytes[position + 1] << 8);
+        position += 2;
+        for (uint8_t i = TelemetryRecorder::NUM_CELLS + 1; i < TelemetryRecorder::NUM_FIELDS; i++) {
+            fields[i] = bytes[position++];
+        }
+        fromFields(time, fields, samples[count++]);
+
+        // Deltas
+        while (position < length) {
+            time += getVarint(bytes, position);
+            uint32_t changed = getVarint(bytes, position);
+            for (uint8_t i = 0; i < TelemetryRecorder::NUM_FIELDS; i++) {
+                if (changed & (1UL << i)) {
+                    uint32_t zigzag = getVarint(bytes, position);
+                    fields[i] += static_cast<int32_t>(zigzag >> 1) ^ -static_cast<int32_t>(zigzag & 1);
+                }
+            }
+            fromFields(time, fields, samples[count++]);
+        }
+        if (position != length) {
+            return -1;
+        }
+    }
+
+    return offset == size && count == numSamples ? count : -1;
+}
+
+/**
+ * Download the log through the CANopen interface
+ *
+ * @param[in] recorder The recorder
+ * @param[out] log The buffer to fill, MAX_LOG_SIZE in size
+ * @param[in] segmentSize Number of bytes per read
+ * @return The size of the log
+ */
+static uint32_t upload(TelemetryRecorder& recorder, uint8_t* log, uint32_t segmentSize) {
+    CO_OBJ_T entry = {0, &recorder.canOpenInterface, (CO_DATA) &recorder};
+
+    uint32_t size = recorder.canOpenInterface.Size(&entry, nullptr, 0);
+    recorder.canOpenInterface.Ctrl(&entry, nullptr, CO_CTRL_SET_OFF, 0);
+    for (uint32_t offset = 0; offset < size; offset += segmentSize) {
+        uint32_t length = size - offset < segmentSize ? size - offset : segmentSize;
+        recorder.canOpenInterface.Read(&entry, nullptr, &log[offset], length);
+    }
+    return size;
+}
+
+/**
+ * Check the log holds the newest of the recorded samples
+ *
+ * @param[in] recorder The recorder
+ * @param[in] recorded Every sample recorded, oldest first
+ * @param[in] numRecorded Number of samples recorded
+ * @param[in] context Description of the case, printed on failure
+ * @return Number of samples in the log
+ */
+static int32_t checkLog(const TelemetryRecorder& recorder, const TelemetryRecorder::Sample* recorded,
+                        uint32_t numRecorded, const char* context) {
+    static uint8_t log[MAX_LOG_SIZE];
+    static TelemetryRecorder::Sample decoded[MAX_SAMPLES];
+
+    uint32_t size = recorder.getLogSize();
+    if (size > MAX_LOG_SIZE || recorder.readLog(0, log, size) != size) {
+        fail(context);
+        return -1;
+    }
+
+    int32_t numDecoded = decodeLog(log, size, decoded);
+    if (numDecoded <= 0 || static_cast<uint32_t>(numDecoded) > numRecorded
+        || numDecoded != recorder.getNumSamples()) {
+        fail(context);
+        return -1;
+    }
+
+    const TelemetryRecorder::Sample* expected = &recorded[numRecorded - numDecoded];
+    for (int32_t i = 0; i < numDecoded; i++) {
+        if (memcmp(&decoded[i], &expected[i], sizeof(TelemetryRecorder::Sample)) != 0) {
+            fail(context);
+            return -1;
+        }
+    }
+    return numDecoded;
+}
+
+/**
+ * Make the next sample of a slow random walk, like a discharging pack
+ *
+ * @param[in] previous The previous sample
+ * @param[out] next The next sample
+ */
+static void walk(const TelemetryRecorder::Sample& previous, TelemetryRecorder::Sample& next) {
+    next = previous;
+    next.time += 20;
+    for (uint8_t i = 0; i < TelemetryRecorder::NUM_CELLS; i++) {
+        next.cellVoltage[i] += rand() % 7 - 3;
+    }
+    next.current += rand() % 201 - 100;
+    if (rand() % 50 == 0) {
+        next.temperature[rand() % TelemetryRecorder::NUM_TEMPS] += rand() % 3 - 1;
+    }
+    if (rand() % 200 == 0) {
+        next.bqStatus[rand() % TelemetryRecorder::NUM_STATUS] ^= 1 << (rand() % 8);
+    }
+}
+
+/**
+ * Make a sample with every value random
+ *
+ * @param[in] time Time of the sample
+ * @param[out] sample The sample
+ */
+static void randomSample(uint32_t time, TelemetryRecorder::Sample& sample) {
+    sample.time = time;
+    for (uint8_t i = 0; i < TelemetryRecorder::NUM_CELLS; i++) {
+        sample.cellVoltage[i] = rand();
+    }
+    sample.current = rand();
+    for (uint8_t i = 0; i < TelemetryRecorder::NUM_TEMPS; i++) {
+        sample.temperature[i] = rand();
+    }
+    for (uint8_t i = 0; i < TelemetryRecorder::NUM_STATUS; i++) {
+        sample.bqStatus[i] = rand();
+    }
+    sample.errorRegister = rand();
+}
+
+int main() {
+    constexpr uint32_t NUM_SAMPLES = 2000;
+    static TelemetryRecorder::Sample recorded[NUM_SAMPLES];
+    srand(1);
+
+    // Random walk, checked after every sample
+    {
+        static TelemetryRecorder recorder;
+        memset(&recorded[0], 0, sizeof(recorded[0]));
+        recorded[0].time = 123456;
+        for (uint8_t i = 0; i < TelemetryRecorder::NUM_CELLS; i++) {
+            recorded[0].cellVoltage[i] = 3700;
+        }
+        recorded[0].current = -8000;
+        memset(recorded[0].temperature, 25, sizeof(recorded[0].temperature));
+
+        int32_t numLogged = 0;
+        for (uint32_t i = 0; i < NUM_SAMPLES; i++) {
+            if (i > 0) {
+                walk(recorded[i - 1], recorded[i]);
+            }
+            recorder.record(recorded[i]);
+            numLogged = checkLog(recorder, recorded, i + 1, "random walk");
+        }
+        printf("Random walk: %d samples (%d ms) in %u bytes\r\n",
+               numLogged, numLogged * 20, recorder.getLogSize());
+
+        // Every segment size gives the same download
+        static uint8_t whole[MAX_LOG_SIZE];
+        static uint8_t segmented[MAX_LOG_SIZE];
+        uint32_t size = upload(recorder, whole, MAX_LOG_SIZE);
+        for (uint32_t segmentSize = 1; segmentSize <= 8; segmentSize++) {
+            memset(segmented, 0, sizeof(segmented));
+            if (upload(recorder, segmented, segmentSize) != size || memcmp(whole, segmented, size) != 0) {
+                fail("segmented download");
+            }
+        }
+
+        // The download froze the log
+        if (!recorder.isFrozen()) {
+            fail("download freezes");
+        }
+        TelemetryRecorder::Sample ignored;
+        walk(recorded[NUM_SAMPLES - 1], ignored);
+        recorder.record(ignored);
+        checkLog(recorder, recorded, NUM_SAMPLES, "frozen");
+
+        // Clearing the flag continues the log
+        *recorder.getFrozenFlag() = 0;
+        static TelemetryRecorder::Sample resumed[NUM_SAMPLES + 100];
+        memcpy(resumed, recorded, sizeof(recorded));
+        for (uint32_t i = NUM_SAMPLES; i < NUM_SAMPLES + 100; i++) {
+            walk(resumed[i - 1], resumed[i]);
+            resumed[i].time += 5000;
+            recorder.record(resumed[i]);
+        }
+        checkLog(recorder, resumed, NUM_SAMPLES + 100, "resumed");
+    }
+
+    // Fully random values, every record as large as it gets
+    {
+        static TelemetryRecorder recorder;
+        int32_t numLogged = 0;
+        for (uint32_t i = 0; i < NUM_SAMPLES; i++) {
+            randomSample(i * 20, recorded[i]);
+            recorder.record(recorded[i]);
+            numLogged = checkLog(recorder, recorded, i + 1, "random values");
+        }
+        printf("Random values: %d samples (%d ms) in %u bytes\r\n",
+               numLogged, numLogged * 20, recorder.getLogSize());
+    }
+
+    printf("%s\r\n", numFailures ? "FAIL" : "PASS");
+    return numFailures ? 1 : 0;
+}
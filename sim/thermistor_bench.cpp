@@ -0,0 +1,141 @@
+/**
+ * Host benchmark and accuracy comparison of the thermistor conversion
+ *
+ * Converts every ADC count with the lookup table used by ThermistorMux and
+ * with the integer evaluation of the calibrated quadratic fit it replaced,
+ * and compares both against the fit evaluated in floating point, which the
+ * table is generated from:
+ *
+ * - Table vs fit shows the interpolation and rounding error of the table
+ * - Integer quadratic vs fit shows the error of the old conversion, which
+ *   truncated to whole degrees, at and above 0 C. Below 0 C its unsigned
+ *   math wrapped, those counts are only counted
+ *
+ * The errors are reported over the full ADC range and over the ADC counts
+ * the fit puts between -20 C and 60 C, where the pack operates. The
+ * timing is of the host, the quadratic's 64-bit division is far slower on
+ * the Cortex-M4 where it is a library call.
+ *
+ * Usage: thermistor_bench [iterations]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <dev/ThermistorTable.hpp>
+
+using BMS::DEV::ThermistorTable;
+
+/** Table used by ThermistorMux */
+static constexpr ThermistorTable TEMP_TABLE{ThermistorTable::DEV1_PARAMS};
+
+/** Operating range of the pack, in 0.1 C */
+constexpr double OPERATING_MIN = -200;
+constexpr double OPERATING_MAX = 600;
+
+/**
+ * The quadratic fit ThermistorMux used before, returns whole degrees Celsius
+ *
+ * T(x) = 0.00000375688x^2 + 0.0121347x - 15.9911
+ *
+ * @param[in] adcCounts ADC reading to convert
+ * @return Temperature in whole degrees Celsius, truncated to 16 bits
+ */
+static uint32_t quadraticConvert(uint32_t adcCounts) {
+    uint16_t temp;
+
+    temp = (((uint64_t) adcCounts * adcCounts) * 375688 + ((uint64_t) adcCounts) * 1213470000 - 1599110000000) / 100000000000;
+
+    return temp;
+}
+
+/**
+ * Largest and mean absolute error of a conversion against the model
+ */
+struct ErrorStats {
+    double max = 0;
+    double sum = 0;
+    uint32_t count = 0;
+    uint32_t maxAdcCounts = 0;
+
+    void add(uint32_t adcCounts, double error) {
+        error = std::fabs(error);
+        if (error > max) {
+            max = error;
+            maxAdcCounts = adcCounts;
+        }
+        sum += error;
+        count++;
+    }
+
+    void print(const char* name) {
+        printf("  %-28s max %6.2f C (at %4u counts), mean %5.2f C\r\n", name, max / 10, maxAdcCounts,
+               count ? sum / count / 10 : 0);
+    }
+};
+
+/**
+ * Time a conversion over the full ADC range
+ *
+ * @param[in] convert The conversion
+ * @param[in] iterations Number of passes over the ADC range
+ * @return Nanoseconds per conversion
+ */
+template<class Convert>
+static double timeConversion(Convert convert, uint32_t iterations) {
+    volatile int32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (uint32_t adcCounts = 0; adcCounts < ThermistorTable::ADC_COUNTS; adcCounts++) {
+            sink = sink + convert(adcCounts);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double total = std::chrono::duration<double, std::nano>(end - start).count();
+    return total / (static_cast<double>(iterations) * ThermistorTable::ADC_COUNTS);
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = argc > 1 ? atoi(argv[1]) : 2000;
+
+    ErrorStats tableFull, tableOperating, quadraticFull, quadraticOperating;
+    uint32_t numWrapped = 0;
+
+    for (uint32_t adcCounts = 0; adcCounts < ThermistorTable::ADC_COUNTS; adcCounts++) {
+        double fit = ThermistorTable::modelTemp(ThermistorTable::DEV1_PARAMS, adcCounts);
+        double table = TEMP_TABLE.convert(adcCounts);
+        // Sign extend the truncated result the way it would have been read
+        double quadratic = static_cast<int16_t>(quadraticConvert(adcCounts)) * 10.0;
+
+        tableFull.add(adcCounts, table - fit);
+        if (fit >= OPERATING_MIN && fit <= OPERATING_MAX) {
+            tableOperating.add(adcCounts, table - fit);
+        }
+        if (fit < 0) {
+            numWrapped++;
+            continue;
+        }
+        quadraticFull.add(adcCounts, quadratic - fit);
+        if (fit <= OPERATING_MAX) {
+            quadraticOperating.add(adcCounts, quadratic - fit);
+        }
+    }
+
+    printf("Table: %u points, %zu bytes\r\n", ThermistorTable::NUM_POINTS, sizeof(TEMP_TABLE));
+    printf("Error against the quadratic fit, full ADC range:\r\n");
+    tableFull.print("Table");
+    quadraticFull.print("Quadratic, integer, >= 0 C");
+    printf("Error against the quadratic fit, -20 C to 60 C:\r\n");
+    tableOperating.print("Table");
+    quadraticOperating.print("Quadratic, integer, >= 0 C");
+    printf("Quadratic, integer: %u counts below 0 C wrapped\r\n", numWrapped);
+
+    printf("Host time per conversion:\r\n");
+    printf("  Table      %5.2f ns\r\n", timeConversion([](uint32_t x) { return TEMP_TABLE.convert(x); }, iterations));
+    printf("  Quadratic  %5.2f ns\r\n", timeConversion(quadraticConvert, iterations));
+
+    return 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * Host check of the thermistor acquisition with injected noise
+ *
+ * Scans six thermistors through the real ThermistorMux the way the BMS
+ * thermistor task does, with the simulated ADC adding Gaussian noise and
+ * full scale spikes to every sample:
+ *
+ * - Noise: every thermistor sits at a steady temperature, one close to the
+ *   over temperature limit. The filtered readings have to stay close to the
+ *   true temperatures and never cross the limit. Single, unfiltered samples
+ *   of the same signal are counted for comparison.
+ * - Step: one thermistor jumps over the limit. The filtered reading has to
+ *   cross the limit within two scans of the pack.
+ *
+ * Usage: thermistor_filter_check
+ */
+
+#include <cmath>
+#include <cstdio>
+
+#include <dev/ThermistorMux.hpp>
+#include <dev/ThermistorTable.hpp>
+
+#include <sim/SimADC.hpp>
+#include <sim/SimClock.hpp>
+#include <sim/SimGPIO.hpp>
+
+namespace SIM = BMS::SIM;
+using BMS::DEV::ThermistorMux;
+using BMS::DEV::ThermistorTable;
+
+/** Number of thermistors scanned, matches the BMS */
+constexpr uint8_t NUM_THERMISTORS = 6;
+
+/** Period of the thermistor task in milliseconds, matches the BMS */
+constexpr uint32_t TASK_PERIOD = 10;
+
+/** Over temperature limit of the BMS, in 0.1 C */
+constexpr int16_t MAX_TEMP = 500;
+
+/** Largest error allowed in the filtered readings under noise, in 0.1 C */
+constexpr int16_t MAX_NOISE_ERROR = 20;
+
+/** Standard deviation of the ADC noise in counts */
+constexpr double NOISE_SIGMA = 15.0;
+
+/** Chance of a sample being a full scale spike */
+constexpr double SPIKE_CHANCE = 0.05;
+
+/** Table the MUX converts with, for the single sample comparison */
+static constexpr ThermistorTable TEMP_TABLE{ThermistorTable::DEV1_PARAMS};
+
+/** Time each scenario is run for in milliseconds */
+constexpr uint32_t RUN_TIME = 60000;
+
+/** Time of the step in the step scenario in milliseconds */
+constexpr uint32_t STEP_TIME = 10000;
+
+/**
+ * Signal on the MUX inputs
+ *
+ * @var pins The MUX select pins, to know which thermistor is selected
+ * @var adcCounts Noise free ADC count of each thermistor
+ * @var random State of the random number generator
+ */
+struct Inputs {
+    SIM::SimGPIO* pins[3];
+    uint32_t adcCounts[ThermistorMux::NUM_CHANNELS];
+    uint64_t random;
+};
+
+/**
+ * Uniform random number
+ *
+ * @param[in,out] state State of the generator
+ * @return Number in (0, 1)
+ */
+static double uniform(uint64_t& state) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return ((state >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/**
+ * ADC count the model gives for a temperature
+ *
+ * @param[in] temp Temperature in 0.1 C
+ * @return The ADC count
+ */
+static uint32_t tempToCounts(int16_t temp) {
+    uint32_t low = 0;
+    uint32_t high = ThermistorTable::ADC_COUNTS - 1;
+    while (low < high) {
+        uint32_t middle = (low + high) / 2;
+        if (ThermistorTable::modelTemp(ThermistorTable::DEV1_PARAMS, middle) < temp) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * Noisy sample of an ADC count
+ *
+ * @param[in] inputs The signal, for the random number generator
+ * @param[in] adcCounts Noise free ADC count
+ * @return The sample
+ */
+static uint32_t noisySample(Inputs& inputs, uint32_t adcCounts) {
+    if (uniform(inputs.random) < SPIKE_CHANCE) {
+        return uniform(inputs.random) < 0.5 ? 0 : SIM::SimADC::MAX_RAW;
+    }
+
+    // Box-Muller
+    double noise = NOISE_SIGMA * std::sqrt(-2.0 * std::log(uniform(inputs.random)))
+                   * std::cos(2.0 * M_PI * uniform(inputs.random));
+    double sample = std::round(adcCounts + noise);
+    if (sample < 0) {
+        return 0;
+    }
+    if (sample > SIM::SimADC::MAX_RAW) {
+        return SIM::SimADC::MAX_RAW;
+    }
+    return static_cast<uint32_t>(sample);
+}
+
+/**
+ * ADC sample source, samples the thermistor selected on the MUX
+ *
+ * @param[in] priv The signal (Inputs)
+ * @return The sample
+ */
+static uint32_t sampleSource(void* priv) {
+    Inputs& inputs = *static_cast<Inputs*>(priv);
+
+    uint8_t selected = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        if (inputs.pins[i]->readPin() == IO::GPIO::State::HIGH) {
+            selected |= 1 << i;
+        }
+    }
+
+    return noisySample(inputs, inputs.adcCounts[selected]);
+}
+
+/**
+ * Results of a scenario
+ *
+ * @var maxError Largest error of the filtered readings of the steady
+ * thermistors, in 0.1 C
+ * @var filteredOverTemp Number of filtered readings of steady thermistors
+ * over the limit
+ * @var rawOverTemp Number of single samples of steady thermistors over the
+ * limit
+ * @var numReadings Number of filtered readings
+ * @var scanTime Average time to read all thermistors in milliseconds
+ * @var detectTime Time from the step until the stepped thermistor read over
+ * the limit in milliseconds, 0 if it never did
+ */
+struct Results {
+    int16_t maxError;
+    uint32_t filteredOverTemp;
+    uint32_t rawOverTemp;
+    uint32_t numReadings;
+    uint32_t scanTime;
+    uint32_t detectTime;
+};
+
+/**
+ * Scan the thermistors like the BMS thermistor task does
+ *
+ * @param[in] temps Temperature of each thermistor in 0.1 C
+ * @param[in] stepTherm Thermistor which steps, NUM_THERMISTORS for none
+ * @param[in] stepTemp Temperature the thermistor steps to in 0.1 C
+ * @return The results
+ */
+static Results runScenario(const int16_t* temps, uint8_t stepTherm, int16_t stepTemp) {
+    SIM::SimGPIO muxS1(IO::GPIO::Direction::OUTPUT);
+    SIM::SimGPIO muxS2(IO::GPIO::Direction::OUTPUT);
+    SIM::SimGPIO muxS3(IO::GPIO::Direction::OUTPUT);
+    IO::GPIO* muxSelectArr[3] = {&muxS1, &muxS2, &muxS3};
+
+    Inputs inputs = {
+        .pins = {&muxS1, &muxS2, &muxS3},
+        .adcCounts = {},
+        .random = 1,
+    };
+    for (uint8_t i = 0; i < NUM_THERMISTORS; i++) {
+        inputs.adcCounts[i] = tempToCounts(temps[i]);
+    }
+
+    SIM::SimADC adc;
+    adc.setSource(sampleSource, &inputs);
+    ThermistorMux thermMux(muxSelectArr, adc);
+
+    Results results = {};
+    uint8_t thermNum = 0;
+    uint32_t numScans = 0;
+    uint64_t start = SIM::clock::micros();
+
+    for (uint32_t elapsed = 0; elapsed < RUN_TIME; elapsed += TASK_PERIOD) {
+        if (elapsed == STEP_TIME && stepTherm < NUM_THERMISTORS) {
+            inputs.adcCounts[stepTherm] = tempToCounts(stepTemp);
+        }
+
+        int16_t temp;
+        if (thermMux.pollTemp(thermNum, temp)) {
+            bool stepped = thermNum == stepTherm;
+            if (stepped && elapsed >= STEP_TIME && temp > MAX_TEMP && results.detectTime == 0) {
+                results.detectTime = elapsed - STEP_TIME;
+            }
+
+            if (!stepped) {
+                int16_t error = static_cast<int16_t>(std::abs(temp - temps[thermNum]));
+                if (error > results.maxError) {
+                    results.maxError = error;
+                }
+                if (temp > MAX_TEMP) {
+                    results.filteredOverTemp++;
+                }
+
+                // What a single sample of the same signal would have read
+                if (TEMP_TABLE.convert(noisySample(inputs, inputs.adcCounts[thermNum])) > MAX_TEMP) {
+                    results.rawOverTemp++;
+                }
+            }
+
+            results.numReadings++;
+            thermNum = (thermNum + 1) % NUM_THERMISTORS;
+            if (thermNum == 0) {
+                numScans++;
+            }
+        }
+
+        SIM::clock::advance(TASK_PERIOD * 1000);
+    }
+
+    results.scanTime = static_cast<uint32_t>((SIM::clock::micros() - start) / 1000 / numScans);
+    return results;
+}
+
+int main() {
+    bool passed = true;
+
+    // Steady temperatures, one close to the limit
+    const int16_t steadyTemps[NUM_THERMISTORS] = {250, 300, 350, 200, 450, 300};
+    Results noise = runScenario(steadyTemps, NUM_THERMISTORS, 0);
+    bool noisePassed = noise.filteredOverTemp == 0 && noise.maxError <= MAX_NOISE_ERROR;
+    passed &= noisePassed;
+    printf("Noise: %u readings, max error %d.%d C, %u filtered and %u single sample readings over the limit: %s\r\n",
+           noise.numReadings, noise.maxError / 10, noise.maxError % 10, noise.filteredOverTemp,
+           noise.rawOverTemp, noisePassed ? "PASS" : "FAIL");
+
+    // Thermistor 2 goes from 35 C to 70 C
+    Results step = runScenario(steadyTemps, 2, 700);
+    bool stepPassed = step.detectTime > 0 && step.detectTime <= 2 * step.scanTime
+                      && step.filteredOverTemp == 0;
+    passed &= stepPassed;
+    printf("Step: scan time %u ms, over temperature read %u ms after the step: %s\r\n",
+           step.scanTime, step.detectTime, stepPassed ? "PASS" : "FAIL");
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/**
+ * Host check of the non-blocking thermistor MUX reads
+ *
+ * Drives ThermistorMux::pollTemp on the simulated clock, with each MUX
+ * input at its own ADC count, and checks:
+ *
+ * - IDLE: the first poll selects the thermistor and returns at once,
+ *   without sampling the ADC
+ * - SETTLING: polls return false without sampling the ADC until the MUX has
+ *   settled, the first poll after that returns the reading of the selected
+ *   thermistor
+ * - Restart: asking for another thermistor while one is settling starts the
+ *   settling time over for the new one
+ * - Blocking: no poll moves the simulated clock, while the blocking getTemp
+ *   waits out the settling time
+ *
+ * Usage: thermistor_mux_timing_check
+ */
+
+#include <cstdio>
+
+#include <dev/ThermistorMux.hpp>
+#include <dev/ThermistorTable.hpp>
+
+#include <sim/SimADC.hpp>
+#include <sim/SimClock.hpp>
+#include <sim/SimGPIO.hpp>
+
+namespace SIM = BMS::SIM;
+using BMS::DEV::ThermistorMux;
+using BMS::DEV::ThermistorTable;
+
+/** Settling time of the MUX in milliseconds, matches ThermistorMux */
+constexpr uint32_t SETTLING_TIME = 40;
+
+/** Number of thermistors scanned, matches the BMS */
+constexpr uint8_t NUM_THERMISTORS = 6;
+
+/** Table the MUX converts with */
+static constexpr ThermistorTable TEMP_TABLE{ThermistorTable::DEV1_PARAMS};
+
+/** Number of polls made and the longest time one took in microseconds */
+static uint32_t numPolls = 0;
+static uint64_t longestPoll = 0;
+
+/** Number of failed checks, only the first few are printed */
+static uint32_t numFailures = 0;
+
+/**
+ * Record a failure
+ *
+ * @param[in] context Description of the failed check
+ * @param[in] thermNum The thermistor being read
+ */
+static void fail(const char* context, uint8_t thermNum) {
+    if (numFailures++ < 10) {
+        printf("FAIL %s, thermistor %u\r\n", context, thermNum);
+    }
+}
+
+/**
+ * MUX select pins, read back by the ADC source to route the selected input
+ */
+struct Mux {
+    SIM::SimGPIO pins[3] = {
+        SIM::SimGPIO(IO::GPIO::Direction::OUTPUT),
+        SIM::SimGPIO(IO::GPIO::Direction::OUTPUT),
+        SIM::SimGPIO(IO::GPIO::Direction::OUTPUT),
+    };
+};
+
+/**
+ * ADC count of a MUX input, different for every input
+ *
+ * @param[in] thermNum The MUX input
+ * @return The ADC count
+ */
+static uint32_t inputCount(uint8_t thermNum) {
+    return 1200 + thermNum * 150;
+}
+
+/**
+ * ADC sample source, the count of the input selected on the MUX
+ *
+ * @param[in] priv The Mux
+ * @return The ADC count
+ */
+static uint32_t sampleSource(void* priv) {
+    Mux* mux = static_cast<Mux*>(priv);
+    uint8_t thermNum = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        if (mux->pins[i].readPin() == IO::GPIO::State::HIGH) {
+            thermNum |= 1 << i;
+        }
+    }
+    return inputCount(thermNum);
+}
+
+/**
+ * Poll a thermistor, checking the poll does not move the clock
+ *
+ * @param[in] thermMux The MUX
+ * @param[in] thermNum The thermistor to read
+ * @param[out] temp The reading, when true is returned
+ * @return The result of the poll
+ */
+static bool poll(ThermistorMux& thermMux, uint8_t thermNum, int16_t& temp) {
+    uint64_t start = SIM::clock::micros();
+    bool isRead = thermMux.pollTemp(thermNum, temp);
+    uint64_t pollTime = SIM::clock::micros() - start;
+    numPolls++;
+    longestPoll = pollTime > longestPoll ? pollTime : longestPoll;
+    if (pollTime != 0) {
+        fail("poll blocked", thermNum);
+    }
+    return isRead;
+}
+
+/**
+ * Read a thermistor polling once a millisecond, from IDLE, and check the
+ * reading comes after exactly the settling time
+ *
+ * @param[in] thermMux The MUX
+ * @param[in] adc The ADC behind the MUX
+ * @param[in] thermNum The thermistor to read
+ */
+static void checkRead(ThermistorMux& thermMux, SIM::SimADC& adc, uint8_t thermNum) {
+    int16_t temp = 0;
+    uint32_t samples = adc.getNumSamples();
+
+    // IDLE, selects the thermistor
+    if (poll(thermMux, thermNum, temp) || adc.getNumSamples() != samples) {
+        fail("read from IDLE", thermNum);
+        return;
+    }
+
+    // SETTLING, nothing is sampled until the MUX output has settled
+    for (uint32_t elapsed = 1; elapsed < SETTLING_TIME; elapsed++) {
+        SIM::clock::advance(1000);
+        if (poll(thermMux, thermNum, temp) || adc.getNumSamples() != samples) {
+            fail("read while settling", thermNum);
+            return;
+        }
+    }
+
+    SIM::clock::advance(1000);
+    if (!poll(thermMux, thermNum, temp)) {
+        fail("no reading once settled", thermNum);
+        return;
+    }
+    if (adc.getNumSamples() == samples || temp != TEMP_TABLE.convert(inputCount(thermNum))) {
+        fail("reading of the wrong input", thermNum);
+    }
+}
+
+int main() {
+    Mux mux;
+    IO::GPIO* muxSelectArr[3] = {&mux.pins[0], &mux.pins[1], &mux.pins[2]};
+    SIM::SimADC adc;
+    adc.setSource(sampleSource, &mux);
+    ThermistorMux thermMux(muxSelectArr, adc);
+
+    // A scan of the pack, the way the thermistor task reads it
+    for (uint8_t thermNum = 0; thermNum < NUM_THERMISTORS; thermNum++) {
+        checkRead(thermMux, adc, thermNum);
+    }
+
+    // Asking for another thermistor part way through settling starts over
+    int16_t temp = 0;
+    poll(thermMux, 0, temp);
+    SIM::clock::advance(SETTLING_TIME / 2 * 1000);
+    if (poll(thermMux, 3, temp)) {
+        fail("read of a thermistor which was not selected", 3);
+    }
+    SIM::clock::advance((SETTLING_TIME - 1) * 1000);
+    if (poll(thermMux, 3, temp)) {
+        fail("read before the new selection settled", 3);
+    }
+    SIM::clock::advance(1000);
+    if (!poll(thermMux, 3, temp) || temp != TEMP_TABLE.convert(inputCount(3))) {
+        fail("no reading after the new selection settled", 3);
+    }
+
+    // The blocking read, for comparison
+    uint64_t start = SIM::clock::micros();
+    int16_t blockingTemp = thermMux.getTemp(2);
+    uint64_t blockedTime = SIM::clock::micros() - start;
+    if (blockedTime != SETTLING_TIME * 1000 || blockingTemp != TEMP_TABLE.convert(inputCount(2))) {
+        fail("blocking read", 2);
+    }
+
+    printf("pollTemp: %u polls, longest %llu us; getTemp blocked for %llu ms\r\n", numPolls,
+           static_cast<unsigned long long>(longestPoll), static_cast<unsigned long long>(blockedTime / 1000));
+    printf("%s\r\n", numFailures ? "FAIL" : "PASS");
+    return numFailures ? 1 : 0;
+}
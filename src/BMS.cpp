@@ -9,16 +9,70 @@ namespace log = EVT::core::log;
 
 namespace BMS {
 
-BMS::BMS(BQSettingsStorage& bqSettingsStorage, DEV::BQ76952 bq,
+BMS::BMS(BQSettingsStorage& bqSettingsStorage, DEV::BQ76952 bq, I2CTransactionQueue& i2cQueue,
          DEV::Interlock& interlock, IO::GPIO& alarm, SystemDetect& systemDetect,
          IO::GPIO& bmsOK, DEV::ThermistorMux& thermMux,
          ResetHandler& resetHandler, EVT::core::DEV::IWDG& iwdg) : bqSettingsStorage(bqSettingsStorage),
-                                                                   bq(bq), state(State::START), interlock(interlock),
+                                                                   bq(bq), i2cQueue(i2cQueue), state(State::START), interlock(interlock),
                                                                    alarm(alarm), systemDetect(systemDetect), resetHandler(resetHandler),
-                                                                   bmsOK(bmsOK), thermistorMux(thermMux), iwdg(iwdg), stateChanged(true) {
+                                                                   bmsOK(bmsOK), thermistorMux(thermMux), iwdg(iwdg),
+                                                                   socEstimator(bqSettingsStorage.getEEPROM(), PACK_CAPACITY),
+                                                                   faultLog(bqSettingsStorage.getEEPROM(), i2cQueue), stateChanged(true) {
     bmsOK.writePin(IO::GPIO::State::LOW);
 
+    // Settings downloaded over CANopen are written while the BQ reads run
+    bqSettingsStorage.setI2CQueue(i2cQueue);
+
+    socEstimator.load();
+    telemetry.working().stateOfCharge = socEstimator.getSoc();
+    faultLog.load();
+
+    // Registration order has to match the BMS::*_TASK IDs
+    static_assert(BALANCING_TASK + 1 == NUM_TASKS, "Every task needs a BQ failure count");
+    static_assert(NUM_THERMISTORS <= 8, "Every thermistor needs a bit in thermistorsRead");
+    scheduler.addTask(currentTask, this, CURRENT_PERIOD, 0);
+    scheduler.addTask(cellVoltageTask, this, CELL_VOLTAGE_PERIOD, 1);
+    scheduler.addTask(bqStatusTask, this, BQ_STATUS_PERIOD, 2);
+    scheduler.addTask(bqTempTask, this, BQ_TEMP_PERIOD, 3);
+    scheduler.addTask(thermistorTask, this, THERMISTOR_PERIOD, 4);
+    scheduler.addTask(telemetryRecordTask, this, TELEMETRY_RECORD_PERIOD, 5);
+    scheduler.addTask(balancingTask, this, BALANCING_PERIOD, 6);
+
+    // Values of the event driven TPDOs, these have to match the TPDO mappings
+    const Telemetry& reported = telemetry.published();
+    tpdoTrigger.watch(0, &reported.batteryVoltage, PACK_VOLTAGE_DEADBAND);
+    tpdoTrigger.watch(0, &reported.voltageInfo.minCellVoltage, CELL_VOLTAGE_DEADBAND);
+    tpdoTrigger.watch(0, &reported.voltageInfo.minCellVoltageId);
+    tpdoTrigger.watch(0, &reported.voltageInfo.maxCellVoltage, CELL_VOLTAGE_DEADBAND);
+    tpdoTrigger.watch(0, &reported.voltageInfo.maxCellVoltageId);
+
+    tpdoTrigger.watch(1, &reported.current, CURRENT_DEADBAND);
+    tpdoTrigger.watch(1, &reported.packTempInfo.minPackTemp, TEMP_DEADBAND);
+    tpdoTrigger.watch(1, &reported.packTempInfo.minPackTempId);
+    tpdoTrigger.watch(1, &reported.packTempInfo.maxPackTemp, TEMP_DEADBAND);
+    tpdoTrigger.watch(1, &reported.packTempInfo.maxPackTempId);
+    tpdoTrigger.watch(1, &reported.bqTempInfo.internalTemp, TEMP_DEADBAND);
+    tpdoTrigger.watch(1, &reported.state);
+
+    for (uint8_t i = 0; i < NUM_THERMISTORS; i++) {
+        tpdoTrigger.watch(2, &reported.thermistorTemperature[i], TEMP_DEADBAND);
+    }
+    tpdoTrigger.watch(2, &reported.bqTempInfo.temp1, TEMP_DEADBAND);
+    tpdoTrigger.watch(2, &reported.bqTempInfo.temp2, TEMP_DEADBAND);
+
+    tpdoTrigger.watch(3, &reported.errorRegister);
+    for (uint8_t i = 0; i < 7; i++) {
+        tpdoTrigger.watch(3, &reported.bqStatus[i]);
+    }
+
+    for (uint8_t i = 0; i < DEV::BQ76952::NUM_CELLS; i++) {
+        tpdoTrigger.watch(4 + i / 4, &reported.cellVoltage[i], CELL_VOLTAGE_DEADBAND);
+    }
+
+    tpdoTrigger.watch(7, &reported.stateOfCharge, SOC_DEADBAND);
+
     updateBQData();
+    publishTelemetry();
 }
 
 CO_OBJ_T* BMS::getObjectDictionary() {
@@ -33,64 +87,90 @@ uint8_t BMS::getNodeID() {
     return NODE_ID;
 }
 
+BMS::State BMS::getState() {
+    return state;
+}
+
+TaskScheduler::TaskStats BMS::getTaskStats(uint8_t taskId) {
+    return scheduler.getTaskStats(taskId);
+}
+
+uint8_t BMS::getTriggeredTPDOs() {
+    return tpdoTrigger.poll();
+}
+
+void BMS::setCANQueueStats(uint32_t highWaterMark, uint32_t overflowCount) {
+    canQueueHighWaterMark = highWaterMark;
+    canQueueOverflowCount = overflowCount;
+}
+
 void BMS::canTest() {
-    batteryVoltage = 0x2301;
-    voltageInfo = {
+    Telemetry& data = telemetry.working();
+
+    data.batteryVoltage = 0x2301;
+    data.voltageInfo = {
         0x6745,
         0x89,
         (int16_t) 0xcdab,
         0xef,
     };
 
-    current = 0x2301;
-    packTempInfo = {
+    data.current = 0x2301;
+    data.packTempInfo = {
         .minPackTemp = 0x45,
         .minPackTempId = 0x67,
         .maxPackTemp = 0x89,
         .maxPackTempId = 0xab,
     };
-    bqTempInfo.internalTemp = 0xcd;
+    data.bqTempInfo.internalTemp = 0xcd;
     state = static_cast<State>(0xef);
 
-    thermistorTemperature[0] = 0x01;
-    thermistorTemperature[1] = 0x23;
-    thermistorTemperature[2] = 0x45;
-    thermistorTemperature[3] = 0x67;
-    thermistorTemperature[4] = 0x89;
-    thermistorTemperature[5] = 0xab;
-    bqTempInfo.temp1 = 0xcd;
-    bqTempInfo.temp2 = 0xef;
+    data.thermistorTemperature[0] = 0x01;
+    data.thermistorTemperature[1] = 0x23;
+    data.thermistorTemperature[2] = 0x45;
+    data.thermistorTemperature[3] = 0x67;
+    data.thermistorTemperature[4] = 0x89;
+    data.thermistorTemperature[5] = 0xab;
+    data.bqTempInfo.temp1 = 0xcd;
+    data.bqTempInfo.temp2 = 0xef;
+
+    data.stateOfCharge = 0x2301;
 
     errorRegister = 0x01;
-    bqStatusArr[0] = 0x23;
-    bqStatusArr[1] = 0x45;
-    bqStatusArr[2] = 0x67;
-    bqStatusArr[3] = 0x89;
-    bqStatusArr[4] = 0xab;
-    bqStatusArr[5] = 0xcd;
-    bqStatusArr[6] = 0xef;
+    data.bqStatus[0] = 0x23;
+    data.bqStatus[1] = 0x45;
+    data.bqStatus[2] = 0x67;
+    data.bqStatus[3] = 0x89;
+    data.bqStatus[4] = 0xab;
+    data.bqStatus[5] = 0xcd;
+    data.bqStatus[6] = 0xef;
 
     for (uint8_t i = 0; i < 12; i++) {
         switch (i % 4) {
         case 0:
-            cellVoltage[i] = 0x2301;
+            data.cellVoltage[i] = 0x2301;
             break;
         case 1:
-            cellVoltage[i] = 0x6745;
+            data.cellVoltage[i] = 0x6745;
             break;
         case 2:
-            cellVoltage[i] = 0xab89;
+            data.cellVoltage[i] = 0xab89;
             break;
         case 3:
-            cellVoltage[i] = 0xefcd;
+            data.cellVoltage[i] = 0xefcd;
             break;
         }
     }
+
+    publishTelemetry();
 }
 
 void BMS::process() {
     iwdg.refresh();
 
+    // Collect the BQ reads which completed since the last call
+    i2cQueue.process();
+
     switch (state) {
     case State::START:
         startState();
@@ -119,6 +199,23 @@ void BMS::process() {
         chargingState();
         break;
     }
+
+    // Everything read during this call goes out together
+    publishTelemetry();
+
+    // Journal each fault once, when its error bit is first set
+    if (errorRegister & ~loggedErrors) {
+        logFault(telemetry.published());
+    }
+    loggedErrors = errorRegister;
+
+    // The SOC estimate is updated from the current read callback, but saved
+    // here, outside the queue, as the EEPROM is on the same bus as the BQ
+    if (socEstimator.isSaveDue()) {
+        i2cQueue.acquireBus();
+        socEstimator.save();
+        i2cQueue.releaseBus();
+    }
 }
 
 void BMS::startState() {
@@ -126,26 +223,36 @@ void BMS::startState() {
         bmsOK.writePin(BMS_NOT_OK);
         stateChanged = false;
 
+        // Let reads still in flight complete, so they can not overwrite the
+        // data reset below, and free the bus for the blocking BQ commands
+        i2cQueue.flush();
+
+        updateBalancing();
+
         // Reset all data
         numBqAttemptsMade = 0;
-        numThermAttemptsMade = 0;
         lastBqAttemptTime = 0;
-        lastThermAttemptTime = 0;
+        memset(numBqTaskFailures, 0, sizeof(numBqTaskFailures));
+        resetHandler.clear();
         clearVoltageReadings();
-        current = 0;
-        packTempInfo = {
+        Telemetry& data = telemetry.working();
+        data.current = 0;
+        data.packTempInfo = {
             .minPackTemp = 0,
             .minPackTempId = 0,
             .maxPackTemp = 0,
             .maxPackTempId = 0,
         };
-        bqTempInfo = {
+        data.bqTempInfo = {
             .internalTemp = 0,
             .temp1 = 0,
             .temp2 = 0,
         };
-        memset(thermistorTemperature, 0, DEV::BQ76952::NUM_CELLS * sizeof(uint16_t));
-        memset(bqStatusArr, 0, sizeof(uint8_t) * 3);
+        memset(data.thermistorTemperature, 0, sizeof(data.thermistorTemperature));
+        thermistorStats.reset();
+        thermistorsRead = 0;
+        packTempsComplete = false;
+        memset(data.bqStatus, 0, sizeof(uint8_t) * 3);
         errorRegister = 0;
         lastCheckedThermNum = -1;
 
@@ -179,6 +286,14 @@ void BMS::startState() {
             stateChanged = true;
         }
     }
+    // Skip the transfer if the BQ already holds the stored settings, which
+    // is the case after a reset of just the BMS
+    else if (bqSettingsStorage.isAppliedToBQ()) {
+        log::LOGGER.log(log::Logger::LogLevel::INFO, "BQ settings already applied");
+        iwdg.init();
+        state = State::SYSTEM_READY;
+        stateChanged = true;
+    }
     // Check to see if we have setting to be transferred
     else if (bqSettingsStorage.hasSettings()) {
         state = State::TRANSFER_SETTINGS;
@@ -196,10 +311,12 @@ void BMS::initializationErrorState() {
         bmsOK.writePin(BMS_NOT_OK);
         stateChanged = false;
         clearVoltageReadings();
+        // Only reset frames received in this state count
+        resetHandler.clear();
         log::LOGGER.log(log::Logger::LogLevel::INFO, "Entering initialization error state");
     }
 
-    updateThermistorReading();
+    scheduler.process(THERMISTOR_ONLY_TASKS);
 
     if (resetHandler.shouldReset()) {
         state = State::START;
@@ -243,7 +360,7 @@ void BMS::transferSettingsState() {
     }
 
     bool isComplete = false;
-    auto result = bqSettingsStorage.transferSetting(isComplete);
+    auto result = bqSettingsStorage.transferBlock(isComplete);
     if (result != DEV::BQ76952::Status::OK) {
         numBqAttemptsMade++;
 
@@ -271,6 +388,7 @@ void BMS::systemReadyState() {
     if (stateChanged) {
         bmsOK.writePin(BMS_NOT_OK);
         stateChanged = false;
+        scheduler.reset();
         log::LOGGER.log(log::Logger::LogLevel::INFO, "Entering system ready state");
     }
 
@@ -295,8 +413,7 @@ void BMS::systemReadyState() {
         }
     }
 
-    updateBQData();
-    updateThermistorReading();
+    scheduler.process();
 }
 
 void BMS::unsafeConditionsError() {
@@ -304,10 +421,17 @@ void BMS::unsafeConditionsError() {
         bmsOK.writePin(BMS_NOT_OK);
         stateChanged = false;
         log::LOGGER.log(log::Logger::LogLevel::INFO, "Entering unsafe conditions state");
+        resetHandler.clear();
+        updateBalancing();
+
+        // Keep the samples leading up to the fault, ending with the readings
+        // which caused it
+        publishTelemetry();
+        recordTelemetry(telemetry.published());
+        telemetryRecorder.freeze();
     }
 
-    updateBQData();
-    updateThermistorReading();
+    scheduler.process();
 
     if (resetHandler.shouldReset()) {
         state = State::START;
@@ -320,6 +444,7 @@ void BMS::powerDeliveryState() {
         bmsOK.writePin(BMS_OK);
         stateChanged = false;
         log::LOGGER.log(log::Logger::LogLevel::INFO, "Entering power delivery state");
+        updateBalancing();
     }
 
     // TODO: Update error register of BMS
@@ -335,8 +460,7 @@ void BMS::powerDeliveryState() {
         return;
     }
 
-    updateBQData();
-    updateThermistorReading();
+    scheduler.process();
 }
 
 void BMS::chargingState() {
@@ -359,8 +483,7 @@ void BMS::chargingState() {
         return;
     }
 
-    updateBQData();
-    updateThermistorReading();
+    scheduler.process();
 }
 
 bool BMS::isHealthy() {
@@ -374,107 +497,344 @@ bool BMS::isHealthy() {
 }
 
 void BMS::updateBQData() {
-    // TODO: Limit the number of times this is called, currently this
-    //       `updateVoltageReadings` is called every run of the loop
-    //       which results in a lot of I2C calls. This isn't directly an
-    //       issue, just not necessary. Could be limited to update once a
-    //       second.
+    updateCellVoltages();
+    updateCurrent();
+    updateBQTemps();
+    updateBQStatus();
+    i2cQueue.flush();
+}
 
-    // Check if an error has taken place, and if so, check to make sure
-    // a certain delay time has taken place before making another attempt
-    if (numBqAttemptsMade > 0) {
-        // If there has not been enough time between attempts, skip this run
-        // of the state and try again later
-        if ((time::millis() - lastBqAttemptTime) < ERROR_TIME_DELAY) {
-            return;
-        }
-    }
+void BMS::updateCellVoltages() {
+    submitBQRead(CELL_VOLTAGE_TASK, DEV::BQ76952::DataRead::CELL_VOLTAGE, cellVoltageReadComplete);
+}
 
-    DEV::BQ76952::Status result = bq.getCellVoltage(cellVoltage, totalVoltage, voltageInfo);
+void BMS::updateCurrent() {
+    submitBQRead(CURRENT_TASK, DEV::BQ76952::DataRead::CURRENT, currentReadComplete);
+}
 
-    if (result == DEV::BQ76952::Status::OK) {
-        result = bq.getTotalVoltage(batteryVoltage);
-    }
+void BMS::updateStateOfCharge() {
+    // totalVoltage is the sum of the cell voltages read by the cell voltage task
+    uint16_t averageCellVoltage = totalVoltage / DEV::BQ76952::NUM_CELLS;
 
-    if (result == DEV::BQ76952::Status::OK) {
-        result = bq.getCurrent(current);
+    socEstimator.update(telemetry.working().current, averageCellVoltage, time::millis());
+    telemetry.working().stateOfCharge = socEstimator.getSoc();
+}
+
+void BMS::updateBQStatus() {
+    submitBQRead(BQ_STATUS_TASK, DEV::BQ76952::DataRead::STATUS, bqStatusReadComplete);
+}
+
+void BMS::updateBQTemps() {
+    submitBQRead(BQ_TEMP_TASK, DEV::BQ76952::DataRead::TEMPS, bqTempReadComplete);
+}
+
+void BMS::submitBQRead(uint8_t taskId, DEV::BQ76952::DataRead read, I2CTransactionQueue::Callback callback) {
+    if (isBQRetryPending(taskId)) {
+        return;
     }
 
-    if (result == DEV::BQ76952::Status::OK) {
-        result = bq.getTemps(bqTempInfo);
+    // Success is only known once the read is collected
+    DEV::BQ76952::Status result = bq.submitRead(i2cQueue, read, callback, this);
+    if (result != DEV::BQ76952::Status::OK) {
+        handleBQResult(taskId, result);
     }
+}
 
-    if (result == DEV::BQ76952::Status::OK) {
-        result = bq.getBQStatus(bqStatusArr);
+bool BMS::isBQRetryPending(uint8_t taskId) {
+    // Check if an error has taken place, and if so, check to make sure
+    // a certain delay time has taken place before making another attempt
+    if (numBqTaskFailures[taskId] > 0) {
+        // If there has not been enough time between attempts, skip this run
+        // of the task and try again later
+        if ((time::millis() - lastBqTaskFailureTime[taskId]) < ERROR_TIME_DELAY) {
+            return true;
+        }
     }
 
+    return false;
+}
+
+void BMS::handleBQResult(uint8_t taskId, DEV::BQ76952::Status result) {
+    // Only a success of the same task clears its failures, the other tasks
+    // run different reads which may fail on their own
     if (result != DEV::BQ76952::Status::OK) {
-        numBqAttemptsMade++;
+        numBqTaskFailures[taskId]++;
 
         // If the number of errors are over the max
-        if (numBqAttemptsMade >= MAX_BQ_COMM_ATTEMPTS) {
+        if (numBqTaskFailures[taskId] >= MAX_BQ_COMM_ATTEMPTS) {
             errorRegister |= static_cast<uint8_t>(result);
             return;
         }
 
-        lastBqAttemptTime = time::millis();
+        lastBqTaskFailureTime[taskId] = time::millis();
     } else {
-        numBqAttemptsMade = 0;
+        numBqTaskFailures[taskId] = 0;
     }
 }
 
 void BMS::updateThermistorReading() {
-    // Check if an error has taken place, and if so, check to make sure
-    // a certain delay time has taken place before making another attempt
-    if (numThermAttemptsMade > 0) {
-        // If there has not been enough time between attempts, skip this run
-        // of the state and try again later
-        if ((time::millis() - lastThermAttemptTime) < ERROR_TIME_DELAY) {
-            return;
-        }
+    // Start or continue a non-blocking read of the next thermistor, skip this
+    // run if the MUX is still settling
+    uint8_t nextThermNum = (lastCheckedThermNum + 1) % NUM_THERMISTORS;
+    int16_t temp;
+    if (!thermistorMux.pollTemp(nextThermNum, temp)) {
+        return;
     }
 
-    lastCheckedThermNum = (lastCheckedThermNum + 1) % NUM_THERMISTORS;
-    thermistorTemperature[lastCheckedThermNum] = thermistorMux.getTemp(lastCheckedThermNum);
-
-    packTempInfo.maxPackTempId = 0;
-    packTempInfo.minPackTempId = 0;
-    packTempInfo.maxPackTemp = thermistorTemperature[0];
-    packTempInfo.minPackTemp = thermistorTemperature[0];
-    for (uint8_t i = 1; i < NUM_THERMISTORS; i++) {
-        if (thermistorTemperature[i] < packTempInfo.minPackTemp) {
-            packTempInfo.minPackTemp = thermistorTemperature[i];
-            packTempInfo.minPackTempId = i;
-        } else if (thermistorTemperature[i] > packTempInfo.maxPackTemp) {
-            packTempInfo.maxPackTemp = thermistorTemperature[i];
-            packTempInfo.maxPackTempId = i;
+    // The CANopen objects hold whole degrees Celsius, below 0 C reads as 0
+    Telemetry& data = telemetry.working();
+    lastCheckedThermNum = nextThermNum;
+    data.thermistorTemperature[lastCheckedThermNum] = temp < 0 ? 0 : (temp + 5) / 10;
+
+    thermistorStats.update(lastCheckedThermNum, data.thermistorTemperature[lastCheckedThermNum]);
+    thermistorsRead |= 1 << lastCheckedThermNum;
+    data.packTempInfo.minPackTemp = thermistorStats.getMin();
+    data.packTempInfo.minPackTempId = thermistorStats.getMinChannel();
+    data.packTempInfo.maxPackTemp = thermistorStats.getMax();
+    data.packTempInfo.maxPackTempId = thermistorStats.getMaxChannel();
+
+    // The readings are already filtered, so one over the limit is acted on
+    // right away
+    if (data.thermistorTemperature[lastCheckedThermNum] > MAX_THERM_TEMP) {
+        if (!(errorRegister & OVER_TEMP_ERROR)) {
+            log::LOGGER.log(log::Logger::LogLevel::ERROR, "Thermistor %d over max temp: %d", lastCheckedThermNum, data.thermistorTemperature[lastCheckedThermNum]);
         }
+
+        errorRegister |= OVER_TEMP_ERROR;
     }
+}
 
-    if (thermistorTemperature[lastCheckedThermNum] > MAX_THERM_TEMP) {
-        numThermAttemptsMade++;
+void BMS::recordTelemetry(const Telemetry& data) {
+    static_assert(TelemetryRecorder::NUM_CELLS == DEV::BQ76952::NUM_CELLS, "Recorded cells do not match the BQ");
+    static_assert(TelemetryRecorder::NUM_TEMPS == NUM_THERMISTORS + 3, "Recorded temperatures do not match the pack");
+
+    TelemetryRecorder::Sample sample;
+    sample.time = time::millis();
+    memcpy(sample.cellVoltage, data.cellVoltage, sizeof(sample.cellVoltage));
+    sample.current = data.current;
+    memcpy(sample.temperature, data.thermistorTemperature, NUM_THERMISTORS);
+    sample.temperature[NUM_THERMISTORS] = data.bqTempInfo.internalTemp;
+    sample.temperature[NUM_THERMISTORS + 1] = data.bqTempInfo.temp1;
+    sample.temperature[NUM_THERMISTORS + 2] = data.bqTempInfo.temp2;
+    memcpy(sample.bqStatus, data.bqStatus, sizeof(sample.bqStatus));
+    sample.errorRegister = data.errorRegister;
+
+    telemetryRecorder.record(sample);
+}
 
-        if (numThermAttemptsMade >= MAX_THERM_READ_ATTEMPTS) {
-            log::LOGGER.log(log::Logger::LogLevel::ERROR, "Thermistor %d over max temp: %d", lastCheckedThermNum, thermistorTemperature[lastCheckedThermNum]);
+void BMS::updateBalancing() {
+    if (state != State::SYSTEM_READY && state != State::CHARGING) {
+        balancingController.reset();
+        setBalancingMask(0);
+        return;
+    }
 
-            errorRegister |= OVER_TEMP_ERROR;
-            return;
-        }
+    // A thermistor not yet read counts as 0 C in the pack maximum, so the
+    // temperature limit can only be checked once all of them have been read
+    if (!packTempsComplete) {
+        balancingController.reset();
+        setBalancingMask(0);
+        return;
+    }
+
+    const Telemetry& data = telemetry.published();
+    if (automaticBalancing) {
+        setBalancingMask(balancingController.update(data.cellVoltage, data.packTempInfo.maxPackTemp,
+                                                    data.bqTempInfo.internalTemp));
+        return;
+    }
+
+    // The written cells are still only bled within the temperature limits
+    balancingController.reset();
+    if (data.packTempInfo.maxPackTemp >= BalancingController::MAX_PACK_TEMP
+        || data.bqTempInfo.internalTemp >= BalancingController::MAX_BQ_TEMP) {
+        setBalancingMask(0);
+        return;
+    }
+    setBalancingMask(manualBalancingMask);
+}
+
+void BMS::setBalancingMask(uint16_t mask) {
+    if (mask == balancingMask) {
+        return;
+    }
+
+    // The mask goes out in one blocking RAM write, between the queued reads
+    i2cQueue.acquireBus();
+    DEV::BQ76952::Status result = bq.setBalancingMask(mask);
+    i2cQueue.releaseBus();
+    handleBQResult(BALANCING_TASK, result);
+
+    if (result == DEV::BQ76952::Status::OK) {
+        balancingMask = mask;
+    }
+}
+
+void BMS::logFault(const Telemetry& data) {
+    FaultLog::Record record;
+    record.time = time::millis();
+    record.state = data.state;
+    record.errorRegister = data.errorRegister;
+    memcpy(record.bqStatus, data.bqStatus, sizeof(record.bqStatus));
+    record.voltageInfo = data.voltageInfo;
+    record.current = data.current;
+    record.maxPackTemp = data.packTempInfo.maxPackTemp;
+    record.maxPackTempId = data.packTempInfo.maxPackTempId;
+
+    faultLog.append(record);
+    log::LOGGER.log(log::Logger::LogLevel::INFO, "Fault logged: 0x%x", data.errorRegister);
+}
+
+void BMS::cellVoltageReadComplete(I2CTransactionQueue::Status status, void* priv) {
+    (void) status;
+    BMS* bms = static_cast<BMS*>(priv);
+    Telemetry& data = bms->telemetry.working();
+    bms->handleBQResult(CELL_VOLTAGE_TASK, bms->bq.collectCellVoltage(data.cellVoltage, bms->totalVoltage, data.voltageInfo));
+}
+
+void BMS::currentReadComplete(I2CTransactionQueue::Status status, void* priv) {
+    (void) status;
+    BMS* bms = static_cast<BMS*>(priv);
+    DEV::BQ76952::Status result = bms->bq.collectCurrent(bms->telemetry.working().current);
+    bms->handleBQResult(CURRENT_TASK, result);
+
+    if (result == DEV::BQ76952::Status::OK) {
+        bms->updateStateOfCharge();
+    }
+}
+
+void BMS::bqStatusReadComplete(I2CTransactionQueue::Status status, void* priv) {
+    (void) status;
+    BMS* bms = static_cast<BMS*>(priv);
+    Telemetry& data = bms->telemetry.working();
+    bms->handleBQResult(BQ_STATUS_TASK, bms->bq.collectStatus(data.batteryVoltage, data.bqStatus));
+}
+
+void BMS::bqTempReadComplete(I2CTransactionQueue::Status status, void* priv) {
+    (void) status;
+    BMS* bms = static_cast<BMS*>(priv);
+    bms->handleBQResult(BQ_TEMP_TASK, bms->bq.collectTemps(bms->telemetry.working().bqTempInfo));
+}
 
-        lastThermAttemptTime = time::millis();
-        lastCheckedThermNum--;
+void BMS::balancingReadComplete(I2CTransactionQueue::Status status, void* priv) {
+    (void) status;
+    BMS* bms = static_cast<BMS*>(priv);
+    uint16_t mask;
+    DEV::BQ76952::Status result = bms->bq.collectBalancing(mask);
+    bms->handleBQResult(BALANCING_TASK, result);
+
+    // Whatever the BQ reports wins, a mask the BQ dropped is written again
+    // on the next balancing period
+    if (result == DEV::BQ76952::Status::OK) {
+        bms->balancingMask = mask;
+    }
+}
+
+void BMS::currentTask(void* priv) {
+    static_cast<BMS*>(priv)->updateCurrent();
+}
+
+void BMS::cellVoltageTask(void* priv) {
+    static_cast<BMS*>(priv)->updateCellVoltages();
+}
+
+void BMS::bqStatusTask(void* priv) {
+    static_cast<BMS*>(priv)->updateBQStatus();
+}
+
+void BMS::bqTempTask(void* priv) {
+    static_cast<BMS*>(priv)->updateBQTemps();
+}
+
+void BMS::thermistorTask(void* priv) {
+    static_cast<BMS*>(priv)->updateThermistorReading();
+}
+
+void BMS::telemetryRecordTask(void* priv) {
+    // The published copy, so every sample is one coherent set of readings
+    BMS* bms = static_cast<BMS*>(priv);
+    bms->recordTelemetry(bms->telemetry.published());
+}
+
+void BMS::balancingTask(void* priv) {
+    BMS* bms = static_cast<BMS*>(priv);
+    bms->updateBalancing();
+    bms->submitBQRead(BALANCING_TASK, DEV::BQ76952::DataRead::BALANCING, balancingReadComplete);
+}
+
+uint32_t BMS::balancingCANOpenSize(CO_OBJ_T* obj, CO_NODE_T* node, uint32_t width) {
+    (void) obj;
+    (void) node;
+    (void) width;
+
+    return 1;
+}
+
+CO_ERR BMS::balancingCANOpenCtrl(CO_OBJ_T* obj, CO_NODE_T* node, uint16_t func, uint32_t para) {
+    (void) obj;
+    (void) node;
+    (void) func;
+    (void) para;
+
+    return CO_ERR_NONE;
+}
+
+CO_ERR BMS::balancingCANOpenRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len) {
+    (void) node;
+
+    if (len < 1) {
+        return CO_ERR_BAD_ARG;
+    }
+
+    auto* bms = (BMS*) obj->Data;
+    uint8_t cell = (obj->Key >> 8) & 0xFF;
+    *static_cast<uint8_t*>(buf) = (bms->balancingMask >> (cell - 1)) & 1;
+
+    return CO_ERR_NONE;
+}
+
+CO_ERR BMS::balancingCANOpenWrite(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len) {
+    (void) node;
+
+    if (len < 1) {
+        return CO_ERR_BAD_ARG;
+    }
+
+    auto* bms = (BMS*) obj->Data;
+    uint8_t cell = (obj->Key >> 8) & 0xFF;
+
+    // The first write takes over from the balancing controller, starting
+    // from no cells
+    if (bms->automaticBalancing) {
+        bms->automaticBalancing = 0;
+        bms->manualBalancingMask = 0;
+    }
+
+    if (*static_cast<uint8_t*>(buf)) {
+        bms->manualBalancingMask |= 1 << (cell - 1);
     } else {
-        numThermAttemptsMade = 0;
+        bms->manualBalancingMask &= ~(1 << (cell - 1));
     }
+
+    return CO_ERR_NONE;
 }
 
 void BMS::clearVoltageReadings() {
+    Telemetry& data = telemetry.working();
     totalVoltage = 0;
-    batteryVoltage = 0;
-    voltageInfo = {0, 0, 0, 0};
+    data.batteryVoltage = 0;
+    data.voltageInfo = {0, 0, 0, 0};
 
     // Zero out all cell voltages
-    memset(cellVoltage, 0, DEV::BQ76952::NUM_CELLS * sizeof(uint16_t));
+    memset(data.cellVoltage, 0, DEV::BQ76952::NUM_CELLS * sizeof(uint16_t));
+}
+
+void BMS::publishTelemetry() {
+    Telemetry& data = telemetry.working();
+    data.state = static_cast<uint8_t>(state);
+    data.errorRegister = errorRegister;
+    telemetry.publish();
+    packTempsComplete = thermistorsRead == ALL_THERMISTORS_READ;
 }
 
 }// namespace BMS
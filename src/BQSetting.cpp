@@ -43,6 +43,68 @@ void BQSetting::toArray(uint8_t buffer[ARRAY_SIZE]) {
     buffer[6] = (data >> 24) & 0xFF;
 }
 
+uint8_t BQSetting::fromStream(const uint8_t* buffer, uint32_t length, uint16_t& nextAddress) {
+    if (length == 0) {
+        return 0;
+    }
+
+    uint8_t commandByte = buffer[0];
+    uint8_t streamNumBytes = (commandByte >> 2) & 0x7;
+    uint8_t addressMode = (commandByte >> 5) & 0x3;
+    if (streamNumBytes > 4 || addressMode > STREAM_ADDRESS_ABSOLUTE) {
+        return 0;
+    }
+
+    uint8_t size = 1 + addressMode + streamNumBytes;
+    if (size > length) {
+        return 0;
+    }
+
+    settingType = static_cast<BQSettingType>(commandByte & 0x3);
+    numBytes = streamNumBytes;
+
+    switch (addressMode) {
+    case STREAM_ADDRESS_NEXT:
+        address = nextAddress;
+        break;
+    case STREAM_ADDRESS_OFFSET:
+        address = nextAddress + buffer[1];
+        break;
+    default:
+        address = (static_cast<uint16_t>(buffer[2]) << 8) | buffer[1];
+        break;
+    }
+
+    data = 0;
+    for (uint8_t i = 0; i < numBytes; i++) {
+        data |= static_cast<uint32_t>(buffer[1 + addressMode + i]) << (i * 8);
+    }
+
+    nextAddress = address + numBytes;
+    return size;
+}
+
+uint8_t BQSetting::toStream(uint8_t buffer[MAX_STREAM_SIZE], uint16_t& nextAddress) {
+    uint8_t addressMode = STREAM_ADDRESS_ABSOLUTE;
+    if (address == nextAddress) {
+        addressMode = STREAM_ADDRESS_NEXT;
+    } else if (address > nextAddress && address - nextAddress <= 0xFF) {
+        addressMode = STREAM_ADDRESS_OFFSET;
+        buffer[1] = address - nextAddress;
+    } else {
+        buffer[1] = address & 0xFF;
+        buffer[2] = address >> 8;
+    }
+    buffer[0] = static_cast<uint8_t>(settingType) | (numBytes << 2) | (addressMode << 5);
+
+    for (uint8_t i = 0; i < numBytes; i++) {
+        buffer[1 + addressMode + i] = (data >> (i * 8)) & 0xFF;
+    }
+
+    nextAddress = address + numBytes;
+    return 1 + addressMode + numBytes;
+}
+
 BQSetting::BQSettingType BQSetting::getSettingType() {
     return settingType;
 }
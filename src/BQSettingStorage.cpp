@@ -1,161 +1,101 @@
 #include <BQSettingStorage.hpp>
 
+#include <cstring>
+
 #include <EVT/utils/log.hpp>
 
-namespace log = EVT::core::log;
+#include <CRC32.hpp>
 
-///////////////////////////////////////////////////////////////////////////////
-// Functions for interacting with the BQSettingsStorage through CANopen
-///////////////////////////////////////////////////////////////////////////////
-///**
-// * Function to get the size of the BQStorage. The size is in bytes to store
-// * all of the BQSettings.
-// *
-// * @param obj[in] CANopen stack object dictionary element (not used)
-// * @param node[in] CANopen stack node (not used)
-// * @param width[in] The width of the data in bytes as it is stored in the
-// *  object dictionary (not used)
-// * @param priv[in] Private data, pointer to an instance of the BQSettingsStorage
-// * @return Number of bytes to store all BQSettings
-// */
-//static uint32_t COBQSettingSize(struct CO_OBJ_T* obj, struct CO_NODE_T* node,
-//                                uint32_t width, void* priv) {
-//    auto* storage = (BMS::BQSettingsStorage*) priv;
-//
-//    (void) obj;
-//    (void) node;
-//    (void) width;
-//
-//    if (!storage) {
-//        log::LOGGER.log(log::Logger::LogLevel::ERROR, "Storage not provided");
-//        return 0;
-//    }
-//
-//    log::LOGGER.log(log::Logger::LogLevel::DEBUG, "Width value %u", width);
-//
-//    uint32_t numSettings = storage->getNumSettings();
-//    uint32_t sizeOfEachSetting = BMS::BQSetting::ARRAY_SIZE;
-//    uint32_t totalBytes = numSettings * sizeOfEachSetting;
-//
-//    log::LOGGER.log(log::Logger::LogLevel::DEBUG, "Number of settings: %u", numSettings);
-//    log::LOGGER.log(log::Logger::LogLevel::DEBUG, "Total bytes: %u", totalBytes);
-//
-//    return totalBytes;
-//}
-//
-///**
-// * Read a given amount of data into the buffer.
-// *
-// * NOT YET SUPPORTED.
-// *
-// * @param obj[in] CANopen stack object dictionary element (not used)
-// * @param node[in] CANopen stack node (not used)
-// * @param buf[out] The buffer to populate with data
-// * @param len[in] The amount of data to read
-// * @param priv[in] The private data (BQSettingsStorage)
-// * @return CO_ERR_NONE on success
-// */
-//static CO_ERR COBQSettingRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len, void* priv) {
-//
-//    (void) obj;
-//    (void) node;
-//    (void) buf;
-//    (void) len;
-//
-//    log::LOGGER.log(log::Logger::LogLevel::WARNING, "Read not supported for BQSettings");
-//
-//    return CO_ERR_NONE;
-//}
-//
-///**
-// * Write out the given settings. The size of the data will be provided and
-// * the buffer will contain the bytes to parse.
-// *
-// * @param obj[in] CANopen stack object dictionary element (not used)
-// * @param node[in] CANopen stack node (not used)
-// * @param buf[in] Bytes of data to read in
-// * @param len[in] The number of bytes in the buf
-// * @param priv[in] The private data (BQSettingsStorage)
-// *
-// * @return CO_ERR_NONE on success
-// */
-//static CO_ERR COBQSettingWrite(CO_OBJ* obj, CO_NODE_T* node, void* buf, uint32_t len, void* priv) {
-//
-//    log::LOGGER.log(log::Logger::LogLevel::INFO, "WRITE REQUEST MADE");
-//    log::LOGGER.log(log::Logger::LogLevel::INFO, "Bytes incoming: %u", len);
-//
-//    auto* buffer = (uint8_t*) buf;
-//
-//    if (len == 0) {
-//        return CO_ERR_NONE;
-//    }
-//
-//    auto* storage = (BMS::BQSettingsStorage*) priv;
-//    if (!storage) {
-//        log::LOGGER.log(log::Logger::LogLevel::ERROR, "Storage not provided");
-//        return CO_ERR_BAD_ARG;
-//    }
-//
-//    // Write the settings into storage
-//    // TODO: Add validation to fromArray and handle errors here
-//    BMS::BQSetting bqSetting;
-//    bqSetting.fromArray(buffer);
-//    storage->writeSetting(bqSetting);
-//
-//    return CO_ERR_NONE;
-//}
-//
-///**
-// * Internal logic to reset the read/write setup.
-// *
-// * @param obj[in] CANopen stack object dictionary element (not used)
-// * @param node[in] CANopen stack node (not used)
-// * @param func[in] The control function to execute
-// * @param para[in] Input parameter data
-// * @param priv[in] The private data (BQSettingsStorage)
-// */
-//static CO_ERR COBQSettingCtrl(CO_OBJ* obj, CO_NODE_T* node, uint16_t func, uint32_t para, void* priv) {
-//    (void) obj;
-//    (void) node;
-//    (void) para;
-//
-//    if (priv == nullptr) {
-//        return CO_ERR_NONE;
-//    }
-//
-//    auto* settingsStorage = (BMS::BQSettingsStorage*) priv;
-//
-//    // Reset the offset
-//    if (func == CO_CTRL_SET_OFF) {
-//        settingsStorage->resetEEPROMOffset();
-//
-//        // Write out the number of settings into EEPROM
-//        settingsStorage->writeNumSettings();
-//    }
-//
-//    log::LOGGER.log(log::Logger::LogLevel::INFO, "CTRL FUNCTION EXECUTED");
-//    log::LOGGER.log(log::Logger::LogLevel::INFO, "Function %u", func);
-//
-//    return CO_ERR_NONE;
-//}
+namespace log = EVT::core::log;
 
 namespace BMS {
 
-BQSettingsStorage::BQSettingsStorage(EVT::core::DEV::M24C32& eeprom, DEV::BQ76952& bq) ://canOpenInterface{
-                                                                                         //    COBQSettingSize,
-                                                                                         //    COBQSettingCtrl,
-                                                                                         //    COBQSettingRead,
-                                                                                         //    COBQSettingWrite,
-                                                                                         //    this,
-                                                                                         //},
-                                                                                         eeprom(eeprom), bq(bq) {
+static_assert(BQSetting::MAX_STREAM_SIZE <= BQSetting::ARRAY_SIZE,
+              "Settings are read into buffers of the fixed encoding size");
+
+BQSettingsStorage::BQSettingsStorage(EVT::core::DEV::M24C32& eeprom, DEV::BQ76952& bq)
+    : canOpenInterface{
+        canOpenSize,
+        canOpenCtrl,
+        canOpenRead,
+        canOpenWrite,
+    },
+      eeprom(eeprom), bq(bq) {
     startAddress = 0;
-    addressLocation = startAddress + 2;
-
-    // TODO: This assumes that the number of settings are already written into
-    // the EEPROM. This may or may not be an issue.
-    numSettings = eeprom.readHalfWord(startAddress);
+    addressLocation = startAddress + HEADER_SIZE;
+
+    // Without a valid header there are no settings to use
+    uint8_t buffer[HEADER_SIZE];
+    Header header;
+    eeprom.readBytes(startAddress, buffer, HEADER_SIZE);
+    if (headerFromArray(buffer, header)) {
+        numSettings = header.numSettings;
+        flags = header.flags;
+        imageCrc = header.imageCrc;
+        settingsSize = header.settingsSize;
+    } else {
+        log::LOGGER.log(log::Logger::LogLevel::WARNING, "No valid BQ settings header");
+        numSettings = 0;
+    }
     numSettingsWritten = numSettings;
+
+    loadImage();
+}
+
+void BQSettingsStorage::headerToArray(const Header& header, uint8_t buffer[HEADER_SIZE]) {
+    buffer[0] = SETTINGS_MAGIC & 0xFF;
+    buffer[1] = SETTINGS_MAGIC >> 8;
+    bool isStream = header.flags & FLAG_STREAM;
+    buffer[2] = isStream ? STREAM_SETTINGS_VERSION : SETTINGS_VERSION;
+    buffer[3] = header.flags;
+    buffer[4] = header.numSettings & 0xFF;
+    buffer[5] = header.numSettings >> 8;
+    buffer[6] = isStream ? header.settingsSize & 0xFF : 0;
+    buffer[7] = isStream ? header.settingsSize >> 8 : 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        buffer[8 + i] = (header.imageCrc >> (i * 8)) & 0xFF;
+    }
+
+    uint32_t headerCrc = CRC32::compute(buffer, 12);
+    for (uint8_t i = 0; i < 4; i++) {
+        buffer[12 + i] = (headerCrc >> (i * 8)) & 0xFF;
+    }
+}
+
+bool BQSettingsStorage::headerFromArray(const uint8_t buffer[HEADER_SIZE], Header& header) {
+    uint16_t magic = buffer[1] << 8 | buffer[0];
+    uint32_t headerCrc = static_cast<uint32_t>(buffer[15]) << 24
+                         | static_cast<uint32_t>(buffer[14]) << 16
+                         | static_cast<uint32_t>(buffer[13]) << 8
+                         | static_cast<uint32_t>(buffer[12]);
+
+    // Older firmware only knows the fixed encoding, and rejects the version
+    // of the stream encoding
+    bool isStream = buffer[3] & FLAG_STREAM;
+    uint8_t version = isStream ? STREAM_SETTINGS_VERSION : SETTINGS_VERSION;
+    if (magic != SETTINGS_MAGIC || buffer[2] != version
+        || headerCrc != CRC32::compute(buffer, 12)) {
+        return false;
+    }
+
+    header.flags = buffer[3];
+    header.numSettings = buffer[5] << 8 | buffer[4];
+    header.settingsSize = isStream ? buffer[7] << 8 | buffer[6] : header.numSettings * BMS::BQSetting::ARRAY_SIZE;
+    header.imageCrc = static_cast<uint32_t>(buffer[11]) << 24
+                      | static_cast<uint32_t>(buffer[10]) << 16
+                      | static_cast<uint32_t>(buffer[9]) << 8
+                      | static_cast<uint32_t>(buffer[8]);
+
+    return header.numSettings <= MAX_SETTINGS && header.settingsSize >= header.numSettings
+           && header.settingsSize <= header.numSettings * BMS::BQSetting::MAX_STREAM_SIZE;
+}
+
+uint32_t BQSettingsStorage::imageSize(const Header& header) {
+    uint32_t size = HEADER_SIZE + header.settingsSize;
+    if (header.flags & FLAG_BLOCK_CRC) {
+        size += 4 * ((header.settingsSize + CRC_BLOCK_SIZE - 1) / CRC_BLOCK_SIZE);
+    }
+    return size;
 }
 
 uint32_t BQSettingsStorage::getNumSettings() {
@@ -164,31 +104,49 @@ uint32_t BQSettingsStorage::getNumSettings() {
 
 void BQSettingsStorage::setNumSettings(uint32_t numSettings) {
     this->numSettings = numSettings;
+    cacheState = CacheState::UNLOADED;
+    isImageValid = false;
 }
 
 void BQSettingsStorage::readSetting(BQSetting& setting) {
-    uint8_t buffer[BMS::BQSetting::ARRAY_SIZE];
+    uint8_t localBuffer[BMS::BQSetting::ARRAY_SIZE] = {};
+    uint8_t* buffer = localBuffer;
+
+    // Settings in the stream encoding vary in size, read as much as the
+    // largest one
+    uint32_t offset = addressLocation - startAddress - HEADER_SIZE;
+    uint32_t length = offset < settingsSize ? settingsSize - offset : 0;
+    if (cacheState == CacheState::LOADED) {
+        buffer = &cache[offset];
+    } else {
+        eeprom.readBytes(addressLocation, buffer,
+                         length < BMS::BQSetting::ARRAY_SIZE ? length : BMS::BQSetting::ARRAY_SIZE);
+    }
 
-    eeprom.readBytes(addressLocation,
-                     buffer, BMS::BQSetting::ARRAY_SIZE);
+    uint8_t size = parseSetting(buffer, length, setting, readNextAddress);
+    if (size == 0) {
+        setting = BQSetting();
+    }
 
+    // Only the bytes of this setting are logged, the last setting in the
+    // cache can end before a whole array
+    uint8_t parsed[BMS::BQSetting::ARRAY_SIZE] = {};
+    memcpy(parsed, buffer, size);
     log::LOGGER.log(log::Logger::LogLevel::DEBUG,
                     "Address Location: %u", addressLocation);
     log::LOGGER.log(log::Logger::LogLevel::DEBUG,
-                    "{ 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x }",
-                    buffer[0], buffer[1], buffer[2], buffer[3], buffer[4], buffer[5],
-                    buffer[6]);
-
-    setting.fromArray(buffer);
+                    "%u bytes: { 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x }",
+                    size, parsed[0], parsed[1], parsed[2], parsed[3], parsed[4], parsed[5],
+                    parsed[6]);
 
     // Increment where to read from next
-    addressLocation += BMS::BQSetting::ARRAY_SIZE;
+    addressLocation += size;
 }
 
 void BQSettingsStorage::writeSetting(BQSetting& setting) {
     // Create array for storing the data
-    uint8_t buffer[BMS::BQSetting::ARRAY_SIZE];
-    setting.toArray(buffer);
+    uint8_t buffer[BMS::BQSetting::ARRAY_SIZE] = {};
+    uint8_t size = setting.toStream(buffer, writeNextAddress);
 
     log::LOGGER.log(log::Logger::LogLevel::DEBUG,
                     "{ 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x }",
@@ -197,34 +155,363 @@ void BQSettingsStorage::writeSetting(BQSetting& setting) {
 
     log::LOGGER.log(log::Logger::LogLevel::DEBUG, "Writing to address: 0x%02x",
                     addressLocation);
-    // Write the array of data into the EEPROM
-    eeprom.writeBytes(addressLocation,
-                      buffer, BMS::BQSetting::ARRAY_SIZE);
-
-    // Increment where to write to next
-    addressLocation += BMS::BQSetting::ARRAY_SIZE;
+    // Buffer the data, it is written into the EEPROM a page at a time
+    bufferImage(buffer, size);
 
     // Increment the number of settings that have been written
     numSettingsWritten += 1;
+    writeCrc = CRC32::update(writeCrc, buffer, size);
+
+    // Once every setting is written, commit the header and check the new image
+    if (numSettingsWritten == numSettings) {
+        Header header = {
+            .numSettings = numSettings,
+            .flags = FLAG_STREAM,
+            .imageCrc = CRC32::finalize(writeCrc),
+            .settingsSize = static_cast<uint16_t>(addressLocation - startAddress - HEADER_SIZE),
+        };
+        commitImage(header);
+    }
 }
 
 void BQSettingsStorage::writeNumSettings() {
-    eeprom.writeHalfWord(startAddress, numSettings);
+    // Clear the magic number so a partially written image is never used, the
+    // header is written once all settings have been written
+    eeprom.writeHalfWord(startAddress, 0);
+    cacheState = CacheState::UNLOADED;
+    isImageValid = false;
+    hasAppliedCrc = false;
 
     // Once the total number of settings have been updated, assume none
     // have yet been written.
     numSettingsWritten = 0;
+    writeCrc = CRC32::INITIAL;
+    writeNextAddress = 0;
+    pageFill = 0;
+}
+
+void BQSettingsStorage::startDownload() {
+    // Nothing is stored until the header comes in
+    numSettings = 0;
+    resetEEPROMOffset();
+    writeNumSettings();
+
+    downloadOffset = 0;
+    downloadSize = 0;
+    downloadFailed = false;
+    downloadComplete = false;
+}
+
+bool BQSettingsStorage::downloadBytes(const uint8_t* bytes, uint32_t numBytes) {
+    if (downloadFailed) {
+        return false;
+    }
+
+    // The header is held back until the image is complete
+    while (numBytes > 0 && downloadOffset < HEADER_SIZE) {
+        downloadHeader[downloadOffset++] = *bytes++;
+        numBytes--;
+    }
+    if (downloadOffset < HEADER_SIZE) {
+        return true;
+    }
+
+    if (downloadSize == 0) {
+        if (!headerFromArray(downloadHeader, downloadedHeader) || downloadedHeader.numSettings == 0) {
+            return failDownload("Invalid BQ settings image header");
+        }
+        downloadSize = imageSize(downloadedHeader);
+    }
+    const Header& header = downloadedHeader;
+
+    if (downloadOffset + numBytes > downloadSize) {
+        return failDownload("BQ settings image longer than its header");
+    }
+
+    // The image CRC covers the settings, not the block CRCs after them
+    uint32_t settingsEnd = HEADER_SIZE + header.settingsSize;
+    if (downloadOffset < settingsEnd) {
+        uint32_t numSettingBytes = settingsEnd - downloadOffset < numBytes ? settingsEnd - downloadOffset : numBytes;
+        writeCrc = CRC32::update(writeCrc, bytes, numSettingBytes);
+    }
+    bufferImage(bytes, numBytes);
+    downloadOffset += numBytes;
+
+    if (downloadOffset < downloadSize) {
+        return true;
+    }
+
+    if (CRC32::finalize(writeCrc) != header.imageCrc) {
+        return failDownload("BQ settings image CRC mismatch");
+    }
+    if (!commitImage(header)) {
+        return failDownload("BQ settings image failed validation");
+    }
+
+    log::LOGGER.log(log::Logger::LogLevel::INFO, "BQ settings image stored, %u settings", numSettings);
+    downloadComplete = true;
+    return true;
+}
+
+bool BQSettingsStorage::isDownloadComplete() {
+    return downloadComplete;
+}
+
+void BQSettingsStorage::setI2CQueue(I2CTransactionQueue& queue) {
+    i2cQueue = &queue;
 }
 
 void BQSettingsStorage::resetEEPROMOffset() {
-    // Update the start address, +2 for the two bytes to store the number of
-    // settings
-    addressLocation = startAddress + 2;
+    // Settings start after the header
+    addressLocation = startAddress + HEADER_SIZE;
+    readNextAddress = 0;
+}
+
+EVT::core::DEV::M24C32& BQSettingsStorage::getEEPROM() {
+    return eeprom;
 }
 
 void BQSettingsStorage::resetTransfer() {
     numSettingsTransferred = 0;
+    hasPendingSetting = false;
+    hasAppliedCrc = false;
+    resetEEPROMOffset();
+}
+
+bool BQSettingsStorage::loadImage() {
+    cacheState = CacheState::UNLOADED;
+    isImageValid = false;
+    if (numSettings == 0) {
+        return false;
+    }
+
+    uint32_t imageSize = settingsSize;
+    if (imageSize <= sizeof(cache)) {
+        readImage(0, cache, imageSize);
+        cacheState = CacheState::LOADED;
+    }
+
+    if (computeImageCrc(0, imageSize) != imageCrc) {
+        log::LOGGER.log(log::Logger::LogLevel::ERROR, "BQ settings image CRC mismatch");
+        if (flags & FLAG_BLOCK_CRC) {
+            logBadBlock();
+        }
+        cacheState = CacheState::UNLOADED;
+        return false;
+    }
+
+    // The CRC only shows the image is what was uploaded, also check every
+    // cached setting can be transferred
+    if (cacheState == CacheState::LOADED) {
+        BQSetting setting;
+        uint16_t nextAddress = 0;
+        uint16_t index = 0;
+        for (uint32_t offset = 0; offset < imageSize; index++) {
+            uint8_t size = parseSetting(&cache[offset], imageSize - offset, setting, nextAddress);
+            if (size == 0 || setting.getSettingType() == BQSetting::BQSettingType::UNINITIALIZED
+                || setting.getNumBytes() > 4) {
+                log::LOGGER.log(log::Logger::LogLevel::ERROR,
+                                "Invalid setting stored at index: %u", index);
+                cacheState = CacheState::UNLOADED;
+                return false;
+            }
+            offset += size;
+        }
+
+        if (index != numSettings) {
+            log::LOGGER.log(log::Logger::LogLevel::ERROR,
+                            "BQ settings image holds %u settings, header has %u", index, numSettings);
+            cacheState = CacheState::UNLOADED;
+            return false;
+        }
+    }
+
+    isImageValid = true;
+    return true;
+}
+
+uint8_t BQSettingsStorage::parseSetting(const uint8_t* buffer, uint32_t length, BQSetting& setting,
+                                        uint16_t& nextAddress) {
+    if (flags & FLAG_STREAM) {
+        return setting.fromStream(buffer, length, nextAddress);
+    }
+
+    if (length < BMS::BQSetting::ARRAY_SIZE) {
+        return 0;
+    }
+    setting.fromArray(buffer);
+    return BMS::BQSetting::ARRAY_SIZE;
+}
+
+void BQSettingsStorage::readImage(uint32_t offset, uint8_t* buffer, uint32_t numBytes) {
+    if (cacheState == CacheState::LOADED) {
+        memcpy(buffer, &cache[offset], numBytes);
+        return;
+    }
+
+    // Burst read up to each page boundary, the first read may be partial as
+    // the image starts after the header
+    uint32_t address = startAddress + HEADER_SIZE + offset;
+    while (numBytes > 0) {
+        uint32_t chunk = EEPROM_PAGE_SIZE - (address % EEPROM_PAGE_SIZE);
+        if (chunk > numBytes) {
+            chunk = numBytes;
+        }
+
+        eeprom.readBytes(address, buffer, chunk);
+        address += chunk;
+        buffer += chunk;
+        numBytes -= chunk;
+    }
+}
+
+uint32_t BQSettingsStorage::computeImageCrc(uint32_t offset, uint32_t numBytes) {
+    if (cacheState == CacheState::LOADED) {
+        return CRC32::compute(&cache[offset], numBytes);
+    }
+
+    uint8_t buffer[EEPROM_PAGE_SIZE];
+    uint32_t crc = CRC32::INITIAL;
+    while (numBytes > 0) {
+        uint32_t chunk = numBytes > EEPROM_PAGE_SIZE ? EEPROM_PAGE_SIZE : numBytes;
+        readImage(offset, buffer, chunk);
+        crc = CRC32::update(crc, buffer, chunk);
+        offset += chunk;
+        numBytes -= chunk;
+    }
+    return CRC32::finalize(crc);
+}
+
+void BQSettingsStorage::logBadBlock() {
+    uint32_t imageSize = settingsSize;
+    uint32_t crcAddress = startAddress + HEADER_SIZE + imageSize;
+    for (uint32_t offset = 0; offset < imageSize; offset += CRC_BLOCK_SIZE) {
+        uint8_t buffer[4];
+        eeprom.readBytes(crcAddress, buffer, 4);
+        crcAddress += 4;
+
+        uint32_t blockCrc = static_cast<uint32_t>(buffer[3]) << 24
+                            | static_cast<uint32_t>(buffer[2]) << 16
+                            | static_cast<uint32_t>(buffer[1]) << 8
+                            | static_cast<uint32_t>(buffer[0]);
+        uint32_t numBytes = imageSize - offset > CRC_BLOCK_SIZE ? CRC_BLOCK_SIZE : imageSize - offset;
+        if (computeImageCrc(offset, numBytes) != blockCrc) {
+            // Settings in the stream encoding vary in size, so the block is
+            // given in bytes of the settings
+            log::LOGGER.log(log::Logger::LogLevel::ERROR,
+                            "BQ settings block CRC mismatch, bytes %u to %u",
+                            offset, offset + numBytes - 1);
+            return;
+        }
+    }
+}
+
+void BQSettingsStorage::bufferImage(const uint8_t* bytes, uint32_t numBytes) {
+    while (numBytes > 0) {
+        uint32_t pageOffset = addressLocation % EEPROM_PAGE_SIZE;
+        uint32_t chunk = EEPROM_PAGE_SIZE - pageOffset;
+        if (chunk > numBytes) {
+            chunk = numBytes;
+        }
+
+        memcpy(&pageBuffer[pageOffset], bytes, chunk);
+        addressLocation += chunk;
+        pageFill += chunk;
+        bytes += chunk;
+        numBytes -= chunk;
+
+        if (addressLocation % EEPROM_PAGE_SIZE == 0) {
+            flushPage();
+        }
+    }
+}
+
+void BQSettingsStorage::flushPage() {
+    if (pageFill == 0) {
+        return;
+    }
+
+    // A single write, the buffered bytes never cross a page boundary
+    uint32_t address = addressLocation - pageFill;
+    eeprom.writeBytes(address, &pageBuffer[address % EEPROM_PAGE_SIZE], pageFill);
+    pageFill = 0;
+}
+
+bool BQSettingsStorage::commitImage(const Header& header) {
+    flushPage();
+
+    uint8_t headerBuffer[HEADER_SIZE];
+    headerToArray(header, headerBuffer);
+    eeprom.writeBytes(startAddress, headerBuffer, HEADER_SIZE);
+
+    numSettings = header.numSettings;
+    numSettingsWritten = numSettings;
+    flags = header.flags;
+    imageCrc = header.imageCrc;
+    settingsSize = header.settingsSize;
     resetEEPROMOffset();
+    return loadImage();
+}
+
+bool BQSettingsStorage::failDownload(const char* reason) {
+    log::LOGGER.log(log::Logger::LogLevel::ERROR, "%s", reason);
+    downloadFailed = true;
+    return false;
+}
+
+uint32_t BQSettingsStorage::canOpenSize(CO_OBJ_T* obj, CO_NODE_T* node, uint32_t width) {
+    (void) obj;
+    (void) node;
+
+    // Any image up to the largest one fits, its size is only known once its
+    // header has come in
+    if (width == 0 || width > MAX_IMAGE_SIZE) {
+        return MAX_IMAGE_SIZE;
+    }
+    return width;
+}
+
+CO_ERR BQSettingsStorage::canOpenCtrl(CO_OBJ_T* obj, CO_NODE_T* node, uint16_t func, uint32_t para) {
+    (void) node;
+
+    // The offset is set again ahead of later segments, only the one at the
+    // start of a transfer starts a new download
+    if (func == CO_CTRL_SET_OFF && para == 0) {
+        auto* storage = (BQSettingsStorage*) obj->Data;
+        if (storage->i2cQueue != nullptr) {
+            storage->i2cQueue->acquireBus();
+        }
+        storage->startDownload();
+        if (storage->i2cQueue != nullptr) {
+            storage->i2cQueue->releaseBus();
+        }
+    }
+    return CO_ERR_NONE;
+}
+
+CO_ERR BQSettingsStorage::canOpenRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len) {
+    (void) obj;
+    (void) node;
+    (void) buf;
+    (void) len;
+
+    log::LOGGER.log(log::Logger::LogLevel::WARNING, "Read not supported for BQSettings");
+    return CO_ERR_OBJ_READ;
+}
+
+CO_ERR BQSettingsStorage::canOpenWrite(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len) {
+    (void) node;
+
+    auto* storage = (BQSettingsStorage*) obj->Data;
+    if (storage->i2cQueue != nullptr) {
+        storage->i2cQueue->acquireBus();
+    }
+    bool accepted = storage->downloadBytes(static_cast<const uint8_t*>(buf), len);
+    if (storage->i2cQueue != nullptr) {
+        storage->i2cQueue->releaseBus();
+    }
+
+    return accepted ? CO_ERR_NONE : CO_ERR_OBJ_WRITE;
 }
 
 BMS::DEV::BQ76952::Status BQSettingsStorage::transferSetting(bool& isComplete) {
@@ -234,6 +521,11 @@ BMS::DEV::BQ76952::Status BQSettingsStorage::transferSetting(bool& isComplete) {
         return BMS::DEV::BQ76952::Status::OK;
     }
 
+    if (!isImageValid) {
+        isComplete = false;
+        return BMS::DEV::BQ76952::Status::ERROR;
+    }
+
     if (numSettingsTransferred == 0) {
         bq.enterConfigUpdateMode();
     }
@@ -263,6 +555,99 @@ BMS::DEV::BQ76952::Status BQSettingsStorage::transferSetting(bool& isComplete) {
     // Exit the config update mode if need be
     if (isComplete) {
         bq.exitConfigUpdateMode();
+        appliedCrc = imageCrc;
+        hasAppliedCrc = true;
+    }
+    return BMS::DEV::BQ76952::Status::OK;
+}
+
+BMS::DEV::BQ76952::Status BQSettingsStorage::transferBlock(bool& isComplete) {
+    // If all settings have already been transferred, do nothing
+    if (numSettingsTransferred == numSettings) {
+        isComplete = true;
+        return BMS::DEV::BQ76952::Status::OK;
+    }
+
+    if (!isImageValid) {
+        isComplete = false;
+        return BMS::DEV::BQ76952::Status::ERROR;
+    }
+
+    if (numSettingsTransferred == 0) {
+        bq.enterConfigUpdateMode();
+    }
+
+    // Coalesce settings into a block until the next one is not contiguous
+    // or would not fit
+    uint8_t block[DEV::BQ76952::MAX_RAM_BLOCK_SIZE];
+    uint16_t blockAddress = 0;
+    uint8_t blockSize = 0;
+    uint16_t numInBlock = 0;
+    while (numSettingsTransferred + numInBlock < numSettings) {
+        if (!hasPendingSetting) {
+            readSetting(pendingSetting);
+            hasPendingSetting = true;
+        }
+
+        uint8_t numBytes = pendingSetting.getNumBytes();
+
+        // Only RAM settings can be written as a block
+        if (pendingSetting.getSettingType() != BQSetting::BQSettingType::RAM) {
+            if (numInBlock > 0) {
+                break;
+            }
+
+            isComplete = false;
+            log::LOGGER.log(log::Logger::LogLevel::ERROR,
+                            "Setting type is incorrect, address: 0x%04x",
+                            pendingSetting.getAddress());
+            bq.exitConfigUpdateMode();
+            return BMS::DEV::BQ76952::Status::ERROR;
+        }
+
+        if (numInBlock > 0
+            && (pendingSetting.getAddress() != blockAddress + blockSize
+                || blockSize + numBytes > DEV::BQ76952::MAX_RAM_BLOCK_SIZE)) {
+            break;
+        }
+
+        if (numInBlock == 0) {
+            blockAddress = pendingSetting.getAddress();
+        }
+
+        // Data is stored little endian in the BQ
+        uint32_t data = pendingSetting.getData();
+        for (uint8_t i = 0; i < numBytes; i++) {
+            block[blockSize + i] = (data >> (i * 8)) & 0xFF;
+        }
+        blockSize += numBytes;
+        numInBlock++;
+        hasPendingSetting = false;
+    }
+
+    BMS::DEV::BQ76952::Status status = bq.writeRAMBlock(blockAddress, block, blockSize);
+
+    // Make sure the status was ok
+    if (status != BMS::DEV::BQ76952::Status::OK) {
+        isComplete = false;
+
+        log::LOGGER.log(log::Logger::LogLevel::ERROR,
+                        "Failed with block address: 0x%04x, size: %u",
+                        blockAddress, blockSize);
+
+        bq.exitConfigUpdateMode();
+        return status;
+    }
+
+    numSettingsTransferred += numInBlock;
+    // If the status was ok, update complete flag
+    isComplete = numSettingsTransferred == numSettings;
+
+    // Exit the config update mode if need be
+    if (isComplete) {
+        bq.exitConfigUpdateMode();
+        appliedCrc = imageCrc;
+        hasAppliedCrc = true;
     }
     return BMS::DEV::BQ76952::Status::OK;
 }
@@ -270,7 +655,54 @@ BMS::DEV::BQ76952::Status BQSettingsStorage::transferSetting(bool& isComplete) {
 bool BQSettingsStorage::hasSettings() {
     // Make sure we have settings, and the total number of settings
     // written equals the total expected number of settings
-    return numSettings > 0 && numSettingsWritten == numSettings;
+    return numSettings > 0 && numSettingsWritten == numSettings && isImageValid;
+}
+
+bool BQSettingsStorage::isAppliedToBQ() {
+    if (!hasAppliedCrc || !hasSettings() || imageCrc != appliedCrc) {
+        return false;
+    }
+
+    // The BQ may have been reset on its own, or be mid configuration
+    bool isInConfigMode = true;
+    if (bq.inConfigMode(&isInConfigMode) != DEV::BQ76952::Status::OK || isInConfigMode) {
+        return false;
+    }
+
+    // Compare a sample of settings spread across the image with the BQ
+    uint16_t step = numSettings / SIGNATURE_SAMPLES;
+    if (step == 0) {
+        step = 1;
+    }
+
+    // Settings in the stream encoding can only be read in order, the
+    // settings in between come from the cache
+    BQSetting setting;
+    resetEEPROMOffset();
+    for (uint16_t i = 0; i < numSettings; i++) {
+        readSetting(setting);
+
+        if (i % step != 0 || setting.getSettingType() != BQSetting::BQSettingType::RAM) {
+            continue;
+        }
+
+        uint32_t readData;
+        if (bq.makeRAMRead(setting.getAddress(), &readData) != DEV::BQ76952::Status::OK) {
+            resetEEPROMOffset();
+            return false;
+        }
+
+        uint32_t mask = setting.getNumBytes() >= 4 ? 0xFFFFFFFF : (1u << (setting.getNumBytes() * 8)) - 1;
+        if ((readData & mask) != setting.getData()) {
+            log::LOGGER.log(log::Logger::LogLevel::INFO,
+                            "BQ setting differs at address: 0x%04x", setting.getAddress());
+            resetEEPROMOffset();
+            return false;
+        }
+    }
+
+    resetEEPROMOffset();
+    return true;
 }
 
 }// namespace BMS
@@ -0,0 +1,71 @@
+#include <BalancingController.hpp>
+
+namespace BMS {
+
+namespace {
+
+/** Cells taking their turn, bit N for cell N + 1 */
+constexpr uint16_t EVEN_CELLS = 0x0555;
+constexpr uint16_t ODD_CELLS = 0x0AAA;
+
+}// namespace
+
+uint16_t BalancingController::update(const uint16_t cellVoltage[NUM_CELLS], uint8_t packTemp, uint8_t bqTemp) {
+    uint16_t minVoltage = cellVoltage[0];
+    for (uint8_t i = 1; i < NUM_CELLS; i++) {
+        if (cellVoltage[i] < minVoltage) {
+            minVoltage = cellVoltage[i];
+        }
+    }
+
+    if (minVoltage < MIN_CELL_VOLTAGE || packTemp >= MAX_PACK_TEMP || bqTemp >= MAX_BQ_TEMP) {
+        reset();
+        return 0;
+    }
+
+    // Hysteresis, a cell which is being balanced carries on down to the
+    // stop threshold
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        uint16_t aboveMin = cellVoltage[i] - minVoltage;
+        uint16_t bit = 1 << i;
+        if (aboveMin > START_THRESHOLD) {
+            unbalancedCells |= bit;
+        } else if (aboveMin <= STOP_THRESHOLD) {
+            unbalancedCells &= ~bit;
+        }
+    }
+
+    uint8_t maxCells = MAX_BALANCING_CELLS;
+    if (packTemp + TEMP_DERATE_MARGIN >= MAX_PACK_TEMP || bqTemp + TEMP_DERATE_MARGIN >= MAX_BQ_TEMP) {
+        maxCells /= 2;
+    }
+
+    uint16_t candidates = unbalancedCells & (oddTurn ? ODD_CELLS : EVEN_CELLS);
+    oddTurn = !oddTurn;
+
+    // Highest cells first
+    uint16_t mask = 0;
+    for (uint8_t count = 0; count < maxCells && candidates; count++) {
+        uint8_t highest = 0;
+        for (uint8_t i = 0; i < NUM_CELLS; i++) {
+            if ((candidates & (1 << i)) && (!(candidates & (1 << highest)) || cellVoltage[i] > cellVoltage[highest])) {
+                highest = i;
+            }
+        }
+        candidates &= ~(1 << highest);
+        mask |= 1 << highest;
+    }
+
+    return mask;
+}
+
+void BalancingController::reset() {
+    unbalancedCells = 0;
+    oddTurn = false;
+}
+
+uint16_t BalancingController::getUnbalancedCells() const {
+    return unbalancedCells;
+}
+
+}// namespace BMS
@@ -0,0 +1,49 @@
+#include <CANDispatcher.hpp>
+
+namespace IO = EVT::core::IO;
+
+namespace BMS {
+
+bool CANDispatcher::addHandler(uint16_t id, Handler handler, void* priv) {
+    if (numHandlers >= MAX_HANDLERS || id > EXACT_MATCH_MASK) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < numHandlers; i++) {
+        if (entries[i].id == id) {
+            return false;
+        }
+    }
+
+    entries[numHandlers++] = {
+        .id = id,
+        .handler = handler,
+        .priv = priv,
+    };
+    return true;
+}
+
+bool CANDispatcher::dispatch(IO::CANMessage& message) {
+    if (message.isCANExtended()) {
+        return false;
+    }
+
+    uint32_t id = message.getId();
+    for (uint8_t i = 0; i < numHandlers; i++) {
+        if (entries[i].id == id) {
+            entries[i].handler(message, entries[i].priv);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t CANDispatcher::getNumHandlers() {
+    return numHandlers;
+}
+
+uint16_t CANDispatcher::getId(uint8_t index) {
+    return entries[index].id;
+}
+
+}// namespace BMS
@@ -0,0 +1,26 @@
+#include <CRC32.hpp>
+
+namespace BMS {
+
+/** CRC of each nibble value, for the reflected polynomial 0xEDB88320 */
+static constexpr uint32_t NIBBLE_TABLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t CRC32::update(uint32_t crc, const uint8_t* data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ NIBBLE_TABLE[crc & 0x0F];
+        crc = (crc >> 4) ^ NIBBLE_TABLE[crc & 0x0F];
+    }
+    return crc;
+}
+
+uint32_t CRC32::compute(const uint8_t* data, uint32_t length) {
+    return finalize(update(INITIAL, data, length));
+}
+
+}// namespace BMS
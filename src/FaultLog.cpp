@@ -0,0 +1,228 @@
+#include <FaultLog.hpp>
+
+#include <cstring>
+
+#include <EVT/utils/log.hpp>
+
+#include <BQSettingStorage.hpp>
+#include <CRC32.hpp>
+#include <SocEstimator.hpp>
+
+namespace log = EVT::core::log;
+
+namespace BMS {
+
+static_assert(FaultLog::EEPROM_ADDRESS % FaultLog::RECORD_SIZE == 0,
+              "Fault log slots have to be page aligned");
+static_assert(FaultLog::EEPROM_ADDRESS >= BQSettingsStorage::HEADER_SIZE
+                                              + BQSettingsStorage::MAX_SETTINGS * BQSetting::ARRAY_SIZE
+                                              + BQSettingsStorage::MAX_SETTINGS / BQSettingsStorage::CRC_BLOCK_SETTINGS * 4,
+              "Fault log overlaps the BQ settings");
+static_assert(FaultLog::EEPROM_ADDRESS + FaultLog::NUM_RECORDS * FaultLog::RECORD_SIZE
+                  <= SocEstimator::EEPROM_ADDRESS,
+              "Fault log overlaps the SOC record");
+
+namespace {
+
+/** Number of bytes covered by the CRC */
+constexpr uint8_t CRC_OFFSET = FaultLog::RECORD_SIZE - 4;
+
+void putU16(uint8_t* buffer, uint16_t value) {
+    buffer[0] = value & 0xFF;
+    buffer[1] = value >> 8;
+}
+
+void putU32(uint8_t* buffer, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) {
+        buffer[i] = (value >> (i * 8)) & 0xFF;
+    }
+}
+
+uint32_t getU32(const uint8_t* buffer) {
+    return static_cast<uint32_t>(buffer[3]) << 24 | static_cast<uint32_t>(buffer[2]) << 16
+           | static_cast<uint32_t>(buffer[1]) << 8 | static_cast<uint32_t>(buffer[0]);
+}
+
+}// namespace
+
+FaultLog::FaultLog(EVT::core::DEV::M24C32& eeprom, I2CTransactionQueue& i2cQueue)
+    : canOpenInterface{
+        canOpenSize,
+        canOpenCtrl,
+        canOpenRead,
+        canOpenWrite,
+    },
+      eeprom(eeprom), i2cQueue(i2cQueue) {}
+
+void FaultLog::load() {
+    // Only the sequence numbers are read up front, a full record is only
+    // read to check the CRC of the newest one
+    i2cQueue.acquireBus();
+    for (uint8_t slot = 0; slot < NUM_RECORDS; slot++) {
+        uint8_t sequence[4];
+        eeprom.readBytes(EEPROM_ADDRESS + slot * RECORD_SIZE, sequence, 4);
+        slotSequence[slot] = getU32(sequence);
+    }
+
+    head = 0;
+    nextSequence = 0;
+    while (true) {
+        uint8_t newest = NUM_RECORDS;
+        for (uint8_t slot = 0; slot < NUM_RECORDS; slot++) {
+            if (slotSequence[slot] != EMPTY_SEQUENCE
+                && (newest == NUM_RECORDS || slotSequence[slot] > slotSequence[newest])) {
+                newest = slot;
+            }
+        }
+        if (newest == NUM_RECORDS) {
+            break;
+        }
+
+        // A write cut short by a power loss leaves a record with a bad CRC
+        uint8_t buffer[RECORD_SIZE];
+        if (readSlot(newest, buffer)) {
+            head = (newest + 1) % NUM_RECORDS;
+            nextSequence = slotSequence[newest] + 1;
+            break;
+        }
+        slotSequence[newest] = EMPTY_SEQUENCE;
+    }
+    i2cQueue.releaseBus();
+
+    log::LOGGER.log(log::Logger::LogLevel::INFO, "Fault log: %u events", nextSequence);
+}
+
+void FaultLog::append(const Record& record) {
+    uint8_t buffer[RECORD_SIZE];
+    recordToArray(record, nextSequence, buffer);
+
+    i2cQueue.acquireBus();
+    eeprom.writeBytes(EEPROM_ADDRESS + head * RECORD_SIZE, buffer, RECORD_SIZE);
+    i2cQueue.releaseBus();
+
+    slotSequence[head] = nextSequence;
+    head = (head + 1) % NUM_RECORDS;
+    nextSequence++;
+
+    // The slot may have been read for a download before it was overwritten
+    bufferedSlot = NUM_RECORDS;
+}
+
+const uint32_t* FaultLog::getNumAppended() const {
+    return &nextSequence;
+}
+
+void FaultLog::recordToArray(const Record& record, uint32_t sequence, uint8_t buffer[RECORD_SIZE]) {
+    putU32(&buffer[0], sequence);
+    putU32(&buffer[4], record.time);
+    buffer[8] = record.state;
+    buffer[9] = record.errorRegister;
+    memcpy(&buffer[10], record.bqStatus, sizeof(record.bqStatus));
+    putU16(&buffer[17], record.voltageInfo.minCellVoltage);
+    buffer[19] = record.voltageInfo.minCellVoltageId;
+    putU16(&buffer[20], record.voltageInfo.maxCellVoltage);
+    buffer[22] = record.voltageInfo.maxCellVoltageId;
+    putU16(&buffer[23], static_cast<uint16_t>(record.current));
+    buffer[25] = record.maxPackTemp;
+    buffer[26] = record.maxPackTempId;
+    buffer[27] = 0;
+    putU32(&buffer[CRC_OFFSET], CRC32::compute(buffer, CRC_OFFSET));
+}
+
+bool FaultLog::readSlot(uint8_t slot, uint8_t buffer[RECORD_SIZE]) {
+    eeprom.readBytes(EEPROM_ADDRESS + slot * RECORD_SIZE, buffer, RECORD_SIZE);
+    return getU32(buffer) == slotSequence[slot]
+           && getU32(&buffer[CRC_OFFSET]) == CRC32::compute(buffer, CRC_OFFSET);
+}
+
+uint32_t FaultLog::startDownload() {
+    // Slots are written in order, so walking the ring from the head gives
+    // the records oldest first. Damaged slots are left out.
+    numDownloadSlots = 0;
+    bufferedSlot = NUM_RECORDS;
+
+    i2cQueue.acquireBus();
+    for (uint8_t i = 0; i < NUM_RECORDS; i++) {
+        uint8_t slot = (head + i) % NUM_RECORDS;
+        if (slotSequence[slot] == EMPTY_SEQUENCE) {
+            continue;
+        }
+        if (readSlot(slot, readBuffer)) {
+            downloadSlots[numDownloadSlots++] = slot;
+            bufferedSlot = slot;
+        } else {
+            slotSequence[slot] = EMPTY_SEQUENCE;
+            bufferedSlot = NUM_RECORDS;
+        }
+    }
+    i2cQueue.releaseBus();
+
+    return numDownloadSlots * RECORD_SIZE;
+}
+
+uint32_t FaultLog::canOpenSize(CO_OBJ_T* obj, CO_NODE_T* node, uint32_t width) {
+    (void) node;
+    (void) width;
+
+    // The stack gets the size at the start of every upload, which is when
+    // the records in the download are picked
+    auto* faultLog = (FaultLog*) obj->Data;
+    return faultLog->startDownload();
+}
+
+CO_ERR FaultLog::canOpenCtrl(CO_OBJ_T* obj, CO_NODE_T* node, uint16_t func, uint32_t para) {
+    (void) node;
+
+    auto* faultLog = (FaultLog*) obj->Data;
+    if (func == CO_CTRL_SET_OFF) {
+        faultLog->readOffset = para;
+    }
+    return CO_ERR_NONE;
+}
+
+CO_ERR FaultLog::canOpenRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len) {
+    (void) node;
+
+    auto* faultLog = (FaultLog*) obj->Data;
+    auto* bytes = (uint8_t*) buf;
+
+    // Segments are smaller than a record, so the record a segment starts in
+    // is kept to serve the next segments from RAM
+    while (len > 0) {
+        uint8_t index = faultLog->readOffset / RECORD_SIZE;
+        uint8_t offset = faultLog->readOffset % RECORD_SIZE;
+        if (index >= faultLog->numDownloadSlots) {
+            break;
+        }
+
+        uint8_t slot = faultLog->downloadSlots[index];
+        if (slot != faultLog->bufferedSlot) {
+            faultLog->i2cQueue.acquireBus();
+            faultLog->eeprom.readBytes(EEPROM_ADDRESS + slot * RECORD_SIZE, faultLog->readBuffer, RECORD_SIZE);
+            faultLog->i2cQueue.releaseBus();
+            faultLog->bufferedSlot = slot;
+        }
+
+        uint32_t count = RECORD_SIZE - offset;
+        if (count > len) {
+            count = len;
+        }
+        memcpy(bytes, &faultLog->readBuffer[offset], count);
+        bytes += count;
+        len -= count;
+        faultLog->readOffset += count;
+    }
+    return CO_ERR_NONE;
+}
+
+CO_ERR FaultLog::canOpenWrite(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len) {
+    (void) obj;
+    (void) node;
+    (void) buf;
+    (void) len;
+
+    // The journal is only written by the BMS itself
+    return CO_ERR_OBJ_WRITE;
+}
+
+}// namespace BMS
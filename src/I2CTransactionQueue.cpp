@@ -0,0 +1,220 @@
+#include <I2CTransactionQueue.hpp>
+
+namespace IO = EVT::core::IO;
+
+namespace BMS {
+
+void I2CTransactionQueue::Bus::complete(Status status) {
+    if (queue != nullptr) {
+        queue->transferComplete(status);
+    }
+}
+
+I2CTransactionQueue::BlockingBus::BlockingBus(IO::I2C& i2c) : i2c(i2c) {}
+
+void I2CTransactionQueue::BlockingBus::startTransfer(uint8_t addr, const Transfer& transfer) {
+    IO::I2C::I2CStatus i2cStatus;
+    if (transfer.type == Transfer::Type::READ) {
+        i2cStatus = i2c.readMemReg(addr, transfer.reg, transfer.bytes, transfer.length, 1);
+    } else {
+        uint8_t reg = transfer.reg;
+        i2cStatus = i2c.writeReg(addr, &reg, 1, transfer.bytes, transfer.length);
+    }
+
+    complete(i2cStatus == IO::I2C::I2CStatus::OK ? Status::OK : Status::ERROR);
+}
+
+void I2CTransactionQueue::BlockingBus::waitTransfer() {
+    // Every transfer completes before startTransfer() returns
+}
+
+void I2CTransactionQueue::Transaction::reset(uint8_t addr) {
+    this->addr = addr;
+    numTransfers = 0;
+    currentTransfer = 0;
+    status = Status::OK;
+}
+
+bool I2CTransactionQueue::Transaction::addWrite(uint8_t reg, uint8_t* bytes, uint8_t length) {
+    return add(Transfer::Type::WRITE, reg, bytes, length);
+}
+
+bool I2CTransactionQueue::Transaction::addRead(uint8_t reg, uint8_t* bytes, uint8_t length) {
+    return add(Transfer::Type::READ, reg, bytes, length);
+}
+
+I2CTransactionQueue::Status I2CTransactionQueue::Transaction::getStatus() const {
+    return status;
+}
+
+bool I2CTransactionQueue::Transaction::add(Transfer::Type type, uint8_t reg, uint8_t* bytes,
+                                           uint8_t length) {
+    if (numTransfers >= MAX_TRANSFERS) {
+        return false;
+    }
+
+    transfers[numTransfers++] = {
+        .type = type,
+        .reg = reg,
+        .bytes = bytes,
+        .length = length,
+    };
+    return true;
+}
+
+I2CTransactionQueue::I2CTransactionQueue(Bus& bus) : bus(bus) {
+    bus.queue = this;
+}
+
+I2CTransactionQueue::Status I2CTransactionQueue::submit(Transaction& transaction, Callback callback,
+                                                        void* priv) {
+    uint8_t submitted = numSubmitted.load(std::memory_order_relaxed);
+    if (static_cast<uint8_t>(submitted - numCollected.load(std::memory_order_relaxed)) >= MAX_TRANSACTIONS) {
+        return Status::FULL;
+    }
+
+    transaction.currentTransfer = 0;
+    transaction.status = Status::PENDING;
+    transaction.callback = callback;
+    transaction.priv = priv;
+
+    transactions[submitted % MAX_TRANSACTIONS] = &transaction;
+    numSubmitted.store(submitted + 1, std::memory_order_release);
+
+    kick();
+    return Status::PENDING;
+}
+
+void I2CTransactionQueue::process() {
+    uint8_t collected = numCollected.load(std::memory_order_relaxed);
+    while (collected != numCompleted.load(std::memory_order_acquire)) {
+        Transaction& transaction = *transactions[collected % MAX_TRANSACTIONS];
+        Status status = transaction.status;
+
+        // Free the slot first, the callback may submit the next transaction
+        collected++;
+        numCollected.store(collected, std::memory_order_release);
+
+        if (transaction.callback != nullptr) {
+            transaction.callback(status, transaction.priv);
+        }
+        collected = numCollected.load(std::memory_order_relaxed);
+    }
+}
+
+void I2CTransactionQueue::flush() {
+    while (!isIdle()) {
+        if (busy.load(std::memory_order_acquire)) {
+            bus.waitTransfer();
+        }
+        process();
+    }
+}
+
+bool I2CTransactionQueue::isIdle() const {
+    return numCollected.load(std::memory_order_acquire) == numSubmitted.load(std::memory_order_acquire);
+}
+
+void I2CTransactionQueue::acquireBus() {
+    busAcquired.store(true, std::memory_order_release);
+    bus.waitTransfer();
+}
+
+void I2CTransactionQueue::releaseBus() {
+    busAcquired.store(false, std::memory_order_release);
+
+    // Resume a chain which was held between two transfers, or start the
+    // transactions submitted in the meantime
+    if (busy.load(std::memory_order_acquire)) {
+        startTransfers();
+    } else {
+        kick();
+    }
+}
+
+void I2CTransactionQueue::kick() {
+    // Nothing is on the wire while the queue is not busy, so the completion
+    // interrupt can not race this. If the queue is busy, the interrupt picks
+    // up the new transaction when the one in flight completes.
+    if (busy.load(std::memory_order_acquire) || busAcquired.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    busy.store(true, std::memory_order_release);
+    if (selectNext()) {
+        startTransfers();
+    }
+}
+
+bool I2CTransactionQueue::selectNext() {
+    uint8_t started = numStarted.load(std::memory_order_relaxed);
+    while (started != numSubmitted.load(std::memory_order_acquire)) {
+        Transaction& transaction = *transactions[started % MAX_TRANSACTIONS];
+        started++;
+        numStarted.store(started, std::memory_order_release);
+
+        if (transaction.numTransfers > 0) {
+            return true;
+        }
+
+        // An empty chain completes right away
+        transaction.status = Status::OK;
+        numCompleted.fetch_add(1, std::memory_order_release);
+    }
+
+    busy.store(false, std::memory_order_release);
+    return false;
+}
+
+void I2CTransactionQueue::startTransfers() {
+    while (true) {
+        Transaction& transaction = inFlight();
+
+        completedInStart = false;
+        starting = true;
+        bus.startTransfer(transaction.addr, transaction.transfers[transaction.currentTransfer]);
+        starting = false;
+
+        // Otherwise the completion interrupt takes it from here
+        if (!completedInStart) {
+            return;
+        }
+
+        if (!advance(lastStatus) || busAcquired.load(std::memory_order_acquire)) {
+            return;
+        }
+    }
+}
+
+bool I2CTransactionQueue::advance(Status status) {
+    Transaction& transaction = inFlight();
+    transaction.currentTransfer = transaction.currentTransfer + 1;
+
+    if (status == Status::OK && transaction.currentTransfer < transaction.numTransfers) {
+        return true;
+    }
+
+    transaction.status = status;
+    numCompleted.fetch_add(1, std::memory_order_release);
+    return selectNext();
+}
+
+void I2CTransactionQueue::transferComplete(Status status) {
+    // Completed inside startTransfer(), the start loop moves on from there
+    // rather than recursing through it
+    if (starting) {
+        lastStatus = status;
+        completedInStart = true;
+        return;
+    }
+
+    if (advance(status) && !busAcquired.load(std::memory_order_acquire)) {
+        startTransfers();
+    }
+}
+
+I2CTransactionQueue::Transaction& I2CTransactionQueue::inFlight() {
+    return *transactions[static_cast<uint8_t>(numStarted.load(std::memory_order_relaxed) - 1) % MAX_TRANSACTIONS];
+}
+
+}// namespace BMS
@@ -6,30 +6,43 @@ namespace BMS {
 
 ResetHandler::ResetHandler() = default;
 
-void ResetHandler::registerInput(IO::CANMessage msg) {
-    lastRegMsgIndex = (lastRegMsgIndex + 1) % MSG_HIST_LEN;
-    msgHistory[lastRegMsgIndex] = msg;
+void ResetHandler::registerInput(IO::CANMessage& msg) {
+    if (!isResetMessage(msg)) {
+        numResetMsgs = 0;
+        return;
+    }
+
+    numResetMsgs++;
+    if (numResetMsgs >= MSG_HIST_LEN) {
+        numResetMsgs = 0;
+        resetRequested = true;
+    }
 }
 
 bool ResetHandler::shouldReset() {
-    for (IO::CANMessage msg : msgHistory) {
-        if (msg.getId() != RESET_ID || msg.getDataLength() != RESET_ARR_LEN) {
-            return false;
-        }
-
-        uint8_t* payload = msg.getPayload();
-        for (uint8_t i = 0; i < RESET_ARR_LEN; i++) {
-            if (payload[i] != RESET_ARR[i]) {
-                return false;
-            }
-        }
+    if (!resetRequested) {
+        return false;
     }
 
-    // Clear message history
-    for (uint8_t i = 0; i < MSG_HIST_LEN; i++) {
-        msgHistory[i] = IO::CANMessage();
+    resetRequested = false;
+    return true;
+}
+
+void ResetHandler::clear() {
+    resetRequested = false;
+}
+
+bool ResetHandler::isResetMessage(IO::CANMessage& msg) {
+    if (msg.getId() != RESET_ID || msg.getDataLength() != RESET_ARR_LEN) {
+        return false;
     }
 
+    uint8_t* payload = msg.getPayload();
+    for (uint8_t i = 0; i < RESET_ARR_LEN; i++) {
+        if (payload[i] != RESET_ARR[i]) {
+            return false;
+        }
+    }
     return true;
 }
 
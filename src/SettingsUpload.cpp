@@ -0,0 +1,143 @@
+#include <SettingsUpload.hpp>
+
+#include <cstring>
+
+#include <EVT/utils/time.hpp>
+
+#include <CRC32.hpp>
+
+namespace time = EVT::core::time;
+
+namespace BMS {
+
+SettingsUpload::SettingsUpload(Link& link, BQSettingsStorage& storage) : link(link), storage(storage) {}
+
+void SettingsUpload::process() {
+    while (link.isReadable()) {
+        receive(link.read());
+        lastByteTime = time::millis();
+    }
+
+    // The end of the window was lost, answer with what came in
+    bool isPending = inFrame || windowFrames > 0 || hasDropped;
+    if (isPending && time::millis() - lastByteTime > IDLE_TIMEOUT) {
+        inFrame = false;
+        answerWindow();
+    }
+}
+
+bool SettingsUpload::isDone() const {
+    return status == Status::DONE;
+}
+
+uint32_t SettingsUpload::getNumWindows() const {
+    return numWindows;
+}
+
+uint32_t SettingsUpload::getNumDropped() const {
+    return numDropped;
+}
+
+void SettingsUpload::receive(uint8_t byte) {
+    if (!inFrame) {
+        if (byte == DATA_SOF) {
+            inFrame = true;
+            frameFill = 0;
+        }
+        return;
+    }
+
+    frame[frameFill++] = byte;
+    if (frameFill < FRAME_HEADER_SIZE) {
+        return;
+    }
+
+    uint8_t length = frame[3];
+    if (length == 0 || length > MAX_PAYLOAD) {
+        inFrame = false;
+        hasDropped = true;
+        numDropped++;
+        return;
+    }
+    if (frameFill == FRAME_HEADER_SIZE + length + 4) {
+        inFrame = false;
+        handleFrame();
+    }
+}
+
+void SettingsUpload::handleFrame() {
+    uint8_t length = frame[3];
+    uint8_t* crcBytes = &frame[FRAME_HEADER_SIZE + length];
+    uint32_t crc = static_cast<uint32_t>(crcBytes[3]) << 24 | static_cast<uint32_t>(crcBytes[2]) << 16
+                   | static_cast<uint32_t>(crcBytes[1]) << 8 | static_cast<uint32_t>(crcBytes[0]);
+    if (CRC32::compute(frame, FRAME_HEADER_SIZE + length) != crc) {
+        hasDropped = true;
+        numDropped++;
+        return;
+    }
+
+    uint16_t sequence = static_cast<uint16_t>(frame[1] << 8 | frame[0]);
+    uint8_t flags = frame[2];
+
+    // The EEPROM is only touched once the window is in, starting over
+    // included
+    if (sequence == 0) {
+        restartPending = true;
+        expectedSequence = 0;
+        windowFill = 0;
+        windowFrames = 0;
+        hasDropped = false;
+        status = Status::CONTINUE;
+    }
+
+    // Frames before the expected one were already stored, their window is
+    // being sent again because its response was lost
+    if (status == Status::CONTINUE) {
+        if (sequence == expectedSequence) {
+            memcpy(&window[windowFill], &frame[FRAME_HEADER_SIZE], length);
+            windowFill += length;
+            windowFrames++;
+            expectedSequence++;
+        } else if (sequence > expectedSequence) {
+            hasDropped = true;
+            numDropped++;
+        }
+    }
+
+    if ((flags & FLAG_END_OF_WINDOW) || windowFrames == WINDOW_FRAMES) {
+        answerWindow();
+    }
+}
+
+void SettingsUpload::answerWindow() {
+    if (restartPending) {
+        storage.startDownload();
+        restartPending = false;
+    }
+
+    if (windowFill > 0 && status == Status::CONTINUE) {
+        if (!storage.downloadBytes(window, windowFill)) {
+            status = Status::REJECTED;
+        } else if (storage.isDownloadComplete()) {
+            status = Status::DONE;
+        }
+    }
+    windowFill = 0;
+    windowFrames = 0;
+    hasDropped = false;
+
+    uint8_t response[RESPONSE_SIZE] = {
+        RESPONSE_SOF,
+        static_cast<uint8_t>(status),
+        static_cast<uint8_t>(expectedSequence & 0xFF),
+        static_cast<uint8_t>(expectedSequence >> 8),
+    };
+    uint32_t crc = CRC32::compute(&response[1], 3);
+    for (uint8_t i = 0; i < 4; i++) {
+        response[4 + i] = (crc >> (i * 8)) & 0xFF;
+    }
+    link.write(response, RESPONSE_SIZE);
+    numWindows++;
+}
+
+}// namespace BMS
@@ -0,0 +1,165 @@
+#include <SocEstimator.hpp>
+
+#include <EVT/utils/log.hpp>
+
+namespace log = EVT::core::log;
+
+namespace BMS {
+
+SocEstimator::SocEstimator(EVT::core::DEV::M24C32& eeprom, uint32_t capacity)
+    : eeprom(eeprom), capacity(capacity * 3600), chargePerStep(capacity * 36 / 100) {}
+
+void SocEstimator::load() {
+    uint8_t record[RECORD_SIZE];
+    eeprom.readBytes(EEPROM_ADDRESS, record, RECORD_SIZE);
+
+    uint16_t magic = record[1] << 8 | record[0];
+    int32_t storedCharge = static_cast<int32_t>(static_cast<uint32_t>(record[5]) << 24
+                                                | static_cast<uint32_t>(record[4]) << 16
+                                                | static_cast<uint32_t>(record[3]) << 8
+                                                | static_cast<uint32_t>(record[2]));
+    uint16_t checksum = record[7] << 8 | record[6];
+
+    uint16_t expectedChecksum = 0;
+    for (uint8_t i = 0; i < 6; i++) {
+        expectedChecksum += record[i];
+    }
+    expectedChecksum = ~expectedChecksum;
+
+    if (magic != RECORD_MAGIC || checksum != expectedChecksum
+        || storedCharge < 0 || storedCharge > capacity) {
+        log::LOGGER.log(log::Logger::LogLevel::INFO, "No stored SOC");
+        initialized = false;
+        return;
+    }
+
+    charge = storedCharge;
+    chargeRemainder = 0;
+    initialized = true;
+    lastSavedSoc = getSoc();
+
+    log::LOGGER.log(log::Logger::LogLevel::INFO, "Restored SOC: %u", lastSavedSoc);
+}
+
+void SocEstimator::save() {
+    uint8_t record[RECORD_SIZE];
+    record[0] = RECORD_MAGIC & 0xFF;
+    record[1] = RECORD_MAGIC >> 8;
+    record[2] = charge & 0xFF;
+    record[3] = (charge >> 8) & 0xFF;
+    record[4] = (charge >> 16) & 0xFF;
+    record[5] = (charge >> 24) & 0xFF;
+
+    uint16_t checksum = 0;
+    for (uint8_t i = 0; i < 6; i++) {
+        checksum += record[i];
+    }
+    checksum = ~checksum;
+    record[6] = checksum & 0xFF;
+    record[7] = checksum >> 8;
+
+    eeprom.writeBytes(EEPROM_ADDRESS, record, RECORD_SIZE);
+    lastSavedSoc = getSoc();
+    saveDue = false;
+}
+
+void SocEstimator::update(int16_t current, uint16_t cellVoltage, uint32_t timestamp) {
+    // Without a stored estimate, the best guess is the OCV of the pack. Wait
+    // for a valid voltage reading before making that guess.
+    if (!initialized) {
+        if (cellVoltage == 0) {
+            return;
+        }
+
+        setSoc(ocvToSoc(cellVoltage));
+        initialized = true;
+        saveDue = true;
+    }
+
+    if (!hasSample) {
+        hasSample = true;
+        lastTimestamp = timestamp;
+        return;
+    }
+
+    uint32_t deltaTime = timestamp - lastTimestamp;
+    lastTimestamp = timestamp;
+
+    // A long gap means sampling stopped and has now restarted, the current
+    // during the gap is unknown so start integrating again from this sample
+    if (deltaTime > MAX_SAMPLE_GAP) {
+        log::LOGGER.log(log::Logger::LogLevel::DEBUG, "SOC sampling restarted after %u ms", deltaTime);
+        atRest = false;
+        return;
+    }
+
+    // Integrate in mA*ms, carrying anything below 1 mAs to the next sample
+    int64_t sampleCharge = static_cast<int64_t>(current) * static_cast<int64_t>(deltaTime) + chargeRemainder;
+    charge += static_cast<int32_t>(sampleCharge / 1000);
+    chargeRemainder = static_cast<int32_t>(sampleCharge % 1000);
+
+    if (charge < 0) {
+        charge = 0;
+        chargeRemainder = 0;
+    } else if (charge > capacity) {
+        charge = capacity;
+        chargeRemainder = 0;
+    }
+
+    // Correct against the OCV once the cells have relaxed
+    if (current > -REST_CURRENT && current < REST_CURRENT) {
+        if (!atRest) {
+            atRest = true;
+            restCorrected = false;
+            restStartTime = timestamp;
+        } else if (!restCorrected && (timestamp - restStartTime) >= REST_TIME) {
+            setSoc(ocvToSoc(cellVoltage));
+            restCorrected = true;
+            log::LOGGER.log(log::Logger::LogLevel::DEBUG, "SOC corrected from OCV: %u", getSoc());
+        }
+    } else {
+        atRest = false;
+    }
+
+    uint16_t soc = getSoc();
+    uint16_t change = soc > lastSavedSoc ? soc - lastSavedSoc : lastSavedSoc - soc;
+    if (change >= SAVE_DELTA) {
+        saveDue = true;
+    }
+}
+
+bool SocEstimator::isSaveDue() {
+    return saveDue;
+}
+
+uint16_t SocEstimator::getSoc() {
+    uint32_t soc = charge / chargePerStep;
+    return soc > SOC_FULL ? SOC_FULL : soc;
+}
+
+uint16_t SocEstimator::ocvToSoc(uint16_t cellVoltage) {
+    if (cellVoltage <= OCV_TABLE[0]) {
+        return 0;
+    }
+    if (cellVoltage >= OCV_TABLE[OCV_TABLE_SIZE - 1]) {
+        return SOC_FULL;
+    }
+
+    // Linearly interpolate between the surrounding table points
+    static constexpr uint16_t SOC_PER_POINT = SOC_FULL / (OCV_TABLE_SIZE - 1);
+    uint8_t i = 1;
+    while (cellVoltage > OCV_TABLE[i]) {
+        i++;
+    }
+
+    uint32_t span = OCV_TABLE[i] - OCV_TABLE[i - 1];
+    uint32_t offset = cellVoltage - OCV_TABLE[i - 1];
+    return (i - 1) * SOC_PER_POINT + offset * SOC_PER_POINT / span;
+}
+
+void SocEstimator::setSoc(uint16_t soc) {
+    charge = static_cast<int32_t>(soc) * chargePerStep;
+    chargeRemainder = 0;
+}
+
+}// namespace BMS
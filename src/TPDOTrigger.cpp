@@ -0,0 +1,67 @@
+#include <TPDOTrigger.hpp>
+
+namespace BMS {
+
+bool TPDOTrigger::watch(uint8_t tpdo, const uint8_t* value, uint16_t deadband) {
+    return add(tpdo, value, ValueType::UNSIGNED8, deadband);
+}
+
+bool TPDOTrigger::watch(uint8_t tpdo, const uint16_t* value, uint16_t deadband) {
+    return add(tpdo, value, ValueType::UNSIGNED16, deadband);
+}
+
+bool TPDOTrigger::watch(uint8_t tpdo, const int16_t* value, uint16_t deadband) {
+    return add(tpdo, value, ValueType::SIGNED16, deadband);
+}
+
+uint8_t TPDOTrigger::poll() {
+    uint8_t triggered = 0;
+    for (uint8_t i = 0; i < numValues; i++) {
+        int32_t change = read(values[i]) - values[i].lastSent;
+        if (change > values[i].deadband || -change > values[i].deadband) {
+            triggered |= 1 << values[i].tpdo;
+        }
+    }
+
+    // The whole TPDO is sent, so all of its values are the new reference
+    if (triggered) {
+        for (uint8_t i = 0; i < numValues; i++) {
+            if (triggered & (1 << values[i].tpdo)) {
+                values[i].lastSent = read(values[i]);
+            }
+        }
+    }
+
+    return triggered;
+}
+
+bool TPDOTrigger::add(uint8_t tpdo, const void* value, ValueType type, uint16_t deadband) {
+    if (numValues >= MAX_VALUES || tpdo > 7) {
+        return false;
+    }
+
+    values[numValues] = {
+        .value = value,
+        .type = type,
+        .tpdo = tpdo,
+        .deadband = deadband,
+        .lastSent = 0,
+    };
+    values[numValues].lastSent = read(values[numValues]);
+    numValues++;
+    return true;
+}
+
+int32_t TPDOTrigger::read(const WatchedValue& watched) {
+    switch (watched.type) {
+    case ValueType::UNSIGNED8:
+        return *static_cast<const uint8_t*>(watched.value);
+    case ValueType::UNSIGNED16:
+        return *static_cast<const uint16_t*>(watched.value);
+    case ValueType::SIGNED16:
+        return *static_cast<const int16_t*>(watched.value);
+    }
+    return 0;
+}
+
+}// namespace BMS
@@ -0,0 +1,98 @@
+#include <TaskScheduler.hpp>
+
+#include <EVT/utils/log.hpp>
+#include <EVT/utils/time.hpp>
+
+namespace time = EVT::core::time;
+namespace log = EVT::core::log;
+
+namespace BMS {
+
+TaskScheduler::TaskScheduler() = default;
+
+uint8_t TaskScheduler::addTask(TaskFunction func, void* priv, uint32_t period, uint8_t priority) {
+    if (numTasks >= MAX_TASKS) {
+        log::LOGGER.log(log::Logger::LogLevel::ERROR, "Task table full");
+        return MAX_TASKS;
+    }
+
+    uint8_t taskId = numTasks;
+
+    // Insert the task behind every task with an equal or higher priority
+    uint8_t index = numTasks;
+    while (index > 0 && tasks[index - 1].priority > priority) {
+        tasks[index] = tasks[index - 1];
+        index--;
+    }
+
+    tasks[index] = {
+        .func = func,
+        .priv = priv,
+        .period = period,
+        .nextRunTime = time::millis(),
+        .priority = priority,
+        .id = taskId,
+        .stats = {0, 0, 0, 0},
+    };
+    numTasks++;
+
+    return taskId;
+}
+
+void TaskScheduler::process(uint32_t taskMask) {
+    for (uint8_t i = 0; i < numTasks; i++) {
+        Task& task = tasks[i];
+
+        if (!(taskMask & TaskScheduler::taskMask(task.id))) {
+            continue;
+        }
+
+        uint32_t startTime = time::millis();
+
+        // Signed difference handles the millisecond counter wrapping
+        int32_t lateness = static_cast<int32_t>(startTime - task.nextRunTime);
+        if (lateness < 0) {
+            continue;
+        }
+
+        task.func(task.priv);
+
+        uint32_t execTime = time::millis() - startTime;
+        task.stats.lastExecTime = execTime;
+        if (execTime > task.stats.maxExecTime) {
+            task.stats.maxExecTime = execTime;
+        }
+        task.stats.numRuns++;
+
+        if (execTime > task.period || static_cast<uint32_t>(lateness) >= task.period) {
+            task.stats.numOverruns++;
+            log::LOGGER.log(log::Logger::LogLevel::DEBUG, "Task %u overrun, late: %d, exec: %u",
+                            task.id, lateness, execTime);
+        }
+
+        // Schedule the next run, skipping any periods that were missed
+        task.nextRunTime += task.period;
+        if (static_cast<int32_t>(startTime - task.nextRunTime) >= 0) {
+            task.nextRunTime = startTime + task.period;
+        }
+    }
+}
+
+void TaskScheduler::reset() {
+    uint32_t now = time::millis();
+    for (uint8_t i = 0; i < numTasks; i++) {
+        tasks[i].nextRunTime = now;
+    }
+}
+
+TaskScheduler::TaskStats TaskScheduler::getTaskStats(uint8_t taskId) {
+    for (uint8_t i = 0; i < numTasks; i++) {
+        if (tasks[i].id == taskId) {
+            return tasks[i].stats;
+        }
+    }
+
+    return {0, 0, 0, 0};
+}
+
+}// namespace BMS
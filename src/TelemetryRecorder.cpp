@@ -0,0 +1,227 @@
+#include <TelemetryRecorder.hpp>
+
+#include <cstring>
+
+namespace BMS {
+
+TelemetryRecorder::TelemetryRecorder() : canOpenInterface{
+                                             canOpenSize,
+                                             canOpenCtrl,
+                                             canOpenRead,
+                                             canOpenWrite,
+                                         } {}
+
+void TelemetryRecorder::record(const Sample& sample) {
+    if (frozen) {
+        return;
+    }
+
+    int32_t fields[NUM_FIELDS];
+    toFields(sample, fields);
+
+    uint8_t record[MAX_DELTA_SIZE];
+    uint8_t size = numBlocks > 0 ? encodeDelta(sample, fields, record) : 0;
+
+    if (numBlocks == 0 || blockLength[currentBlock] + size > BLOCK_SIZE) {
+        startBlock(sample, fields);
+    } else {
+        memcpy(&blocks[currentBlock][blockLength[currentBlock]], record, size);
+        blockLength[currentBlock] += size;
+        blockSamples[currentBlock]++;
+    }
+
+    memcpy(lastFields, fields, sizeof(lastFields));
+    lastTime = sample.time;
+}
+
+void TelemetryRecorder::freeze() {
+    frozen = 1;
+}
+
+bool TelemetryRecorder::isFrozen() const {
+    return frozen != 0;
+}
+
+uint8_t* TelemetryRecorder::getFrozenFlag() {
+    return &frozen;
+}
+
+uint16_t TelemetryRecorder::getNumSamples() const {
+    uint16_t numSamples = 0;
+    for (uint8_t age = 0; age < numBlocks; age++) {
+        numSamples += blockSamples[blockIndex(age)];
+    }
+    return numSamples;
+}
+
+uint32_t TelemetryRecorder::getLogSize() const {
+    uint32_t size = LOG_HEADER_SIZE;
+    for (uint8_t age = 0; age < numBlocks; age++) {
+        size += 2 + blockLength[blockIndex(age)];
+    }
+    return size;
+}
+
+uint32_t TelemetryRecorder::readLog(uint32_t offset, uint8_t* buffer, uint32_t length) const {
+    uint32_t numCopied = 0;
+
+    // The log is walked piece by piece, the header, then each block length
+    // and block, copying whatever part of a piece falls in the requested range
+    auto copyPiece = [&](const uint8_t* piece, uint32_t pieceSize) {
+        if (offset < pieceSize && numCopied < length) {
+            uint32_t count = pieceSize - offset;
+            if (count > length - numCopied) {
+                count = length - numCopied;
+            }
+            memcpy(&buffer[numCopied], &piece[offset], count);
+            numCopied += count;
+            offset = 0;
+        } else {
+            offset = offset >= pieceSize ? offset - pieceSize : 0;
+        }
+    };
+
+    uint16_t numSamples = getNumSamples();
+    uint8_t header[LOG_HEADER_SIZE] = {
+        FORMAT_VERSION,
+        numBlocks,
+        static_cast<uint8_t>(numSamples),
+        static_cast<uint8_t>(numSamples >> 8),
+    };
+    copyPiece(header, LOG_HEADER_SIZE);
+
+    for (uint8_t age = 0; age < numBlocks && numCopied < length; age++) {
+        uint8_t block = blockIndex(age);
+        uint8_t lengthBytes[2] = {
+            static_cast<uint8_t>(blockLength[block]),
+            static_cast<uint8_t>(blockLength[block] >> 8),
+        };
+        copyPiece(lengthBytes, 2);
+        copyPiece(blocks[block], blockLength[block]);
+    }
+
+    return numCopied;
+}
+
+void TelemetryRecorder::startBlock(const Sample& sample, const int32_t fields[NUM_FIELDS]) {
+    if (numBlocks == 0) {
+        currentBlock = 0;
+        numBlocks = 1;
+    } else {
+        // When every block is in use the next one is the oldest
+        currentBlock = (currentBlock + 1) % NUM_BLOCKS;
+        if (numBlocks < NUM_BLOCKS) {
+            numBlocks++;
+        }
+    }
+
+    uint8_t* keyframe = blocks[currentBlock];
+    uint8_t size = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        keyframe[size++] = sample.time >> (i * 8);
+    }
+    for (uint8_t i = 0; i < NUM_CELLS + 1; i++) {
+        keyframe[size++] = fields[i];
+        keyframe[size++] = fields[i] >> 8;
+    }
+    for (uint8_t i = NUM_CELLS + 1; i < NUM_FIELDS; i++) {
+        keyframe[size++] = fields[i];
+    }
+
+    blockLength[currentBlock] = size;
+    blockSamples[currentBlock] = 1;
+}
+
+uint8_t TelemetryRecorder::encodeDelta(const Sample& sample, const int32_t fields[NUM_FIELDS],
+                                       uint8_t* buffer) const {
+    uint32_t changed = 0;
+    for (uint8_t i = 0; i < NUM_FIELDS; i++) {
+        if (fields[i] != lastFields[i]) {
+            changed |= 1UL << i;
+        }
+    }
+
+    uint8_t size = putVarint(sample.time - lastTime, buffer);
+    size += putVarint(changed, &buffer[size]);
+
+    for (uint8_t i = 0; i < NUM_FIELDS; i++) {
+        if (changed & (1UL << i)) {
+            // Zigzag, so small differences of either sign stay small
+            int32_t difference = fields[i] - lastFields[i];
+            uint32_t zigzag = (static_cast<uint32_t>(difference) << 1) ^ static_cast<uint32_t>(difference >> 31);
+            size += putVarint(zigzag, &buffer[size]);
+        }
+    }
+
+    return size;
+}
+
+uint8_t TelemetryRecorder::blockIndex(uint8_t age) const {
+    return (currentBlock + 1 + NUM_BLOCKS - numBlocks + age) % NUM_BLOCKS;
+}
+
+void TelemetryRecorder::toFields(const Sample& sample, int32_t fields[NUM_FIELDS]) {
+    uint8_t field = 0;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        fields[field++] = sample.cellVoltage[i];
+    }
+    fields[field++] = sample.current;
+    for (uint8_t i = 0; i < NUM_TEMPS; i++) {
+        fields[field++] = sample.temperature[i];
+    }
+    for (uint8_t i = 0; i < NUM_STATUS; i++) {
+        fields[field++] = sample.bqStatus[i];
+    }
+    fields[field] = sample.errorRegister;
+}
+
+uint8_t TelemetryRecorder::putVarint(uint32_t value, uint8_t* buffer) {
+    uint8_t size = 0;
+    while (value >= 0x80) {
+        buffer[size++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    buffer[size++] = static_cast<uint8_t>(value);
+    return size;
+}
+
+uint32_t TelemetryRecorder::canOpenSize(CO_OBJ_T* obj, CO_NODE_T* node, uint32_t width) {
+    (void) node;
+    (void) width;
+
+    // The stack gets the size at the start of every upload, freezing here
+    // keeps the log from changing in the middle of it
+    auto* recorder = (TelemetryRecorder*) obj->Data;
+    recorder->freeze();
+    return recorder->getLogSize();
+}
+
+CO_ERR TelemetryRecorder::canOpenCtrl(CO_OBJ_T* obj, CO_NODE_T* node, uint16_t func, uint32_t para) {
+    (void) node;
+
+    auto* recorder = (TelemetryRecorder*) obj->Data;
+    if (func == CO_CTRL_SET_OFF) {
+        recorder->readOffset = para;
+    }
+    return CO_ERR_NONE;
+}
+
+CO_ERR TelemetryRecorder::canOpenRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len) {
+    (void) node;
+
+    auto* recorder = (TelemetryRecorder*) obj->Data;
+    recorder->readOffset += recorder->readLog(recorder->readOffset, (uint8_t*) buf, len);
+    return CO_ERR_NONE;
+}
+
+CO_ERR TelemetryRecorder::canOpenWrite(CO_OBJ_T* obj, CO_NODE_T* node, void* buf, uint32_t len) {
+    (void) obj;
+    (void) node;
+    (void) buf;
+    (void) len;
+
+    // The log is read only, recording is restarted through the frozen flag
+    return CO_ERR_OBJ_WRITE;
+}
+
+}// namespace BMS
@@ -2,8 +2,6 @@
 
 #include <EVT/utils/log.hpp>
 #include <EVT/utils/time.hpp>
-#include <co_err.h>
-#include <co_obj.h>
 
 // (void)0 is added to the end of each macro to force users to follow the macro with a ';'
 /// Macro to make an I2C transfer and return an error on failure
@@ -24,137 +22,10 @@
         }                                                                                       \
     }                                                                                           \
     (void) 0
-//TODO: BQ is implemented incorrectly, so we must fix it
-//(The new implementation of CO_OBJ_TYPE_T does not allow the methods to accept void *)
-//and our implementation relies on those void * to be able to get a reference to the
-//instance of the class
-
-///////////////////////////////////////////////////////////////////////////////
-/// Functions for interacting with the BQ76952 balancing logic through CANopen
-///////////////////////////////////////////////////////////////////////////////
-/**
- * This function is used to get the size of the balancing data. This will
- * always be a fixed size 1 byte since the state of balancing is either
- * enabled (1) or disabled (0)
- *
- * @param[in] obj The CANopen stack object dictionary, (not used here)
- * @param[in] node The CANopen stack node (not used)
- * @param[in] width The width of the data in bytes as it is stored in the
- *                  object dictionary (not used)
- * @param[in] priv Private data, pointer to the BQ76952 instance
- * @return The number of bytes representing the state of balancing (1)
- */
-/*
-static uint32_t COBQBalancingSize(struct CO_OBJ_T* obj, struct CO_NODE_T* node,
-                                  uint32_t width, void* priv) {
-
-    (void) obj;
-    (void) node;
-    (void) width;
-    (void) priv;
-
-    return 1;
-}
-*/
-/**
- * Read in the balance state of the given cell. This will communicate with the
- * BQ to determine the state.
- *
- * @param[in] obj The CANopen stack object dictionary, used to determine
- *                the cell number.
- * @param[in] node The CANopen stack node (not used)
- * @param[out] buf THe buffer to populate with data
- * @param[in] len The number of bytes to read
- * @param[in] priv The private data (BQ76952 instance)
- * @return CO_ERR_NONE on success
- */
-/*
-static CO_ERR COBQBalancingRead(CO_OBJ_T* obj, CO_NODE_T* node, void* buf,
-                                uint32_t len, void* priv) {
-
-    (void) node;
-    (void) len;
-
-    auto targetCell = static_cast<uint8_t>(obj->Data);
-
-    auto* bq = (BMS::DEV::BQ76952*) priv;
-
-    bool isBalancing = false;
-    BMS::DEV::BQ76952::Status status = bq->isBalancing(targetCell, &isBalancing);
-
-    if (status != BMS::DEV::BQ76952::Status::OK) {
-        return CO_ERR_OBJ_READ;
-    }
 
-    auto* result = (uint8_t*) buf;
-    *result = isBalancing;
-
-    return CO_ERR_NONE;
-}
-*/
-
-/**
- * Write out the state of the balancing. Can be used to enable balancing by
- * providing a 1 and disable balancing by providing a 0
- *
- * @param[in] obj CANopen stack object dictionary element, used to determine
- *                the cell number.
- * @param[in] node The CANopen stack node (not used)
- * @param[in] buf Bytes containing the enable/disable state
- * @param[in] len Number of bytes in the buf (should be 1)
- * @param[in] priv The private data (BQ76952 instance)
- * @return CO_ERR_NONE on success
- */
-/*
-static CO_ERR COBQBalancingWrite(CO_OBJ_T* obj, CO_NODE_T* node, void* buf,
-                                 uint32_t len, void* priv) {
-    (void) node;
-    (void) len;
-
-    auto targetCell = static_cast<uint8_t>(obj->Data);
-
-    auto* bq = (BMS::DEV::BQ76952*) priv;
-
-    uint8_t balancingState = *(uint8_t*) buf;
-    balancingState = balancingState > 0 ? 1 : 0;
-
-    BMS::DEV::BQ76952::Status status = bq->setBalancing(targetCell, balancingState);
-
-    if (status != BMS::DEV::BQ76952::Status::OK) {
-        return CO_ERR_OBJ_WRITE;
-    }
-
-    return CO_ERR_NONE;
-}
-*/
-
-/**
- * Control logic, for the balancing logic does not need to do anything
- */
-/*
-static CO_ERR COBalancingCtrl(CO_OBJ* obj, CO_NODE_T* node, uint16_t func,
-                              uint32_t para, void* priv) {
-    (void) obj;
-    (void) node;
-    (void) para;
-    (void) func;
-    (void) priv;
-
-    return CO_ERR_NONE;
-}
-*/
 namespace BMS::DEV {
 
-BQ76952::BQ76952(EVT::core::IO::I2C& i2c, uint8_t i2cAddress) : /*
-    balancingCANOpen{
-        COBQBalancingSize,
-        COBalancingCtrl,
-        COBQBalancingRead,
-        COBQBalancingWrite,
-        this,
-    },
-     */
-                                                                i2c(i2c), i2cAddress(i2cAddress) {}
+BQ76952::BQ76952(EVT::core::IO::I2C& i2c, uint8_t i2cAddress) : i2c(i2c), i2cAddress(i2cAddress) {}
 
 BQ76952::Status BQ76952::writeSetting(BMS::BQSetting& setting) {
     // Right now, the BQ only accepts settings made into RAM
@@ -216,6 +87,13 @@ BQ76952::Status BQ76952::makeDirectRead(uint8_t reg, uint16_t* result) {
     return Status::OK;
 }
 
+BQ76952::Status BQ76952::makeBlockRead(uint8_t reg, uint8_t* buffer, uint8_t numBytes) {
+    // Single transaction, the BQ auto-increments the register address
+    BQ_I2C_RETURN_IF_ERR(i2c.readMemReg(i2cAddress, reg, buffer, numBytes, 1));
+
+    return Status::OK;
+}
+
 BQ76952::Status BQ76952::makeSubcommandRead(uint16_t reg, uint32_t* result) {
     // Write out the target subcommand
     uint8_t targetReg[] = {static_cast<uint8_t>(reg & 0xFF), static_cast<uint8_t>((reg >> 8) & 0XFF)};
@@ -253,34 +131,48 @@ BQ76952::Status BQ76952::makeRAMRead(uint16_t reg, uint32_t* result) {
 }
 
 BQ76952::Status BQ76952::writeRAMSetting(BMS::BQSetting& setting) {
+    // Insert the data into a buffer, little endian
+    uint8_t data[4];
+    for (int i = 0; i < setting.getNumBytes(); i++) {
+        data[i] = (setting.getData() >> (i * 8)) & 0xFF;
+    }
+
+    return writeRAMBlock(setting.getAddress(), data, setting.getNumBytes());
+}
+
+BQ76952::Status BQ76952::writeRAMBlock(uint16_t address, const uint8_t* data, uint8_t numBytes) {
+    if (numBytes > MAX_RAM_BLOCK_SIZE) {
+        return Status::ERROR;
+    }
+
     // Array which stores all bytes that make up a RAM write request
     // transfer[0]: LSB of the address in RAM
     // transfer[1]: MSB of the address in RAM
-    // transfer[2:]: Data associated with the setting
-    uint8_t transfer[7];
+    // transfer[2:]: Data associated with the block
+    uint8_t transfer[2 + MAX_RAM_BLOCK_SIZE];
 
     // Insert RAM address into transfer buffer
-    transfer[0] = static_cast<uint8_t>(setting.getAddress() & 0xFF);
-    transfer[1] = static_cast<uint8_t>((setting.getAddress() >> 8) & 0xFF);
+    transfer[0] = static_cast<uint8_t>(address & 0xFF);
+    transfer[1] = static_cast<uint8_t>((address >> 8) & 0xFF);
 
     // Insert the data into the transfer buffer
-    for (int i = 0; i < setting.getNumBytes(); i++) {
-        transfer[2 + i] = (setting.getData() >> (i * 8)) & 0xFF;
+    for (uint8_t i = 0; i < numBytes; i++) {
+        transfer[2 + i] = data[i];
     }
 
-    // Send over the settings
+    // Send over the data
     BQ_I2C_RETURN_IF_ERR(i2c.writeMemReg(i2cAddress, RAM_BASE_ADDR, transfer,
-                                         3 + setting.getNumBytes(), 1, 100));
+                                         2 + numBytes, 1, 100));
 
     // Calculate and write out checksum and data length,
     // checksum algorithm = ~(ram_address + sum(data_bytes))
     // Detailed in BQ76952 Software Development Guide
     uint8_t checksum = transfer[0] + transfer[1];
-    for (int i = 2; i < (2 + setting.getNumBytes()); i++) {
+    for (uint8_t i = 2; i < (2 + numBytes); i++) {
         checksum += transfer[i];
     }
     checksum = ~checksum;
-    uint8_t length = 4 + setting.getNumBytes();
+    uint8_t length = 4 + numBytes;
 
     // transfer[0]: calculated checksum
     // transfer[1]: number of data bytes
@@ -294,18 +186,16 @@ BQ76952::Status BQ76952::writeRAMSetting(BMS::BQSetting& setting) {
     // Verify the transfer took place successfully. From the BQ Technical
     // Reference Manual Chapter 3. This can be done by polling the address
     // register until the address matches what was written out can be read
-    // back. Then you can verify the checksum and length matches what was
-    // written out
-    uint16_t address = 0;
-    uint16_t targetAddress = setting.getAddress();
+    // back. Then you can verify the data matches what was written out
+    uint16_t readAddress = 0;
     uint16_t rawResponse;
     uint32_t startTime = EVT::core::time::millis();
 
     // Try to read back the address that was written out
-    while (address != targetAddress) {
+    while (readAddress != address) {
         // Attempt to reach back the address
         RETURN_IF_ERR(makeDirectRead(RAM_BASE_ADDR, &rawResponse));
-        address = rawResponse;
+        readAddress = rawResponse;
 
         // Check to see if a timeout occurred
         if (EVT::core::time::millis() - startTime > TIMEOUT) {
@@ -313,25 +203,20 @@ BQ76952::Status BQ76952::writeRAMSetting(BMS::BQSetting& setting) {
         }
     }
 
-    // Verify the data written matches
-    uint32_t readData;
-    RETURN_IF_ERR(makeRAMRead(setting.getAddress(), &readData));
-    switch (setting.getNumBytes()) {
-    case 1:
-        readData = readData & 0xFF;
-        break;
-    case 2:
-        readData = readData & 0xFFFF;
-        break;
-    case 3:
-        readData = readData & 0xFFFFFF;
-        break;
-    case 4:
-        readData = readData & 0xFFFFFFFF;
-        break;
+    if (numBytes == 0) {
+        return Status::OK;
     }
-    if (readData != setting.getData()) {
-        return Status::ERROR;
+
+    // Read the whole block back in one transfer and verify it matches
+    uint8_t readBack[MAX_RAM_BLOCK_SIZE];
+    uint8_t targetReg[] = {static_cast<uint8_t>(address & 0xFF), static_cast<uint8_t>((address >> 8) & 0xFF)};
+    BQ_I2C_RETURN_IF_ERR(i2c.writeMemReg(i2cAddress, COMMAND_ADDR, targetReg, 2, 1, 1));
+    BQ_I2C_RETURN_IF_ERR(i2c.readMemReg(i2cAddress, READ_BACK_ADDR, readBack, numBytes, 1));
+
+    for (uint8_t i = 0; i < numBytes; i++) {
+        if (readBack[i] != data[i]) {
+            return Status::ERROR;
+        }
     }
 
     return Status::OK;
@@ -377,40 +262,11 @@ BQ76952::Status BQ76952::communicationStatus() {
 }
 
 BQ76952::Status BQ76952::getCellVoltage(uint16_t cellVoltages[NUM_CELLS], uint32_t& sum, CellVoltageInfo& voltageInfo) {
-    Status status = Status::OK;
-    uint8_t cellVoltageReg = CELL_VOLTAGE_BASE_ADDR;
-    //Must use temporary storage variables or else the values reported over CAN will be inaccurate from regular changes.
-    uint32_t tempVoltage = 0;
-    uint16_t tempMinVoltage = 65535;
-    uint16_t tempMaxVoltage = 0;
-    uint8_t tempMinCellID;
-    uint8_t tempMaxCellID;
-
-    // Loop over all the cells and update the corresponding voltage
-    for (uint8_t i = 0; i < NUM_CELLS; i++) {
-        uint8_t cellReg = CELL_BALANCE_MAPPING[i] * 2 + 0x14;
-        status = makeDirectRead(cellReg, &cellVoltages[i]);
-        if (status != Status::OK) {
-            return status;
-        }
-        if (cellVoltages[i] < tempMinVoltage) {
-            tempMinVoltage = cellVoltages[i];
-            tempMinCellID = i + 1;
-        } else if (cellVoltages[i] > tempMaxVoltage) {
-            tempMaxVoltage = cellVoltages[i];
-            tempMaxCellID = i + 1;
-        }
-        tempVoltage += cellVoltages[i];
-
-        // Each cell register is 2 bytes off from each other
-        cellVoltageReg += 2;
-    }
+    // Read the whole cell voltage window in one transfer
+    uint8_t rawVoltages[CELL_VOLTAGE_WINDOW_SIZE];
+    RETURN_IF_ERR(makeBlockRead(CELL_VOLTAGE_BASE_ADDR, rawVoltages, CELL_VOLTAGE_WINDOW_SIZE));
 
-    sum = tempVoltage;
-    voltageInfo.minCellVoltage = tempMinVoltage;
-    voltageInfo.minCellVoltageId = tempMinCellID;
-    voltageInfo.maxCellVoltage = tempMaxVoltage;
-    voltageInfo.maxCellVoltageId = tempMaxCellID;
+    decodeCellVoltages(rawVoltages, cellVoltages, sum, voltageInfo);
 
     return BQ76952::Status::OK;
 }
@@ -455,8 +311,21 @@ BQ76952::Status BQ76952::setBalancing(uint8_t targetCell, uint8_t enable) {
     return Status::OK;
 }
 
+BQ76952::Status BQ76952::setBalancingMask(uint16_t cellMask) {
+    // Map the cells onto the cell inputs they are connected to
+    uint16_t reg = 0;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        if (cellMask & (1 << i)) {
+            reg |= 1 << CELL_BALANCE_MAPPING[i];
+        }
+    }
+
+    uint8_t data[] = {static_cast<uint8_t>(reg & 0xFF), static_cast<uint8_t>(reg >> 8)};
+    return writeRAMBlock(ACTIVE_BALANCING_ADDR, data, 2);
+}
+
 BQ76952::Status BQ76952::getCurrent(int16_t& current) {
-    return makeDirectRead(0x3a, reinterpret_cast<uint16_t*>(&current));
+    return makeDirectRead(CURRENT_ADDR, reinterpret_cast<uint16_t*>(&current));
 }
 
 BQ76952::Status BQ76952::getTotalVoltage(uint16_t& totalVoltage) {
@@ -495,4 +364,132 @@ BQ76952::Status BQ76952::getBQStatus(uint8_t bqStatusArr[7]) {
     return BQ76952::Status::OK;
 }
 
+BQ76952::Status BQ76952::submitRead(I2CTransactionQueue& queue, DataRead read,
+                                    I2CTransactionQueue::Callback callback, void* priv) {
+    I2CTransactionQueue::Transaction& transaction = dataReads[static_cast<uint8_t>(read)];
+    if (transaction.getStatus() == I2CTransactionQueue::Status::PENDING) {
+        return Status::OK;
+    }
+
+    // Each direct command is a write of the register address and a read of
+    // its value, chained into one transaction
+    transaction.reset(i2cAddress);
+    switch (read) {
+    case DataRead::CELL_VOLTAGE:
+        transaction.addRead(CELL_VOLTAGE_BASE_ADDR, rawCellVoltages, CELL_VOLTAGE_WINDOW_SIZE);
+        break;
+    case DataRead::CURRENT:
+        transaction.addRead(CURRENT_ADDR, rawCurrent, 2);
+        break;
+    case DataRead::STATUS:
+        for (uint8_t i = 0; i < sizeof(STATUS_READ_ADDRS); i++) {
+            transaction.addRead(STATUS_READ_ADDRS[i], &rawStatus[2 * i], 2);
+        }
+        break;
+    case DataRead::TEMPS:
+        for (uint8_t i = 0; i < sizeof(TEMP_READ_ADDRS); i++) {
+            transaction.addRead(TEMP_READ_ADDRS[i], &rawTemps[2 * i], 2);
+        }
+        break;
+    case DataRead::BALANCING:
+        // Subcommand, the result is read back from the transfer buffer
+        transaction.addWrite(COMMAND_ADDR, const_cast<uint8_t*>(ACTIVE_BALANCING_SUBCOMMAND), 2);
+        transaction.addRead(READ_BACK_ADDR, rawBalancing, 2);
+        break;
+    }
+
+    if (queue.submit(transaction, callback, priv) != I2CTransactionQueue::Status::PENDING) {
+        return Status::ERROR;
+    }
+    return Status::OK;
+}
+
+BQ76952::Status BQ76952::collectCellVoltage(uint16_t cellVoltages[NUM_CELLS], uint32_t& sum,
+                                            CellVoltageInfo& voltageInfo) {
+    RETURN_IF_ERR(readResult(DataRead::CELL_VOLTAGE));
+    decodeCellVoltages(rawCellVoltages, cellVoltages, sum, voltageInfo);
+    return Status::OK;
+}
+
+BQ76952::Status BQ76952::collectCurrent(int16_t& current) {
+    RETURN_IF_ERR(readResult(DataRead::CURRENT));
+    current = static_cast<int16_t>(rawCurrent[1] << 8 | rawCurrent[0]);
+    return Status::OK;
+}
+
+BQ76952::Status BQ76952::collectStatus(uint16_t& totalVoltage, uint8_t bqStatusArr[7]) {
+    RETURN_IF_ERR(readResult(DataRead::STATUS));
+
+    // Same layout as getTotalVoltage() and getBQStatus()
+    totalVoltage = (rawStatus[1] << 8 | rawStatus[0]) * 10;
+    for (uint8_t i = 0; i < 3; i++) {
+        bqStatusArr[i] = rawStatus[2 + 2 * i];
+    }
+    bqStatusArr[3] = rawStatus[8];
+    bqStatusArr[4] = rawStatus[9];
+    bqStatusArr[5] = rawStatus[10];
+    bqStatusArr[6] = rawStatus[11];
+
+    return Status::OK;
+}
+
+BQ76952::Status BQ76952::collectTemps(BqTempInfo& bqTempInfo) {
+    RETURN_IF_ERR(readResult(DataRead::TEMPS));
+
+    uint16_t raw[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        raw[i] = rawTemps[2 * i + 1] << 8 | rawTemps[2 * i];
+    }
+    bqTempInfo.internalTemp = (raw[0] - 2732) / 10;
+    bqTempInfo.temp1 = (raw[1] - 2732) / 10;
+    bqTempInfo.temp2 = (raw[2] - 2732) / 10;
+
+    return Status::OK;
+}
+
+BQ76952::Status BQ76952::collectBalancing(uint16_t& cellMask) {
+    RETURN_IF_ERR(readResult(DataRead::BALANCING));
+
+    // Map the cell inputs back onto the cells, see setBalancingMask()
+    uint16_t reg = rawBalancing[1] << 8 | rawBalancing[0];
+    cellMask = 0;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        if (reg & (1 << CELL_BALANCE_MAPPING[i])) {
+            cellMask |= 1 << i;
+        }
+    }
+
+    return Status::OK;
+}
+
+BQ76952::Status BQ76952::readResult(DataRead read) {
+    if (dataReads[static_cast<uint8_t>(read)].getStatus() != I2CTransactionQueue::Status::OK) {
+        return Status::I2C_ERROR;
+    }
+    return Status::OK;
+}
+
+void BQ76952::decodeCellVoltages(const uint8_t* rawVoltages, uint16_t cellVoltages[NUM_CELLS],
+                                 uint32_t& sum, CellVoltageInfo& voltageInfo) {
+    sum = 0;
+
+    // Loop over all the cells and pull out the corresponding voltage
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        // Each cell register is 2 bytes off from each other
+        uint8_t cellOffset = CELL_BALANCE_MAPPING[i] * 2;
+        cellVoltages[i] = rawVoltages[cellOffset + 1] << 8 | rawVoltages[cellOffset];
+        sum += cellVoltages[i];
+
+        // Cell IDs start at 1, ties go to the lowest cell
+        if (i == 0 || cellVoltages[i] < voltageInfo.minCellVoltage) {
+            voltageInfo.minCellVoltage = cellVoltages[i];
+            voltageInfo.minCellVoltageId = i + 1;
+        }
+        if (i == 0 || cellVoltages[i] > voltageInfo.maxCellVoltage) {
+            voltageInfo.maxCellVoltage = cellVoltages[i];
+            voltageInfo.maxCellVoltageId = i + 1;
+        }
+    }
+}
+
 }// namespace BMS::DEV
@@ -4,15 +4,74 @@ namespace BMS::DEV {
 
 ThermistorMux::ThermistorMux(IO::GPIO** muxSelectArr, IO::ADC& adc) : muxSelectArr{
     muxSelectArr[0], muxSelectArr[1], muxSelectArr[2]},
-                                                                      therm(EVT::core::DEV::Thermistor(adc, convert)) {}
+                                                                      adc(adc) {}
 
-uint16_t ThermistorMux::getTemp(uint8_t thermNum) {
+int16_t ThermistorMux::getTemp(uint8_t thermNum) {
+    select(thermNum);
+    acquisitionState = AcquisitionState::IDLE;
+
+    time::wait(SETTLING_TIME);
+    return readMedianTemp();
+}
+
+bool ThermistorMux::pollTemp(uint8_t thermNum, int16_t& temp) {
+    switch (acquisitionState) {
+    case AcquisitionState::IDLE:
+        select(thermNum);
+        return false;
+    case AcquisitionState::SETTLING:
+        // A different thermistor was requested, start over with that one
+        if (thermNum != selectedTherm) {
+            select(thermNum);
+            return false;
+        }
+
+        if ((time::millis() - selectTime) < SETTLING_TIME) {
+            return false;
+        }
+
+        int32_t reading = static_cast<int32_t>(readMedianTemp()) << FILTER_FRACTION_BITS;
+        if (filterStarted & (1 << thermNum)) {
+            filteredTemp[thermNum] += (reading - filteredTemp[thermNum]) >> IIR_SHIFT;
+        } else {
+            filteredTemp[thermNum] = reading;
+            filterStarted |= 1 << thermNum;
+        }
+
+        // Round to the nearest 0.1 C
+        temp = static_cast<int16_t>((filteredTemp[thermNum] + (1 << (FILTER_FRACTION_BITS - 1))) >> FILTER_FRACTION_BITS);
+        acquisitionState = AcquisitionState::IDLE;
+        return true;
+    }
+
+    return false;
+}
+
+void ThermistorMux::select(uint8_t thermNum) {
     for (uint8_t i = 0; i < 3; i++) {
         muxSelectArr[i]->writePin(thermNum & 1 << i ? IO::GPIO::State::HIGH : IO::GPIO::State::LOW);
     }
 
-    time::wait(40);
-    return therm.getTempCelcius();
+    selectedTherm = thermNum;
+    selectTime = time::millis();
+    acquisitionState = AcquisitionState::SETTLING;
+}
+
+int16_t ThermistorMux::readMedianTemp() {
+    uint32_t samples[OVERSAMPLE_COUNT];
+
+    // Insertion sort as the samples come in, there are only a few of them
+    for (uint8_t i = 0; i < OVERSAMPLE_COUNT; i++) {
+        uint32_t sample = adc.readRaw();
+        uint8_t j = i;
+        while (j > 0 && samples[j - 1] > sample) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = sample;
+    }
+
+    return TEMP_TABLE.convert(samples[OVERSAMPLE_COUNT / 2]);
 }
 
 }// namespace BMS::DEV
@@ -16,6 +16,8 @@
 #include <EVT/utils/types/FixedQueue.hpp>
 
 #include <BMS.hpp>
+#include <CANDispatcher.hpp>
+#include <SPSCQueue.hpp>
 #include <SystemDetect.hpp>
 #include <dev/BQ76952.hpp>
 
@@ -27,6 +29,20 @@ namespace log = EVT::core::log;
 #define BIKE_HEART_BEAT 0x70A   // NODE_ID = 10
 #define CHARGER_HEART_BEAT 0x710// NODE_ID = 16
 #define DETECT_TIMEOUT 1000
+#define NMT_ID 0x000
+#define SDO_REQUEST_ID (0x600 + BMS::BMS::NODE_ID)
+#define RESET_ID 0x7FF
+// Received frames waiting for the main loop, has to be a power of two
+#define CAN_RX_QUEUE_SIZE 64
+// RAM in bytes for the BMS and the settings storage on the stack of main,
+// leaves about 4.75 KB of the 12 KB of the STM32F334x8 for EVT-core, the
+// CANopen stack, the CAN queues and the call stack
+#define BMS_RAM_BUDGET 7424
+
+/**
+ * Queue of CANopen frames from the CAN interrupt handler to the main loop
+ */
+typedef BMS::SPSCQueue<IO::CANMessage, CAN_RX_QUEUE_SIZE> CANRxQueue;
 
 /**
  * This struct is a catchall for data that is needed by the CAN interrupt
@@ -34,39 +50,59 @@ namespace log = EVT::core::log;
  * to the interrupt handler.
  */
 struct CANInterruptParams {
-    EVT::core::types::FixedQueue<CANOPEN_QUEUE_SIZE, IO::CANMessage>* queue;
+    CANRxQueue* queue;
     BMS::SystemDetect* systemDetect;
     BMS::ResetHandler* resetHandler;
+    BMS::CANDispatcher* dispatcher;
 };
 
 /**
- * Interrupt handler for incoming CAN messages.
+ * Handler for frames meant for the CANopen stack (NMT and SDO requests)
  *
- * @param priv[in] The private data (FixedQueue<CANOPEN_QUEUE_SIZE, CANMessage>)
+ * @param message[in] The received frame
+ * @param priv[in] The interrupt parameters (CANInterruptParams)
  */
-void canInterruptHandler(IO::CANMessage& message, void* priv) {
+void canOpenFrameHandler(IO::CANMessage& message, void* priv) {
     struct CANInterruptParams* params = (CANInterruptParams*) priv;
 
-    EVT::core::types::FixedQueue<CANOPEN_QUEUE_SIZE, IO::CANMessage>* queue =
-        params->queue;
-    BMS::SystemDetect* systemDetect = params->systemDetect;
-    BMS::ResetHandler* resetHandler = params->resetHandler;
-
-    systemDetect->processHeartbeat(message.getId());
+    if (params->queue == nullptr)
+        return;
+    params->queue->push(message);
+}
 
-    resetHandler->registerInput(message);
+/**
+ * Handler for the heartbeats of the bike and the charger
+ *
+ * @param message[in] The received frame
+ * @param priv[in] The interrupt parameters (CANInterruptParams)
+ */
+void heartbeatFrameHandler(IO::CANMessage& message, void* priv) {
+    struct CANInterruptParams* params = (CANInterruptParams*) priv;
+    params->systemDetect->processHeartbeat(message.getId());
+}
 
-    if (queue == nullptr)
-        return;
-    if (!message.isCANExtended())
-        queue->append(message);
+/**
+ * Interrupt handler for incoming CAN messages. Only the IDs in the dispatch
+ * table and reset frames pass the hardware filters. Every frame goes to the
+ * reset handler, as any other frame between reset frames restarts the
+ * count, then to the handler of its ID.
+ *
+ * @param priv[in] The private data (CANInterruptParams)
+ */
+void canInterruptHandler(IO::CANMessage& message, void* priv) {
+    struct CANInterruptParams* params = (CANInterruptParams*) priv;
+    params->resetHandler->registerInput(message);
+    params->dispatcher->dispatch(message);
 }
 
 int main() {
     // Initialize system
     EVT::core::platform::init();
 
-    // Queue that will store CANopen messages
+    // Queue of CANopen frames filled by the CAN interrupt handler
+    CANRxQueue canRxQueue;
+
+    // Queue the CANopen driver reads frames from, only used by the main loop
     EVT::core::types::FixedQueue<CANOPEN_QUEUE_SIZE, IO::CANMessage> canOpenQueue;
 
     // Initialize the system detect
@@ -75,17 +111,30 @@ int main() {
 
     BMS::ResetHandler resetHandler;
 
+    BMS::CANDispatcher dispatcher;
+
     // Create struct that will hold CAN interrupt parameters
     struct CANInterruptParams canParams = {
-        .queue = &canOpenQueue,
+        .queue = &canRxQueue,
         .systemDetect = &systemDetect,
         .resetHandler = &resetHandler,
+        .dispatcher = &dispatcher,
     };
 
+    // Frames the BMS acts on, everything else is dropped by the hardware
+    dispatcher.addHandler(NMT_ID, canOpenFrameHandler, &canParams);
+    dispatcher.addHandler(SDO_REQUEST_ID, canOpenFrameHandler, &canParams);
+    dispatcher.addHandler(BIKE_HEART_BEAT, heartbeatFrameHandler, &canParams);
+    dispatcher.addHandler(CHARGER_HEART_BEAT, heartbeatFrameHandler, &canParams);
+
     // Initialize IO
-    // TODO: Investigate adding CAN filters
     IO::CAN& can = IO::getCAN<BMS::BMS::CAN_TX_PIN, BMS::BMS::CAN_RX_PIN>();
     can.addIRQHandler(canInterruptHandler, reinterpret_cast<void*>(&canParams));
+    for (uint8_t i = 0; i < dispatcher.getNumHandlers(); i++) {
+        can.addCANFilter(dispatcher.getId(i), BMS::CANDispatcher::EXACT_MATCH_MASK, i);
+    }
+    // Reset frames have no handler of their own, canInterruptHandler counts them
+    can.addCANFilter(RESET_ID, BMS::CANDispatcher::EXACT_MATCH_MASK, dispatcher.getNumHandlers());
     IO::UART& uart = IO::getUART<BMS::BMS::UART_TX_PIN, BMS::BMS::UART_RX_PIN>(115200, true);
     IO::I2C& i2c = IO::getI2C<BMS::BMS::I2C_SCL_PIN, BMS::BMS::I2C_SDA_PIN>();
 
@@ -103,6 +152,11 @@ int main() {
     BMS::DEV::BQ76952 bq(i2c, 0x08);
     BMS::BQSettingsStorage bqSettingsStorage(eeprom, bq);
 
+    // The periodic BQ reads go through a transaction queue. EVT-core only
+    // has blocking I2C, so each transfer runs as soon as it is started.
+    BMS::I2CTransactionQueue::BlockingBus i2cBus(i2c);
+    BMS::I2CTransactionQueue i2cQueue(i2cBus);
+
     // Initialize the Interlock
     IO::GPIO& interlockGPIO = IO::getGPIO<BMS::BMS::INTERLOCK_PIN>(IO::GPIO::Direction::INPUT);
     BMS::DEV::Interlock interlock(interlockGPIO);
@@ -126,7 +180,9 @@ int main() {
     DEV::IWDG& iwdg = DEV::getIWDG(500);
 
     // Initialize the BMS itself
-    BMS::BMS bms(bqSettingsStorage, bq, interlock, alarm, systemDetect, bmsOK, thermMux, resetHandler, iwdg);
+    static_assert(sizeof(BMS::BMS) + sizeof(BMS::BQSettingsStorage) <= BMS_RAM_BUDGET,
+                  "The BMS is over its RAM budget");
+    BMS::BMS bms(bqSettingsStorage, bq, i2cQueue, interlock, alarm, systemDetect, bmsOK, thermMux, resetHandler, iwdg);
 
     ///////////////////////////////////////////////////////////////////////////
     // Setup CAN configuration, this handles making drivers, applying settings.
@@ -170,12 +226,27 @@ int main() {
     // Main processing loop, contains the following logic
     // 1. Update CANopen logic and processing incoming messages
     // 2. Run per-loop BMS state logic
-    // 3. Wait for new data to come in
+    // 3. Send TPDOs with changed data
+    // 4. Wait for new data to come in
+    IO::CANMessage rxMessage;
     while (1) {
-        // Process CANopen
+        // Process CANopen, the node reads one frame per call so each
+        // received frame is handed over and processed on its own
+        while (canRxQueue.pop(&rxMessage)) {
+            canOpenQueue.append(rxMessage);
+            IO::processCANopenNode(&canNode);
+        }
         IO::processCANopenNode(&canNode);
+        bms.setCANQueueStats(canRxQueue.getHighWaterMark(), canRxQueue.getOverflowCount());
         // Update the state of the BMS
         bms.process();
+        // Send the TPDOs whose values changed right away
+        uint8_t triggeredTPDOs = bms.getTriggeredTPDOs();
+        for (uint8_t i = 0; i < CO_TPDO_N; i++) {
+            if (triggeredTPDOs & (1 << i)) {
+                COTPdoTrigPdo(canNode.TPdo, i);
+            }
+        }
         // Wait for new data to come in
         time::wait(10);
     }
@@ -103,6 +103,11 @@ int main() {
     BMS::DEV::BQ76952 bq(i2c, 0x08);
     BMS::BQSettingsStorage bqSettingsStorage(eeprom, bq);
 
+    // The periodic BQ reads go through a transaction queue. EVT-core only
+    // has blocking I2C, so each transfer runs as soon as it is started.
+    BMS::I2CTransactionQueue::BlockingBus i2cBus(i2c);
+    BMS::I2CTransactionQueue i2cQueue(i2cBus);
+
     // Initialize the Interlock
     IO::GPIO& interlockGPIO = IO::getGPIO<BMS::BMS::INTERLOCK_PIN>(IO::GPIO::Direction::INPUT);
     BMS::DEV::Interlock interlock(interlockGPIO);
@@ -126,7 +131,7 @@ int main() {
     DEV::IWDG& iwdg = DEV::getIWDG(500);
 
     // Initialize the BMS itself
-    BMS::BMS bms(bqSettingsStorage, bq, interlock, alarm, systemDetect, bmsOK, thermMux, resetHandler, iwdg);
+    BMS::BMS bms(bqSettingsStorage, bq, i2cQueue, interlock, alarm, systemDetect, bmsOK, thermMux, resetHandler, iwdg);
 
     ///////////////////////////////////////////////////////////////////////////
     // Setup CAN configuration, this handles making drivers, applying settings.
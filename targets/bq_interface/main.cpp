@@ -318,8 +318,9 @@ void exitConfigMode(IO::UART& uart, BMS::DEV::BQ76952& bq) {
 
 void getTemperatures(IO::UART& uart, BMS::DEV::BQ76952& bq, BMS::DEV::ThermistorMux tMux) {
     for (uint8_t i = 0; i < 6; i++) {
-        uint16_t temp = tMux.getTemp(i);
-        uart.printf("Thermistor %d: %d.%03d\r\n", i, temp / 1000, temp % 1000);
+        int16_t temp = tMux.getTemp(i);
+        uint16_t magnitude = temp < 0 ? -temp : temp;
+        uart.printf("Thermistor %d: %s%d.%01d\r\n", i, temp < 0 ? "-" : "", magnitude / 10, magnitude % 10);
     }
     uint16_t result;
     bq.makeDirectRead(0x68, &result);
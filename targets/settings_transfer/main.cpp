@@ -1,6 +1,7 @@
 /**
  * This test is to explore the ability to transfer settings from EEPROM to the
- * BQ chip.
+ * BQ chip. Settings are transferred in blocks of contiguous RAM, and the time
+ * taken for the transfer is reported at the end.
  */
 
 #include <EVT/dev/storage/M24C32.hpp>
@@ -36,9 +37,16 @@ int main() {
     BMS::BQSettingsStorage settingsStorage(eeprom, bq);
 
     bool isComplete = false;
+    uint32_t numBlocks = 0;
+    uint32_t numFailures = 0;
     settingsStorage.resetTransfer();
+    uint32_t startTime = EVT::core::time::millis();
     while (!isComplete) {
-        auto status = settingsStorage.transferSetting(isComplete);
+        auto status = settingsStorage.transferBlock(isComplete);
+        numBlocks++;
+        if (status != BMS::DEV::BQ76952::Status::OK) {
+            numFailures++;
+        }
 
         switch (status) {
         case BMS::DEV::BQ76952::Status::ERROR:
@@ -59,7 +67,12 @@ int main() {
         }
     }
 
+    uint32_t elapsedTime = EVT::core::time::millis() - startTime;
+
     EVT::core::time::wait(500);
 
-    uart.printf("Setting transfer complete");
+    uart.printf("Setting transfer complete\r\n");
+    uart.printf("Settings: %u, blocks: %u, failed blocks: %u\r\n",
+                settingsStorage.getNumSettings(), numBlocks, numFailures);
+    uart.printf("Transfer time: %u ms\r\n", elapsedTime);
 }
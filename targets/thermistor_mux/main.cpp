@@ -35,6 +35,7 @@ int main() {
     time::wait(500);
 
     while (1) {
+        // Temperature in 0.1 C
         uart.printf("%d\r\n", thermistorMux.getTemp(looper));
 
         looper = (looper + 1) % 8;
@@ -1,37 +1,65 @@
 /**
  * This utility target is used to upload settings to the BMS EEPROM via UART, so
  * they can then be transferred to the BQ chip.
+ *
+ * The settings image produced by `tools/bqsettings/run.py convert` is
+ * streamed by `tools/bqsettings/run.py upload` in CRC checked frames, a
+ * window of frames at a time, see BMS::SettingsUpload for the protocol. The
+ * header is only written to EEPROM once the whole image has been received
+ * and its CRC checks out, so an interrupted upload leaves no usable settings
+ * behind. The target keeps listening afterwards, so the upload can be run
+ * again.
 */
 
 #include <BMS.hpp>
+#include <BQSettingStorage.hpp>
 #include <EVT/dev/storage/M24C32.hpp>
 #include <EVT/manager.hpp>
+#include <SettingsUpload.hpp>
+#include <dev/BQ76952.hpp>
 
 namespace IO = EVT::core::IO;
 
+/**
+ * Link to the host over the UART
+ */
+class UARTLink : public BMS::SettingsUpload::Link {
+public:
+    explicit UARTLink(IO::UART& uart) : uart(uart) {}
+
+    bool isReadable() override {
+        return uart.isReadable();
+    }
+
+    uint8_t read() override {
+        return uart.read();
+    }
+
+    void write(uint8_t* bytes, uint8_t length) override {
+        uart.writeBytes(bytes, length);
+    }
+
+private:
+    IO::UART& uart;
+};
+
 int main() {
     // Initialize system
     EVT::core::platform::init();
 
-    IO::UART& uart = IO::getUART<BMS::BMS::UART_TX_PIN, BMS::BMS::UART_RX_PIN>(9600, true);
+    IO::UART& uart = IO::getUART<BMS::BMS::UART_TX_PIN, BMS::BMS::UART_RX_PIN>(
+        BMS::SettingsUpload::BAUD_RATE, true);
 
     IO::I2C& i2c = IO::getI2C<BMS::BMS::I2C_SCL_PIN, BMS::BMS::I2C_SDA_PIN>();
     EVT::core::DEV::M24C32 eeprom(0x57, i2c);
 
-    uart.printf("Test start\r\n");
-    uint8_t buf[2];
-    uart.readBytes(buf, 2);
-    uint16_t numSettings = (((uint16_t) buf[1]) << 8) + buf[0];
-    eeprom.writeHalfWord(0, numSettings);
-    uart.write(0);
-
-    uint8_t setBuf[7];
-    uint32_t address = 2;
-    for (uint16_t i = 0; i < numSettings; i++) {
-        uart.readBytes(setBuf, 7);
-        eeprom.writeBytes(address, setBuf, 7);
-        address += 7;
-        uart.write(0);
+    BMS::DEV::BQ76952 bq(i2c, 0x08);
+    BMS::BQSettingsStorage storage(eeprom, bq);
+
+    UARTLink link(uart);
+    BMS::SettingsUpload upload(link, storage);
+
+    while (true) {
+        upload.process();
     }
-    uart.printf("Done");
 }
@@ -4,6 +4,8 @@ logic.
 """
 from enum import Enum
 import struct
+from typing import List
+import zlib
 
 
 class BQSetting:
@@ -16,6 +18,12 @@ class BQSetting:
     # Size of each setting in bytes
     SETTING_SIZE = 7
 
+    # Address encodings of the stream format, each the number of address
+    # bytes
+    STREAM_ADDRESS_NEXT = 0
+    STREAM_ADDRESS_OFFSET = 1
+    STREAM_ADDRESS_ABSOLUTE = 2
+
     class BQSettingType(Enum):
         """
         BQSetting type, as defined in TODO: Add URL
@@ -191,3 +199,207 @@ class BQSetting:
         result += bytearray(self.data.to_bytes(4, 'little'))
 
         return result
+
+    def to_stream(self, next_address: int):
+        """
+        Convert the BQSetting into the stream format, where the setting only
+        takes the bytes it needs. Mirrors `BQSetting::toStream` in the BMS
+        firmware.
+
+        * Command byte: type in bits 0-1, number of bytes in bits 2-4 and
+          the address encoding in bits 5-6
+        * Address (0 to 2 bytes): none if the setting starts where the
+          previous one ends, a 1 byte offset from there, or the full address
+        * Data (number of bytes), little endian
+
+        :param next_address: Where the previous setting ends, its address
+                             plus its number of bytes, 0 for the first
+        :return: Tuple of the bytes of the setting and where it ends
+        """
+        offset = self.address - next_address
+        if offset == 0:
+            address_mode = BQSetting.STREAM_ADDRESS_NEXT
+            address = b''
+        elif 0 < offset <= 0xFF:
+            address_mode = BQSetting.STREAM_ADDRESS_OFFSET
+            address = bytes([offset])
+        else:
+            address_mode = BQSetting.STREAM_ADDRESS_ABSOLUTE
+            address = self.address.to_bytes(2, 'little')
+
+        command_byte = (address_mode << 5 | self.num_bytes << 2
+                        | self.setting_type.value)
+        data = (self.data & ((1 << 8 * self.num_bytes) - 1)).to_bytes(
+            self.num_bytes, 'little')
+        return (bytes([command_byte]) + address + data,
+                (self.address + self.num_bytes) & 0xFFFF)
+
+    @staticmethod
+    def from_stream(data: bytes, offset: int, next_address: int):
+        """
+        Parse the setting at the given offset of a stream. Performs the
+        opposite logic as `to_stream`.
+
+        :param data: The settings in the stream format
+        :param offset: Offset of the setting in data
+        :param next_address: Where the previous setting ends
+        :return: Tuple of the parsed BQSetting, the offset of the next
+                 setting and where this setting ends
+        :raises ValueError: If the setting is not valid
+        """
+        command_byte = data[offset]
+        num_bytes = command_byte >> 2 & 0x7
+        address_mode = command_byte >> 5 & 0x3
+        if num_bytes > 4 or address_mode > BQSetting.STREAM_ADDRESS_ABSOLUTE:
+            raise ValueError('Invalid setting at offset {}'.format(offset))
+
+        end = offset + 1 + address_mode + num_bytes
+        if end > len(data):
+            raise ValueError('Setting at offset {} is cut short'.format(
+                offset))
+
+        address_bytes = data[offset + 1:offset + 1 + address_mode]
+        if address_mode == BQSetting.STREAM_ADDRESS_NEXT:
+            address = next_address
+        elif address_mode == BQSetting.STREAM_ADDRESS_OFFSET:
+            address = (next_address + address_bytes[0]) & 0xFFFF
+        else:
+            address = int.from_bytes(address_bytes, 'little')
+
+        setting = BQSetting(BQSetting.BQSettingType(command_byte & 0x3),
+                            num_bytes, address,
+                            int.from_bytes(data[end - num_bytes:end],
+                                           'little'))
+        return setting, end, (address + num_bytes) & 0xFFFF
+
+
+class SettingsHeader:
+    """
+    Header that starts the settings image stored in the BMS EEPROM. Mirrors
+    `BQSettingsStorage::Header` in the BMS firmware. The header is 16 bytes,
+    stored little endian as
+
+    * Magic number (2 bytes), `SettingsHeader.MAGIC`
+    * Format version (1 byte), `SettingsHeader.STREAM_VERSION` with the
+      stream flag, `SettingsHeader.VERSION` otherwise
+    * Flags (1 byte), `SettingsHeader.FLAG_BLOCK_CRC` and
+      `SettingsHeader.FLAG_STREAM`
+    * Number of settings (2 bytes)
+    * Size of the settings in bytes (2 bytes) with the stream flag, 0
+      otherwise
+    * CRC32 of all settings (4 bytes)
+    * CRC32 of the 12 bytes above (4 bytes)
+
+    The settings follow the header back to back, each in the format of
+    `BQSetting.to_stream` with the stream flag, or in the fixed 7 byte
+    format of `BQSetting.to_binary` otherwise. When the block CRC flag is
+    set, the settings are followed by the CRC32 of each
+    `SettingsHeader.CRC_BLOCK_SIZE` bytes of settings.
+    """
+
+    MAGIC = 0x5342
+    VERSION = 1
+    STREAM_VERSION = 2
+    SIZE = 16
+    FLAG_BLOCK_CRC = 0x01
+    FLAG_STREAM = 0x02
+    CRC_BLOCK_SETTINGS = 32
+    CRC_BLOCK_SIZE = CRC_BLOCK_SETTINGS * BQSetting.SETTING_SIZE
+
+    def __init__(self, num_settings: int, flags: int, image_crc: int,
+                 settings_size: int = None):
+        """
+        Create a settings header
+
+        :param num_settings: The number of settings in the image
+        :param flags: Combination of the FLAG_* values
+        :param image_crc: CRC32 of all settings in the image
+        :param settings_size: Size of the settings in bytes, defaults to the
+                              size in the fixed format
+        """
+        self.num_settings = num_settings
+        self.flags = flags
+        self.image_crc = image_crc
+        if settings_size is None:
+            settings_size = num_settings * BQSetting.SETTING_SIZE
+        self.settings_size = settings_size
+
+    def to_binary(self) -> bytes:
+        """
+        Convert the header into its binary format
+
+        :return: The 16 byte header
+        """
+        if self.flags & SettingsHeader.FLAG_STREAM:
+            version = SettingsHeader.STREAM_VERSION
+            settings_size = self.settings_size
+        else:
+            version = SettingsHeader.VERSION
+            settings_size = 0
+        result = struct.pack('<HBBHHI', SettingsHeader.MAGIC, version,
+                             self.flags, self.num_settings, settings_size,
+                             self.image_crc)
+        return result + struct.pack('<I', zlib.crc32(result))
+
+    @staticmethod
+    def from_binary(data: bytes):
+        """
+        Parse and validate the header at the start of a settings image
+
+        :param data: The settings image, or at least its first 16 bytes
+        :return: The parsed header
+        :raises ValueError: If the header is not valid
+        """
+        if len(data) < SettingsHeader.SIZE:
+            raise ValueError('Settings image is too short for a header')
+
+        magic, version, flags, num_settings, settings_size, image_crc, \
+            header_crc = struct.unpack('<HBBHHII',
+                                       data[:SettingsHeader.SIZE])
+        if magic != SettingsHeader.MAGIC:
+            raise ValueError('Settings image has the wrong magic number')
+        is_stream = flags & SettingsHeader.FLAG_STREAM
+        if version != (SettingsHeader.STREAM_VERSION if is_stream
+                       else SettingsHeader.VERSION):
+            raise ValueError('Unsupported settings format version {}'.format(
+                version))
+        if header_crc != zlib.crc32(data[:SettingsHeader.SIZE - 4]):
+            raise ValueError('Settings header CRC mismatch')
+
+        return SettingsHeader(num_settings, flags, image_crc,
+                              settings_size if is_stream else None)
+
+
+def build_image(settings: List[BQSetting], block_crc: bool = False,
+                stream: bool = True) -> bytes:
+    """
+    Build the settings image, as stored in the BMS EEPROM, from a list of
+    settings. See `SettingsHeader` for the format. The settings keep their
+    order, the BQ is written in the order of the image.
+
+    :param settings: The settings to store
+    :param block_crc: Whether to append the CRC32 of each block of settings
+    :param stream: Whether to store the settings in the stream format, or
+                   in the fixed format older firmware expects
+    :return: The binary settings image
+    """
+    flags = SettingsHeader.FLAG_BLOCK_CRC if block_crc else 0
+    if stream:
+        flags |= SettingsHeader.FLAG_STREAM
+        body = b''
+        next_address = 0
+        for setting in settings:
+            encoded, next_address = setting.to_stream(next_address)
+            body += encoded
+    else:
+        body = b''.join(bytes(setting.to_binary()) for setting in settings)
+    header = SettingsHeader(len(settings), flags, zlib.crc32(body),
+                            len(body))
+
+    image = header.to_binary() + body
+    if block_crc:
+        block_size = SettingsHeader.CRC_BLOCK_SIZE
+        for offset in range(0, len(body), block_size):
+            image += struct.pack('<I',
+                                 zlib.crc32(body[offset:offset + block_size]))
+    return image
@@ -9,7 +9,7 @@ format which is a CSV of just the settings.
 import argparse
 import os
 import sys
-from common import BQSetting
+from common import BQSetting, build_image
 import pathlib
 from typing import List
 import serial
@@ -61,17 +61,21 @@ def save_to_csv(file_path: str, settings: List[BQSetting]) -> None:
             csv_file.write(setting.to_csv() + '\n')
 
 
-def save_to_binary(file_path: str, settings: List[BQSetting]) -> None:
+def save_to_binary(file_path: str, settings: List[BQSetting],
+                   block_crc: bool = False, stream: bool = True) -> None:
     """
-    Save the provided settings into a binary format. The data will have all
-    the settings listed back-to-back. See TODO: Add URL for more details
+    Save the provided settings into a binary format. The data is the settings
+    image as stored in the BMS EEPROM, a header with the number of settings
+    and their CRC followed by the settings back-to-back. See `SettingsHeader`
+    in common.py for more details
 
     :param file_path: The path to the file to write out the binary data
     :param settings: The list of settings to convert
+    :param block_crc: Whether to also store a CRC for each block of settings
+    :param stream: Whether to store the settings in the stream format
     """
     with open(file_path, 'wb') as binary_file:
-        for setting in settings:
-            binary_file.write(setting.to_binary())
+        binary_file.write(build_image(settings, block_crc, stream))
 
 
 def is_ti_file(file_path: str) -> bool:
@@ -96,7 +100,7 @@ def convert_to_binary(args: argparse.Namespace):
         settings = load_from_ti(args.input)
     else:
         settings = load_from_csv(args.input)
-    save_to_binary(args.output, settings)
+    save_to_binary(args.output, settings, args.block_crc, not args.fixed)
 
 
 def convert_to_csv(args: argparse.Namespace):
@@ -129,6 +133,10 @@ def convert(args: argparse.Namespace):
       intermediate CSV file or the final binary file
     * target (defaults to binary): The target output format, either binary
       or CSV
+    * block_crc (defaults to False): Whether the binary output includes a
+      CRC for each block of settings
+    * fixed (defaults to False): Whether the binary output stores the
+      settings in the fixed 7 byte format, for older firmware
     """
     # Validate the input file exists
     if not os.path.exists(args.input):
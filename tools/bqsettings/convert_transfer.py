@@ -7,8 +7,9 @@ only supports transfer over UART
 import argparse
 import os
 import sys
-from common import BQSetting
+from common import BQSetting, build_image
 from convert import load_from_ti
+from upload import upload_image, BAUD_RATE
 import pathlib
 from typing import List
 import serial
@@ -16,27 +17,22 @@ import serial
 
 def ti_to_uart(file_path: str, port_name: str) -> None:
     """
-    Load a list of the BQSettings from a TI file, and write the settings
-    to the BMS over the given serial port.
+    Load a list of the BQSettings from a TI file, and upload the settings
+    image to the BMS over the given serial port.
+
+    The image is streamed to the `uart_settings_upload` target, see
+    `upload.py`.
 
     :param file_path: Path to the TI file to parse.
     :param port_name: Port that the BMS is connected to.
     """
     settings = load_from_ti(file_path)
+    image = build_image(settings)
 
-    stm = serial.Serial(port_name)
-    stm.write(len(settings).to_bytes(2, 'little'))
-
-    for setting in settings:
-        val = stm.read()
-        if val != b'\0':
-            print(val)
+    with serial.Serial(port_name, BAUD_RATE) as stm:
+        if not upload_image(stm, image):
             print("STM failure")
             return
-
-        byte_arr = setting.to_binary()
-        stm.write(byte_arr)
-        print(byte_arr)
     print("Complete")
 
 
@@ -9,6 +9,7 @@ intermidate steps in order to perform edits to the converted format.
 from argparse import ArgumentParser
 from convert import convert
 from transfer import transfer
+from upload import upload, BAUD_RATE
 from convert_transfer import convert_transfer
 
 
@@ -35,6 +36,14 @@ def main():
                                 help='''The target format, either binary or
                                 CSV, defaults to binary''', default='binary',
                                 choices=['binary', 'csv'])
+    convert_parser.add_argument('--block-crc', action='store_true',
+                                help='''Also store a CRC for each block of
+                                settings in the binary output, so a corrupted
+                                block can be located''')
+    convert_parser.add_argument('--fixed', action='store_true',
+                                help='''Store the settings in the fixed 7
+                                byte format instead of the stream format, for
+                                firmware older than the stream format''')
 
     # Arguments for the transfer command
     transfer_parser = subparsers.add_parser('transfer')
@@ -46,6 +55,18 @@ def main():
     transfer_parser.add_argument('bms_node', action='store', type=int,
                                  help='The CANopen node of the BMS')
 
+    # Arguments for the upload command
+    upload_parser = subparsers.add_parser('upload', help='''Command to stream
+                                          the binary file to the BMS running
+                                          the uart_settings_upload target''')
+    upload_parser.add_argument('input', action='store', help='''The binary
+                               file containing the settings to upload''')
+    upload_parser.add_argument('port', action='store', help='''Serial port
+                               connected to the BMS''')
+    upload_parser.add_argument('--baud', action='store', type=int,
+                               default=BAUD_RATE, help='''Baud rate of the
+                               serial port''')
+
     # Arguments for the convert-transfer command
     transfer_parser = subparsers.add_parser('convert_transfer')
     transfer_parser.add_argument('input', action='store', help='''The TI file 
@@ -59,6 +80,8 @@ def main():
         convert(args)
     elif args.command == 'transfer':
         transfer(args)
+    elif args.command == 'upload':
+        upload(args)
     else:
         convert_transfer(args)
 
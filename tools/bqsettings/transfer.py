@@ -1,7 +1,7 @@
 """
-Utility for transfering the binary representation of the setting over to the
-BMS. The binary transfer utility assumes a serial communication with an
-Arudino that is running the provided script.
+Utility for transfering the binary settings image over to the BMS. The whole
+image, header included, is downloaded over CANopen in a single SDO block
+download, the BMS checks the image against its header once it is complete.
 
 The binary file can also be sent over to the BMS via other methods including
 using the SDO file transfer logic of the Vector CAN.
@@ -11,33 +11,37 @@ using the SDO file transfer logic of the Vector CAN.
 import argparse
 import os
 import sys
-from common import BQSetting
+from common import SettingsHeader
 import canopen
 import struct
 
+# Object of the settings image on the BMS, subindex 1 takes the image and
+# subindex 2 holds the number of settings stored
+BQ_SETTINGS_INDEX = 0x2114
 
-def get_num_settings(binary_file: str) -> int:
+
+def get_num_settings(settings_bin: bytes) -> int:
     """
-    Determine the number of settings contained in the binary file. It is
-    understood that the binary file only contains the settings and that the
-    settings are each 7 bytes in size.
+    Determine the number of settings contained in the binary settings image
+    from its header.
 
-    :param binary_file: The file containing the settings in binary form
+    :param settings_bin: The settings image in binary form
     """
-    return int(os.path.getsize(binary_file) / BQSetting.SETTING_SIZE)
+    return SettingsHeader.from_binary(settings_bin).num_settings
 
 
 def transfer(args: argparse.Namespace):
     """
-    Handles the logic of transfering the binary data over a serial connection
-    to the Arduino running the provided code.
+    Handles the logic of downloading the binary settings image to the BMS
+    over CANopen.
 
     Expected Arguments
     ==================
     From `run.py`, the args will include
 
     * input (required): The binary file to transfer
-    * port (required): The serial port of the Arduino
+    * port (required): The serial port of the SLcan device
+    * bms_node (required): The CANopen node of the BMS
     """
     if not os.path.exists(args.input):
         print('Input file: {}, does not exist'.format(args.input),
@@ -51,16 +55,29 @@ def transfer(args: argparse.Namespace):
     # Make an SDO client for communicating with the BMS
     # TODO: Once we have EDS for the BMS, this None will be replaced with
     #       a path to the EDS
-    node = network.add_node(5, None)
+    node = network.add_node(args.bms_node, None)
     client = node.sdo
 
     # Read in all bytes of the data
     with open(args.input, 'rb') as input_file:
         settings_bin = input_file.read()
 
-    # Transfer the number of settings over
-    client.download(0x2100, 0x0,
-                    struct.pack('<H', get_num_settings(args.input)))
+    # Download the whole image, a block download only waits for the BMS once
+    # every 127 segments. A BMS which aborts block transfers gets a
+    # segmented download, which restarts the image from the start.
+    try:
+        with client.open(BQ_SETTINGS_INDEX, 1, 'wb', size=len(settings_bin),
+                         block_transfer=True) as image:
+            image.write(settings_bin)
+    except canopen.SdoAbortedError:
+        client.download(BQ_SETTINGS_INDEX, 1, settings_bin)
+
+    num_settings = get_num_settings(settings_bin)
+    stored = struct.unpack('<H', client.upload(BQ_SETTINGS_INDEX, 2))[0]
+    if stored != num_settings:
+        print('BMS stored {} settings, expected {}'.format(stored,
+              num_settings), file=sys.stderr)
+        exit(1)
+    print('Transferred {} settings'.format(stored))
 
-    # Transfer the settings themselves
-    client.download(0x2100, 0x1, settings_bin)
+    network.disconnect()
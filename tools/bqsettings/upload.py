@@ -0,0 +1,141 @@
+"""
+Utility for uploading the binary settings image to the BMS over UART, to the
+`uart_settings_upload` target. The image is streamed in CRC checked frames,
+a window of frames at a time, and the BMS answers each window with the
+frame it expects next, see `SettingsUpload.hpp` for the protocol.
+"""
+import argparse
+import os
+import struct
+import sys
+import zlib
+import serial
+
+DATA_SOF = 0xA5
+RESPONSE_SOF = 0x5A
+MAX_PAYLOAD = 64
+WINDOW_FRAMES = 8
+FLAG_END_OF_WINDOW = 0x01
+RESPONSE_SIZE = 8
+BAUD_RATE = 115200
+
+STATUS_CONTINUE = 0
+STATUS_DONE = 1
+STATUS_REJECTED = 2
+
+# Time to wait for the response to a window, which includes the EEPROM
+# writes of the window
+RESPONSE_TIMEOUT = 1.0
+
+# Number of windows in a row which may go unanswered or make no progress
+MAX_RETRIES = 5
+
+
+def encode_frame(sequence: int, payload: bytes, end_of_window: bool) -> bytes:
+    """
+    Make a data frame
+
+    :param sequence: Sequence number of the frame
+    :param payload: Bytes of the image carried by the frame
+    :param end_of_window: True for the last frame sent before a response
+    :return: The frame
+    """
+    flags = FLAG_END_OF_WINDOW if end_of_window else 0
+    body = struct.pack('<HBB', sequence, flags, len(payload)) + payload
+    return bytes([DATA_SOF]) + body + struct.pack('<I', zlib.crc32(body))
+
+
+def read_response(stm: serial.Serial):
+    """
+    Wait for the response to a window, skipping anything else on the line
+
+    :param stm: The serial port of the BMS
+    :return: Tuple of the status and the next sequence number expected, None
+             if no valid response came in time
+    """
+    while True:
+        start = stm.read(1)
+        if not start:
+            return None
+        if start[0] != RESPONSE_SOF:
+            continue
+
+        response = stm.read(RESPONSE_SIZE - 1)
+        if len(response) < RESPONSE_SIZE - 1:
+            return None
+        status, sequence, crc = struct.unpack('<BHI', response)
+        if zlib.crc32(response[:3]) == crc:
+            return status, sequence
+
+
+def upload_image(stm: serial.Serial, image: bytes) -> bool:
+    """
+    Upload a settings image
+
+    :param stm: The serial port of the BMS
+    :param image: The settings image
+    :return: True if the BMS stored the image
+    """
+    payloads = [image[offset:offset + MAX_PAYLOAD]
+                for offset in range(0, len(image), MAX_PAYLOAD)]
+    stm.timeout = RESPONSE_TIMEOUT
+    stm.reset_input_buffer()
+
+    base = 0
+    retries = 0
+    windows = 0
+    while retries <= MAX_RETRIES:
+        end = min(base + WINDOW_FRAMES, len(payloads))
+        stm.write(b''.join(encode_frame(sequence, payloads[sequence],
+                                        sequence == end - 1)
+                           for sequence in range(base, end)))
+        windows += 1
+
+        response = read_response(stm)
+        if response is None:
+            retries += 1
+            continue
+
+        status, sequence = response
+        if status == STATUS_DONE:
+            print('Uploaded {} bytes in {} windows'.format(len(image),
+                                                          windows))
+            return True
+        if status == STATUS_REJECTED:
+            print('BMS rejected the image', file=sys.stderr)
+            return False
+        if sequence >= len(payloads):
+            print('BMS did not accept the complete image', file=sys.stderr)
+            return False
+
+        retries = retries + 1 if sequence <= base else 0
+        base = sequence
+
+    print('No progress from the BMS', file=sys.stderr)
+    return False
+
+
+def upload(args: argparse.Namespace):
+    """
+    Entry point into the upload logic, the arguments are the parsed command
+    line arguments that are handled in `run.py`.
+
+    Expected Arguments
+    ==================
+    From `run.py`, the args will include
+
+    * input (required): The binary file to upload
+    * port (required): The serial port connected to the BMS
+    * baud (optional): The baud rate of the serial port
+    """
+    if not os.path.exists(args.input):
+        print('Input file: {}, does not exist'.format(args.input),
+              file=sys.stderr)
+        exit(1)
+
+    with open(args.input, 'rb') as input_file:
+        image = input_file.read()
+
+    with serial.Serial(args.port, args.baud) as stm:
+        if not upload_image(stm, image):
+            exit(1)
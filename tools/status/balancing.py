@@ -1,11 +1,16 @@
 """
 Script to interact with the balancing functionality of the BMS. Has the ability
 to get the current state of balancing and set balancing on sepcific cells.
+Setting a cell takes over from the automatic balancing of the BMS until the
+automatic balancing is turned back on.
 """
 import canopen
 from argparse import ArgumentParser
 import struct
 
+BALANCING_INDEX = 0x2107
+AUTOMATIC_SUB_INDEX = 13
+
 
 def main():
     argparser = ArgumentParser(description='''Utility to get the current state
@@ -15,20 +20,25 @@ def main():
                            BMS''')
     argparser.add_argument('node', action='store', type=int, help='''The
                            CANopen node ID of the BMS''')
-    argparser.add_argument('cell', action='store', type=int, help='''The
-                           cell index to check/set balancing of with 1 indexing
-                           ''')
 
     subparsers = argparser.add_subparsers(dest='cmd', required=True)
 
     poll_parser = subparsers.add_parser('poll', help='''Poll the state of
                                         balancing of a cell''')
+    poll_parser.add_argument('cell', action='store', type=int, help='''The
+                             cell index to check balancing of with 1 indexing
+                             ''')
 
     set_parser = subparsers.add_parser('set', help='''Set the state of
                                         balancing of a cell''')
+    set_parser.add_argument('cell', action='store', type=int, help='''The
+                            cell index to set balancing of with 1 indexing''')
     set_parser.add_argument('state', action='store', type=int, help='''0
                             for disabling balancing, 1 for balancing''')
 
+    subparsers.add_parser('auto', help='''Hand balancing back to the
+                          BMS''')
+
     args = argparser.parse_args()
 
     network = canopen.Network()
@@ -37,13 +47,15 @@ def main():
     node = network.add_node(args.node, None)
     client = node.sdo
 
-
     if args.cmd == 'poll':
-        state = struct.unpack('<B', client.upload(0x2103, args.cell))[0]
+        state = struct.unpack('<B', client.upload(BALANCING_INDEX, args.cell))[0]
         print('Cell {} is balancing: {}'.format(args.cell, state))
-    else:
-        client.download(0x2103, args.cell, struct.pack('<B', args.state))
+    elif args.cmd == 'set':
+        client.download(BALANCING_INDEX, args.cell, struct.pack('<B', args.state))
         print('Cell {} balancin set to: {}'.format(args.cell, args.state))
+    else:
+        client.download(BALANCING_INDEX, AUTOMATIC_SUB_INDEX, struct.pack('<B', 1))
+        print('Balancing handed back to the BMS')
 
     network.disconnect()
 
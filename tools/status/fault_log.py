@@ -0,0 +1,67 @@
+"""
+Script to download the fault log of the BMS and print it as CSV. The fault
+log is kept in EEPROM and holds a snapshot of the BMS for each of the last
+few faults, so it survives a reset of the BMS.
+"""
+import canopen
+from argparse import ArgumentParser
+import binascii
+import struct
+
+FAULT_LOG_INDEX = 0x2113
+
+RECORD_SIZE = 32
+RECORD_FORMAT = '<IIBB7BhBhBhBBx'
+
+COLUMNS = (['sequence', 'time', 'state', 'errorRegister'] +
+           ['bqStatus{}'.format(i) for i in range(7)] +
+           ['minCellVoltage', 'minCellVoltageId', 'maxCellVoltage',
+            'maxCellVoltageId', 'current', 'maxPackTemp', 'maxPackTempId'])
+
+
+def decode_log(log):
+    """
+    Decode the fault log into records
+
+    :param log: The downloaded log
+    :return: List of records, oldest first, each a list of the fields
+    """
+    records = []
+    for offset in range(0, len(log), RECORD_SIZE):
+        record = log[offset:offset + RECORD_SIZE]
+        crc = struct.unpack_from('<I', record, RECORD_SIZE - 4)[0]
+        if binascii.crc32(record[:RECORD_SIZE - 4]) != crc:
+            raise ValueError('Bad CRC in record at offset {}'.format(offset))
+        records.append(list(struct.unpack_from(RECORD_FORMAT, record, 0)))
+    return records
+
+
+def main():
+    argparser = ArgumentParser(description='''Utility to download the fault
+                               log of the BMS''')
+    argparser.add_argument('port', action='store', type=str, help='''The
+                           port of the can device to interface with the
+                           BMS''')
+    argparser.add_argument('node', action='store', type=int, help='''The
+                           CANopen node ID of the BMS''')
+    args = argparser.parse_args()
+
+    network = canopen.Network()
+    network.connect(channel=args.port, bustype='slcan')
+
+    node = network.add_node(args.node, None)
+    client = node.sdo
+
+    log = client.upload(FAULT_LOG_INDEX, 1)
+    num_events = struct.unpack('<I', client.upload(FAULT_LOG_INDEX, 2))[0]
+
+    print(','.join(COLUMNS))
+    for record in decode_log(log):
+        print(','.join(str(value) for value in record))
+    print('{} fault events logged in total'.format(num_events))
+
+    network.disconnect()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,118 @@
+"""
+Script to download the telemetry log of the BMS and print it as CSV. The log
+holds the last few seconds of pack telemetry and is frozen when the BMS
+detects a fault. Downloading the log freezes it as well, use --rearm to start
+recording again afterwards.
+"""
+import canopen
+from argparse import ArgumentParser
+import struct
+
+TELEMETRY_LOG_INDEX = 0x2112
+FORMAT_VERSION = 1
+
+NUM_CELLS = 12
+NUM_TEMPS = 9
+NUM_STATUS = 7
+NUM_FIELDS = NUM_CELLS + 1 + NUM_TEMPS + NUM_STATUS + 1
+
+COLUMNS = (['time'] + ['cell{}'.format(i + 1) for i in range(NUM_CELLS)] +
+           ['current'] + ['therm{}'.format(i) for i in range(6)] +
+           ['bqInternal', 'bqTemp1', 'bqTemp2'] +
+           ['bqStatus{}'.format(i) for i in range(NUM_STATUS)] +
+           ['errorRegister'])
+
+
+def get_varint(data, offset):
+    """
+    Read a varint, 7 bits per byte with the least significant group first
+
+    :param data: The bytes to read from
+    :param offset: Offset of the varint
+    :return: The value and the offset after the varint
+    """
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, offset
+
+
+def decode_log(log):
+    """
+    Decode the telemetry log into samples
+
+    :param log: The downloaded log
+    :return: List of samples, each a list of the time followed by the fields
+    """
+    if log[0] != FORMAT_VERSION:
+        raise ValueError('Unsupported log format {}'.format(log[0]))
+
+    num_blocks = log[1]
+    offset = 4
+    samples = []
+
+    for _ in range(num_blocks):
+        length = struct.unpack_from('<H', log, offset)[0]
+        block = log[offset + 2:offset + 2 + length]
+        offset += 2 + length
+
+        # Keyframe, every value of the sample
+        keyframe = struct.unpack_from('<I{}Hh{}B'.format(
+            NUM_CELLS, NUM_FIELDS - NUM_CELLS - 1), block, 0)
+        time = keyframe[0]
+        fields = list(keyframe[1:])
+        samples.append([time] + fields)
+        position = struct.calcsize('<I{}Hh{}B'.format(
+            NUM_CELLS, NUM_FIELDS - NUM_CELLS - 1))
+
+        # Deltas, the changed fields as zigzag differences
+        while position < length:
+            delta, position = get_varint(block, position)
+            time += delta
+            changed, position = get_varint(block, position)
+            for i in range(NUM_FIELDS):
+                if changed & (1 << i):
+                    zigzag, position = get_varint(block, position)
+                    fields[i] += (zigzag >> 1) ^ -(zigzag & 1)
+            samples.append([time] + fields)
+
+    return samples
+
+
+def main():
+    argparser = ArgumentParser(description='''Utility to download the
+                               telemetry log of the BMS''')
+    argparser.add_argument('port', action='store', type=str, help='''The
+                           port of the can device to interface with the
+                           BMS''')
+    argparser.add_argument('node', action='store', type=int, help='''The
+                           CANopen node ID of the BMS''')
+    argparser.add_argument('--rearm', action='store_true', help='''Start
+                           recording again after the download''')
+    args = argparser.parse_args()
+
+    network = canopen.Network()
+    network.connect(channel=args.port, bustype='slcan')
+
+    node = network.add_node(args.node, None)
+    client = node.sdo
+
+    log = client.upload(TELEMETRY_LOG_INDEX, 1)
+
+    print(','.join(COLUMNS))
+    for sample in decode_log(log):
+        print(','.join(str(value) for value in sample))
+
+    if args.rearm:
+        client.download(TELEMETRY_LOG_INDEX, 2, bytes([0]))
+
+    network.disconnect()
+
+
+if __name__ == '__main__':
+    main()